@@ -0,0 +1,1343 @@
+#include "LatencyHistogram.h"
+#include "EchoEngine.h"
+#include "EchoFrame.h"
+#include "EchoLog.h"
+
+// printf, fprintf
+#include <stdio.h>
+
+// atoi, strtol, exit
+#include <stdlib.h>
+
+// memcpy, strcmp, strerror
+#include <string.h>
+
+// errno
+#include <errno.h>
+
+// offsetof
+#include <stddef.h>
+
+// getopt_long
+#include <getopt.h>
+
+// close, usleep, syscall
+#include <unistd.h>
+
+// clock_gettime
+#include <time.h>
+
+// pthread_create
+#include <pthread.h>
+
+// fcntl
+#include <fcntl.h>
+
+// opendir, readdir
+#include <dirent.h>
+
+// socket, connect, send, recv
+#include <sys/types.h>
+#include <sys/socket.h>
+
+// sockaddr_in
+#include <netinet/in.h>
+
+// TCP_NODELAY
+#include <netinet/tcp.h>
+
+// inet_pton
+#include <arpa/inet.h>
+
+// sockaddr_un
+#include <sys/un.h>
+
+// epoll
+#include <sys/epoll.h>
+
+// SYS_perf_event_open
+#include <sys/syscall.h>
+
+// perf_event_attr
+#include <linux/perf_event.h>
+
+// std::atomic
+#include <atomic>
+
+// std::vector
+#include <vector>
+
+/*
+ * Load generator for the echo servers. The servers run in this
+ * process from the echo engine of the app, without a Java virtual
+ * machine, and the clients keep
+ * a number of messages in flight on each connection over the
+ * loopback interface. Each message carries its send time, the
+ * echo gives the round trip latency.
+ */
+
+// Messages start with the send time, framed ones after the header
+#define MIN_MESSAGE_SIZE ((int) sizeof(int64_t))
+
+// Largest datagram over IPv4
+#define MAX_DATAGRAM_SIZE 65507
+
+// Bytes a client receives at once from a stream
+#define BENCH_RECEIVE_SIZE 65536
+
+// Events a client handles at once
+#define MAX_BENCH_EVENTS 64
+
+// Poll timeout of the clients in milliseconds
+#define BENCH_POLL_TIMEOUT 10
+
+// Datagrams without an echo for this long are lost, in nanoseconds
+#define DATAGRAM_LOSS_TIMEOUT 200000000LL
+
+// How long to wait for the server to come up, in milliseconds
+#define SERVER_START_TIMEOUT 5000
+
+// Benchmark phases
+#define BENCH_WARMUP 0
+#define BENCH_MEASURE 1
+#define BENCH_STOP 2
+
+/**
+ * Transport of a server.
+ */
+enum BenchTransport
+{
+    BENCH_TCP,
+    BENCH_UDP,
+    BENCH_LOCAL,
+    BENCH_SHM
+};
+
+struct BenchServer;
+
+/**
+ * Benchmark options.
+ */
+struct BenchOptions
+{
+    const BenchServer* server;
+    const char* host;
+    int port;
+    const char* name;
+    int connections;
+    int messageSize;
+    int pipeline;
+    int duration;
+    int warmup;
+    int clientThreads;
+    int serverThreads;
+    int batchSize;
+    int bufferSize;
+    bool zeroCopy;
+    int logLevel;
+    bool external;
+};
+
+/**
+ * Server mode, the engine function serving the clients.
+ */
+struct BenchServer
+{
+    const char* mode;
+    void (*run)(const BenchOptions* options, std::error_code& error);
+    BenchTransport transport;
+
+    // False if the server accepts a single client only
+    bool multipleClients;
+
+    // Messages are sent as frames of the echo stream protocol
+    bool framed;
+};
+
+static void RunTcpServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunTcpEchoServer((unsigned short) options->port, error);
+}
+
+static void RunTcpReactorServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunTcpReactorEchoServer((unsigned short) options->port, error);
+}
+
+static void RunTcpFramedServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunTcpFramedEchoServer((unsigned short) options->port, error);
+}
+
+static void RunTcpMultiReactorServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunTcpMultiReactorEchoServer((unsigned short) options->port,
+            options->serverThreads, error);
+}
+
+static void RunTcpUringServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunTcpUringEchoServer((unsigned short) options->port, error);
+}
+
+static void RunUdpBatchServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunUdpBatchEchoServer((unsigned short) options->port,
+            options->batchSize, error);
+}
+
+static void RunUdpUringServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunUdpUringEchoServer((unsigned short) options->port, error);
+}
+
+static void RunLocalServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunLocalEchoServer(options->name, error);
+}
+
+static void RunLocalUringServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunLocalUringEchoServer(options->name, error);
+}
+
+static void RunLocalShmServer(const BenchOptions* options,
+        std::error_code& error)
+{
+    RunLocalShmEchoServer(options->name, error);
+}
+
+// The plain UDP server echoes a single datagram and is left out
+static const BenchServer gServers[] =
+{
+    { "tcp", RunTcpServer, BENCH_TCP, false, false },
+    { "tcp-reactor", RunTcpReactorServer, BENCH_TCP, true, false },
+    { "tcp-framed", RunTcpFramedServer, BENCH_TCP, true, true },
+    { "tcp-multi", RunTcpMultiReactorServer, BENCH_TCP, true, false },
+    { "tcp-uring", RunTcpUringServer, BENCH_TCP, true, false },
+    { "udp-batch", RunUdpBatchServer, BENCH_UDP, true, false },
+    { "udp-uring", RunUdpUringServer, BENCH_UDP, true, false },
+    { "local", RunLocalServer, BENCH_LOCAL, false, false },
+    { "local-uring", RunLocalUringServer, BENCH_LOCAL, true, false },
+    { "local-shm", RunLocalShmServer, BENCH_SHM, false, false },
+};
+
+/**
+ * Client connection.
+ */
+struct BenchConnection
+{
+    int sd;
+
+    // Messages that can be sent before an echo arrives
+    int credits;
+
+    // Bytes sent of the current message
+    int sendOffset;
+
+    // Bytes received of the current echo
+    int receiveOffset;
+
+    // Send time of the current echo
+    unsigned char stamp[sizeof(int64_t)];
+
+    // Offset of the send time in the message
+    int stampOffset;
+
+    // Waiting to be writable
+    bool writeBlocked;
+
+    // Last echo or resend time
+    long long activeTime;
+
+    char* message;
+
+    // Shared memory session instead of the socket
+    ShmEchoSession* session;
+};
+
+/**
+ * Client thread driving a share of the connections.
+ */
+struct BenchClient
+{
+    pthread_t thread;
+    const BenchOptions* options;
+    std::vector<BenchConnection*> connections;
+    int epollFd;
+    char* buffer;
+
+    // Results of the measure phase
+    LatencyHistogram histogram;
+    long long messages;
+    long long syscalls;
+    long long lost;
+
+    // Error number if the client failed
+    int error;
+};
+
+/**
+ * Per thread counters of the system call tracepoint.
+ */
+struct SyscallCounter
+{
+    std::vector<int> fds;
+};
+
+// Current benchmark phase
+static std::atomic<int> gPhase(BENCH_WARMUP);
+
+static long long GetMonotonicTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+// System calls are only counted while measuring
+static inline void CountSyscall(BenchClient* client)
+{
+    if (BENCH_MEASURE == gPhase.load(std::memory_order_relaxed))
+    {
+        client->syscalls++;
+    }
+}
+
+// Server log messages go to the standard error
+static FileLogSink gLogSink(stderr);
+
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -m, --mode MODE          server, one of", program);
+
+    for (size_t i = 0; i < sizeof(gServers) / sizeof(gServers[0]); i++)
+    {
+        fprintf(stderr, " %s", gServers[i].mode);
+    }
+
+    fprintf(stderr,
+            "\n"
+            "  -c, --connections N      connections (1)\n"
+            "  -s, --size BYTES         message size (64)\n"
+            "  -p, --pipeline N         messages in flight per connection (1)\n"
+            "  -d, --duration SECONDS   measured duration (10)\n"
+            "  -w, --warmup SECONDS     unmeasured warm up (2)\n"
+            "  -t, --threads N          client threads (1)\n"
+            "      --server-threads N   multi reactor threads, 0 for CPUs\n"
+            "      --batch N            datagrams per batch, 0 for default\n"
+            "      --buffer-size BYTES  server buffer size\n"
+            "      --zero-copy          splice the data in the servers\n"
+            "      --log-level LEVEL    server log level (3, warnings)\n"
+            "      --host ADDRESS       server address (127.0.0.1)\n"
+            "      --port PORT          server port (9000)\n"
+            "      --name NAME          local socket name (echo-bench)\n"
+            "      --external           connect to a running server\n");
+}
+
+// Gets the frame header size of a message, 0 if no frame has the size
+static int GetMessageHeaderSize(int size)
+{
+    // Header shrinks the payload, find the length that fits
+    for (int headerSize = 2; headerSize <= ECHO_FRAME_MAX_HEADER_SIZE;
+            headerSize++)
+    {
+        if ((int) GetEchoFrameLength((size_t) (size - headerSize)) == size)
+        {
+            return headerSize;
+        }
+    }
+
+    return 0;
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions* options)
+{
+    static const struct option longOptions[] =
+    {
+        { "mode", required_argument, NULL, 'm' },
+        { "connections", required_argument, NULL, 'c' },
+        { "size", required_argument, NULL, 's' },
+        { "pipeline", required_argument, NULL, 'p' },
+        { "duration", required_argument, NULL, 'd' },
+        { "warmup", required_argument, NULL, 'w' },
+        { "threads", required_argument, NULL, 't' },
+        { "server-threads", required_argument, NULL, 'T' },
+        { "batch", required_argument, NULL, 'b' },
+        { "buffer-size", required_argument, NULL, 'B' },
+        { "zero-copy", no_argument, NULL, 'z' },
+        { "log-level", required_argument, NULL, 'l' },
+        { "host", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'P' },
+        { "name", required_argument, NULL, 'n' },
+        { "external", no_argument, NULL, 'x' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    const char* mode = "tcp-reactor";
+
+    options->host = "127.0.0.1";
+    options->port = 9000;
+    options->name = "echo-bench";
+    options->connections = 1;
+    options->messageSize = 64;
+    options->pipeline = 1;
+    options->duration = 10;
+    options->warmup = 2;
+    options->clientThreads = 1;
+    options->serverThreads = 0;
+    options->batchSize = 0;
+    options->bufferSize = 0;
+    options->zeroCopy = false;
+    options->logLevel = LOG_LEVEL_WARN;
+    options->external = false;
+
+    int option;
+    while (-1 != (option = getopt_long(argc, argv, "m:c:s:p:d:w:t:h",
+            longOptions, NULL)))
+    {
+        switch (option)
+        {
+            case 'm': mode = optarg; break;
+            case 'c': options->connections = atoi(optarg); break;
+            case 's': options->messageSize = atoi(optarg); break;
+            case 'p': options->pipeline = atoi(optarg); break;
+            case 'd': options->duration = atoi(optarg); break;
+            case 'w': options->warmup = atoi(optarg); break;
+            case 't': options->clientThreads = atoi(optarg); break;
+            case 'T': options->serverThreads = atoi(optarg); break;
+            case 'b': options->batchSize = atoi(optarg); break;
+            case 'B': options->bufferSize = atoi(optarg); break;
+            case 'z': options->zeroCopy = true; break;
+            case 'l': options->logLevel = atoi(optarg); break;
+            case 'H': options->host = optarg; break;
+            case 'P': options->port = atoi(optarg); break;
+            case 'n': options->name = optarg; break;
+            case 'x': options->external = true; break;
+            default: return false;
+        }
+    }
+
+    options->server = NULL;
+    for (size_t i = 0; i < sizeof(gServers) / sizeof(gServers[0]); i++)
+    {
+        if (0 == strcmp(gServers[i].mode, mode))
+        {
+            options->server = &gServers[i];
+        }
+    }
+
+    if (NULL == options->server)
+    {
+        fprintf(stderr, "Unknown mode %s.\n", mode);
+        return false;
+    }
+
+    int maxMessageSize = (BENCH_UDP == options->server->transport)
+            ? MAX_DATAGRAM_SIZE : BENCH_RECEIVE_SIZE;
+
+    // Frames carry the send time after the largest header
+    int minMessageSize = options->server->framed
+            ? MIN_MESSAGE_SIZE + ECHO_FRAME_MAX_HEADER_SIZE
+            : MIN_MESSAGE_SIZE;
+
+    if ((options->messageSize < minMessageSize)
+            || (options->messageSize > maxMessageSize))
+    {
+        fprintf(stderr, "Message size must be between %d and %d.\n",
+                minMessageSize, maxMessageSize);
+        return false;
+    }
+
+    if (options->server->framed
+            && (0 == GetMessageHeaderSize(options->messageSize)))
+    {
+        fprintf(stderr, "No frame is %d bytes long.\n", options->messageSize);
+        return false;
+    }
+
+    if ((options->connections < 1) || (options->pipeline < 1)
+            || (options->duration < 1) || (options->warmup < 0)
+            || (options->clientThreads < 1))
+    {
+        fprintf(stderr, "Counts and durations must be positive.\n");
+        return false;
+    }
+
+    if (!options->server->multipleClients && (options->connections > 1))
+    {
+        fprintf(stderr, "The %s server accepts a single connection.\n",
+                options->server->mode);
+        return false;
+    }
+
+    if (options->clientThreads > options->connections)
+    {
+        options->clientThreads = options->connections;
+    }
+
+    return true;
+}
+
+/**
+ * Connects a new client socket to the server.
+ *
+ * @param options benchmark options.
+ * @return socket descriptor or -1 with errno set.
+ */
+static int ConnectClientSocket(const BenchOptions* options)
+{
+    BenchTransport transport = options->server->transport;
+    int sd;
+
+    if (BENCH_LOCAL == transport)
+    {
+        struct sockaddr_un address;
+        size_t nameLength = strlen(options->name);
+
+        if (nameLength + 1 > sizeof(address.sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        // Names without a slash are in the abstract namespace
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_LOCAL;
+
+        char* sunPath = address.sun_path;
+        if ('/' != options->name[0])
+        {
+            sunPath++;
+        }
+
+        memcpy(sunPath, options->name, nameLength);
+
+        socklen_t addressLength = (socklen_t) (
+                offsetof(struct sockaddr_un, sun_path)
+                + (sunPath - address.sun_path) + nameLength);
+
+        sd = socket(PF_LOCAL, SOCK_STREAM, 0);
+        if (-1 == sd)
+            return -1;
+
+        if (-1 == connect(sd, (struct sockaddr*) &address, addressLength))
+            goto fail;
+    }
+    else
+    {
+        struct sockaddr_in address;
+
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short) options->port);
+
+        if (1 != inet_pton(AF_INET, options->host, &address.sin_addr))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+
+        sd = socket(PF_INET,
+                (BENCH_UDP == transport) ? SOCK_DGRAM : SOCK_STREAM, 0);
+        if (-1 == sd)
+            return -1;
+
+        if (-1 == connect(sd, (struct sockaddr*) &address, sizeof(address)))
+            goto fail;
+
+        // Small messages are sent right away
+        if (BENCH_TCP == transport)
+        {
+            int noDelay = 1;
+            setsockopt(sd, IPPROTO_TCP, TCP_NODELAY,
+                    &noDelay, sizeof(noDelay));
+        }
+    }
+
+    return sd;
+
+fail:
+    int error = errno;
+    close(sd);
+    errno = error;
+
+    return -1;
+}
+
+/**
+ * Waits until a datagram is echoed, the server may not be bound
+ * yet when the benchmark starts.
+ *
+ * @param sd socket descriptor.
+ * @param message message to send.
+ * @param size message size.
+ * @return false if the server does not reply in time.
+ */
+static bool ProbeDatagramServer(int sd, char* message, int size)
+{
+    long long deadline = GetMonotonicTime()
+            + (SERVER_START_TIMEOUT * 1000000LL);
+
+    while (GetMonotonicTime() < deadline)
+    {
+        int64_t now = GetMonotonicTime();
+        memcpy(message, &now, sizeof(now));
+
+        // Refused until the server is bound
+        send(sd, message, (size_t) size, MSG_NOSIGNAL);
+
+        struct timeval timeout = { 0, 100000 };
+        setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        if (size == recv(sd, message, (size_t) size, 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Makes the message a binary frame of the given total size
+static int EncodeMessageFrame(char* message, int size)
+{
+    int headerSize = GetMessageHeaderSize(size);
+
+    EncodeEchoFrameHeader(ECHO_FRAME_BINARY,
+            (size_t) (size - headerSize), message);
+
+    return headerSize;
+}
+
+/**
+ * Opens a shared memory session, retrying until the server
+ * listens.
+ *
+ * @param options benchmark options.
+ * @return session or NULL with errno set.
+ */
+static ShmEchoSession* OpenShmSession(const BenchOptions* options)
+{
+    long long deadline = GetMonotonicTime()
+            + (SERVER_START_TIMEOUT * 1000000LL);
+
+    while (1)
+    {
+        std::error_code error;
+        ShmEchoSession* session = OpenShmEchoSession(options->name, error);
+
+        if (!error)
+            return session;
+
+        // Engine errors have no errno of their own
+        errno = (std::system_category() == error.category())
+                ? error.value() : EPROTO;
+
+        if (((ECONNREFUSED != errno) && (ENOENT != errno))
+                || (GetMonotonicTime() >= deadline))
+            return NULL;
+
+        usleep(10000);
+    }
+}
+
+/**
+ * Opens the connections to the server, retrying the first one
+ * until the server accepts.
+ *
+ * @param options benchmark options.
+ * @param connections opened connections.
+ * @return false if failed, errno is set.
+ */
+static bool OpenConnections(
+        const BenchOptions* options,
+        std::vector<BenchConnection*>* connections)
+{
+    long long deadline = GetMonotonicTime()
+            + (SERVER_START_TIMEOUT * 1000000LL);
+
+    for (int i = 0; i < options->connections; i++)
+    {
+        // Messages go through the shared memory rings
+        if (BENCH_SHM == options->server->transport)
+        {
+            ShmEchoSession* session = OpenShmSession(options);
+            if (NULL == session)
+                return false;
+
+            BenchConnection* connection = new BenchConnection();
+            connection->sd = -1;
+            connection->credits = options->pipeline;
+            connection->activeTime = 0;
+            connection->message = new char[options->messageSize];
+            connection->stampOffset = 0;
+            connection->session = session;
+
+            memset(connection->message, 'x', (size_t) options->messageSize);
+            connections->push_back(connection);
+
+            continue;
+        }
+
+        int sd = ConnectClientSocket(options);
+
+        // Until the server listens
+        while ((0 == i) && (-1 == sd)
+                && ((ECONNREFUSED == errno) || (ENOENT == errno))
+                && (GetMonotonicTime() < deadline))
+        {
+            usleep(10000);
+            sd = ConnectClientSocket(options);
+        }
+
+        if (-1 == sd)
+            return false;
+
+        BenchConnection* connection = new BenchConnection();
+        connection->sd = sd;
+        connection->credits = options->pipeline;
+        connection->sendOffset = 0;
+        connection->receiveOffset = 0;
+        connection->writeBlocked = false;
+        connection->activeTime = 0;
+        connection->message = new char[options->messageSize];
+        connection->session = NULL;
+
+        memset(connection->message, 'x', (size_t) options->messageSize);
+
+        connection->stampOffset = options->server->framed
+                ? EncodeMessageFrame(connection->message, options->messageSize)
+                : 0;
+        connections->push_back(connection);
+
+        if ((BENCH_UDP == options->server->transport)
+                && !ProbeDatagramServer(sd, connection->message,
+                        options->messageSize))
+        {
+            errno = ETIMEDOUT;
+            return false;
+        }
+
+        fcntl(sd, F_SETFL, fcntl(sd, F_GETFL) | O_NONBLOCK);
+    }
+
+    return true;
+}
+
+// Records the echo of a message
+static void CompleteMessage(
+        BenchClient* client,
+        BenchConnection* connection,
+        const unsigned char* stamp,
+        long long now)
+{
+    if (BENCH_MEASURE == gPhase.load(std::memory_order_relaxed))
+    {
+        int64_t sendTime;
+        memcpy(&sendTime, stamp, sizeof(sendTime));
+
+        RecordLatency(&client->histogram, now - sendTime);
+        client->messages++;
+    }
+
+    // Late echoes of lost datagrams do not add credits
+    if (connection->credits < client->options->pipeline)
+    {
+        connection->credits++;
+    }
+
+    connection->activeTime = now;
+}
+
+// Sends messages until the pipeline is full or the socket blocks
+static bool SendMessages(BenchClient* client, BenchConnection* connection)
+{
+    int size = client->options->messageSize;
+
+    while (connection->credits > 0)
+    {
+        // Stamp each message with its send time
+        if (0 == connection->sendOffset)
+        {
+            int64_t now = GetMonotonicTime();
+            memcpy(connection->message + connection->stampOffset,
+                    &now, sizeof(now));
+        }
+
+        ssize_t sentSize = send(connection->sd,
+                connection->message + connection->sendOffset,
+                (size_t) (size - connection->sendOffset), MSG_NOSIGNAL);
+
+        CountSyscall(client);
+
+        if (-1 == sentSize)
+        {
+            if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+                break;
+
+            // Datagrams sent while the server is not reading
+            if (ECONNREFUSED == errno)
+                return true;
+
+            return false;
+        }
+
+        connection->sendOffset += (int) sentSize;
+        if (size == connection->sendOffset)
+        {
+            connection->sendOffset = 0;
+            connection->credits--;
+        }
+    }
+
+    // Wait for the socket to be writable only if it is full
+    bool writeBlocked = (connection->credits > 0);
+    if (writeBlocked != connection->writeBlocked)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN | (writeBlocked ? EPOLLOUT : 0);
+        event.data.ptr = connection;
+
+        epoll_ctl(client->epollFd, EPOLL_CTL_MOD, connection->sd, &event);
+        CountSyscall(client);
+
+        connection->writeBlocked = writeBlocked;
+    }
+
+    return true;
+}
+
+// Receives the echoed messages until the socket is drained
+static bool ReceiveMessages(BenchClient* client, BenchConnection* connection)
+{
+    int size = client->options->messageSize;
+    bool datagram = (BENCH_UDP == client->options->server->transport);
+
+    while (1)
+    {
+        ssize_t recvSize = recv(connection->sd, client->buffer,
+                BENCH_RECEIVE_SIZE, 0);
+
+        CountSyscall(client);
+
+        if (-1 == recvSize)
+        {
+            if ((EAGAIN == errno) || (EWOULDBLOCK == errno)
+                    || (datagram && (ECONNREFUSED == errno)))
+                return true;
+
+            return false;
+        }
+
+        if (0 == recvSize)
+        {
+            errno = ECONNRESET;
+            return false;
+        }
+
+        long long now = GetMonotonicTime();
+
+        if (datagram)
+        {
+            if (size == recvSize)
+            {
+                CompleteMessage(client, connection,
+                        (const unsigned char*) client->buffer, now);
+            }
+
+            continue;
+        }
+
+        // Messages may be split anywhere in the stream
+        ssize_t offset = 0;
+        while (offset < recvSize)
+        {
+            int chunk = size - connection->receiveOffset;
+            if (chunk > recvSize - offset)
+            {
+                chunk = (int) (recvSize - offset);
+            }
+
+            // Keep the send time of the message
+            int stampStart = connection->stampOffset;
+            int stampEnd = stampStart + MIN_MESSAGE_SIZE;
+            int chunkEnd = connection->receiveOffset + chunk;
+
+            if ((connection->receiveOffset < stampEnd) && (chunkEnd > stampStart))
+            {
+                int start = (connection->receiveOffset > stampStart)
+                        ? connection->receiveOffset : stampStart;
+                int end = (chunkEnd < stampEnd) ? chunkEnd : stampEnd;
+
+                memcpy(connection->stamp + (start - stampStart),
+                        client->buffer + offset
+                                + (start - connection->receiveOffset),
+                        (size_t) (end - start));
+            }
+
+            connection->receiveOffset += chunk;
+            offset += chunk;
+
+            if (size == connection->receiveOffset)
+            {
+                connection->receiveOffset = 0;
+                CompleteMessage(client, connection, connection->stamp, now);
+            }
+        }
+
+        // Drained without another call
+        if (recvSize < BENCH_RECEIVE_SIZE)
+            return true;
+    }
+}
+
+// Resends the datagrams without an echo
+static void CheckLostMessages(BenchClient* client, long long now)
+{
+    int pipeline = client->options->pipeline;
+
+    for (size_t i = 0; i < client->connections.size(); i++)
+    {
+        BenchConnection* connection = client->connections[i];
+
+        if ((connection->credits < pipeline)
+                && ((now - connection->activeTime) > DATAGRAM_LOSS_TIMEOUT))
+        {
+            if (BENCH_MEASURE == gPhase.load(std::memory_order_relaxed))
+            {
+                client->lost += pipeline - connection->credits;
+            }
+
+            connection->credits = pipeline;
+            connection->activeTime = now;
+
+            SendMessages(client, connection);
+        }
+    }
+}
+
+// Records the echo of a message sent through the shared memory
+static void HandleShmEcho(
+        void* context,
+        size_t index,
+        const char* reply,
+        size_t size)
+{
+    BenchClient* client = (BenchClient*) context;
+
+    if ((size_t) client->options->messageSize == size)
+    {
+        CompleteMessage(client, client->connections[0],
+                (const unsigned char*) reply, GetMonotonicTime());
+    }
+}
+
+/**
+ * Sends the pipeline through the shared memory session, all
+ * messages of a round at once, until the benchmark stops. The
+ * rings are waited on inside the engine, so the system calls of
+ * this client are only counted for the whole process.
+ *
+ * @param client client thread.
+ * @return false if failed, errno is set.
+ */
+static bool RunShmClient(BenchClient* client)
+{
+    BenchConnection* connection = client->connections[0];
+    int pipeline = client->options->pipeline;
+
+    // Messages of a round share the buffer and its send time
+    std::vector<const char*> messages((size_t) pipeline, connection->message);
+    std::vector<size_t> sizes((size_t) pipeline,
+            (size_t) client->options->messageSize);
+
+    while (BENCH_STOP != gPhase.load(std::memory_order_relaxed))
+    {
+        int64_t now = GetMonotonicTime();
+        memcpy(connection->message, &now, sizeof(now));
+
+        std::error_code error;
+        SendShmEchoSession(connection->session, messages.data(),
+                sizes.data(), (size_t) pipeline, HandleShmEcho, client, error);
+
+        if (error)
+        {
+            errno = (std::system_category() == error.category())
+                    ? error.value() : ECONNRESET;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void* BenchClientThread(void* args)
+{
+    BenchClient* client = (BenchClient*) args;
+    bool datagram = (BENCH_UDP == client->options->server->transport);
+    struct epoll_event events[MAX_BENCH_EVENTS];
+
+    if (BENCH_SHM == client->options->server->transport)
+    {
+        if (!RunShmClient(client))
+            client->error = errno;
+
+        return NULL;
+    }
+
+    // Fill the pipelines
+    long long now = GetMonotonicTime();
+    for (size_t i = 0; i < client->connections.size(); i++)
+    {
+        client->connections[i]->activeTime = now;
+
+        if (!SendMessages(client, client->connections[i]))
+            goto fail;
+    }
+
+    while (BENCH_STOP != gPhase.load(std::memory_order_relaxed))
+    {
+        int eventCount = epoll_wait(client->epollFd, events,
+                MAX_BENCH_EVENTS, BENCH_POLL_TIMEOUT);
+
+        CountSyscall(client);
+
+        if (-1 == eventCount)
+        {
+            if (EINTR == errno)
+                continue;
+
+            goto fail;
+        }
+
+        for (int i = 0; i < eventCount; i++)
+        {
+            BenchConnection* connection =
+                    (BenchConnection*) events[i].data.ptr;
+
+            if ((0 != (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+                    && !ReceiveMessages(client, connection))
+                goto fail;
+
+            if (!SendMessages(client, connection))
+                goto fail;
+        }
+
+        if (datagram)
+        {
+            CheckLostMessages(client, GetMonotonicTime());
+        }
+    }
+
+    return NULL;
+
+fail:
+    client->error = errno;
+
+    return NULL;
+}
+
+static void* BenchServerThread(void* args)
+{
+    const BenchOptions* options = (const BenchOptions*) args;
+
+    OpenLogSink(&gLogSink);
+
+    std::error_code error;
+    options->server->run(options, error);
+
+    // Servers serving a single client stop with it
+    if (BENCH_STOP != gPhase.load(std::memory_order_relaxed))
+    {
+        fprintf(stderr, "Server stopped%s%s\n",
+                error ? ": " : ".",
+                error ? error.message().c_str() : "");
+    }
+
+    CloseLogSink();
+
+    return NULL;
+}
+
+/**
+ * Sets the server options and starts the server on a new thread.
+ *
+ * @param options benchmark options.
+ * @return false if failed.
+ */
+static bool StartServer(const BenchOptions* options)
+{
+    SetLogLevel(options->logLevel);
+    SetEchoZeroCopy(options->zeroCopy);
+
+    if (0 != options->bufferSize)
+    {
+        SetEchoBufferSize((size_t) options->bufferSize);
+    }
+
+    pthread_t thread;
+    if (0 != pthread_create(&thread, NULL, BenchServerThread,
+            (void*) options))
+    {
+        fprintf(stderr, "Starting the server failed.\n");
+        return false;
+    }
+
+    pthread_detach(thread);
+
+    return true;
+}
+
+/**
+ * Opens a counter of the system call tracepoint for each thread
+ * of the process, the servers included. Needs tracefs and perf
+ * access, the clients count their own calls regardless.
+ *
+ * @param counter syscall counter.
+ * @return false if not available.
+ */
+static bool OpenSyscallCounter(SyscallCounter* counter)
+{
+    static const char* idPaths[] =
+    {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+    };
+
+    long long id = -1;
+    for (size_t i = 0; (i < 2) && (-1 == id); i++)
+    {
+        FILE* file = fopen(idPaths[i], "r");
+        if (NULL != file)
+        {
+            if (1 != fscanf(file, "%lld", &id))
+                id = -1;
+
+            fclose(file);
+        }
+    }
+
+    if (-1 == id)
+        return false;
+
+    DIR* tasks = opendir("/proc/self/task");
+    if (NULL == tasks)
+        return false;
+
+    struct dirent* task;
+    while (NULL != (task = readdir(tasks)))
+    {
+        if ('.' == task->d_name[0])
+            continue;
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = (unsigned long long) id;
+
+        int fd = (int) syscall(SYS_perf_event_open, &attr,
+                atoi(task->d_name), -1, -1, 0);
+
+        if (-1 == fd)
+        {
+            for (size_t i = 0; i < counter->fds.size(); i++)
+                close(counter->fds[i]);
+
+            counter->fds.clear();
+            break;
+        }
+
+        counter->fds.push_back(fd);
+    }
+
+    closedir(tasks);
+
+    return !counter->fds.empty();
+}
+
+static long long ReadSyscallCounter(const SyscallCounter* counter)
+{
+    long long total = 0;
+
+    for (size_t i = 0; i < counter->fds.size(); i++)
+    {
+        long long count = 0;
+        if (sizeof(count) == read(counter->fds[i], &count, sizeof(count)))
+            total += count;
+    }
+
+    return total;
+}
+
+static void PrintResults(
+        const BenchOptions* options,
+        const LatencyHistogram* histogram,
+        long long messages,
+        long long syscalls,
+        long long processSyscalls,
+        long long lost,
+        double seconds)
+{
+    double perMessage = (messages > 0) ? (double) messages : 1.0;
+
+    printf("%s: %d connections, %d byte messages, pipeline %d, %.1f s\n",
+            options->server->mode, options->connections,
+            options->messageSize, options->pipeline, seconds);
+
+    printf("  messages    %lld\n", messages);
+
+    printf("  throughput  %.0f msg/s, %.2f MB/s\n",
+            messages / seconds,
+            (messages * (double) options->messageSize) / seconds / 1e6);
+
+    printf("  latency     min %.1f, mean %.1f, p50 %.1f, p99 %.1f, "
+            "p99.9 %.1f, max %.1f us\n",
+            histogram->minValue / 1e3,
+            histogram->sum / perMessage / 1e3,
+            GetLatencyPercentile(histogram, 50.0) / 1e3,
+            GetLatencyPercentile(histogram, 99.0) / 1e3,
+            GetLatencyPercentile(histogram, 99.9) / 1e3,
+            histogram->maxValue / 1e3);
+
+    printf("  syscalls    %.2f per message in the clients", syscalls / perMessage);
+
+    if (processSyscalls >= 0)
+    {
+        printf(", %.2f in the process", processSyscalls / perMessage);
+    }
+
+    printf("\n");
+
+    if (BENCH_UDP == options->server->transport)
+    {
+        printf("  lost        %lld\n", lost);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    if (!options.external && !StartServer(&options))
+        return 1;
+
+    std::vector<BenchConnection*> connections;
+    if (!OpenConnections(&options, &connections))
+    {
+        fprintf(stderr, "Connecting to the server failed: %s\n",
+                strerror(errno));
+        return 1;
+    }
+
+    // Connections are spread over the client threads
+    std::vector<BenchClient*> clients;
+    for (int i = 0; i < options.clientThreads; i++)
+    {
+        BenchClient* client = new BenchClient();
+        client->options = &options;
+        client->epollFd = epoll_create1(0);
+        client->buffer = new char[BENCH_RECEIVE_SIZE];
+        client->messages = 0;
+        client->syscalls = 0;
+        client->lost = 0;
+        client->error = 0;
+
+        ClearLatencyHistogram(&client->histogram);
+        clients.push_back(client);
+    }
+
+    for (size_t i = 0; i < connections.size(); i++)
+    {
+        BenchClient* client = clients[i % clients.size()];
+        client->connections.push_back(connections[i]);
+
+        if (NULL != connections[i]->session)
+            continue;
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connections[i];
+
+        epoll_ctl(client->epollFd, EPOLL_CTL_ADD, connections[i]->sd, &event);
+    }
+
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        if (0 != pthread_create(&clients[i]->thread, NULL,
+                BenchClientThread, clients[i]))
+        {
+            fprintf(stderr, "Starting the clients failed.\n");
+            return 1;
+        }
+    }
+
+    sleep((unsigned int) options.warmup);
+
+    // All threads exist now, count their system calls
+    SyscallCounter counter;
+    bool counting = OpenSyscallCounter(&counter);
+    long long startSyscalls = counting ? ReadSyscallCounter(&counter) : 0;
+
+    long long startTime = GetMonotonicTime();
+    gPhase.store(BENCH_MEASURE, std::memory_order_relaxed);
+
+    sleep((unsigned int) options.duration);
+
+    gPhase.store(BENCH_STOP, std::memory_order_relaxed);
+    long long endTime = GetMonotonicTime();
+    long long processSyscalls = counting
+            ? ReadSyscallCounter(&counter) - startSyscalls : -1;
+
+    LatencyHistogram* histogram = new LatencyHistogram();
+    ClearLatencyHistogram(histogram);
+
+    long long messages = 0;
+    long long syscalls = 0;
+    long long lost = 0;
+    int error = 0;
+
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        pthread_join(clients[i]->thread, NULL);
+
+        MergeLatencyHistogram(histogram, &clients[i]->histogram);
+        messages += clients[i]->messages;
+        syscalls += clients[i]->syscalls;
+        lost += clients[i]->lost;
+
+        if (0 != clients[i]->error)
+            error = clients[i]->error;
+    }
+
+    PrintResults(&options, histogram, messages, syscalls, processSyscalls,
+            lost, (endTime - startTime) / 1e9);
+
+    if (0 != error)
+    {
+        fprintf(stderr, "A client failed: %s\n", strerror(error));
+        return 1;
+    }
+
+    // Servers run until the process exits
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "LatencyHistogram.h"
+
+// memset
+#include <string.h>
+
+// Largest value that has a bucket
+#define LATENCY_MAX_VALUE ((INT64_C(2) << LATENCY_MAX_MAGNITUDE) - 1)
+
+static inline int GetBucketIndex(int64_t value)
+{
+    if (value < (2 * LATENCY_SUB_BUCKET_COUNT))
+    {
+        return (int) value;
+    }
+
+    // Keep the highest bits of the value
+    int magnitude = 63 - __builtin_clzll((unsigned long long) value);
+    int shift = magnitude - LATENCY_SUB_BUCKET_BITS;
+    int subBucket = (int) (value >> shift) - LATENCY_SUB_BUCKET_COUNT;
+
+    return (2 * LATENCY_SUB_BUCKET_COUNT)
+            + ((shift - 1) * LATENCY_SUB_BUCKET_COUNT) + subBucket;
+}
+
+static inline int64_t GetBucketHighestValue(int index)
+{
+    if (index < (2 * LATENCY_SUB_BUCKET_COUNT))
+    {
+        return index;
+    }
+
+    index -= 2 * LATENCY_SUB_BUCKET_COUNT;
+
+    int shift = (index / LATENCY_SUB_BUCKET_COUNT) + 1;
+    int64_t subBucket = (index % LATENCY_SUB_BUCKET_COUNT)
+            + LATENCY_SUB_BUCKET_COUNT;
+
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void ClearLatencyHistogram(LatencyHistogram* histogram)
+{
+    memset(histogram->counts, 0, sizeof(histogram->counts));
+
+    histogram->totalCount = 0;
+    histogram->minValue = 0;
+    histogram->maxValue = 0;
+    histogram->sum = 0;
+}
+
+void RecordLatency(LatencyHistogram* histogram, int64_t value)
+{
+    if (value < 0)
+    {
+        value = 0;
+    }
+    else if (value > LATENCY_MAX_VALUE)
+    {
+        value = LATENCY_MAX_VALUE;
+    }
+
+    histogram->counts[GetBucketIndex(value)]++;
+
+    if ((0 == histogram->totalCount) || (value < histogram->minValue))
+    {
+        histogram->minValue = value;
+    }
+
+    if (value > histogram->maxValue)
+    {
+        histogram->maxValue = value;
+    }
+
+    histogram->totalCount++;
+    histogram->sum += (double) value;
+}
+
+void MergeLatencyHistogram(
+        LatencyHistogram* histogram,
+        const LatencyHistogram* other)
+{
+    if (0 == other->totalCount)
+    {
+        return;
+    }
+
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        histogram->counts[i] += other->counts[i];
+    }
+
+    if ((0 == histogram->totalCount)
+            || (other->minValue < histogram->minValue))
+    {
+        histogram->minValue = other->minValue;
+    }
+
+    if (other->maxValue > histogram->maxValue)
+    {
+        histogram->maxValue = other->maxValue;
+    }
+
+    histogram->totalCount += other->totalCount;
+    histogram->sum += other->sum;
+}
+
+int64_t GetLatencyPercentile(
+        const LatencyHistogram* histogram,
+        double percentile)
+{
+    if (0 == histogram->totalCount)
+    {
+        return 0;
+    }
+
+    // Rank of the value, at least the first one
+    int64_t rank = (int64_t) ((percentile / 100.0)
+            * (double) histogram->totalCount + 0.5);
+
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    int64_t count = 0;
+
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        count += histogram->counts[i];
+
+        if (count >= rank)
+        {
+            // The maximum is exact, do not report more
+            int64_t value = GetBucketHighestValue(i);
+            return (value < histogram->maxValue)
+                    ? value : histogram->maxValue;
+        }
+    }
+
+    return histogram->maxValue;
+}
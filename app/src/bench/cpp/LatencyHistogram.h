@@ -0,0 +1,80 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// int64_t
+#include <stdint.h>
+
+// Sub-buckets of each power of two, precision of 1/64
+#define LATENCY_SUB_BUCKET_BITS 6
+#define LATENCY_SUB_BUCKET_COUNT (1 << LATENCY_SUB_BUCKET_BITS)
+
+// Highest power of two recorded, about 68 seconds in nanoseconds
+#define LATENCY_MAX_MAGNITUDE 36
+
+// Linear buckets below twice the sub-bucket count, then one set
+// of sub-buckets for each power of two
+#define LATENCY_BUCKET_COUNT ((2 * LATENCY_SUB_BUCKET_COUNT) \
+        + ((LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BUCKET_BITS) \
+        * LATENCY_SUB_BUCKET_COUNT))
+
+/**
+ * Log-linear histogram of latencies in nanoseconds, in the way
+ * of HdrHistogram. Values are exact below 128 and kept with 1.6%
+ * precision above, larger values are clamped. Recording is a
+ * few instructions without allocation. Not thread safe, each
+ * thread records its own histogram and they are merged.
+ */
+struct LatencyHistogram
+{
+    // Values per bucket
+    int64_t counts[LATENCY_BUCKET_COUNT];
+
+    // Number of values
+    int64_t totalCount;
+
+    // Smallest and largest values
+    int64_t minValue;
+    int64_t maxValue;
+
+    // Sum of the values for the mean
+    double sum;
+};
+
+/**
+ * Empties the given histogram.
+ *
+ * @param histogram latency histogram.
+ */
+void ClearLatencyHistogram(LatencyHistogram* histogram);
+
+/**
+ * Records a value.
+ *
+ * @param histogram latency histogram.
+ * @param value value in nanoseconds.
+ */
+void RecordLatency(LatencyHistogram* histogram, int64_t value);
+
+/**
+ * Adds the values of another histogram.
+ *
+ * @param histogram latency histogram.
+ * @param other histogram to add.
+ */
+void MergeLatencyHistogram(
+        LatencyHistogram* histogram,
+        const LatencyHistogram* other);
+
+/**
+ * Gets the value at the given percentile, the highest value
+ * equivalent to the bucket it falls into.
+ *
+ * @param histogram latency histogram.
+ * @param percentile percentile between 0 and 100.
+ * @return value in nanoseconds or 0 if empty.
+ */
+int64_t GetLatencyPercentile(
+        const LatencyHistogram* histogram,
+        double percentile);
+
+#endif
@@ -0,0 +1,190 @@
+#include "JniCache.h"
+
+// strcmp
+#include <string.h>
+
+/**
+ * Cached class.
+ */
+struct JniCachedClass
+{
+    const char* className;
+    jclass clazz;
+};
+
+/**
+ * Cached method.
+ */
+struct JniCachedMethod
+{
+    const char* className;
+    const char* name;
+    const char* signature;
+    jmethodID methodID;
+};
+
+// Cached classes, written only while the library loads
+static JniCachedClass gClasses[MAX_JNI_CACHED_CLASSES];
+static int gClassCount = 0;
+
+// Cached methods, written only while the library loads
+static JniCachedMethod gMethods[MAX_JNI_CACHED_METHODS];
+static int gMethodCount = 0;
+
+// Names are usually the same literals, compare the pointers first
+static inline bool IsSameName(const char* name, const char* otherName)
+{
+    return (name == otherName) || (0 == strcmp(name, otherName));
+}
+
+jclass GetCachedJniClass(const char* className)
+{
+    for (int i = 0; i < gClassCount; i++)
+    {
+        if (IsSameName(gClasses[i].className, className))
+        {
+            return gClasses[i].clazz;
+        }
+    }
+
+    return NULL;
+}
+
+jmethodID GetCachedJniMethod(
+        const char* className,
+        const char* name,
+        const char* signature)
+{
+    for (int i = 0; i < gMethodCount; i++)
+    {
+        if (IsSameName(gMethods[i].name, name)
+                && IsSameName(gMethods[i].className, className)
+                && IsSameName(gMethods[i].signature, signature))
+        {
+            return gMethods[i].methodID;
+        }
+    }
+
+    return NULL;
+}
+
+jclass CacheJniClass(JNIEnv* env, const char* className)
+{
+    jclass clazz = GetCachedJniClass(className);
+    if ((NULL != clazz) || (gClassCount >= MAX_JNI_CACHED_CLASSES))
+    {
+        return clazz;
+    }
+
+    // Find the class with the class loader of the library
+    jclass localClazz = env->FindClass(className);
+    if (NULL == localClazz)
+    {
+        env->ExceptionClear();
+        return NULL;
+    }
+
+    // Keep the class loaded while it is cached
+    clazz = (jclass) env->NewGlobalRef(localClazz);
+    env->DeleteLocalRef(localClazz);
+
+    if (NULL == clazz)
+    {
+        env->ExceptionClear();
+        return NULL;
+    }
+
+    gClasses[gClassCount].className = className;
+    gClasses[gClassCount].clazz = clazz;
+    gClassCount++;
+
+    return clazz;
+}
+
+jmethodID CacheJniMethod(
+        JNIEnv* env,
+        const char* className,
+        const char* name,
+        const char* signature)
+{
+    jclass clazz = GetCachedJniClass(className);
+    if ((NULL == clazz) || (gMethodCount >= MAX_JNI_CACHED_METHODS))
+    {
+        return NULL;
+    }
+
+    jmethodID methodID = env->GetMethodID(clazz, name, signature);
+    if (NULL == methodID)
+    {
+        env->ExceptionClear();
+        return NULL;
+    }
+
+    gMethods[gMethodCount].className = className;
+    gMethods[gMethodCount].name = name;
+    gMethods[gMethodCount].signature = signature;
+    gMethods[gMethodCount].methodID = methodID;
+    gMethodCount++;
+
+    return methodID;
+}
+
+bool RegisterJniNatives(
+        JNIEnv* env,
+        const char* className,
+        const JNINativeMethod* methods,
+        int methodCount)
+{
+    jclass clazz = CacheJniClass(env, className);
+    if (NULL == clazz)
+    {
+        return false;
+    }
+
+    if (JNI_OK != env->RegisterNatives(clazz, methods, methodCount))
+    {
+        env->ExceptionClear();
+        return false;
+    }
+
+    return true;
+}
+
+void ThrowJniException(
+        JNIEnv* env,
+        const char* className,
+        const char* message)
+{
+    // Get the exception class
+    jclass clazz = GetCachedJniClass(className);
+    if (NULL != clazz)
+    {
+        // Throw exception
+        env->ThrowNew(clazz, message);
+        return;
+    }
+
+    // Not cached, look it up
+    clazz = env->FindClass(className);
+
+    // If exception class is found
+    if (NULL != clazz)
+    {
+        // Throw exception
+        env->ThrowNew(clazz, message);
+
+        // Release local class reference
+        env->DeleteLocalRef(clazz);
+    }
+}
+
+void FreeJniCache(JNIEnv* env)
+{
+    for (int i = 0; i < gClassCount; i++)
+    {
+        env->DeleteGlobalRef(gClasses[i].clazz);
+    }
+
+    gClassCount = 0;
+    gMethodCount = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef JNI_CACHE_H
+#define JNI_CACHE_H
+
+// JNI
+#include <jni.h>
+
+// Classes a library can cache
+#define MAX_JNI_CACHED_CLASSES 16
+
+// Methods a library can cache
+#define MAX_JNI_CACHED_METHODS 32
+
+/**
+ * Class and method handles of a library, looked up once in
+ * JNI_OnLoad. Entries are only added while the library loads,
+ * afterwards the cache is read only and safe to use from any
+ * thread without locking. Each library links its own copy.
+ */
+
+/**
+ * Caches a global reference to the given class. Must only be
+ * called from JNI_OnLoad.
+ *
+ * @param env JNIEnv interface.
+ * @param className class name.
+ * @return class or NULL if not found, no exception is pending.
+ */
+jclass CacheJniClass(JNIEnv* env, const char* className);
+
+/**
+ * Caches the given method of a class cached before. Must only
+ * be called from JNI_OnLoad.
+ *
+ * @param env JNIEnv interface.
+ * @param className class name.
+ * @param name method name.
+ * @param signature method signature.
+ * @return method ID or NULL if not found, no exception is pending.
+ */
+jmethodID CacheJniMethod(
+        JNIEnv* env,
+        const char* className,
+        const char* name,
+        const char* signature);
+
+/**
+ * Gets a cached class.
+ *
+ * @param className class name.
+ * @return class or NULL if not cached.
+ */
+jclass GetCachedJniClass(const char* className);
+
+/**
+ * Gets a cached method.
+ *
+ * @param className class name.
+ * @param name method name.
+ * @param signature method signature.
+ * @return method ID or NULL if not cached.
+ */
+jmethodID GetCachedJniMethod(
+        const char* className,
+        const char* name,
+        const char* signature);
+
+/**
+ * Registers the native methods of the given class, so they are
+ * bound at load time instead of by symbol lookup on first call.
+ * The class is cached. Must only be called from JNI_OnLoad.
+ *
+ * @param env JNIEnv interface.
+ * @param className class name.
+ * @param methods native methods.
+ * @param methodCount number of methods.
+ * @return false if the class or a method is not found, no
+ *         exception is pending.
+ */
+bool RegisterJniNatives(
+        JNIEnv* env,
+        const char* className,
+        const JNINativeMethod* methods,
+        int methodCount);
+
+/**
+ * Gets the number of entries of a native method table.
+ */
+#define JNI_METHOD_COUNT(methods) \
+        ((int) (sizeof(methods) / sizeof((methods)[0])))
+
+/**
+ * Throws a new exception of the given class. Cached classes
+ * are used directly, others are looked up.
+ *
+ * @param env JNIEnv interface.
+ * @param className exception class name.
+ * @param message exception message.
+ */
+void ThrowJniException(
+        JNIEnv* env,
+        const char* className,
+        const char* message);
+
+/**
+ * JNIEnv out argument of the JavaVM attach functions, declared
+ * as JNIEnv** by the NDK and as void** by the JDK headers used
+ * for host builds. Converts to either.
+ */
+class JniEnvArgument
+{
+public:
+    explicit JniEnvArgument(JNIEnv** env) : env(env) {}
+
+    operator JNIEnv**() const { return env; }
+
+    operator void**() const { return (void**) env; }
+
+private:
+    JNIEnv** env;
+};
+
+/**
+ * Releases the cached global references, from JNI_OnUnload.
+ *
+ * @param env JNIEnv interface.
+ */
+void FreeJniCache(JNIEnv* env);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef JNI_MODULES_H
+#define JNI_MODULES_H
+
+// JNI
+#include <jni.h>
+
+/**
+ * Native modules. Each module caches its handles and registers
+ * its native methods when the library containing it loads, a
+ * library may contain one module or all of them.
+ */
+
+/**
+ * Loads the MainActivity natives of native-lib.
+ *
+ * @param vm Java virtual machine.
+ * @param env JNIEnv interface.
+ * @return false if the natives could not be registered.
+ */
+bool LoadMainModule(JavaVM* vm, JNIEnv* env);
+
+/**
+ * Loads the echo activity natives of Echo.
+ *
+ * @param vm Java virtual machine.
+ * @param env JNIEnv interface.
+ * @return false if the natives could not be registered.
+ */
+bool LoadEchoModule(JavaVM* vm, JNIEnv* env);
+
+/**
+ * Loads the natives of jnidynamicload.
+ *
+ * @param vm Java virtual machine.
+ * @param env JNIEnv interface.
+ * @return false if the natives could not be registered.
+ */
+bool LoadDynamicLoadModule(JavaVM* vm, JNIEnv* env);
+
+/**
+ * Loads the player activity natives of BitmapPlayer.
+ *
+ * @param vm Java virtual machine.
+ * @param env JNIEnv interface.
+ * @return false if the natives could not be registered.
+ */
+bool LoadPlayerModule(JavaVM* vm, JNIEnv* env);
+
+#endif
@@ -0,0 +1,63 @@
+#include "JniModules.h"
+#include "JniCache.h"
+
+// NULL
+#include <stddef.h>
+
+/*
+ * Load hooks shared by all libraries. Each library is compiled
+ * with the JNI_MODULE_* definitions of the modules it contains,
+ * the single library build defines all of them.
+ */
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    JNIEnv* env = NULL;
+
+    // Get the JNIEnv interface of the loading thread
+    if (JNI_OK != vm->GetEnv((void**) &env, JNI_VERSION_1_6))
+    {
+        return JNI_ERR;
+    }
+
+#ifdef JNI_MODULE_MAIN
+    if (!LoadMainModule(vm, env))
+    {
+        return JNI_ERR;
+    }
+#endif
+
+#ifdef JNI_MODULE_ECHO
+    if (!LoadEchoModule(vm, env))
+    {
+        return JNI_ERR;
+    }
+#endif
+
+#ifdef JNI_MODULE_DYNAMIC_LOAD
+    if (!LoadDynamicLoadModule(vm, env))
+    {
+        return JNI_ERR;
+    }
+#endif
+
+#ifdef JNI_MODULE_PLAYER
+    if (!LoadPlayerModule(vm, env))
+    {
+        return JNI_ERR;
+    }
+#endif
+
+    return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved)
+{
+    JNIEnv* env = NULL;
+
+    // Release the cached classes
+    if (JNI_OK == vm->GetEnv((void**) &env, JNI_VERSION_1_6))
+    {
+        FreeJniCache(env);
+    }
+}
@@ -0,0 +1,60 @@
+#include "MessageBatch.h"
+
+// memcpy
+#include <string.h>
+
+// clock_gettime
+#include <time.h>
+
+static long long GetMonotonicTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+void ClearMessageBatch(MessageBatch* batch)
+{
+    batch->length = 0;
+    batch->count = 0;
+    batch->firstTime = 0;
+}
+
+bool AppendMessageBatch(
+        MessageBatch* batch,
+        const char* message,
+        size_t length)
+{
+    // Length, text and terminator
+    size_t recordSize = sizeof(uint32_t) + length + 1;
+
+    if (recordSize > MESSAGE_BATCH_SIZE - batch->length)
+    {
+        return false;
+    }
+
+    if (0 == batch->count)
+    {
+        batch->firstTime = GetMonotonicTime();
+    }
+
+    // Records are not aligned, the length is copied
+    char* record = batch->data + batch->length;
+    uint32_t recordLength = (uint32_t) length;
+
+    memcpy(record, &recordLength, sizeof(uint32_t));
+    memcpy(record + sizeof(uint32_t), message, length);
+    record[sizeof(uint32_t) + length] = '\0';
+
+    batch->length += recordSize;
+    batch->count++;
+
+    return true;
+}
+
+bool IsMessageBatchDue(MessageBatch* batch, long long interval)
+{
+    return (0 != batch->count)
+            && ((GetMonotonicTime() - batch->firstTime) >= interval);
+}
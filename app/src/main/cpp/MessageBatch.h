@@ -0,0 +1,93 @@
+#ifndef MESSAGE_BATCH_H
+#define MESSAGE_BATCH_H
+
+// size_t
+#include <stddef.h>
+
+// uint32_t
+#include <stdint.h>
+
+// memcpy
+#include <string.h>
+
+// Bytes of records a batch holds
+#define MESSAGE_BATCH_SIZE 16384
+
+/**
+ * Messages collected by a thread before they are delivered to
+ * Java at once. Each record is a 32-bit length in native byte
+ * order, the UTF-8 bytes and a NULL terminator not counted in
+ * the length. A batch is not thread safe, each thread owns its
+ * own batch.
+ */
+struct MessageBatch
+{
+    // Records
+    char data[MESSAGE_BATCH_SIZE];
+
+    // Used bytes of the data
+    size_t length;
+
+    // Number of records
+    int count;
+
+    // Monotonic time of the first record in nanoseconds
+    long long firstTime;
+};
+
+/**
+ * Empties the given batch.
+ *
+ * @param batch message batch.
+ */
+void ClearMessageBatch(MessageBatch* batch);
+
+/**
+ * Appends a message to the given batch.
+ *
+ * @param batch message batch.
+ * @param message message text.
+ * @param length message length.
+ * @return false if the message does not fit.
+ */
+bool AppendMessageBatch(
+        MessageBatch* batch,
+        const char* message,
+        size_t length);
+
+/**
+ * Checks if the first record of the given batch waits longer
+ * than the given interval.
+ *
+ * @param batch message batch.
+ * @param interval interval in nanoseconds.
+ * @return true if the batch should be delivered.
+ */
+bool IsMessageBatchDue(MessageBatch* batch, long long interval);
+
+/**
+ * Gets the record at the given offset.
+ *
+ * @param batch message batch.
+ * @param offset record offset, moved to the next record.
+ * @param length record length.
+ * @return NULL terminated record text or NULL at the end.
+ */
+static inline const char* NextMessageRecord(
+        const MessageBatch* batch,
+        size_t* offset,
+        uint32_t* length)
+{
+    if (*offset >= batch->length)
+    {
+        return NULL;
+    }
+
+    const char* record = batch->data + *offset;
+    memcpy(length, record, sizeof(uint32_t));
+    *offset += sizeof(uint32_t) + *length + 1;
+
+    return record + sizeof(uint32_t);
+}
+
+#endif
@@ -0,0 +1,534 @@
+#include "WorkPool.h"
+
+// errno
+#include <errno.h>
+
+// rand_r
+#include <stdlib.h>
+
+// sysconf
+#include <unistd.h>
+
+// std::nothrow
+#include <new>
+
+// Upper bound of the worker count
+#define WORK_MAX_WORKERS 64
+
+// Worker of the current thread, NULL for outside threads
+static thread_local WorkWorker* tWorker = NULL;
+
+static void InitWorkDeque(WorkDeque* deque)
+{
+    deque->top.store(0, std::memory_order_relaxed);
+    deque->bottom.store(0, std::memory_order_relaxed);
+}
+
+// Pushes at the bottom, owner only
+static bool PushWorkDeque(WorkDeque* deque, WorkTask* task)
+{
+    long bottom = deque->bottom.load(std::memory_order_relaxed);
+    long top = deque->top.load(std::memory_order_acquire);
+
+    if ((bottom - top) >= WORK_DEQUE_CAPACITY)
+    {
+        return false;
+    }
+
+    deque->tasks[bottom & (WORK_DEQUE_CAPACITY - 1)].store(task,
+            std::memory_order_relaxed);
+
+    // Publish the task with the new bottom
+    deque->bottom.store(bottom + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Pops at the bottom, owner only
+static WorkTask* PopWorkDeque(WorkDeque* deque)
+{
+    long bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(bottom, std::memory_order_relaxed);
+
+    // Thieves must see the claim before the top is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long top = deque->top.load(std::memory_order_relaxed);
+
+    // Empty
+    if (top > bottom)
+    {
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    WorkTask* task = deque->tasks[bottom & (WORK_DEQUE_CAPACITY - 1)].load(
+            std::memory_order_relaxed);
+
+    // Last task, race the thieves for it
+    if (top == bottom)
+    {
+        if (!deque->top.compare_exchange_strong(top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            task = NULL;
+        }
+
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return task;
+}
+
+// Steals at the top, any thread
+static WorkTask* StealWorkDeque(WorkDeque* deque)
+{
+    long top = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long bottom = deque->bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return NULL;
+    }
+
+    WorkTask* task = deque->tasks[top & (WORK_DEQUE_CAPACITY - 1)].load(
+            std::memory_order_relaxed);
+
+    // Lost to the owner or another thief
+    if (!deque->top.compare_exchange_strong(top, top + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return NULL;
+    }
+
+    return task;
+}
+
+static bool IsWorkDequeEmpty(WorkDeque* deque)
+{
+    return deque->top.load(std::memory_order_acquire)
+            >= deque->bottom.load(std::memory_order_acquire);
+}
+
+// Wakes up a sleeping worker if there is any
+static void WakeWorker(WorkPool* pool, bool all)
+{
+    // Pairs with the sleepers increment before the last check
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (0 == pool->sleepers.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (all)
+    {
+        pthread_cond_broadcast(&pool->wakeup);
+    }
+    else
+    {
+        pthread_cond_signal(&pool->wakeup);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Takes a share of the submission queue, mutex held
+static WorkTask* TakeQueuedWork(WorkPool* pool, WorkWorker* worker)
+{
+    WorkTask* task = pool->queueHead;
+    if (NULL == task)
+    {
+        return NULL;
+    }
+
+    // Leave the rest for the other workers to take or steal
+    long share = (pool->queued.load(std::memory_order_relaxed)
+            / pool->workerCount) + 1;
+
+    pool->queueHead = task->next;
+    long taken = 1;
+
+    while ((taken < share) && (NULL != pool->queueHead))
+    {
+        // Read before the push, once published a thief may run the
+        // task and its submit may free it
+        WorkTask* next = pool->queueHead->next;
+
+        if (!PushWorkDeque(&worker->deque, pool->queueHead))
+        {
+            break;
+        }
+
+        pool->queueHead = next;
+        taken++;
+    }
+
+    if (NULL == pool->queueHead)
+    {
+        pool->queueTail = NULL;
+    }
+
+    pool->queued.fetch_sub(taken, std::memory_order_relaxed);
+
+    // Others may steal what was moved to the deque
+    if (taken > 1)
+    {
+        pthread_cond_signal(&pool->wakeup);
+    }
+
+    return task;
+}
+
+// Tries the other workers, starting at a random one
+static WorkTask* StealWork(WorkPool* pool, WorkWorker* worker)
+{
+    int first = (int) (rand_r(&worker->seed) % pool->workerCount);
+
+    for (int i = 0; i < pool->workerCount; i++)
+    {
+        WorkWorker* victim = &pool->workers[(first + i) % pool->workerCount];
+
+        if (victim != worker)
+        {
+            WorkTask* task = StealWorkDeque(&victim->deque);
+            if (NULL != task)
+            {
+                return task;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static bool HasStealableWork(WorkPool* pool, WorkWorker* worker)
+{
+    for (int i = 0; i < pool->workerCount; i++)
+    {
+        if ((&pool->workers[i] != worker)
+                && !IsWorkDequeEmpty(&pool->workers[i].deque))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Finds the next task, sleeps while there is none
+static WorkTask* FindWork(WorkPool* pool, WorkWorker* worker)
+{
+    while (!pool->stopping.load(std::memory_order_acquire))
+    {
+        // Own tasks first, newest first for locality
+        WorkTask* task = PopWorkDeque(&worker->deque);
+        if (NULL != task)
+        {
+            return task;
+        }
+
+        // Submitted tasks next, the queue is only locked if not empty
+        if (0 != pool->queued.load(std::memory_order_relaxed))
+        {
+            pthread_mutex_lock(&pool->mutex);
+            task = TakeQueuedWork(pool, worker);
+            pthread_mutex_unlock(&pool->mutex);
+
+            if (NULL != task)
+            {
+                return task;
+            }
+        }
+
+        task = StealWork(pool, worker);
+        if (NULL != task)
+        {
+            return task;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+
+        // Announce the sleep, then check again before sleeping
+        pool->sleepers.fetch_add(1, std::memory_order_seq_cst);
+
+        if ((NULL == pool->queueHead)
+                && !HasStealableWork(pool, worker)
+                && !pool->stopping.load(std::memory_order_acquire))
+        {
+            pthread_cond_wait(&pool->wakeup, &pool->mutex);
+        }
+
+        pool->sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return NULL;
+}
+
+static void FinishWork(WorkGroup* group)
+{
+    if (1 != group->pending.fetch_sub(1, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    // Last task of the group
+    pthread_mutex_lock(&group->mutex);
+    pthread_cond_broadcast(&group->done);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static void* WorkerThread(void* args)
+{
+    WorkWorker* worker = (WorkWorker*) args;
+    WorkPool* pool = worker->pool;
+
+    tWorker = worker;
+
+    if (NULL != pool->threadStart)
+    {
+        worker->threadContext = pool->threadStart(pool->context);
+    }
+
+    WorkTask* task;
+    while (NULL != (task = FindWork(pool, worker)))
+    {
+        // Task may free itself
+        WorkGroup* group = task->group;
+
+        task->run(task, worker->threadContext);
+
+        if (NULL != group)
+        {
+            FinishWork(group);
+        }
+    }
+
+    if (NULL != pool->threadStop)
+    {
+        pool->threadStop(pool->context, worker->threadContext);
+    }
+
+    tWorker = NULL;
+
+    return NULL;
+}
+
+bool InitWorkGroup(WorkGroup* group)
+{
+    group->pending.store(0, std::memory_order_relaxed);
+
+    int result = pthread_mutex_init(&group->mutex, NULL);
+    if (0 != result)
+    {
+        errno = result;
+        return false;
+    }
+
+    result = pthread_cond_init(&group->done, NULL);
+    if (0 != result)
+    {
+        pthread_mutex_destroy(&group->mutex);
+        errno = result;
+        return false;
+    }
+
+    return true;
+}
+
+void FreeWorkGroup(WorkGroup* group)
+{
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->mutex);
+}
+
+void AwaitWorkGroup(WorkGroup* group)
+{
+    pthread_mutex_lock(&group->mutex);
+
+    while (0 != group->pending.load(std::memory_order_acquire))
+    {
+        pthread_cond_wait(&group->done, &group->mutex);
+    }
+
+    pthread_mutex_unlock(&group->mutex);
+}
+
+bool NewWorkPool(
+        WorkPool* pool,
+        int workerCount,
+        WorkThreadStart threadStart,
+        WorkThreadStop threadStop,
+        void* context)
+{
+    // One worker per CPU by default
+    if (workerCount <= 0)
+    {
+        workerCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (workerCount <= 0)
+    {
+        workerCount = 1;
+    }
+    else if (workerCount > WORK_MAX_WORKERS)
+    {
+        workerCount = WORK_MAX_WORKERS;
+    }
+
+    pool->workers = NULL;
+    pool->workerCount = 0;
+    pool->threadStart = threadStart;
+    pool->threadStop = threadStop;
+    pool->context = context;
+    pool->queueHead = NULL;
+    pool->queueTail = NULL;
+    pool->queued.store(0, std::memory_order_relaxed);
+    pool->sleepers.store(0, std::memory_order_relaxed);
+    pool->stopping.store(false, std::memory_order_relaxed);
+
+    int result = pthread_mutex_init(&pool->mutex, NULL);
+    if (0 != result)
+    {
+        errno = result;
+        return false;
+    }
+
+    result = pthread_cond_init(&pool->wakeup, NULL);
+    if (0 != result)
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        errno = result;
+        return false;
+    }
+
+    pool->workers = new (std::nothrow) WorkWorker[workerCount];
+    if (NULL == pool->workers)
+    {
+        pthread_cond_destroy(&pool->wakeup);
+        pthread_mutex_destroy(&pool->mutex);
+        errno = ENOMEM;
+        return false;
+    }
+
+    // Deques must be ready before any worker steals
+    for (int i = 0; i < workerCount; i++)
+    {
+        WorkWorker* worker = &pool->workers[i];
+        InitWorkDeque(&worker->deque);
+        worker->pool = pool;
+        worker->threadContext = NULL;
+        worker->seed = (unsigned int) i + 1;
+    }
+
+    pool->workerCount = workerCount;
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        result = pthread_create(&pool->workers[i].thread, NULL,
+                WorkerThread, &pool->workers[i]);
+
+        if (0 != result)
+        {
+            // Stop the ones already started
+            pool->workerCount = i;
+            FreeWorkPool(pool);
+            errno = result;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FreeWorkPool(WorkPool* pool)
+{
+    if (NULL == pool->workers)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping.store(true, std::memory_order_release);
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->workerCount; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    delete[] pool->workers;
+    pool->workers = NULL;
+    pool->workerCount = 0;
+
+    pthread_cond_destroy(&pool->wakeup);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+void SubmitWork(
+        WorkPool* pool,
+        WorkGroup* group,
+        WorkTask** tasks,
+        int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // Count the tasks before any of them can finish
+    if (NULL != group)
+    {
+        group->pending.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        tasks[i]->group = group;
+        tasks[i]->next = NULL;
+    }
+
+    int queued = count;
+
+    // Workers keep their own tasks, the others steal them
+    WorkWorker* worker = tWorker;
+    if ((NULL != worker) && (worker->pool == pool))
+    {
+        while ((0 != queued)
+                && PushWorkDeque(&worker->deque, tasks[count - queued]))
+        {
+            queued--;
+        }
+    }
+
+    // Outside threads, or a full deque, use the shared queue
+    if (0 != queued)
+    {
+        pthread_mutex_lock(&pool->mutex);
+
+        for (int i = count - queued; i < count; i++)
+        {
+            if (NULL == pool->queueTail)
+            {
+                pool->queueHead = tasks[i];
+            }
+            else
+            {
+                pool->queueTail->next = tasks[i];
+            }
+
+            pool->queueTail = tasks[i];
+        }
+
+        pool->queued.fetch_add(queued, std::memory_order_relaxed);
+
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    WakeWorker(pool, count > 1);
+}
@@ -0,0 +1,208 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+// pthread_t, pthread_mutex_t, pthread_cond_t
+#include <pthread.h>
+
+// std::atomic
+#include <atomic>
+
+// Cache line size, the deque ends are kept apart
+#define WORK_CACHE_LINE 64
+
+// Tasks each worker deque holds, a power of two
+#define WORK_DEQUE_CAPACITY 1024
+
+struct WorkTask;
+struct WorkGroup;
+struct WorkPool;
+
+/**
+ * Task function, runs on a worker thread.
+ *
+ * @param task task instance, may be freed by the function.
+ * @param threadContext context returned by the thread start hook.
+ */
+typedef void (*WorkFunction)(WorkTask* task, void* threadContext);
+
+/**
+ * Unit of work. Usually embedded as the first member of a bigger
+ * structure carrying the arguments.
+ */
+struct WorkTask
+{
+    // Function to run
+    WorkFunction run;
+
+    // Group to notify once done, set on submit
+    WorkGroup* group;
+
+    // Next task in the submission queue
+    WorkTask* next;
+};
+
+/**
+ * Counts the submitted tasks that are not done yet, so a thread
+ * can wait for all of them.
+ */
+struct WorkGroup
+{
+    // Tasks not done yet
+    std::atomic<long> pending;
+
+    // Guards the waiting
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+};
+
+/**
+ * Chase-Lev deque. The owning worker pushes and pops at the bottom,
+ * the other workers steal from the top.
+ */
+struct WorkDeque
+{
+    // Steal end
+    alignas(WORK_CACHE_LINE) std::atomic<long> top;
+
+    // Owner end
+    alignas(WORK_CACHE_LINE) std::atomic<long> bottom;
+
+    // Task slots
+    alignas(WORK_CACHE_LINE) std::atomic<WorkTask*> tasks[WORK_DEQUE_CAPACITY];
+};
+
+/**
+ * Worker thread of a pool.
+ */
+struct WorkWorker
+{
+    // Tasks of this worker
+    WorkDeque deque;
+
+    // Owning pool
+    WorkPool* pool;
+
+    // Thread handle
+    pthread_t thread;
+
+    // Context returned by the thread start hook
+    void* threadContext;
+
+    // Random state for picking the steal victims
+    unsigned int seed;
+};
+
+/**
+ * Called on each worker thread before it runs any task.
+ *
+ * @param context pool context.
+ * @return thread context handed to the tasks.
+ */
+typedef void* (*WorkThreadStart)(void* context);
+
+/**
+ * Called on each worker thread before it exits.
+ *
+ * @param context pool context.
+ * @param threadContext thread context.
+ */
+typedef void (*WorkThreadStop)(void* context, void* threadContext);
+
+/**
+ * Persistent pool of worker threads with work stealing. Tasks
+ * submitted by outside threads go through a shared queue, tasks
+ * submitted by the workers go to their own deques. Idle workers
+ * steal from the others before they sleep.
+ */
+struct WorkPool
+{
+    // Workers
+    WorkWorker* workers;
+    int workerCount;
+
+    // Thread hooks and their context
+    WorkThreadStart threadStart;
+    WorkThreadStop threadStop;
+    void* context;
+
+    // Guards the submission queue and the sleeping workers
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+
+    // Tasks submitted by outside threads
+    WorkTask* queueHead;
+    WorkTask* queueTail;
+
+    // Queued tasks, read without the mutex
+    std::atomic<long> queued;
+
+    // Workers sleeping or about to sleep
+    std::atomic<int> sleepers;
+
+    // Workers exit once set
+    std::atomic<bool> stopping;
+};
+
+/**
+ * Initializes the given group.
+ *
+ * @param group group instance.
+ * @return false on error, errno is set.
+ */
+bool InitWorkGroup(WorkGroup* group);
+
+/**
+ * Releases the given group, no task may be pending.
+ *
+ * @param group group instance.
+ */
+void FreeWorkGroup(WorkGroup* group);
+
+/**
+ * Blocks until all tasks of the given group are done. Must not
+ * be called from a worker of the pool running them.
+ *
+ * @param group group instance.
+ */
+void AwaitWorkGroup(WorkGroup* group);
+
+/**
+ * Starts the workers of a new pool.
+ *
+ * @param pool pool instance.
+ * @param workerCount number of workers, zero for the CPU count.
+ * @param threadStart thread start hook or NULL.
+ * @param threadStop thread stop hook or NULL.
+ * @param context context given to the hooks.
+ * @return false on error, errno is set.
+ */
+bool NewWorkPool(
+        WorkPool* pool,
+        int workerCount,
+        WorkThreadStart threadStart,
+        WorkThreadStop threadStop,
+        void* context);
+
+/**
+ * Stops and joins the workers. Tasks that are still queued are
+ * not run.
+ *
+ * @param pool pool instance.
+ */
+void FreeWorkPool(WorkPool* pool);
+
+/**
+ * Submits the given tasks to the pool.
+ *
+ * @param pool pool instance.
+ * @param group group counting the tasks, or NULL.
+ * @param tasks tasks to run.
+ * @param count number of tasks.
+ */
+void SubmitWork(
+        WorkPool* pool,
+        WorkGroup* group,
+        WorkTask** tasks,
+        int count);
+
+#endif
@@ -0,0 +1,65 @@
+#include "BufferPool.h"
+
+// malloc, free
+#include <stdlib.h>
+
+// Buffers are aligned for any type
+#define BUFFER_ALIGNMENT 16
+
+void InitBufferPool(
+		BufferPool* pool,
+		size_t bufferSize,
+		size_t buffersPerChunk)
+{
+	// Free buffers hold the free list link
+	if (bufferSize < sizeof(void*))
+	{
+		bufferSize = sizeof(void*);
+	}
+
+	pool->bufferSize = (bufferSize + BUFFER_ALIGNMENT - 1)
+			& ~((size_t) BUFFER_ALIGNMENT - 1);
+	pool->buffersPerChunk = (0 == buffersPerChunk) ? 1 : buffersPerChunk;
+	pool->freeList = NULL;
+	pool->chunks = NULL;
+}
+
+void FreeBufferPool(BufferPool* pool)
+{
+	while (NULL != pool->chunks)
+	{
+		void* chunk = pool->chunks;
+		pool->chunks = *(void**) chunk;
+
+		free(chunk);
+	}
+
+	pool->freeList = NULL;
+}
+
+bool GrowBufferPool(BufferPool* pool)
+{
+	// First aligned block of the chunk links the chunks
+	char* chunk = (char*) malloc(BUFFER_ALIGNMENT
+			+ (pool->bufferSize * pool->buffersPerChunk));
+
+	if (NULL == chunk)
+	{
+		return false;
+	}
+
+	*(void**) chunk = pool->chunks;
+	pool->chunks = chunk;
+
+	// Add the new buffers to the free list
+	char* buffer = chunk + BUFFER_ALIGNMENT;
+	for (size_t i = 0; i < pool->buffersPerChunk; i++)
+	{
+		*(void**) buffer = pool->freeList;
+		pool->freeList = buffer;
+
+		buffer += pool->bufferSize;
+	}
+
+	return true;
+}
@@ -0,0 +1,88 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+// size_t
+#include <stddef.h>
+
+/**
+ * Pool of fixed size buffers. Released buffers are kept in a
+ * free list and handed out again, memory is only allocated when
+ * the free list is empty. A pool is not thread safe, each thread
+ * owns its own pool.
+ */
+struct BufferPool
+{
+	// Size of each buffer
+	size_t bufferSize;
+
+	// Number of buffers allocated at once when the pool is empty
+	size_t buffersPerChunk;
+
+	// Released buffers, linked through their first bytes
+	void* freeList;
+
+	// Allocated chunks, linked through their first bytes
+	void* chunks;
+};
+
+/**
+ * Initializes the given pool, no memory is allocated until the
+ * first buffer is acquired.
+ *
+ * @param pool buffer pool.
+ * @param bufferSize size of each buffer.
+ * @param buffersPerChunk buffers allocated at once.
+ */
+void InitBufferPool(
+		BufferPool* pool,
+		size_t bufferSize,
+		size_t buffersPerChunk);
+
+/**
+ * Releases all memory of the given pool, including the buffers
+ * that are not returned yet.
+ *
+ * @param pool buffer pool.
+ */
+void FreeBufferPool(BufferPool* pool);
+
+/**
+ * Grows the given pool by a chunk of buffers.
+ *
+ * @param pool buffer pool.
+ * @return false if out of memory.
+ */
+bool GrowBufferPool(BufferPool* pool);
+
+/**
+ * Takes a buffer from the given pool.
+ *
+ * @param pool buffer pool.
+ * @return buffer or NULL if out of memory.
+ */
+static inline char* AcquireBuffer(BufferPool* pool)
+{
+	if ((NULL == pool->freeList) && !GrowBufferPool(pool))
+	{
+		return NULL;
+	}
+
+	void* buffer = pool->freeList;
+	pool->freeList = *(void**) buffer;
+
+	return (char*) buffer;
+}
+
+/**
+ * Returns the given buffer to its pool.
+ *
+ * @param pool buffer pool.
+ * @param buffer buffer taken from the pool.
+ */
+static inline void ReleaseBuffer(BufferPool* pool, char* buffer)
+{
+	*(void**) buffer = pool->freeList;
+	pool->freeList = buffer;
+}
+
+#endif
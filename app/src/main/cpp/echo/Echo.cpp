@@ -1,6 +1,12 @@
+#include "com_example_lutao_cmakejni_AbstractEchoActivity.h"
 #include "com_example_lutao_cmakejni_EchoClientActivity.h"
 #include "com_example_lutao_cmakejni_EchoServerActivity.h"
 #include "com_example_lutao_cmakejni_LocalEchoActivity.h"
+#include "EchoEngine.h"
+#include "EchoMetrics.h"
+#include "JniLogSink.h"
+#include "JniCache.h"
+#include "JniModules.h"
 
 // JNI
 #include <jni.h>
@@ -8,546 +14,362 @@
 // NULL
 #include <stdio.h>
 
-// va_list, vsnprintf
-#include <stdarg.h>
-
-// errno
-#include <errno.h>
-
-// strerror_r, memset
+// memcpy
 #include <string.h>
 
-// socket, bind, getsockname, listen, accept, recv, send, connect
-#include <sys/types.h>
-#include <sys/socket.h>
-
-// sockaddr_un
-#include <sys/un.h>
-
-// htons, sockaddr_in
-#include <netinet/in.h>
-
-// inet_ntop
-#include <arpa/inet.h>
-
-// close, unlink
-#include <unistd.h>
+// intptr_t
+#include <stdint.h>
 
-// offsetof
-#include <stddef.h>
+// Class of the session replies
+#define STRING_CLASS "java/lang/String"
 
-// Max log message length
-#define MAX_LOG_MESSAGE_LENGTH 256
+// Class of the direct buffer position and limit
+#define BUFFER_CLASS "java/nio/Buffer"
 
-// Max data buffer size
-#define MAX_BUFFER_SIZE 80
+// Exception thrown for buffers that are not direct
+#define ILLEGAL_ARGUMENT_CLASS "java/lang/IllegalArgumentException"
 
 /**
- * Logs the given message to the application.
+ * Throws an IOException with the message of the given error
+ * code, if it is set.
  *
  * @param env JNIEnv interface.
- * @param obj object instance.
- * @param format message format and arguments.
+ * @param error error code.
  */
-static void LogMessage(
+static void ThrowErrorException(
 		JNIEnv* env,
-		jobject obj,
-		const char* format,
-		...)
+		const std::error_code& error)
 {
-	// Cached log method ID
-	static jmethodID methodID = NULL;
-
-	// If method ID is not cached
-	if (NULL == methodID)
+	if (error)
 	{
-		// Get class from object
-		jclass clazz = env->GetObjectClass(obj);
-
-		// Get the method ID for the given method
-		methodID = env->GetMethodID(clazz, "logMessage",
-				"(Ljava/lang/String;)V");
-
-		// Release the class reference
-		env->DeleteLocalRef(clazz);
-	}
-
-	// If method is found
-	if (NULL != methodID)
-	{
-		// Format the log message
-		char buffer[MAX_LOG_MESSAGE_LENGTH];
-
-		va_list ap;
-		va_start(ap, format);
-		vsnprintf(buffer, MAX_LOG_MESSAGE_LENGTH, format, ap);
-		va_end(ap);
-
-		// Convert the buffer to a Java string
-		jstring message = env->NewStringUTF(buffer);
-
-		// If string is properly constructed
-		if (NULL != message)
-		{
-			// Log message
-			env->CallVoidMethod(obj, methodID, message);
-
-			// Release the message reference
-			env->DeleteLocalRef(message);
-		}
+		// Exception classes are cached when the library loads
+		ThrowJniException(env, "java/io/IOException",
+				error.message().c_str());
 	}
 }
 
 /**
- * Throws a new exception using the given exception class
- * and exception message.
+ * Gets the remaining bytes of the given direct buffer, from its
+ * position to its limit, without copying them.
  *
  * @param env JNIEnv interface.
- * @param className class name.
- * @param message exception message.
+ * @param buffer direct buffer.
+ * @param remaining number of remaining bytes.
+ * @return address of the position or NULL if the buffer is not
+ *         direct, an exception is thrown.
  */
-static void ThrowException(
+static char* GetBufferRemaining(
 		JNIEnv* env,
-		const char* className,
-		const char* message)
+		jobject buffer,
+		size_t* remaining)
 {
-	// Get the exception class
-	jclass clazz = env->FindClass(className);
+	char* address = (NULL != buffer)
+			? (char*) env->GetDirectBufferAddress(buffer) : NULL;
 
-	// If exception class is found
-	if (NULL != clazz)
+	if (NULL == address)
 	{
-		// Throw exception
-		env->ThrowNew(clazz, message);
-
-		// Release local class reference
-		env->DeleteLocalRef(clazz);
+		ThrowJniException(env, ILLEGAL_ARGUMENT_CLASS,
+				"Buffer is not direct.");
+		return NULL;
 	}
-}
 
-/**
- * Throws a new exception using the given exception class
- * and error message based on the error number.
- *
- * @param env JNIEnv interface.
- * @param className class name.
- * @param errnum error number.
- */
-static void ThrowErrnoException(
-		JNIEnv* env,
-		const char* className,
-		int errnum)
-{
-	char buffer[MAX_LOG_MESSAGE_LENGTH];
+	jint position = env->CallIntMethod(buffer,
+			GetCachedJniMethod(BUFFER_CLASS, "position", "()I"));
+	jint limit = env->CallIntMethod(buffer,
+			GetCachedJniMethod(BUFFER_CLASS, "limit", "()I"));
 
-	// Get message for the error number
-	if (-1 == strerror_r(errnum, buffer, MAX_LOG_MESSAGE_LENGTH))
-	{
-		strerror_r(errno, buffer, MAX_LOG_MESSAGE_LENGTH);
-	}
+	*remaining = (size_t) (limit - position);
 
-	// Throw exception
-	ThrowException(env, className, buffer);
+	return address + position;
 }
 
 /**
- * Constructs a new TCP socket.
+ * Moves the position of the given buffer over the bytes read
+ * from or written to it.
  *
  * @param env JNIEnv interface.
- * @param obj object instance.
- * @return socket descriptor.
- * @throws IOException
+ * @param buffer direct buffer.
+ * @param count number of bytes.
  */
-static int NewTcpSocket(JNIEnv* env, jobject obj)
+static void AdvanceBuffer(
+		JNIEnv* env,
+		jobject buffer,
+		size_t count)
 {
-	// Construct socket
-	LogMessage(env, obj, "Constructing a new TCP socket...");
-	int tcpSocket = socket(PF_INET, SOCK_STREAM, 0);
+	jint position = env->CallIntMethod(buffer,
+			GetCachedJniMethod(BUFFER_CLASS, "position", "()I"));
 
-	// Check if socket is properly constructed
-	if (-1 == tcpSocket)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
+	// Returns the buffer itself
+	jobject result = env->CallObjectMethod(buffer,
+			GetCachedJniMethod(BUFFER_CLASS, "position",
+					"(I)L" BUFFER_CLASS ";"),
+			position + (jint) count);
 
-	return tcpSocket;
+	env->DeleteLocalRef(result);
 }
 
-/**
- * Binds socket to a port number.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param port port number or zero for random port.
- * @throws IOException
- */
-static void BindSocketToPort(
-		JNIEnv* env,
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartTcpClient
+		(JNIEnv* env,
 		jobject obj,
-		int sd,
-		unsigned short port)
+		jstring ip,
+		jint port,
+		jstring message)
 {
-	struct sockaddr_in address;
-
-	// Address to bind socket
-	memset(&address, 0, sizeof(address));
-	address.sin_family = PF_INET;
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-	// Bind to all addresses
-	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	std::error_code error;
 
-	// Convert port to network byte order
-	address.sin_port = htons(port);
+	// Get IP address and message as C strings
+	const char* ipAddress = env->GetStringUTFChars(ip, NULL);
+	const char* messageText = (NULL != ipAddress)
+			? env->GetStringUTFChars(message, NULL) : NULL;
 
-	// Bind socket
-	LogMessage(env, obj, "Binding to port %hu.", port);
-	if (-1 == bind(sd, (struct sockaddr*) &address, sizeof(address)))
+	if (NULL != messageText)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		RunTcpEchoClient(ipAddress, (unsigned short) port,
+				messageText, error);
 	}
-}
-
-/**
- * Gets the port number socket is currently binded.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @return port number.
- * @throws IOException
- */
-static unsigned short GetSocketPort(
-		JNIEnv* env,
-		jobject obj,
-		int sd)
-{
-	unsigned short port = 0;
-
-	struct sockaddr_in address;
-	socklen_t addressLength = sizeof(address);
 
-	// Get the socket address
-	if (-1 == getsockname(sd, (struct sockaddr*) &address, &addressLength))
+	// Release the strings
+	if (NULL != messageText)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		env->ReleaseStringUTFChars(message, messageText);
 	}
-	else
-	{
-		// Convert port to host byte order
-		port = ntohs(address.sin_port);
 
-		LogMessage(env, obj, "Binded to random port %hu.", port);
+	if (NULL != ipAddress)
+	{
+		env->ReleaseStringUTFChars(ip, ipAddress);
 	}
 
-	return port;
+	CloseLogTarget(env);
+
+	ThrowErrorException(env, error);
 }
 
 /**
- * Listens on given socket with the given backlog for
- * pending connections. When the backlog is full, the
- * new connections will be rejected.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param backlog backlog size.
- * @throws IOException
+ * Replies of a session call, collected into a Java string array.
  */
-static void ListenOnSocket(
-		JNIEnv* env,
-		jobject obj,
-		int sd,
-		int backlog)
+struct SessionReplies
 {
-	// Listen on socket with the given backlog
-	LogMessage(env, obj,
-			"Listening on socket with a backlog of %d pending connections.",
-			backlog);
+	// JNIEnv interface
+	JNIEnv* env;
 
-	if (-1 == listen(sd, backlog))
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
-}
+	// Echoed messages
+	jobjectArray replies;
+
+	// NULL terminated copy of the current reply
+	char* text;
+
+	// Text buffer size
+	size_t textSize;
+};
 
 /**
- * Logs the IP address and the port number from the
- * given address.
+ * Stores the given reply in the string array.
  *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param message message text.
- * @param address adress instance.
- * @throws IOException
+ * @param context session replies.
+ * @param index index of the message.
+ * @param reply reply data.
+ * @param size reply size.
  */
-static void LogAddress(
-		JNIEnv* env,
-		jobject obj,
-		const char* message,
-		const struct sockaddr_in* address)
+static void AddSessionReply(
+		void* context,
+		size_t index,
+		const char* reply,
+		size_t size)
 {
-	char ip[INET_ADDRSTRLEN];
+	SessionReplies* replies = (SessionReplies*) context;
+	JNIEnv* env = replies->env;
+
+	// Skip the rest once a string could not be made
+	if (NULL != env->ExceptionOccurred())
+		return;
 
-	// Convert the IP address to string
-	if (NULL == inet_ntop(PF_INET,
-			&(address->sin_addr),
-			ip,
-			INET_ADDRSTRLEN))
+	// Java strings are made from NULL terminated text
+	if (size >= replies->textSize)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		delete[] replies->text;
+		replies->textSize = size + 1;
+		replies->text = new char[replies->textSize];
 	}
-	else
+
+	memcpy(replies->text, reply, size);
+	replies->text[size] = '\0';
+
+	jstring replyString = env->NewStringUTF(replies->text);
+	if (NULL != replyString)
 	{
-		// Convert port to host byte order
-		unsigned short port = ntohs(address->sin_port);
+		env->SetObjectArrayElement(replies->replies, (jsize) index,
+				replyString);
 
-		// Log address
-		LogMessage(env, obj, "%s %s:%hu.", message, ip, port);
+		// Array holds the string now
+		env->DeleteLocalRef(replyString);
 	}
 }
 
-/**
- * Blocks and waits for incoming client connections on the
- * given socket.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @return client socket.
- * @throws IOException
- */
-static int AcceptOnSocket(
-		JNIEnv* env,
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpBuffer
+		(JNIEnv* env,
 		jobject obj,
-		int sd)
+		jstring ip,
+		jint port,
+		jobject message,
+		jobject reply)
 {
-	struct sockaddr_in address;
-	socklen_t addressLength = sizeof(address);
+	size_t messageSize = 0;
+	size_t replySize = 0;
+	size_t receivedSize = 0;
 
-	// Blocks and waits for an incoming client connection
-	// and accepts it
-	LogMessage(env, obj, "Waiting for a client connection...");
+	// Data is read and written in place
+	const char* messageData = GetBufferRemaining(env, message, &messageSize);
+	char* replyData = (NULL != messageData)
+			? GetBufferRemaining(env, reply, &replySize) : NULL;
 
-	int clientSocket = accept(sd,
-			(struct sockaddr*) &address,
-			&addressLength);
+	if (NULL == replyData)
+		return 0;
 
-	// If client socket is not valid
-	if (-1 == clientSocket)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
-	else
+	// Log messages to the object
+	OpenLogTarget(env, obj);
+
+	std::error_code error;
+
+	// Get IP address as C string
+	const char* ipAddress = env->GetStringUTFChars(ip, NULL);
+	if (NULL != ipAddress)
 	{
-		// Log address
-		LogAddress(env, obj, "Client connection from ", &address);
+		receivedSize = ExchangeTcpEcho(ipAddress, (unsigned short) port,
+				messageData, messageSize, replyData, replySize, error);
+
+		// Release the IP address
+		env->ReleaseStringUTFChars(ip, ipAddress);
 	}
 
-	return clientSocket;
-}
+	CloseLogTarget(env);
 
-/**
- * Block and receive data from the socket into the buffer.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param buffer data buffer.
- * @param bufferSize buffer size.
- * @return receive size.
- * @throws IOException
- */
-static ssize_t ReceiveFromSocket(
-		JNIEnv* env,
-		jobject obj,
-		int sd,
-		char* buffer,
-		size_t bufferSize)
-{
-	// Block and receive data from the socket into the buffer
-	LogMessage(env, obj, "Receiving from the socket...");
-	ssize_t recvSize = recv(sd, buffer, bufferSize - 1, 0);
-
-	// If receive is failed
-	if (-1 == recvSize)
+	if ((NULL != ipAddress) && !error)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		AdvanceBuffer(env, message, messageSize);
+		AdvanceBuffer(env, reply, receivedSize);
 	}
-	else
-	{
-		// NULL terminate the buffer to make it a string
-		buffer[recvSize] = NULL;
 
-		// If data is received
-		if (recvSize > 0)
-		{
-			LogMessage(env, obj, "Received %d bytes: %s", recvSize, buffer);
-		}
-		else
-		{
-			LogMessage(env, obj, "Client disconnected.");
-		}
-	}
+	ThrowErrorException(env, error);
 
-	return recvSize;
+	return (jint) receivedSize;
 }
 
-/**
- * Send data buffer to the socket.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param buffer data buffer.
- * @param bufferSize buffer size.
- * @return sent size.
- * @throws IOException
- */
-static ssize_t SendToSocket(
-		JNIEnv* env,
+JNIEXPORT jlong JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeOpenTcpSession
+		(JNIEnv* env,
 		jobject obj,
-		int sd,
-		const char* buffer,
-		size_t bufferSize)
+		jstring ip,
+		jint port)
 {
-	// Send data buffer to the socket
-	LogMessage(env, obj, "Sending to the socket...");
-	ssize_t sentSize = send(sd, buffer, bufferSize, 0);
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-	// If send is failed
-	if (-1 == sentSize)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
-	else
+	std::error_code error;
+	TcpEchoSession* session = NULL;
+
+	// Get IP address as C string
+	const char* ipAddress = env->GetStringUTFChars(ip, NULL);
+	if (NULL != ipAddress)
 	{
-		if (sentSize > 0)
-		{
-			LogMessage(env, obj, "Sent %d bytes: %s", sentSize, buffer);
-		}
-		else
-		{
-			LogMessage(env, obj, "Client disconnected.");
-		}
+		session = OpenTcpEchoSession(ipAddress, (unsigned short) port, error);
+
+		// Release the IP address
+		env->ReleaseStringUTFChars(ip, ipAddress);
 	}
 
-	return sentSize;
+	CloseLogTarget(env);
+
+	ThrowErrorException(env, error);
+
+	return (jlong) (intptr_t) session;
 }
 
-/**
- * Connects to given IP address and given port.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param ip IP address.
- * @param port port number.
- * @throws IOException
- */
-static void ConnectToAddress(
-		JNIEnv* env,
+JNIEXPORT jobjectArray JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpSession
+		(JNIEnv* env,
 		jobject obj,
-		int sd,
-		const char* ip,
-		unsigned short port)
+		jlong session,
+		jobjectArray messages)
 {
-	// Connecting to given IP address and given port
-	LogMessage(env, obj, "Connecting to %s:%uh...", ip, port);
+	// Log messages to the object
+	OpenLogTarget(env, obj);
+
+	std::error_code error;
+	jsize count = env->GetArrayLength(messages);
 
-	struct sockaddr_in address;
+	// Message strings, their texts and sizes
+	jstring* strings = new jstring[count];
+	const char** texts = new const char*[count];
+	size_t* sizes = new size_t[count];
+	jsize gotCount = 0;
 
-	memset(&address, 0, sizeof(address));
-	address.sin_family = PF_INET;
+	SessionReplies replies;
+	replies.env = env;
+	replies.replies = NULL;
+	replies.text = NULL;
+	replies.textSize = 0;
 
-	// Convert IP address string to Internet address
-	if (0 == inet_aton(ip, &(address.sin_addr)))
+	// Each message holds a local reference until the call ends
+	if (0 == env->EnsureLocalCapacity(count + 4))
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		replies.replies = env->NewObjectArray(count,
+				GetCachedJniClass(STRING_CLASS), NULL);
 	}
-	else
-	{
-		// Convert port to network byte order
-		address.sin_port = htons(port);
 
-		// Connect to address
-		if (-1 == connect(sd, (const sockaddr*) &address, sizeof(address)))
+	if (NULL != replies.replies)
+	{
+		// Get messages as C strings
+		for (; gotCount < count; gotCount++)
 		{
-			// Throw an exception with error number
-			ThrowErrnoException(env, "java/io/IOException", errno);
+			strings[gotCount] = (jstring) env->GetObjectArrayElement(
+					messages, gotCount);
+			texts[gotCount] = env->GetStringUTFChars(strings[gotCount], NULL);
+
+			if (NULL == texts[gotCount])
+			{
+				env->DeleteLocalRef(strings[gotCount]);
+				break;
+			}
+
+			sizes[gotCount] = (size_t) env->GetStringUTFLength(
+					strings[gotCount]);
 		}
-		else
+
+		// Send all messages pipelined over the connection
+		if (gotCount == count)
 		{
-			LogMessage(env, obj, "Connected.");
+			SendTcpEchoSession((TcpEchoSession*) (intptr_t) session,
+					texts, sizes, (size_t) count,
+					AddSessionReply, &replies, error);
 		}
 	}
-}
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartTcpClient
-		(JNIEnv* env,
-		jobject obj,
-		jstring ip,
-		jint port,
-		jstring message)
-{
-	// Construct a new TCP socket.
-	int clientSocket = NewTcpSocket(env, obj);
-	if (NULL == env->ExceptionOccurred())
+	// Release the messages
+	for (jsize i = 0; i < gotCount; i++)
 	{
-		// Get IP address as C string
-		const char* ipAddress = env->GetStringUTFChars(ip, NULL);
-		if (NULL == ipAddress)
-			goto exit;
-
-		// Connect to IP address and port
-		ConnectToAddress(env, obj, clientSocket, ipAddress,
-				(unsigned short) port);
-
-		// Release the IP address
-		env->ReleaseStringUTFChars(ip, ipAddress);
-
-		// If connection was successful
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
-
-		// Get message as C string
-		const char* messageText = env->GetStringUTFChars(message, NULL);
-		if (NULL == messageText)
-			goto exit;
-
-		// Get the message size
-		jsize messageSize = env->GetStringUTFLength(message);
-
-		// Send message to socket
-		SendToSocket(env, obj, clientSocket, messageText, messageSize);
+		env->ReleaseStringUTFChars(strings[i], texts[i]);
+		env->DeleteLocalRef(strings[i]);
+	}
 
-		// Release the message text
-		env->ReleaseStringUTFChars(message, messageText);
+	delete[] strings;
+	delete[] texts;
+	delete[] sizes;
+	delete[] replies.text;
 
-		// If send was not successful
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	CloseLogTarget(env);
 
-		char buffer[MAX_BUFFER_SIZE];
+	ThrowErrorException(env, error);
 
-		// Receive from the socket
-		ReceiveFromSocket(env, obj, clientSocket, buffer, MAX_BUFFER_SIZE);
-	}
+	return replies.replies;
+}
 
-exit:
-	if (clientSocket > 0)
-	{
-		close(clientSocket);
-	}
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeCloseTcpSession
+		(JNIEnv* env,
+		jobject obj,
+		jlong session)
+{
+	CloseTcpEchoSession((TcpEchoSession*) (intptr_t) session);
 }
 
 JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpServer
@@ -555,504 +377,522 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_native
 		jobject obj,
 		jint port)
 {
-	// Construct a new TCP socket.
-	int serverSocket = NewTcpSocket(env, obj);
-	if (NULL == env->ExceptionOccurred())
-	{
-		// Bind socket to a port number
-		BindSocketToPort(env, obj, serverSocket, (unsigned short) port);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// If random port number is requested
-		if (0 == port)
-		{
-			// Get the port number socket is currently binded
-			GetSocketPort(env, obj, serverSocket);
-			if (NULL != env->ExceptionOccurred())
-				goto exit;
-		}
+	std::error_code error;
+	RunTcpEchoServer((unsigned short) port, error);
 
-		// Listen on socket with a backlog of 4 pending connections
-		ListenOnSocket(env, obj, serverSocket, 4);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	CloseLogTarget(env);
 
-		// Accept a client connection on socket
-		int clientSocket = AcceptOnSocket(env, obj, serverSocket);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	ThrowErrorException(env, error);
+}
 
-		char buffer[MAX_BUFFER_SIZE];
-		ssize_t recvSize;
-		ssize_t sentSize;
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpReactorServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// Receive and send back the data
-		while (1)
-		{
-			// Receive from the socket
-			recvSize = ReceiveFromSocket(env, obj, clientSocket,
-					buffer, MAX_BUFFER_SIZE);
+	std::error_code error;
+	RunTcpReactorEchoServer((unsigned short) port, error);
 
-			if ((0 == recvSize) || (NULL != env->ExceptionOccurred()))
-				break;
+	CloseLogTarget(env);
 
-			// Send to the socket
-			sentSize = SendToSocket(env, obj, clientSocket,
-					buffer, (size_t) recvSize);
+	ThrowErrorException(env, error);
+}
 
-			if ((0 == sentSize) || (NULL != env->ExceptionOccurred()))
-				break;
-		}
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpFramedServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// Close the client socket
-		close(clientSocket);
-	}
+	std::error_code error;
+	RunTcpFramedEchoServer((unsigned short) port, error);
 
-exit:
-	if (serverSocket > 0)
-	{
-		close(serverSocket);
-	}
+	CloseLogTarget(env);
+
+	ThrowErrorException(env, error);
 }
 
-/**
- * Constructs a new UDP socket.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @return socket descriptor.
- * @throws IOException
- */
-static int NewUdpSocket(JNIEnv* env, jobject obj)
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpMultiReactorServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port,
+		jint threads)
 {
-	// Construct socket
-	LogMessage(env, obj, "Constructing a new UDP socket...");
-	int udpSocket = socket(PF_INET, SOCK_DGRAM, 0);
+	// Log messages to the object, the reactor threads included
+	OpenLogTarget(env, obj);
 
-	// Check if socket is properly constructed
-	if (-1 == udpSocket)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
+	std::error_code error;
+	RunTcpMultiReactorEchoServer((unsigned short) port, threads, error);
+
+	CloseLogTarget(env);
 
-	return udpSocket;
+	ThrowErrorException(env, error);
 }
 
-/**
- * Block and receive datagram from the socket into
- * the buffer, and populate the client address.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param address client address.
- * @param buffer data buffer.
- * @param bufferSize buffer size.
- * @return receive size.
- * @throws IOException
- */
-static ssize_t ReceiveDatagramFromSocket(
-		JNIEnv* env,
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartUdpClient
+		(JNIEnv* env,
 		jobject obj,
-		int sd,
-		struct sockaddr_in* address,
-		char* buffer,
-		size_t bufferSize)
+		jstring ip,
+		jint port,
+		jstring message)
 {
-	socklen_t addressLength = sizeof(struct sockaddr_in);
-
-	// Receive datagram from socket
-	LogMessage(env, obj, "Receiving from the socket...");
-	ssize_t recvSize = recvfrom(sd, buffer, bufferSize, 0,
-			(struct sockaddr*) address,
-			&addressLength);
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-	// If receive is failed
-	if (-1 == recvSize)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
-	else
-	{
-		// Log address
-		LogAddress(env, obj, "Received from", address);
+	std::error_code error;
 
-		// NULL terminate the buffer to make it a string
-		buffer[recvSize] = NULL;
+	// Get IP address and message as C strings
+	const char* ipAddress = env->GetStringUTFChars(ip, NULL);
+	const char* messageText = (NULL != ipAddress)
+			? env->GetStringUTFChars(message, NULL) : NULL;
 
-		// If data is received
-		if (recvSize > 0)
-		{
-			LogMessage(env, obj, "Received %d bytes: %s", recvSize, buffer);
-		}
+	if (NULL != messageText)
+	{
+		RunUdpEchoClient(ipAddress, (unsigned short) port,
+				messageText, error);
 	}
 
-	return recvSize;
-}
-
-/**
- * Sends datagram to the given address using the given socket.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param address remote address.
- * @param buffer data buffer.
- * @param bufferSize buffer size.
- * @return sent size.
- * @throws IOException
- */
-static ssize_t SendDatagramToSocket(
-		JNIEnv* env,
-		jobject obj,
-		int sd,
-		const struct sockaddr_in* address,
-		const char* buffer,
-		size_t bufferSize)
-{
-	// Send data buffer to the socket
-	LogAddress(env, obj, "Sending to", address);
-	ssize_t sentSize = sendto(sd, buffer, bufferSize, 0,
-			(const sockaddr*) address,
-			sizeof(struct sockaddr_in));
-
-	// If send is failed
-	if (-1 == sentSize)
+	// Release the strings
+	if (NULL != messageText)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		env->ReleaseStringUTFChars(message, messageText);
 	}
-	else if (sentSize > 0)
+
+	if (NULL != ipAddress)
 	{
-		LogMessage(env, obj, "Sent %d bytes: %s", sentSize, buffer);
+		env->ReleaseStringUTFChars(ip, ipAddress);
 	}
 
-	return sentSize;
+	CloseLogTarget(env);
+
+	ThrowErrorException(env, error);
 }
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartUdpClient
-        (JNIEnv* env,
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendUdpBuffer
+		(JNIEnv* env,
 		jobject obj,
 		jstring ip,
 		jint port,
-		jstring message)
+		jobject message,
+		jobject reply)
 {
-	// Construct a new UDP socket.
-	int clientSocket = NewUdpSocket(env, obj);
-	if (NULL == env->ExceptionOccurred())
-	{
-		struct sockaddr_in address;
+	size_t messageSize = 0;
+	size_t replySize = 0;
+	size_t receivedSize = 0;
+
+	// Data is read and written in place
+	const char* messageData = GetBufferRemaining(env, message, &messageSize);
+	char* replyData = (NULL != messageData)
+			? GetBufferRemaining(env, reply, &replySize) : NULL;
 
-		memset(&address, 0, sizeof(address));
-		address.sin_family = PF_INET;
+	if (NULL == replyData)
+		return 0;
 
-		// Get IP address as C string
-		const char* ipAddress = env->GetStringUTFChars(ip, NULL);
-		if (NULL == ipAddress)
-			goto exit;
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// Convert IP address string to Internet address
-		int result = inet_aton(ipAddress, &(address.sin_addr));
+	std::error_code error;
+
+	// Get IP address as C string
+	const char* ipAddress = env->GetStringUTFChars(ip, NULL);
+	if (NULL != ipAddress)
+	{
+		receivedSize = ExchangeUdpEcho(ipAddress, (unsigned short) port,
+				messageData, messageSize, replyData, replySize, error);
 
 		// Release the IP address
 		env->ReleaseStringUTFChars(ip, ipAddress);
+	}
 
-		// If conversion is failed
-		if (0 == result)
-		{
-			// Throw an exception with error number
-			ThrowErrnoException(env, "java/io/IOException", errno);
-			goto exit;
-		}
+	CloseLogTarget(env);
 
-		// Convert port to network byte order
-		address.sin_port = htons(port);
+	if ((NULL != ipAddress) && !error)
+	{
+		AdvanceBuffer(env, message, messageSize);
+		AdvanceBuffer(env, reply, receivedSize);
+	}
 
-		// Get message as C string
-		const char* messageText = env->GetStringUTFChars(message, NULL);
-		if (NULL == messageText)
-			goto exit;
+	ThrowErrorException(env, error);
 
-		// Get the message size
-		jsize messageSize = env->GetStringUTFLength(message);
+	return (jint) receivedSize;
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// Send message to socket
-		SendDatagramToSocket(env, obj, clientSocket, &address,
-				messageText, messageSize);
+	std::error_code error;
+	RunUdpEchoServer((unsigned short) port, error);
 
-		// Release the message text
-		env->ReleaseStringUTFChars(message, messageText);
+	CloseLogTarget(env);
 
-		// If send was not successful
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	ThrowErrorException(env, error);
+}
 
-		char buffer[MAX_BUFFER_SIZE];
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpBatchServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port,
+		jint batchSize)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// Clear address
-		memset(&address, 0, sizeof(address));
+	std::error_code error;
+	RunUdpBatchEchoServer((unsigned short) port, batchSize, error);
 
-		// Receive from the socket
-		ReceiveDatagramFromSocket(env, obj, clientSocket, &address,
-				buffer, MAX_BUFFER_SIZE);
-	}
+	CloseLogTarget(env);
 
-exit:
-	if (clientSocket > 0)
-	{
-		close(clientSocket);
-	}
+	ThrowErrorException(env, error);
 }
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpServer
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpUringServer
 		(JNIEnv* env,
 		jobject obj,
 		jint port)
 {
-	// Construct a new UDP socket.
-	int serverSocket = NewUdpSocket(env, obj);
-	if (NULL == env->ExceptionOccurred())
-	{
-		// Bind socket to a port number
-		BindSocketToPort(env, obj, serverSocket, (unsigned short) port);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		// If random port number is requested
-		if (0 == port)
-		{
-			// Get the port number socket is currently binded
-			GetSocketPort(env, obj, serverSocket);
-			if (NULL != env->ExceptionOccurred())
-				goto exit;
-		}
+	std::error_code error;
+	RunTcpUringEchoServer((unsigned short) port, error);
 
-		// Client address
-		struct sockaddr_in address;
-		memset(&address, 0, sizeof(address));
+	CloseLogTarget(env);
 
-		char buffer[MAX_BUFFER_SIZE];
-		ssize_t recvSize;
-		ssize_t sentSize;
+	ThrowErrorException(env, error);
+}
 
-		// Receive from the socket
-		recvSize = ReceiveDatagramFromSocket(env, obj, serverSocket,
-				&address, buffer, MAX_BUFFER_SIZE);
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpUringServer
+		(JNIEnv* env,
+		jobject obj,
+		jint port)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-		if ((0 == recvSize) || (NULL != env->ExceptionOccurred()))
-			goto exit;
+	std::error_code error;
+	RunUdpUringEchoServer((unsigned short) port, error);
 
-		// Send to the socket
-		sentSize = SendDatagramToSocket(env, obj, serverSocket,
-				&address, buffer, (size_t) recvSize);
-	}
+	CloseLogTarget(env);
 
-exit:
-	if (serverSocket > 0)
-	{
-		close(serverSocket);
-	}
+	ThrowErrorException(env, error);
 }
 
 /**
- * Constructs a new Local UNIX socket.
+ * Runs the given local server with the name as C string.
  *
  * @param env JNIEnv interface.
  * @param obj object instance.
- * @return socket descriptor.
- * @throws IOException
+ * @param name socket name.
+ * @param server local echo server.
  */
-static int NewLocalSocket(JNIEnv* env, jobject obj)
+static void RunLocalServer(
+		JNIEnv* env,
+		jobject obj,
+		jstring name,
+		void (*server)(const char* name, std::error_code& error))
 {
-	// Construct socket
-	LogMessage(env, obj, "Constructing a new Local UNIX socket...");
-	int localSocket = socket(PF_LOCAL, SOCK_STREAM, 0);
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-	// Check if socket is properly constructed
-	if (-1 == localSocket)
+	std::error_code error;
+
+	// Get name as C string
+	const char* nameText = env->GetStringUTFChars(name, NULL);
+	if (NULL != nameText)
 	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
+		server(nameText, error);
+
+		// Release the name text
+		env->ReleaseStringUTFChars(name, nameText);
 	}
 
-	return localSocket;
+	CloseLogTarget(env);
+
+	ThrowErrorException(env, error);
 }
 
-/**
- * Binds a local UNIX socket to a name.
- *
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @param name socket name.
- * @throws IOException
- */
-static void BindLocalSocketToName(
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalServer(
+		JNIEnv* env,
+		jobject obj,
+		jstring name)
+{
+	RunLocalServer(env, obj, name, RunLocalEchoServer);
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalUringServer(
+		JNIEnv* env,
+		jobject obj,
+		jstring name)
+{
+	RunLocalServer(env, obj, name, RunLocalUringEchoServer);
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmServer(
 		JNIEnv* env,
 		jobject obj,
-		int sd,
-		const char* name)
+		jstring name)
 {
-	struct sockaddr_un address;
+	RunLocalServer(env, obj, name, RunLocalShmEchoServer);
+}
 
-	// Name length
-	const size_t nameLength = strlen(name);
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmClient(
+		JNIEnv* env,
+		jobject obj,
+		jstring name,
+		jstring message)
+{
+	// Log messages to the object
+	OpenLogTarget(env, obj);
 
-	// Path length is initiall equal to name length
-	size_t pathLength = nameLength;
+	std::error_code error;
 
-	// If name is not starting with a slash it is
-	// in the abstract namespace
-	bool abstractNamespace = ('/' != name[0]);
+	// Get name and message as C strings
+	const char* nameText = env->GetStringUTFChars(name, NULL);
+	const char* messageText = (NULL != nameText)
+			? env->GetStringUTFChars(message, NULL) : NULL;
 
-	// Abstract namespace requires having the first
-	// byte of the path to be the zero byte, update
-	// the path length to include the zero byte
-	if (abstractNamespace)
+	if (NULL != messageText)
 	{
-		pathLength++;
+		RunLocalShmEchoClient(nameText, messageText, error);
 	}
 
-	// Check the path length
-	if (pathLength > sizeof(address.sun_path))
+	// Release the strings
+	if (NULL != messageText)
 	{
-		// Throw an exception with error number
-		ThrowException(env, "java/io/IOException", "Name is too big.");
+		env->ReleaseStringUTFChars(message, messageText);
 	}
-	else
-	{
-		// Clear the address bytes
-		memset(&address, 0, sizeof(address));
-		address.sun_family = PF_LOCAL;
 
-		// Socket path
-		char* sunPath = address.sun_path;
-
-		// First byte must be zero to use the abstract namespace
-		if (abstractNamespace)
-		{
-			*sunPath++ = NULL;
-		}
-
-		// Append the local name
-		strcpy(sunPath, name);
-
-		// Address length
-		socklen_t addressLength =
-				(offsetof(struct sockaddr_un, sun_path))
-				+ pathLength;
-
-		// Unlink if the socket name is already binded
-		unlink(address.sun_path);
+	if (NULL != nameText)
+	{
+		env->ReleaseStringUTFChars(name, nameText);
+	}
 
-		// Bind socket
-		LogMessage(env, obj, "Binding to local name %s%s.",
-				(abstractNamespace) ? "(null)" : "",
-				name);
+	CloseLogTarget(env);
 
-		if (-1 == bind(sd, (struct sockaddr*) &address, addressLength))
-		{
-			// Throw an exception with error number
-			ThrowErrnoException(env, "java/io/IOException", errno);
-		}
-	}
+	ThrowErrorException(env, error);
 }
 
-/**
- * Blocks and waits for incoming client connections on the
- * given socket.
- * @param env JNIEnv interface.
- * @param obj object instance.
- * @param sd socket descriptor.
- * @return client socket.
- * @throws IOException
- */
-static int AcceptOnLocalSocket(
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeSendLocalBuffer(
 		JNIEnv* env,
 		jobject obj,
-		int sd)
+		jstring name,
+		jobject message,
+		jobject reply)
 {
-	// Blocks and waits for an incoming client connection
-	// and accepts it
-	LogMessage(env, obj, "Waiting for a client connection...");
-	int clientSocket = accept(sd, NULL, NULL);
+	size_t messageSize = 0;
+	size_t replySize = 0;
+	size_t receivedSize = 0;
 
-	// If client socket is not valid
-	if (-1 == clientSocket)
-	{
-		// Throw an exception with error number
-		ThrowErrnoException(env, "java/io/IOException", errno);
-	}
+	// Data is read and written in place
+	const char* messageData = GetBufferRemaining(env, message, &messageSize);
+	char* replyData = (NULL != messageData)
+			? GetBufferRemaining(env, reply, &replySize) : NULL;
 
-	return clientSocket;
-}
+	if (NULL == replyData)
+		return 0;
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalServer(
-		JNIEnv* env,
-		jobject obj,
-		jstring name)
-{
-	// Construct a new local UNIX socket.
-	int serverSocket = NewLocalSocket(env, obj);
-	if (NULL == env->ExceptionOccurred())
-	{
-		// Get name as C string
-		const char* nameText = env->GetStringUTFChars(name, NULL);
-		if (NULL == nameText)
-			goto exit;
+	// Log messages to the object
+	OpenLogTarget(env, obj);
+
+	std::error_code error;
 
-		// Bind socket to a port number
-		BindLocalSocketToName(env, obj, serverSocket, nameText);
+	// Get name as C string
+	const char* nameText = env->GetStringUTFChars(name, NULL);
+	if (NULL != nameText)
+	{
+		receivedSize = ExchangeLocalEcho(nameText,
+				messageData, messageSize, replyData, replySize, error);
 
 		// Release the name text
 		env->ReleaseStringUTFChars(name, nameText);
+	}
 
-		// If bind is failed
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
-
-		// Listen on socket with a backlog of 4 pending connections
-		ListenOnSocket(env, obj, serverSocket, 4);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	CloseLogTarget(env);
 
-		// Accept a client connection on socket
-		int clientSocket = AcceptOnLocalSocket(env, obj, serverSocket);
-		if (NULL != env->ExceptionOccurred())
-			goto exit;
+	if ((NULL != nameText) && !error)
+	{
+		AdvanceBuffer(env, message, messageSize);
+		AdvanceBuffer(env, reply, receivedSize);
+	}
 
-		char buffer[MAX_BUFFER_SIZE];
-		ssize_t recvSize;
-		ssize_t sentSize;
+	ThrowErrorException(env, error);
 
-		// Receive and send back the data
-		while (1)
-		{
-			// Receive from the socket
-			recvSize = ReceiveFromSocket(env, obj, clientSocket,
-					buffer, MAX_BUFFER_SIZE);
+	return (jint) receivedSize;
+}
 
-			if ((0 == recvSize) || (NULL != env->ExceptionOccurred()))
-				break;
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetLogLevel(
+		JNIEnv* env,
+		jclass clazz,
+		jint level)
+{
+	SetLogLevel(level);
+}
 
-			// Send to the socket
-			sentSize = SendToSocket(env, obj, clientSocket,
-					buffer, (size_t) recvSize);
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetBufferSize(
+		JNIEnv* env,
+		jclass clazz,
+		jint bufferSize)
+{
+	// Negative sizes are raised to the minimum
+	SetEchoBufferSize((bufferSize > 0) ? (size_t) bufferSize : 0);
+}
 
-			if ((0 == sentSize) || (NULL != env->ExceptionOccurred()))
-				break;
-		}
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetZeroCopy(
+		JNIEnv* env,
+		jclass clazz,
+		jboolean enabled)
+{
+	SetEchoZeroCopy(JNI_TRUE == enabled);
+}
 
-		// Close the client socket
-		close(clientSocket);
-	}
+JNIEXPORT jlongArray JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeGetMetrics(
+		JNIEnv* env,
+		jclass clazz)
+{
+	int64_t values[ECHO_METRICS_SNAPSHOT_SIZE];
+	size_t count = SnapshotEchoMetrics(values, ECHO_METRICS_SNAPSHOT_SIZE);
 
-exit:
-	if (serverSocket > 0)
+	jlongArray metrics = env->NewLongArray((jsize) count);
+	if (NULL != metrics)
 	{
-		close(serverSocket);
+		env->SetLongArrayRegion(metrics, 0, (jsize) count,
+				(const jlong*) values);
 	}
+
+	return metrics;
+}
+
+// Snapshot layout known to the Java side
+static_assert(com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_WOULD_BLOCK
+		== ECHO_COUNTER_WOULD_BLOCK, "Counter indexes differ.");
+static_assert(com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_QUEUE_DEPTH
+		== ECHO_COUNTER_COUNT
+				+ (ECHO_HISTOGRAM_QUEUE_DEPTH * ECHO_HISTOGRAM_SNAPSHOT_SIZE),
+		"Histogram indexes differ.");
+static_assert(com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_BUCKET_COUNT
+		== ECHO_HISTOGRAM_BUCKETS, "Bucket counts differ.");
+static_assert(sizeof(jlong) == sizeof(int64_t), "Metrics are 64 bit.");
+
+// Classes whose native methods are registered on load
+#define ABSTRACT_ECHO_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/echo/AbstractEchoActivity"
+#define ECHO_CLIENT_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/echo/EchoClientActivity"
+#define ECHO_SERVER_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/echo/EchoServerActivity"
+#define LOCAL_ECHO_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/echo/LocalEchoActivity"
+
+// Native methods of the activities
+static const JNINativeMethod gAbstractEchoActivityMethods[] =
+{
+	{ "nativeSetLogLevel", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetLogLevel },
+	{ "nativeSetBufferSize", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetBufferSize },
+	{ "nativeSetZeroCopy", "(Z)V",
+			(void*) Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetZeroCopy },
+	{ "nativeGetMetrics", "()[J",
+			(void*) Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeGetMetrics },
+};
+
+static const JNINativeMethod gEchoClientActivityMethods[] =
+{
+	{ "nativeStartTcpClient", "(Ljava/lang/String;ILjava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartTcpClient },
+	{ "nativeStartUdpClient", "(Ljava/lang/String;ILjava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartUdpClient },
+	{ "nativeSendTcpBuffer",
+			"(Ljava/lang/String;ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpBuffer },
+	{ "nativeSendUdpBuffer",
+			"(Ljava/lang/String;ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendUdpBuffer },
+	{ "nativeOpenTcpSession", "(Ljava/lang/String;I)J",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeOpenTcpSession },
+	{ "nativeSendTcpSession", "(J[Ljava/lang/String;)[Ljava/lang/String;",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpSession },
+	{ "nativeCloseTcpSession", "(J)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoClientActivity_nativeCloseTcpSession },
+};
+
+static const JNINativeMethod gEchoServerActivityMethods[] =
+{
+	{ "nativeStartTcpServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpServer },
+	{ "nativeStartUdpServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpServer },
+	{ "nativeStartTcpReactorServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpReactorServer },
+	{ "nativeStartTcpFramedServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpFramedServer },
+	{ "nativeStartTcpMultiReactorServer", "(II)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpMultiReactorServer },
+	{ "nativeStartUdpBatchServer", "(II)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpBatchServer },
+	{ "nativeStartTcpUringServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpUringServer },
+	{ "nativeStartUdpUringServer", "(I)V",
+			(void*) Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpUringServer },
+};
+
+static const JNINativeMethod gLocalEchoActivityMethods[] =
+{
+	{ "nativeStartLocalServer", "(Ljava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalServer },
+	{ "nativeStartLocalUringServer", "(Ljava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalUringServer },
+	{ "nativeStartLocalShmServer", "(Ljava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmServer },
+	{ "nativeStartLocalShmClient", "(Ljava/lang/String;Ljava/lang/String;)V",
+			(void*) Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmClient },
+	{ "nativeSendLocalBuffer",
+			"(Ljava/lang/String;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I",
+			(void*) Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeSendLocalBuffer },
+};
+
+bool LoadEchoModule(JavaVM* vm, JNIEnv* env)
+{
+	// Cache the exception classes thrown by the native methods
+	CacheJniClass(env, "java/io/IOException");
+	CacheJniClass(env, ILLEGAL_ARGUMENT_CLASS);
+
+	// Cache the class of the session replies
+	CacheJniClass(env, STRING_CLASS);
+
+	// Cache the position and limit of the direct buffers
+	CacheJniClass(env, BUFFER_CLASS);
+	CacheJniMethod(env, BUFFER_CLASS, "position", "()I");
+	CacheJniMethod(env, BUFFER_CLASS, "position", "(I)L" BUFFER_CLASS ";");
+	CacheJniMethod(env, BUFFER_CLASS, "limit", "()I");
+
+	// Cache the log target class and method
+	LoadLogCache(env);
+
+	// Bind the native methods now, the symbols are not exported
+	return RegisterJniNatives(env, ABSTRACT_ECHO_ACTIVITY_CLASS,
+			gAbstractEchoActivityMethods,
+			JNI_METHOD_COUNT(gAbstractEchoActivityMethods))
+			&& RegisterJniNatives(env, ECHO_CLIENT_ACTIVITY_CLASS,
+					gEchoClientActivityMethods,
+					JNI_METHOD_COUNT(gEchoClientActivityMethods))
+			&& RegisterJniNatives(env, ECHO_SERVER_ACTIVITY_CLASS,
+					gEchoServerActivityMethods,
+					JNI_METHOD_COUNT(gEchoServerActivityMethods))
+			&& RegisterJniNatives(env, LOCAL_ECHO_ACTIVITY_CLASS,
+					gLocalEchoActivityMethods,
+					JNI_METHOD_COUNT(gLocalEchoActivityMethods));
 }
@@ -0,0 +1,4657 @@
+#include "EchoEngine.h"
+#include "EchoFrame.h"
+#include "EchoLog.h"
+#include "EchoMetrics.h"
+#include "BufferPool.h"
+#include "IoUring.h"
+#include "ShmRing.h"
+
+// NULL
+#include <stdio.h>
+
+// errno
+#include <errno.h>
+
+// strerror, strlen, memset
+#include <string.h>
+
+// socket, bind, getsockname, listen, accept, recv, send, connect,
+// recvmmsg, sendmmsg, sendmsg, recvmsg
+#include <sys/types.h>
+#include <sys/socket.h>
+
+// sockaddr_un
+#include <sys/un.h>
+
+// htons, sockaddr_in
+#include <netinet/in.h>
+
+// inet_ntop
+#include <arpa/inet.h>
+
+// close, unlink
+#include <unistd.h>
+
+// offsetof
+#include <stddef.h>
+
+// fcntl, splice
+#include <fcntl.h>
+
+// epoll_create, epoll_ctl, epoll_wait
+#include <sys/epoll.h>
+
+// eventfd
+#include <sys/eventfd.h>
+
+// pthread_create, pthread_join
+#include <pthread.h>
+
+// sched_setaffinity, CPU_SET
+#include <sched.h>
+
+// poll
+#include <poll.h>
+
+// iovec
+#include <sys/uio.h>
+
+// TCP_NODELAY
+#include <netinet/tcp.h>
+
+// uintptr_t
+#include <stdint.h>
+
+// clock_gettime
+#include <time.h>
+
+// std::atomic
+#include <atomic>
+
+// std::string
+#include <string>
+
+// Default data buffer size
+#define DEFAULT_BUFFER_SIZE 65536
+
+// Min data buffer size
+#define MIN_BUFFER_SIZE 64
+
+// Max data buffer size
+#define MAX_BUFFER_SIZE (4 * 1024 * 1024)
+
+// Max size of a UDP datagram
+#define MAX_DATAGRAM_SIZE 65536
+
+// Connections allocated at once by the reactor pools
+#define CONNECTIONS_PER_CHUNK 64
+
+// Data buffer size of the servers started next
+static std::atomic<size_t> gBufferSize(DEFAULT_BUFFER_SIZE);
+
+// Echo through a pipe without copying to user space
+static std::atomic<bool> gZeroCopy(false);
+
+// Max events returned by a single epoll wait
+#define MAX_EPOLL_EVENTS 64
+
+// Echo read at once past the end of a reply buffer
+#define DROPPED_ECHO_SIZE 4096
+
+// Max number of frames sent back with a single call
+#define FRAME_REPLY_BATCH 32
+
+// Default number of datagrams received with a single call
+#define DEFAULT_DATAGRAM_BATCH 32
+
+// Max number of datagrams received with a single call
+#define MAX_DATAGRAM_BATCH 1024
+
+// Submission queue size of the io_uring engine
+#define URING_ENTRIES 256
+
+// Completion queue size, multishot requests complete many times
+#define URING_CQ_ENTRIES 4096
+
+// Number of provided receive buffers, a power of two
+#define URING_BUFFER_COUNT 128
+
+// Provided buffer group of the io_uring engine
+#define URING_BUFFER_GROUP 0
+
+// io_uring request kinds, kept in the low bits of the user data
+#define URING_ACCEPT 1
+#define URING_RECV 2
+#define URING_SEND 3
+#define URING_RECVMSG 4
+#define URING_SENDMSG 5
+#define URING_KIND_MASK 15
+
+// Most reactors of the multi reactor server
+#define MAX_REACTOR_THREADS 64
+
+// Capacity of each shared memory ring, a power of two
+#define SHM_RING_CAPACITY (1024 * 1024)
+
+// Messages a client session keeps in flight
+#define SESSION_MAX_IN_FLIGHT 256
+
+// Frames a client session writes with a single call
+#define SESSION_WRITE_BATCH 32
+
+/**
+ * Category of the echo engine errors, messages are the ones
+ * the Java side used to receive.
+ */
+class EchoErrorCategory : public std::error_category
+{
+public:
+	virtual const char* name() const noexcept
+	{
+		return "echo";
+	}
+
+	virtual std::string message(int error) const
+	{
+		switch (error)
+		{
+		case ECHO_ERROR_NAME_TOO_BIG:
+			return "Name is too big.";
+		case ECHO_ERROR_QUEUE_FULL:
+			return "Submission queue is full.";
+		case ECHO_ERROR_NO_URING:
+			return "io_uring is not supported by this build.";
+		case ECHO_ERROR_NO_SHARED_MEMORY:
+			return "No shared memory is received.";
+		case ECHO_ERROR_INVALID_HANDSHAKE:
+			return "Invalid shared memory handshake.";
+		case ECHO_ERROR_MESSAGE_TOO_BIG:
+			return "Message is too big.";
+		case ECHO_ERROR_DISCONNECTED:
+			return "Server disconnected.";
+		case ECHO_ERROR_INVALID_FRAME:
+			return "Invalid frame.";
+		default:
+			return "Unknown error.";
+		}
+	}
+};
+
+const std::error_category& GetEchoErrorCategory()
+{
+	static EchoErrorCategory category;
+
+	return category;
+}
+
+std::error_code make_error_code(EchoError error)
+{
+	return std::error_code((int) error, GetEchoErrorCategory());
+}
+
+/**
+ * Constructs a new TCP socket.
+ *
+ * @param error error code.
+ * @return socket descriptor.
+ */
+static int NewTcpSocket(std::error_code& error)
+{
+	// Construct socket
+	LOG_DEBUG("Constructing a new TCP socket...");
+	int tcpSocket = socket(PF_INET, SOCK_STREAM, 0);
+
+	// Check if socket is properly constructed
+	if (-1 == tcpSocket)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+
+	return tcpSocket;
+}
+
+/**
+ * Binds socket to a port number.
+ *
+ * @param sd socket descriptor.
+ * @param port port number or zero for random port.
+ * @param error error code.
+ */
+static void BindSocketToPort(
+		int sd,
+		unsigned short port,
+		std::error_code& error)
+{
+	struct sockaddr_in address;
+
+	// Address to bind socket
+	memset(&address, 0, sizeof(address));
+	address.sin_family = PF_INET;
+
+	// Bind to all addresses
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	// Convert port to network byte order
+	address.sin_port = htons(port);
+
+	// Bind socket
+	LOG_INFO("Binding to port %hu.", port);
+	if (-1 == bind(sd, (struct sockaddr*) &address, sizeof(address)))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Gets the port number socket is currently binded.
+ *
+ * @param sd socket descriptor.
+ * @param error error code.
+ * @return port number.
+ */
+static unsigned short GetSocketPort(
+		int sd,
+		std::error_code& error)
+{
+	unsigned short port = 0;
+
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+
+	// Get the socket address
+	if (-1 == getsockname(sd, (struct sockaddr*) &address, &addressLength))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		// Convert port to host byte order
+		port = ntohs(address.sin_port);
+
+		LOG_INFO("Binded to random port %hu.", port);
+	}
+
+	return port;
+}
+
+/**
+ * Listens on given socket with the given backlog for
+ * pending connections. When the backlog is full, the
+ * new connections will be rejected.
+ *
+ * @param sd socket descriptor.
+ * @param backlog backlog size.
+ * @param error error code.
+ */
+static void ListenOnSocket(
+		int sd,
+		int backlog,
+		std::error_code& error)
+{
+	// Listen on socket with the given backlog
+	LOG_INFO("Listening on socket with a backlog of %d pending connections.",
+			backlog);
+
+	if (-1 == listen(sd, backlog))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Logs the IP address and the port number from the
+ * given address.
+ *
+ * @param level log level.
+ * @param message message text.
+ * @param address adress instance.
+ * @param error error code.
+ */
+static void LogAddress(
+		int level,
+		const char* message,
+		const struct sockaddr_in* address,
+		std::error_code& error)
+{
+	// Skip the conversion if the level is disabled
+	if (!LOG_ENABLED(level))
+		return;
+
+	char ip[INET_ADDRSTRLEN];
+
+	// Convert the IP address to string
+	if (NULL == inet_ntop(PF_INET,
+			&(address->sin_addr),
+			ip,
+			INET_ADDRSTRLEN))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		// Convert port to host byte order
+		unsigned short port = ntohs(address->sin_port);
+
+		// Log address
+		LogMessage("%s %s:%hu.", message, ip, port);
+	}
+}
+
+/**
+ * Blocks and waits for incoming client connections on the
+ * given socket.
+ *
+ * @param sd socket descriptor.
+ * @param error error code.
+ * @return client socket.
+ */
+static int AcceptOnSocket(
+		int sd,
+		std::error_code& error)
+{
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+
+	// Blocks and waits for an incoming client connection
+	// and accepts it
+	LOG_DEBUG("Waiting for a client connection...");
+
+	int clientSocket = accept(sd,
+			(struct sockaddr*) &address,
+			&addressLength);
+
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If client socket is not valid
+	if (-1 == clientSocket)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		METRIC_ADD(ECHO_COUNTER_ACCEPTED, 1);
+
+		// Log address
+		LogAddress(LOG_LEVEL_INFO,
+				"Client connection from ", &address, error);
+	}
+
+	return clientSocket;
+}
+
+/**
+ * Block and receive data from the socket into the buffer.
+ *
+ * @param sd socket descriptor.
+ * @param buffer data buffer.
+ * @param bufferSize buffer size.
+ * @param error error code.
+ * @return receive size.
+ */
+static ssize_t ReceiveFromSocket(
+		int sd,
+		char* buffer,
+		size_t bufferSize,
+		std::error_code& error)
+{
+	// Block and receive data from the socket into the buffer
+	LOG_TRACE("Receiving from the socket...");
+	int64_t start = METRIC_TIME();
+	ssize_t recvSize = recv(sd, buffer, bufferSize, 0);
+
+	METRIC_RECORD_SINCE(ECHO_HISTOGRAM_RECV_LATENCY, start);
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If receive is failed
+	if (-1 == recvSize)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		// If data is received
+		if (recvSize > 0)
+		{
+			METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+
+			LOG_TRACE("Received %d bytes: %s", recvSize,
+					LogData(buffer, (size_t) recvSize));
+		}
+		else
+		{
+			LOG_INFO("Client disconnected.");
+		}
+	}
+
+	return recvSize;
+}
+
+/**
+ * Send data buffer to the socket.
+ *
+ * @param sd socket descriptor.
+ * @param buffer data buffer.
+ * @param bufferSize buffer size.
+ * @param error error code.
+ * @return sent size.
+ */
+static ssize_t SendToSocket(
+		int sd,
+		const char* buffer,
+		size_t bufferSize,
+		std::error_code& error)
+{
+	// Send data buffer to the socket
+	LOG_TRACE("Sending to the socket...");
+	int64_t start = METRIC_TIME();
+	ssize_t sentSize = send(sd, buffer, bufferSize, 0);
+
+	METRIC_RECORD_SINCE(ECHO_HISTOGRAM_SEND_LATENCY, start);
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If send is failed
+	if (-1 == sentSize)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		if (sentSize > 0)
+		{
+			METRIC_ADD(ECHO_COUNTER_BYTES_OUT, sentSize);
+
+			LOG_TRACE("Sent %d bytes: %s", sentSize,
+					LogData(buffer, (size_t) sentSize));
+		}
+		else
+		{
+			LOG_INFO("Client disconnected.");
+		}
+	}
+
+	return sentSize;
+}
+
+/**
+ * Connects to given IP address and given port.
+ *
+ * @param sd socket descriptor.
+ * @param ip IP address.
+ * @param port port number.
+ * @param error error code.
+ */
+static void ConnectToAddress(
+		int sd,
+		const char* ip,
+		unsigned short port,
+		std::error_code& error)
+{
+	// Connecting to given IP address and given port
+	LOG_INFO("Connecting to %s:%uh...", ip, port);
+
+	struct sockaddr_in address;
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = PF_INET;
+
+	// Convert IP address string to Internet address
+	if (0 == inet_aton(ip, &(address.sin_addr)))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		// Convert port to network byte order
+		address.sin_port = htons(port);
+
+		// Connect to address
+		if (-1 == connect(sd, (const sockaddr*) &address, sizeof(address)))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+		}
+		else
+		{
+			LOG_INFO("Connected.");
+		}
+	}
+}
+
+/**
+ * Constructs a new pipe to move data between sockets, and
+ * grows it to hold the given number of bytes if possible.
+ *
+ * @param pipeFds pipe read and write descriptors.
+ * @param size requested pipe size.
+ * @param error error code.
+ * @return pipe size.
+ */
+static size_t NewSplicePipe(
+		int* pipeFds,
+		size_t size,
+		std::error_code& error)
+{
+	// Default pipe size
+	size_t pipeSize = 65536;
+
+	if (-1 == pipe(pipeFds))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return 0;
+	}
+
+#ifdef F_SETPIPE_SZ
+	// Pipe size is limited by the system, keep the default if it fails
+	int newSize = fcntl(pipeFds[1], F_SETPIPE_SZ, (int) size);
+	if (newSize > 0)
+	{
+		pipeSize = (size_t) newSize;
+	}
+#endif
+
+	return pipeSize;
+}
+
+/**
+ * Blocks until the given socket is ready for the given events.
+ *
+ * @param sd socket descriptor.
+ * @param events poll events.
+ * @return -1 on error.
+ */
+static int WaitForSocket(int sd, short events)
+{
+	struct pollfd pollFd;
+	pollFd.fd = sd;
+	pollFd.events = events;
+	pollFd.revents = 0;
+
+	int result;
+	do
+	{
+		result = poll(&pollFd, 1, -1);
+	} while ((-1 == result) && (EINTR == errno));
+
+	return result;
+}
+
+/**
+ * Receives and sends back the data of the given socket by moving
+ * it through a pipe, the data never leaves the kernel. The pipe is
+ * reused for the whole connection.
+ *
+ * @param sd socket descriptor.
+ * @param chunkSize max bytes moved at once.
+ * @param error error code.
+ * @return false if splice is not supported by the socket.
+ */
+static bool SpliceEchoSocket(
+		int sd,
+		size_t chunkSize,
+		std::error_code& error)
+{
+	int pipeFds[2];
+	bool supported = true;
+	bool moved = false;
+
+	size_t pipeSize = NewSplicePipe(pipeFds, chunkSize, error);
+	if (error)
+		return true;
+
+	// Pipe never holds more than a single chunk
+	if (chunkSize > pipeSize)
+	{
+		chunkSize = pipeSize;
+	}
+
+	LOG_DEBUG("Echoing through a pipe of %d bytes.", pipeSize);
+
+	while (1)
+	{
+		// Block on the socket and move the data into the pipe
+		ssize_t recvSize = splice(sd, NULL, pipeFds[1], NULL, chunkSize,
+				SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == recvSize)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Non-blocking splice also applies to some sockets
+			if (EAGAIN == errno)
+			{
+				METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+
+				if (-1 != WaitForSocket(sd, POLLIN))
+					continue;
+			}
+
+			// Socket type can not be spliced, nothing is consumed yet
+			if (!moved && ((EINVAL == errno) || (ENOSYS == errno)))
+			{
+				supported = false;
+				break;
+			}
+
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			break;
+		}
+
+		if (0 == recvSize)
+		{
+			LOG_INFO("Client disconnected.");
+			break;
+		}
+
+		moved = true;
+		METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+		LOG_TRACE("Received %d bytes.", recvSize);
+
+		// Move the data from the pipe back to the socket
+		size_t pending = (size_t) recvSize;
+		while (pending > 0)
+		{
+			ssize_t sentSize = splice(pipeFds[0], NULL, sd, NULL, pending,
+					SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+			METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+			if (-1 == sentSize)
+			{
+				if (EINTR == errno)
+					continue;
+
+				// Wait for the socket to become writable
+				if (EAGAIN == errno)
+				{
+					METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+
+					if (-1 != WaitForSocket(sd, POLLOUT))
+						continue;
+				}
+
+				// Fail with the error number
+				error.assign(errno, std::system_category());
+				break;
+			}
+
+			pending -= (size_t) sentSize;
+			METRIC_ADD(ECHO_COUNTER_BYTES_OUT, sentSize);
+		}
+
+		if (error)
+			break;
+
+		LOG_TRACE("Sent %d bytes.", recvSize);
+	}
+
+	close(pipeFds[0]);
+	close(pipeFds[1]);
+
+	return supported;
+}
+
+/**
+ * Sends the data to the connected stream socket while receiving
+ * its echo into the reply buffer, so that neither side blocks on
+ * a full socket buffer.
+ *
+ * @param sd socket descriptor.
+ * @param data data to send.
+ * @param size data size.
+ * @param reply reply buffer.
+ * @param replySize reply buffer size.
+ * @param error error code.
+ * @return received reply size.
+ */
+static size_t ExchangeOnSocket(
+		int sd,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error)
+{
+	size_t sent = 0;
+	size_t received = 0;
+
+	// Echo beyond the reply buffer is dropped
+	size_t expected = (size < replySize) ? size : replySize;
+	char dropped[DROPPED_ECHO_SIZE];
+
+	while ((sent < size) || (received < expected))
+	{
+		bool progressed = false;
+
+		if (sent < size)
+		{
+			ssize_t sentSize = send(sd, data + sent, size - sent,
+					MSG_DONTWAIT | MSG_NOSIGNAL);
+
+			if (-1 == sentSize)
+			{
+				if ((EAGAIN != errno) && (EWOULDBLOCK != errno)
+						&& (EINTR != errno))
+				{
+					// Fail with the error number
+					error.assign(errno, std::system_category());
+					break;
+				}
+			}
+			else
+			{
+				LOG_TRACE("Sent %d bytes: %s", sentSize,
+						LogData(data + sent, (size_t) sentSize));
+
+				sent += (size_t) sentSize;
+				progressed = true;
+			}
+		}
+
+		// Keep reading while sending, or the server stops reading
+		if ((received < expected) || (sent < size))
+		{
+			bool dropping = (received == expected);
+
+			ssize_t recvSize = dropping
+					? recv(sd, dropped, sizeof(dropped), MSG_DONTWAIT)
+					: recv(sd, reply + received, expected - received,
+							MSG_DONTWAIT);
+
+			if (-1 == recvSize)
+			{
+				if ((EAGAIN != errno) && (EWOULDBLOCK != errno)
+						&& (EINTR != errno))
+				{
+					// Fail with the error number
+					error.assign(errno, std::system_category());
+					break;
+				}
+			}
+			else if (0 == recvSize)
+			{
+				LOG_INFO("Server disconnected.");
+				break;
+			}
+			else if (dropping)
+			{
+				LOG_TRACE("Dropped %d bytes.", recvSize);
+				progressed = true;
+			}
+			else
+			{
+				LOG_TRACE("Received %d bytes: %s", recvSize,
+						LogData(reply + received, (size_t) recvSize));
+
+				received += (size_t) recvSize;
+				progressed = true;
+			}
+		}
+
+		// Wait only if both directions would block
+		if (!progressed)
+		{
+			short events = POLLIN;
+			if (sent < size)
+			{
+				events |= POLLOUT;
+			}
+
+			if (-1 == WaitForSocket(sd, events))
+			{
+				// Fail with the error number
+				error.assign(errno, std::system_category());
+				break;
+			}
+		}
+	}
+
+	return received;
+}
+
+size_t ExchangeTcpEcho(
+		const char* ip,
+		unsigned short port,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error)
+{
+	size_t received = 0;
+
+	// Construct a new TCP socket.
+	int clientSocket = NewTcpSocket(error);
+	if (!error)
+	{
+		// Connect to IP address and port
+		ConnectToAddress(clientSocket, ip, port, error);
+
+		// If connection was successful
+		if (error)
+			goto exit;
+
+		// Send the data and receive the echo
+		received = ExchangeOnSocket(clientSocket, data, size,
+				reply, replySize, error);
+	}
+
+exit:
+	if (clientSocket > 0)
+	{
+		close(clientSocket);
+	}
+
+	return received;
+}
+
+void RunTcpEchoClient(
+		const char* ip,
+		unsigned short port,
+		const char* message,
+		std::error_code& error)
+{
+	// Data buffer
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	char* buffer = new char[bufferSize];
+
+	ExchangeTcpEcho(ip, port, message, strlen(message),
+			buffer, bufferSize, error);
+
+	delete[] buffer;
+}
+
+void RunTcpEchoServer(unsigned short port, std::error_code& error)
+{
+	// Data buffer
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	char* buffer = NULL;
+
+	// Construct a new TCP socket.
+	int serverSocket = NewTcpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Listen on socket with a backlog of 4 pending connections
+		ListenOnSocket(serverSocket, 4, error);
+		if (error)
+			goto exit;
+
+		// Accept a client connection on socket
+		int clientSocket = AcceptOnSocket(serverSocket, error);
+		if (error)
+			goto exit;
+
+		// Move the data inside the kernel if requested and supported
+		if (!gZeroCopy.load(std::memory_order_relaxed)
+				|| !SpliceEchoSocket(clientSocket, bufferSize, error))
+		{
+			buffer = new char[bufferSize];
+			ssize_t recvSize;
+			ssize_t sentSize;
+
+			// Receive and send back the data
+			while (1)
+			{
+				// Receive from the socket
+				recvSize = ReceiveFromSocket(clientSocket,
+						buffer, bufferSize, error);
+
+				if ((0 == recvSize) || error)
+					break;
+
+				// Send to the socket
+				sentSize = SendToSocket(clientSocket,
+						buffer, (size_t) recvSize, error);
+
+				if ((0 == sentSize) || error)
+					break;
+			}
+		}
+
+		// Close the client socket
+		close(clientSocket);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+
+	delete[] buffer;
+}
+
+/**
+ * Sends the given vectors without raising SIGPIPE if the peer
+ * is gone.
+ *
+ * @param sd socket descriptor.
+ * @param vectors data vectors.
+ * @param vectorCount number of vectors.
+ * @return sent size or -1 if failed, errno is set.
+ */
+static ssize_t SendVectorsToSocket(
+		int sd,
+		struct iovec* vectors,
+		int vectorCount)
+{
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = vectors;
+	message.msg_iovlen = vectorCount;
+
+	return sendmsg(sd, &message, MSG_NOSIGNAL);
+}
+
+/**
+ * Per client connection state of the event driven echo server.
+ */
+struct EchoConnection
+{
+	// Client socket descriptor
+	int sd;
+
+	// Data received from the client, taken from the reactor
+	// pool only while there is data to be sent back
+	char* buffer;
+
+	// Number of bytes in the buffer
+	size_t recvSize;
+
+	// Number of bytes already sent back to the client, of the
+	// frame being replied in framed mode
+	size_t sentSize;
+
+	// Number of bytes of the complete frames, framed mode only
+	size_t parsedSize;
+
+	// Offset of the frame being replied, framed mode only
+	size_t replyOffset;
+
+	// Neighbour connections of the reactor
+	EchoConnection* prev;
+	EchoConnection* next;
+};
+
+/**
+ * Event driven echo server state.
+ */
+struct EchoReactor
+{
+	// Epoll instance descriptor
+	int epollFd;
+
+	// Listening socket descriptor
+	int serverSocket;
+
+	// Event that stops the reactor once signaled, -1 if the
+	// reactor runs until an error occurs
+	int stopEvent;
+
+	// Open client connections
+	EchoConnection* connections;
+
+	// Size of the connection data buffers
+	size_t bufferSize;
+
+	// Clients speak the echo stream protocol, each frame must
+	// fit the data buffer
+	bool framed;
+
+	// Pool of connection states
+	BufferPool connectionPool;
+
+	// Pool of connection data buffers
+	BufferPool bufferPool;
+};
+
+/**
+ * Initializes the reactor state, nothing is allocated until
+ * the first client connects.
+ *
+ * @param reactor reactor instance.
+ * @param bufferSize connection data buffer size.
+ */
+static void InitEchoReactor(
+		EchoReactor* reactor,
+		size_t bufferSize)
+{
+	reactor->epollFd = -1;
+	reactor->serverSocket = -1;
+	reactor->stopEvent = -1;
+	reactor->connections = NULL;
+	reactor->bufferSize = bufferSize;
+	reactor->framed = false;
+
+	InitBufferPool(&reactor->connectionPool, sizeof(EchoConnection),
+			CONNECTIONS_PER_CHUNK);
+	InitBufferPool(&reactor->bufferPool, bufferSize,
+			CONNECTIONS_PER_CHUNK);
+}
+
+/**
+ * Puts the given socket into non-blocking mode.
+ *
+ * @param sd socket descriptor.
+ * @param error error code.
+ */
+static void SetSocketNonBlocking(
+		int sd,
+		std::error_code& error)
+{
+	// Get the current descriptor flags
+	int flags = fcntl(sd, F_GETFL, 0);
+
+	// Add the non-blocking flag
+	if ((-1 == flags) || (-1 == fcntl(sd, F_SETFL, flags | O_NONBLOCK)))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Constructs a new epoll instance and registers the given
+ * listening socket to it.
+ *
+ * @param reactor reactor instance.
+ * @param error error code.
+ */
+static void NewEchoReactor(
+		EchoReactor* reactor,
+		std::error_code& error)
+{
+	// Construct epoll instance, size is only a hint
+	LOG_DEBUG("Constructing a new epoll instance...");
+	reactor->epollFd = epoll_create(MAX_EPOLL_EVENTS);
+
+	if (-1 == reactor->epollFd)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return;
+	}
+
+	// Listening socket is marked with a NULL pointer
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = NULL;
+
+	if (-1 == epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD,
+			reactor->serverSocket, &event))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return;
+	}
+
+	// Stop event is marked with the reactor itself
+	if (-1 != reactor->stopEvent)
+	{
+		event.events = EPOLLIN;
+		event.data.ptr = reactor;
+
+		if (-1 == epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD,
+				reactor->stopEvent, &event))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+		}
+	}
+}
+
+/**
+ * Closes the given client connection and releases its state.
+ *
+ * @param reactor reactor instance.
+ * @param connection client connection.
+ */
+static void CloseEchoConnection(
+		EchoReactor* reactor,
+		EchoConnection* connection)
+{
+	// Unlink from the open connections
+	if (NULL != connection->prev)
+	{
+		connection->prev->next = connection->next;
+	}
+	else
+	{
+		reactor->connections = connection->next;
+	}
+
+	if (NULL != connection->next)
+	{
+		connection->next->prev = connection->prev;
+	}
+
+	// Closing the socket also removes it from the epoll set
+	close(connection->sd);
+
+	// Return the state and the data buffer to the pools
+	if (NULL != connection->buffer)
+	{
+		ReleaseBuffer(&reactor->bufferPool, connection->buffer);
+	}
+
+	ReleaseBuffer(&reactor->connectionPool, (char*) connection);
+}
+
+/**
+ * Accepts all pending client connections on the non-blocking
+ * listening socket and registers them to the reactor.
+ *
+ * @param reactor reactor instance.
+ * @param error error code.
+ */
+static void AcceptEchoConnections(
+		EchoReactor* reactor,
+		std::error_code& error)
+{
+	// Edge triggered, accept until the backlog is drained
+	while (1)
+	{
+		struct sockaddr_in address;
+		socklen_t addressLength = sizeof(address);
+
+		int clientSocket = accept(reactor->serverSocket,
+				(struct sockaddr*) &address,
+				&addressLength);
+
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == clientSocket)
+		{
+			// Connection is aborted before it is accepted
+			if ((EINTR == errno) || (ECONNABORTED == errno))
+				continue;
+
+			// No more pending connections
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+				break;
+			}
+
+			// Out of descriptors, try again on next connection
+			LOG_WARN("Unable to accept: %s", strerror(errno));
+			break;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_ACCEPTED, 1);
+
+		// Log address
+		LogAddress(LOG_LEVEL_DEBUG,
+				"Client connection from", &address, error);
+
+		// Client socket must not block the reactor
+		SetSocketNonBlocking(clientSocket, error);
+		if (error)
+		{
+			close(clientSocket);
+			break;
+		}
+
+		EchoConnection* connection =
+				(EchoConnection*) AcquireBuffer(&reactor->connectionPool);
+
+		if (NULL == connection)
+		{
+			LOG_WARN("Unable to allocate client state.");
+			close(clientSocket);
+			continue;
+		}
+
+		connection->sd = clientSocket;
+		connection->buffer = NULL;
+		connection->recvSize = 0;
+		connection->sentSize = 0;
+		connection->parsedSize = 0;
+		connection->replyOffset = 0;
+
+		// Wait for both directions once, edge triggered
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.ptr = connection;
+
+		if (-1 == epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD,
+				clientSocket, &event))
+		{
+			LOG_WARN("Unable to watch client: %s",
+					strerror(errno));
+
+			close(clientSocket);
+			ReleaseBuffer(&reactor->connectionPool, (char*) connection);
+			continue;
+		}
+
+		// Link to the open connections
+		connection->prev = NULL;
+		connection->next = reactor->connections;
+		if (NULL != reactor->connections)
+		{
+			reactor->connections->prev = connection;
+		}
+		reactor->connections = connection;
+	}
+}
+
+/**
+ * Receives from and sends back to the given client until
+ * the socket would block.
+ *
+ * @param reactor reactor instance.
+ * @param connection client connection.
+ * @return false if connection should be closed.
+ */
+static bool ServiceEchoConnection(
+		EchoReactor* reactor,
+		EchoConnection* connection)
+{
+	while (1)
+	{
+		// Send back the pending data first
+		while (connection->sentSize < connection->recvSize)
+		{
+			int64_t start = METRIC_TIME();
+			ssize_t sentSize = send(connection->sd,
+					connection->buffer + connection->sentSize,
+					connection->recvSize - connection->sentSize,
+					MSG_NOSIGNAL);
+
+			METRIC_RECORD_SINCE(ECHO_HISTOGRAM_SEND_LATENCY, start);
+			METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+			if (-1 == sentSize)
+			{
+				if (EINTR == errno)
+					continue;
+
+				// Wait for the socket to become writable
+				if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+				{
+					METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+					return true;
+				}
+
+				LOG_WARN("Unable to send: %s", strerror(errno));
+				return false;
+			}
+
+			METRIC_ADD(ECHO_COUNTER_BYTES_OUT, sentSize);
+			connection->sentSize += sentSize;
+		}
+
+		// Take a data buffer only while receiving
+		if (NULL == connection->buffer)
+		{
+			connection->buffer = AcquireBuffer(&reactor->bufferPool);
+			if (NULL == connection->buffer)
+			{
+				LOG_WARN("Unable to allocate client buffer.");
+				return false;
+			}
+		}
+
+		// Receive the next chunk
+		int64_t start = METRIC_TIME();
+		ssize_t recvSize = recv(connection->sd, connection->buffer,
+				reactor->bufferSize, 0);
+
+		METRIC_RECORD_SINCE(ECHO_HISTOGRAM_RECV_LATENCY, start);
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == recvSize)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Wait for more data, nothing is pending so the
+			// buffer goes back to the pool for other clients
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+
+				ReleaseBuffer(&reactor->bufferPool, connection->buffer);
+				connection->buffer = NULL;
+
+				return true;
+			}
+
+			LOG_WARN("Unable to receive: %s", strerror(errno));
+			return false;
+		}
+
+		if (0 == recvSize)
+		{
+			LOG_DEBUG("Client disconnected.");
+			return false;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+
+		connection->recvSize = (size_t) recvSize;
+		connection->sentSize = 0;
+	}
+}
+
+/**
+ * Sends back the parsed frames of the given client until the
+ * socket would block. Each reply is gathered from a new header
+ * and the payload in the data buffer, many frames per call.
+ *
+ * @param connection client connection.
+ * @return false if connection should be closed.
+ */
+static bool SendFrameReplies(EchoConnection* connection)
+{
+	while (connection->replyOffset < connection->parsedSize)
+	{
+		struct iovec vectors[2 * FRAME_REPLY_BATCH];
+		char headers[FRAME_REPLY_BATCH][ECHO_FRAME_MAX_HEADER_SIZE];
+		int vectorCount = 0;
+
+		size_t offset = connection->replyOffset;
+		size_t skip = connection->sentSize;
+
+		for (int i = 0; (i < FRAME_REPLY_BATCH)
+				&& (offset < connection->parsedSize); i++)
+		{
+			// Frames are already checked
+			EchoFrame frame;
+			std::error_code error;
+			offset += ParseEchoFrame(connection->buffer + offset,
+					connection->parsedSize - offset, &frame, error);
+
+			size_t headerSize = EncodeEchoFrameHeader(frame.type,
+					frame.size, headers[i]);
+
+			if (skip < headerSize)
+			{
+				vectors[vectorCount].iov_base = headers[i] + skip;
+				vectors[vectorCount].iov_len = headerSize - skip;
+				vectorCount++;
+				skip = 0;
+			}
+			else
+			{
+				skip -= headerSize;
+			}
+
+			if (skip < frame.size)
+			{
+				vectors[vectorCount].iov_base = (char*) frame.payload + skip;
+				vectors[vectorCount].iov_len = frame.size - skip;
+				vectorCount++;
+			}
+
+			skip = 0;
+		}
+
+		int64_t start = METRIC_TIME();
+		ssize_t sentSize = SendVectorsToSocket(connection->sd,
+				vectors, vectorCount);
+
+		METRIC_RECORD_SINCE(ECHO_HISTOGRAM_SEND_LATENCY, start);
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == sentSize)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Wait for the socket to become writable
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+				return true;
+			}
+
+			LOG_WARN("Unable to send: %s", strerror(errno));
+			return false;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_BYTES_OUT, sentSize);
+
+		// Advance over the fully sent frames
+		size_t remaining = connection->sentSize + (size_t) sentSize;
+		while (connection->replyOffset < connection->parsedSize)
+		{
+			EchoFrame frame;
+			std::error_code error;
+			size_t frameLength = ParseEchoFrame(
+					connection->buffer + connection->replyOffset,
+					connection->parsedSize - connection->replyOffset,
+					&frame, error);
+
+			size_t replyLength = GetEchoFrameLength(frame.size);
+			if (remaining < replyLength)
+				break;
+
+			remaining -= replyLength;
+			connection->replyOffset += frameLength;
+		}
+
+		connection->sentSize = remaining;
+	}
+
+	return true;
+}
+
+/**
+ * Receives frames from and sends them back to the given client
+ * until the socket would block. Frames are parsed in place and
+ * the partial one is kept at the front of the data buffer.
+ *
+ * @param reactor reactor instance.
+ * @param connection client connection.
+ * @return false if connection should be closed.
+ */
+static bool ServiceFramedConnection(
+		EchoReactor* reactor,
+		EchoConnection* connection)
+{
+	while (1)
+	{
+		// Send back the parsed frames first
+		if (!SendFrameReplies(connection))
+			return false;
+
+		if (connection->replyOffset < connection->parsedSize)
+			return true;
+
+		// Move the partial frame to the front
+		if (0 < connection->replyOffset)
+		{
+			connection->recvSize -= connection->replyOffset;
+			memmove(connection->buffer,
+					connection->buffer + connection->replyOffset,
+					connection->recvSize);
+
+			connection->parsedSize = 0;
+			connection->replyOffset = 0;
+			connection->sentSize = 0;
+		}
+
+		// Take a data buffer only while receiving
+		if (NULL == connection->buffer)
+		{
+			connection->buffer = AcquireBuffer(&reactor->bufferPool);
+			if (NULL == connection->buffer)
+			{
+				LOG_WARN("Unable to allocate client buffer.");
+				return false;
+			}
+		}
+
+		// Receive after the partial frame
+		int64_t start = METRIC_TIME();
+		ssize_t recvSize = recv(connection->sd,
+				connection->buffer + connection->recvSize,
+				reactor->bufferSize - connection->recvSize, 0);
+
+		METRIC_RECORD_SINCE(ECHO_HISTOGRAM_RECV_LATENCY, start);
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == recvSize)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Wait for more data, the buffer goes back to the
+			// pool unless it holds a partial frame
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				METRIC_ADD(ECHO_COUNTER_WOULD_BLOCK, 1);
+
+				if (0 == connection->recvSize)
+				{
+					ReleaseBuffer(&reactor->bufferPool, connection->buffer);
+					connection->buffer = NULL;
+				}
+
+				return true;
+			}
+
+			LOG_WARN("Unable to receive: %s", strerror(errno));
+			return false;
+		}
+
+		if (0 == recvSize)
+		{
+			LOG_DEBUG("Client disconnected.");
+			return false;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+		connection->recvSize += (size_t) recvSize;
+
+		// Find the complete frames
+		while (1)
+		{
+			EchoFrame frame;
+			std::error_code error;
+			size_t frameLength = ParseEchoFrame(
+					connection->buffer + connection->parsedSize,
+					connection->recvSize - connection->parsedSize,
+					&frame, error);
+
+			if (error)
+			{
+				LOG_WARN("Unable to parse frame: %s",
+						error.message().c_str());
+				return false;
+			}
+
+			if (frameLength > reactor->bufferSize)
+			{
+				LOG_WARN("Frame is bigger than the buffer.");
+				return false;
+			}
+
+			if ((0 == frameLength) || (frameLength
+					> connection->recvSize - connection->parsedSize))
+				break;
+
+			connection->parsedSize += frameLength;
+		}
+
+		// A full buffer must hold a complete frame
+		if ((0 == connection->parsedSize)
+				&& (connection->recvSize == reactor->bufferSize))
+		{
+			LOG_WARN("Frame header is bigger than the buffer.");
+			return false;
+		}
+	}
+}
+
+/**
+ * Dispatches the events of the listening socket and the client
+ * connections until an error occurs or the reactor is stopped.
+ *
+ * @param reactor reactor instance.
+ * @param error error code.
+ */
+static void RunEchoReactor(
+		EchoReactor* reactor,
+		std::error_code& error)
+{
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	bool running = true;
+
+	while (running && !error)
+	{
+		// Block until any of the sockets is ready
+		int eventCount = epoll_wait(reactor->epollFd, events,
+				MAX_EPOLL_EVENTS, -1);
+
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == eventCount)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			break;
+		}
+
+		METRIC_RECORD(ECHO_HISTOGRAM_QUEUE_DEPTH, eventCount);
+
+		for (int i = 0; i < eventCount; i++)
+		{
+			EchoConnection* connection =
+					(EchoConnection*) events[i].data.ptr;
+
+			// Listening socket has pending connections
+			if (NULL == connection)
+			{
+				AcceptEchoConnections(reactor, error);
+				if (error)
+					break;
+			}
+			// Stop event is signaled, the event is left set so
+			// that it stops the other reactors as well
+			else if ((void*) reactor == events[i].data.ptr)
+			{
+				LOG_DEBUG("Reactor is stopped.");
+				running = false;
+				break;
+			}
+			else if ((0 != (events[i].events & EPOLLERR))
+					|| !(reactor->framed
+							? ServiceFramedConnection(reactor, connection)
+							: ServiceEchoConnection(reactor, connection)))
+			{
+				CloseEchoConnection(reactor, connection);
+			}
+		}
+	}
+}
+
+/**
+ * Closes the client connections and the descriptors of the reactor.
+ *
+ * @param reactor reactor instance.
+ * @param closeServerSocket close the listening socket as well.
+ */
+static void ReleaseEchoReactor(
+		EchoReactor* reactor,
+		bool closeServerSocket = true)
+{
+	// Close the remaining client connections
+	while (NULL != reactor->connections)
+	{
+		CloseEchoConnection(reactor, reactor->connections);
+	}
+
+	if (reactor->epollFd > 0)
+	{
+		close(reactor->epollFd);
+		reactor->epollFd = -1;
+	}
+
+	if (closeServerSocket && (reactor->serverSocket > 0))
+	{
+		close(reactor->serverSocket);
+		reactor->serverSocket = -1;
+	}
+
+	FreeBufferPool(&reactor->connectionPool);
+	FreeBufferPool(&reactor->bufferPool);
+}
+
+/**
+ * Serves the TCP clients from a single epoll reactor.
+ *
+ * @param port port number, 0 for a random one.
+ * @param framed clients speak the echo stream protocol.
+ * @param error error code.
+ */
+static void RunTcpReactor(
+		unsigned short port,
+		bool framed,
+		std::error_code& error)
+{
+	EchoReactor reactor;
+	InitEchoReactor(&reactor, gBufferSize.load(std::memory_order_relaxed));
+	reactor.framed = framed;
+
+	// Construct a new TCP socket.
+	reactor.serverSocket = NewTcpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(reactor.serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(reactor.serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Accept must not block the reactor
+		SetSocketNonBlocking(reactor.serverSocket, error);
+		if (error)
+			goto exit;
+
+		// Listen on socket with the maximum backlog
+		ListenOnSocket(reactor.serverSocket, SOMAXCONN, error);
+		if (error)
+			goto exit;
+
+		// Construct the epoll instance
+		NewEchoReactor(&reactor, error);
+		if (error)
+			goto exit;
+
+		// Serve the clients
+		RunEchoReactor(&reactor, error);
+	}
+
+exit:
+	ReleaseEchoReactor(&reactor);
+}
+
+void RunTcpReactorEchoServer(unsigned short port, std::error_code& error)
+{
+	RunTcpReactor(port, false, error);
+}
+
+void RunTcpFramedEchoServer(unsigned short port, std::error_code& error)
+{
+	RunTcpReactor(port, true, error);
+}
+
+/**
+ * Reactor thread arguments.
+ */
+struct EchoReactorThreadArgs
+{
+	// Log sink of the starting thread
+	EchoLogSink* sink;
+
+	// CPU to run on
+	int cpu;
+
+	// Thread handle
+	pthread_t thread;
+
+	// Reactor owned by the thread
+	EchoReactor reactor;
+};
+
+/**
+ * Enables binding multiple sockets to the same port, the
+ * kernel then distributes the incoming connections among them.
+ *
+ * @param sd socket descriptor.
+ * @param error error code.
+ */
+static void SetSocketReusePort(
+		int sd,
+		std::error_code& error)
+{
+	int reusePort = 1;
+
+	if (-1 == setsockopt(sd, SOL_SOCKET, SO_REUSEPORT,
+			&reusePort, sizeof(reusePort)))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Checks that no socket is bound to the given port yet. Sockets
+ * sharing the port would otherwise silently take a share of the
+ * connections, such as those of a server still running on it.
+ *
+ * @param port port number.
+ * @param error error code.
+ */
+static void CheckPortIsFree(
+		unsigned short port,
+		std::error_code& error)
+{
+	// Construct a new TCP socket without sharing the port
+	int probeSocket = NewTcpSocket(error);
+	if (error)
+		return;
+
+	// Bind fails if any socket is bound to the port
+	BindSocketToPort(probeSocket, port, error);
+
+	close(probeSocket);
+}
+
+/**
+ * Pins the calling thread to the given CPU. Failing to pin
+ * is not fatal, the thread simply keeps floating.
+ *
+ * @param cpu CPU number.
+ */
+static void PinThreadToCpu(int cpu)
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+
+	// Zero applies to the calling thread
+	if (-1 == sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+	{
+		LOG_WARN("Unable to pin to CPU %d: %s",
+				cpu, strerror(errno));
+	}
+}
+
+/**
+ * Runs a reactor on its own listening socket until an error occurs.
+ *
+ * @param args reactor thread arguments.
+ * @return NULL.
+ */
+static void* EchoReactorThread(void* args)
+{
+	EchoReactorThreadArgs* threadArgs = (EchoReactorThreadArgs*) args;
+	std::error_code error;
+
+	// Log messages to the sink of the starting thread
+	OpenLogSink(threadArgs->sink);
+
+	PinThreadToCpu(threadArgs->cpu);
+
+	// Construct the epoll instance
+	NewEchoReactor(&threadArgs->reactor, error);
+
+	// Serve the clients
+	if (!error)
+	{
+		RunEchoReactor(&threadArgs->reactor, error);
+	}
+
+	// Error can not cross the thread, log it instead
+	if (error)
+	{
+		LOG_ERROR("Reactor on CPU %d stopped: %s",
+				threadArgs->cpu, error.message().c_str());
+	}
+
+	// Listening socket is closed by the starting thread
+	ReleaseEchoReactor(&threadArgs->reactor, false);
+
+	CloseLogSink();
+
+	return NULL;
+}
+
+void RunTcpMultiReactorEchoServer(
+		unsigned short port,
+		int threads,
+		std::error_code& error)
+{
+	EchoReactorThreadArgs* threadArgs = NULL;
+	int startedThreads = 0;
+	int stopEvent = -1;
+
+	// One reactor per CPU by default
+	int cpuCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpuCount < 1)
+	{
+		cpuCount = 1;
+	}
+
+	if (threads < 1)
+	{
+		threads = cpuCount;
+	}
+
+	if (threads > MAX_REACTOR_THREADS)
+	{
+		threads = MAX_REACTOR_THREADS;
+	}
+
+	threadArgs = new EchoReactorThreadArgs[threads];
+	for (int i = 0; i < threads; i++)
+	{
+		InitEchoReactor(&threadArgs[i].reactor,
+				gBufferSize.load(std::memory_order_relaxed));
+	}
+
+	// Port must not be shared with another server
+	if (0 != port)
+	{
+		CheckPortIsFree(port, error);
+		if (error)
+			goto exit;
+	}
+
+	// Stops the started reactors if the others fail to start
+	stopEvent = eventfd(0, EFD_CLOEXEC);
+	if (-1 == stopEvent)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		goto exit;
+	}
+
+	// Construct a listening socket for each reactor on the same port
+	for (int i = 0; i < threads; i++)
+	{
+		EchoReactor* reactor = &threadArgs[i].reactor;
+
+		// Construct a new TCP socket.
+		reactor->serverSocket = NewTcpSocket(error);
+		if (error)
+			goto exit;
+
+		// Share the port with the other reactors
+		SetSocketReusePort(reactor->serverSocket, error);
+		if (error)
+			goto exit;
+
+		// Bind socket to a port number
+		BindSocketToPort(reactor->serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested, the remaining
+		// reactors bind to the port of the first one
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			port = GetSocketPort(reactor->serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Accept must not block the reactor
+		SetSocketNonBlocking(reactor->serverSocket, error);
+		if (error)
+			goto exit;
+
+		// Listen on socket with the maximum backlog
+		ListenOnSocket(reactor->serverSocket, SOMAXCONN, error);
+		if (error)
+			goto exit;
+	}
+
+	// Start the reactor threads
+	for (int i = 0; i < threads; i++)
+	{
+		// Reactor threads log to the same sink
+		threadArgs[i].sink = GetLogSink();
+		threadArgs[i].cpu = i % cpuCount;
+		threadArgs[i].reactor.stopEvent = stopEvent;
+
+		int result = pthread_create(&threadArgs[i].thread, NULL,
+				EchoReactorThread, &threadArgs[i]);
+
+		if (0 != result)
+		{
+			// Fail with the error number
+			error.assign(result, std::system_category());
+			break;
+		}
+
+		startedThreads++;
+	}
+
+	if (!error)
+	{
+		LOG_INFO("Started %d reactors.", startedThreads);
+	}
+	else if (0 != startedThreads)
+	{
+		// Serve with all reactors or none
+		uint64_t value = 1;
+		if (-1 == write(stopEvent, &value, sizeof(value)))
+		{
+			LOG_ERROR("Unable to stop the reactors: %s", strerror(errno));
+		}
+	}
+
+	// Block until all reactors stop
+	for (int i = 0; i < startedThreads; i++)
+	{
+		pthread_join(threadArgs[i].thread, NULL);
+	}
+
+exit:
+	for (int i = 0; i < threads; i++)
+	{
+		if (threadArgs[i].reactor.serverSocket > 0)
+		{
+			close(threadArgs[i].reactor.serverSocket);
+		}
+	}
+
+	if (-1 != stopEvent)
+	{
+		close(stopEvent);
+	}
+
+	delete[] threadArgs;
+}
+
+/**
+ * Persistent TCP echo client connection. Messages are sent as
+ * text frames and the echoed frames are matched to the messages
+ * in order.
+ */
+struct TcpEchoSession
+{
+	// Socket descriptor
+	int sd;
+
+	// Receive buffer, holds at least one whole frame
+	char* buffer;
+
+	// Receive buffer size
+	size_t bufferSize;
+
+	// Received bytes not yet handled
+	size_t bufferLength;
+};
+
+/**
+ * Writes the next frames of the pipelined messages with a single
+ * call, the frame headers and the messages are gathered without
+ * copying.
+ *
+ * @param session client session.
+ * @param messages messages to send.
+ * @param sizes message sizes.
+ * @param limit first message not to be sent yet.
+ * @param sent number of messages fully sent.
+ * @param sentOffset bytes of the next frame already sent.
+ * @param error error code.
+ * @return false if the socket is full.
+ */
+static bool WriteSessionFrames(
+		TcpEchoSession* session,
+		const char* const* messages,
+		const size_t* sizes,
+		size_t limit,
+		size_t* sent,
+		size_t* sentOffset,
+		std::error_code& error)
+{
+	struct iovec vectors[2 * SESSION_WRITE_BATCH];
+	char headers[SESSION_WRITE_BATCH][ECHO_FRAME_MAX_HEADER_SIZE];
+	int vectorCount = 0;
+
+	for (size_t i = *sent; (i < limit) && (i - *sent < SESSION_WRITE_BATCH); i++)
+	{
+		size_t frame = i - *sent;
+		size_t skip = (0 == frame) ? *sentOffset : 0;
+
+		size_t headerSize = EncodeEchoFrameHeader(ECHO_FRAME_TEXT,
+				sizes[i], headers[frame]);
+
+		if (skip < headerSize)
+		{
+			vectors[vectorCount].iov_base = headers[frame] + skip;
+			vectors[vectorCount].iov_len = headerSize - skip;
+			vectorCount++;
+			skip = 0;
+		}
+		else
+		{
+			skip -= headerSize;
+		}
+
+		if (skip < sizes[i])
+		{
+			vectors[vectorCount].iov_base = (char*) messages[i] + skip;
+			vectors[vectorCount].iov_len = sizes[i] - skip;
+			vectorCount++;
+		}
+	}
+
+	ssize_t sentSize = SendVectorsToSocket(session->sd,
+			vectors, vectorCount);
+
+	if (-1 == sentSize)
+	{
+		if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
+			return false;
+
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return false;
+	}
+
+	LOG_TRACE("Sent %d bytes.", sentSize);
+
+	// Advance over the fully sent frames
+	size_t remaining = (size_t) sentSize + *sentOffset;
+	while ((*sent < limit)
+			&& (remaining >= GetEchoFrameLength(sizes[*sent])))
+	{
+		remaining -= GetEchoFrameLength(sizes[*sent]);
+		(*sent)++;
+	}
+
+	*sentOffset = remaining;
+
+	return true;
+}
+
+/**
+ * Hands the complete frames of the receive buffer to the reply
+ * handler and keeps the partial one.
+ *
+ * @param session client session.
+ * @param count number of messages.
+ * @param received number of replies handled.
+ * @param handler reply handler.
+ * @param context handler context.
+ * @param error error code.
+ */
+static void HandleSessionFrames(
+		TcpEchoSession* session,
+		size_t count,
+		size_t* received,
+		EchoReplyHandler handler,
+		void* context,
+		std::error_code& error)
+{
+	size_t offset = 0;
+	size_t frameLength = 0;
+
+	while (*received < count)
+	{
+		EchoFrame frame;
+		frameLength = ParseEchoFrame(session->buffer + offset,
+				session->bufferLength - offset, &frame, error);
+
+		if (error)
+			return;
+
+		// Wait for the rest of the frame
+		if ((0 == frameLength)
+				|| (frameLength > session->bufferLength - offset))
+			break;
+
+		// Reply is handed over from the receive buffer
+		handler(context, *received, frame.payload, frame.size);
+
+		offset += frameLength;
+		(*received)++;
+	}
+
+	// Move the partial frame to the front
+	session->bufferLength -= offset;
+	memmove(session->buffer, session->buffer + offset,
+			session->bufferLength);
+
+	// Grow the buffer if the partial frame does not fit
+	if ((*received < count) && (frameLength > session->bufferSize))
+	{
+		char* buffer = new char[frameLength];
+		memcpy(buffer, session->buffer, session->bufferLength);
+
+		delete[] session->buffer;
+		session->buffer = buffer;
+		session->bufferSize = frameLength;
+	}
+}
+
+TcpEchoSession* OpenTcpEchoSession(
+		const char* ip,
+		unsigned short port,
+		std::error_code& error)
+{
+	// Construct a new TCP socket.
+	int clientSocket = NewTcpSocket(error);
+	if (error)
+		return NULL;
+
+	// Connect to IP address and port
+	ConnectToAddress(clientSocket, ip, port, error);
+
+	// Small frames must not wait for the acknowledgements
+	int noDelay = 1;
+	if (!error && (-1 == setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY,
+			&noDelay, sizeof(noDelay))))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+
+	// Sending and receiving are interleaved
+	if (!error)
+	{
+		SetSocketNonBlocking(clientSocket, error);
+	}
+
+	if (error)
+	{
+		close(clientSocket);
+		return NULL;
+	}
+
+	TcpEchoSession* session = new TcpEchoSession();
+	session->sd = clientSocket;
+	session->bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	session->buffer = new char[session->bufferSize];
+	session->bufferLength = 0;
+
+	return session;
+}
+
+void SendTcpEchoSession(
+		TcpEchoSession* session,
+		const char* const* messages,
+		const size_t* sizes,
+		size_t count,
+		EchoReplyHandler handler,
+		void* context,
+		std::error_code& error)
+{
+	size_t sent = 0;
+	size_t sentOffset = 0;
+	size_t received = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (sizes[i] > MAX_ECHO_FRAME_SIZE)
+		{
+			error = ECHO_ERROR_MESSAGE_TOO_BIG;
+			return;
+		}
+	}
+
+	while (received < count)
+	{
+		// Keep a window of messages in flight
+		size_t limit = received + SESSION_MAX_IN_FLIGHT;
+		if (limit > count)
+		{
+			limit = count;
+		}
+
+		bool writeBlocked = false;
+		if (sent < limit)
+		{
+			writeBlocked = !WriteSessionFrames(session, messages, sizes,
+					limit, &sent, &sentOffset, error);
+
+			if (error)
+				return;
+		}
+
+		// Receive whatever is echoed so far
+		ssize_t recvSize = recv(session->sd,
+				session->buffer + session->bufferLength,
+				session->bufferSize - session->bufferLength, 0);
+
+		if (recvSize > 0)
+		{
+			LOG_TRACE("Received %d bytes.", recvSize);
+
+			session->bufferLength += (size_t) recvSize;
+			HandleSessionFrames(session, count, &received,
+					handler, context, error);
+
+			if (error)
+				return;
+
+			continue;
+		}
+
+		if (0 == recvSize)
+		{
+			error = ECHO_ERROR_DISCONNECTED;
+			return;
+		}
+
+		if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			return;
+		}
+
+		// Wait only if nothing more can be written right away
+		if ((sent < limit) && !writeBlocked)
+			continue;
+
+		struct pollfd pollFd;
+		pollFd.fd = session->sd;
+		pollFd.events = POLLIN | ((sent < limit) ? POLLOUT : 0);
+		pollFd.revents = 0;
+
+		if ((-1 == poll(&pollFd, 1, -1)) && (EINTR != errno))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			return;
+		}
+	}
+
+	LOG_DEBUG("Echoed %d messages.", count);
+}
+
+void CloseTcpEchoSession(TcpEchoSession* session)
+{
+	if (NULL == session)
+		return;
+
+	close(session->sd);
+
+	delete[] session->buffer;
+	delete session;
+}
+
+/**
+ * Constructs a new UDP socket.
+ *
+ * @param error error code.
+ * @return socket descriptor.
+ */
+static int NewUdpSocket(std::error_code& error)
+{
+	// Construct socket
+	LOG_DEBUG("Constructing a new UDP socket...");
+	int udpSocket = socket(PF_INET, SOCK_DGRAM, 0);
+
+	// Check if socket is properly constructed
+	if (-1 == udpSocket)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+
+	return udpSocket;
+}
+
+/**
+ * Block and receive datagram from the socket into
+ * the buffer, and populate the client address.
+ *
+ * @param sd socket descriptor.
+ * @param address client address.
+ * @param buffer data buffer.
+ * @param bufferSize buffer size.
+ * @param error error code.
+ * @return receive size.
+ */
+static ssize_t ReceiveDatagramFromSocket(
+		int sd,
+		struct sockaddr_in* address,
+		char* buffer,
+		size_t bufferSize,
+		std::error_code& error)
+{
+	socklen_t addressLength = sizeof(struct sockaddr_in);
+
+	// Receive datagram from socket
+	LOG_TRACE("Receiving from the socket...");
+	int64_t start = METRIC_TIME();
+	ssize_t recvSize = recvfrom(sd, buffer, bufferSize, 0,
+			(struct sockaddr*) address,
+			&addressLength);
+
+	METRIC_RECORD_SINCE(ECHO_HISTOGRAM_RECV_LATENCY, start);
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If receive is failed
+	if (-1 == recvSize)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		// Log address
+		LogAddress(LOG_LEVEL_TRACE, "Received from", address, error);
+
+		// If data is received
+		if (recvSize > 0)
+		{
+			METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+
+			LOG_TRACE("Received %d bytes: %s", recvSize,
+					LogData(buffer, (size_t) recvSize));
+		}
+	}
+
+	return recvSize;
+}
+
+/**
+ * Sends datagram to the given address using the given socket.
+ *
+ * @param sd socket descriptor.
+ * @param address remote address.
+ * @param buffer data buffer.
+ * @param bufferSize buffer size.
+ * @param error error code.
+ * @return sent size.
+ */
+static ssize_t SendDatagramToSocket(
+		int sd,
+		const struct sockaddr_in* address,
+		const char* buffer,
+		size_t bufferSize,
+		std::error_code& error)
+{
+	// Send data buffer to the socket
+	LogAddress(LOG_LEVEL_TRACE, "Sending to", address, error);
+	int64_t start = METRIC_TIME();
+	ssize_t sentSize = sendto(sd, buffer, bufferSize, 0,
+			(const sockaddr*) address,
+			sizeof(struct sockaddr_in));
+
+	METRIC_RECORD_SINCE(ECHO_HISTOGRAM_SEND_LATENCY, start);
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If send is failed
+	if (-1 == sentSize)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else if (sentSize > 0)
+	{
+		METRIC_ADD(ECHO_COUNTER_BYTES_OUT, sentSize);
+
+		LOG_TRACE("Sent %d bytes: %s", sentSize,
+				LogData(buffer, (size_t) sentSize));
+	}
+
+	return sentSize;
+}
+
+size_t ExchangeUdpEcho(
+		const char* ip,
+		unsigned short port,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error)
+{
+	ssize_t recvSize = 0;
+
+	// Construct a new UDP socket.
+	int clientSocket = NewUdpSocket(error);
+	if (!error)
+	{
+		struct sockaddr_in address;
+
+		memset(&address, 0, sizeof(address));
+		address.sin_family = PF_INET;
+
+		// Convert IP address string to Internet address
+		int result = inet_aton(ip, &(address.sin_addr));
+
+		// If conversion is failed
+		if (0 == result)
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			goto exit;
+		}
+
+		// Convert port to network byte order
+		address.sin_port = htons(port);
+
+		// Send the data as a single datagram
+		SendDatagramToSocket(clientSocket, &address,
+				data, size, error);
+
+		// If send was not successful
+		if (error)
+			goto exit;
+
+		// Clear address
+		memset(&address, 0, sizeof(address));
+
+		// Receive from the socket, truncated to the reply buffer
+		recvSize = ReceiveDatagramFromSocket(clientSocket, &address,
+				reply, replySize, error);
+	}
+
+exit:
+	if (clientSocket > 0)
+	{
+		close(clientSocket);
+	}
+
+	return (recvSize > 0) ? (size_t) recvSize : 0;
+}
+
+void RunUdpEchoClient(
+		const char* ip,
+		unsigned short port,
+		const char* message,
+		std::error_code& error)
+{
+	// Data buffer, a datagram is never bigger
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	if (bufferSize > MAX_DATAGRAM_SIZE)
+	{
+		bufferSize = MAX_DATAGRAM_SIZE;
+	}
+	char* buffer = new char[bufferSize];
+
+	ExchangeUdpEcho(ip, port, message, strlen(message),
+			buffer, bufferSize, error);
+
+	delete[] buffer;
+}
+
+void RunUdpEchoServer(unsigned short port, std::error_code& error)
+{
+	// Data buffer, a datagram is never bigger
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	if (bufferSize > MAX_DATAGRAM_SIZE)
+	{
+		bufferSize = MAX_DATAGRAM_SIZE;
+	}
+	char* buffer = NULL;
+
+	// Construct a new UDP socket.
+	int serverSocket = NewUdpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Client address
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+
+		buffer = new char[bufferSize];
+		ssize_t recvSize;
+
+		// Receive from the socket
+		recvSize = ReceiveDatagramFromSocket(serverSocket,
+				&address, buffer, bufferSize, error);
+
+		if ((0 == recvSize) || error)
+			goto exit;
+
+		// Send to the socket, a datagram is sent whole or fails
+		SendDatagramToSocket(serverSocket,
+				&address, buffer, (size_t) recvSize, error);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+
+	delete[] buffer;
+}
+
+/**
+ * Preallocated message headers and buffers for receiving and
+ * sending datagrams in batches.
+ */
+struct DatagramBatch
+{
+	// Number of datagrams
+	int size;
+
+	// Message headers
+	struct mmsghdr* messages;
+
+	// Message data vectors
+	struct iovec* iovecs;
+
+	// Peer addresses
+	struct sockaddr_in* addresses;
+
+	// Size of each data buffer
+	size_t bufferSize;
+
+	// Data buffers
+	char* buffers;
+};
+
+/**
+ * Allocates the message headers and buffers of a datagram batch.
+ *
+ * @param batch datagram batch.
+ * @param size number of datagrams.
+ * @param bufferSize size of each data buffer.
+ */
+static void NewDatagramBatch(
+		DatagramBatch* batch,
+		int size,
+		size_t bufferSize)
+{
+	batch->size = size;
+	batch->bufferSize = bufferSize;
+	batch->messages = new struct mmsghdr[size];
+	batch->iovecs = new struct iovec[size];
+	batch->addresses = new struct sockaddr_in[size];
+	batch->buffers = new char[size * bufferSize];
+
+	memset(batch->messages, 0, size * sizeof(struct mmsghdr));
+
+	// Each message points to its own address and buffer
+	for (int i = 0; i < size; i++)
+	{
+		batch->iovecs[i].iov_base = batch->buffers + (i * bufferSize);
+		batch->iovecs[i].iov_len = bufferSize;
+
+		batch->messages[i].msg_hdr.msg_name = &batch->addresses[i];
+		batch->messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		batch->messages[i].msg_hdr.msg_iov = &batch->iovecs[i];
+		batch->messages[i].msg_hdr.msg_iovlen = 1;
+	}
+}
+
+/**
+ * Releases the message headers and buffers of a datagram batch.
+ *
+ * @param batch datagram batch.
+ */
+static void FreeDatagramBatch(DatagramBatch* batch)
+{
+	delete[] batch->messages;
+	delete[] batch->iovecs;
+	delete[] batch->addresses;
+	delete[] batch->buffers;
+}
+
+/**
+ * Blocks until at least one datagram is received, then receives
+ * as many of the queued datagrams as the batch holds.
+ *
+ * @param sd socket descriptor.
+ * @param batch datagram batch.
+ * @param error error code.
+ * @return number of received datagrams.
+ */
+static int ReceiveDatagramBatch(
+		int sd,
+		DatagramBatch* batch,
+		std::error_code& error)
+{
+	// Restore the lengths updated by the previous batch
+	for (int i = 0; i < batch->size; i++)
+	{
+		batch->iovecs[i].iov_len = batch->bufferSize;
+		batch->messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+
+	int recvCount;
+	do
+	{
+		int64_t start = METRIC_TIME();
+		recvCount = recvmmsg(sd, batch->messages, batch->size,
+				MSG_WAITFORONE, NULL);
+
+		METRIC_RECORD_SINCE(ECHO_HISTOGRAM_RECV_LATENCY, start);
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+	} while ((-1 == recvCount) && (EINTR == errno));
+
+	// If receive is failed
+	if (-1 == recvCount)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		LOG_TRACE("Received %d datagrams.", recvCount);
+
+#if ECHO_METRICS_ENABLED
+		size_t recvSize = 0;
+		for (int i = 0; i < recvCount; i++)
+		{
+			recvSize += batch->messages[i].msg_len;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_BYTES_IN, recvSize);
+		METRIC_RECORD(ECHO_HISTOGRAM_QUEUE_DEPTH, recvCount);
+#endif
+	}
+
+	return recvCount;
+}
+
+/**
+ * Sends the first given number of datagrams of the batch back to
+ * their peers, each with the size it was received with.
+ *
+ * @param sd socket descriptor.
+ * @param batch datagram batch.
+ * @param count number of datagrams.
+ */
+static void SendDatagramBatch(
+		int sd,
+		DatagramBatch* batch,
+		int count)
+{
+	// Echo back only the received bytes
+	for (int i = 0; i < count; i++)
+	{
+		batch->iovecs[i].iov_len = batch->messages[i].msg_len;
+	}
+
+	int sent = 0;
+	while (sent < count)
+	{
+		int64_t start = METRIC_TIME();
+		int sentCount = sendmmsg(sd, batch->messages + sent,
+				count - sent, 0);
+
+		METRIC_RECORD_SINCE(ECHO_HISTOGRAM_SEND_LATENCY, start);
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+		if (-1 == sentCount)
+		{
+			if (EINTR == errno)
+				continue;
+
+			// Failing peer must not stop the others, skip it
+			LOG_WARN("Unable to send: %s", strerror(errno));
+			sentCount = 1;
+		}
+		else
+		{
+			// Whole datagrams are sent
+			for (int i = sent; i < sent + sentCount; i++)
+			{
+				METRIC_ADD(ECHO_COUNTER_BYTES_OUT,
+						batch->messages[i].msg_len);
+			}
+		}
+
+		sent += sentCount;
+	}
+
+	LOG_TRACE("Sent %d datagrams.", count);
+}
+
+void RunUdpBatchEchoServer(
+		unsigned short port,
+		int batchSize,
+		std::error_code& error)
+{
+	DatagramBatch batch;
+	batch.size = 0;
+
+	// Construct a new UDP socket.
+	int serverSocket = NewUdpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		if (batchSize < 1)
+		{
+			batchSize = DEFAULT_DATAGRAM_BATCH;
+		}
+		else if (batchSize > MAX_DATAGRAM_BATCH)
+		{
+			batchSize = MAX_DATAGRAM_BATCH;
+		}
+
+		// Datagram is never bigger
+		size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+		if (bufferSize > MAX_DATAGRAM_SIZE)
+		{
+			bufferSize = MAX_DATAGRAM_SIZE;
+		}
+
+		// Allocate all message headers and buffers upfront
+		NewDatagramBatch(&batch, batchSize, bufferSize);
+		LOG_INFO("Receiving up to %d datagrams at once.", batchSize);
+
+		// Receive and send back the datagrams
+		while (1)
+		{
+			int recvCount = ReceiveDatagramBatch(serverSocket,
+					&batch, error);
+
+			if (error)
+				break;
+
+			SendDatagramBatch(serverSocket, &batch, recvCount);
+		}
+	}
+
+exit:
+	if (0 != batch.size)
+	{
+		FreeDatagramBatch(&batch);
+	}
+
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+}
+
+/**
+ * Constructs a new Local UNIX socket.
+ *
+ * @param error error code.
+ * @return socket descriptor.
+ */
+static int NewLocalSocket(std::error_code& error)
+{
+	// Construct socket
+	LOG_DEBUG("Constructing a new Local UNIX socket...");
+	int localSocket = socket(PF_LOCAL, SOCK_STREAM, 0);
+
+	// Check if socket is properly constructed
+	if (-1 == localSocket)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+
+	return localSocket;
+}
+
+/**
+ * Constructs the address of a local UNIX socket name.
+ *
+ * @param name socket name.
+ * @param address socket address.
+ * @param error error code.
+ * @return address length.
+ */
+static socklen_t NewLocalAddress(
+		const char* name,
+		struct sockaddr_un* address,
+		std::error_code& error)
+{
+	// Address length
+	socklen_t addressLength = 0;
+
+	// Name length
+	const size_t nameLength = strlen(name);
+
+	// Path length is initiall equal to name length
+	size_t pathLength = nameLength;
+
+	// If name is not starting with a slash it is
+	// in the abstract namespace
+	bool abstractNamespace = ('/' != name[0]);
+
+	// Abstract namespace requires having the first
+	// byte of the path to be the zero byte, update
+	// the path length to include the zero byte
+	if (abstractNamespace)
+	{
+		pathLength++;
+	}
+
+	// Check the path length
+	if (pathLength > sizeof(address->sun_path))
+	{
+		error = ECHO_ERROR_NAME_TOO_BIG;
+	}
+	else
+	{
+		// Clear the address bytes
+		memset(address, 0, sizeof(*address));
+		address->sun_family = PF_LOCAL;
+
+		// Socket path
+		char* sunPath = address->sun_path;
+
+		// First byte must be zero to use the abstract namespace
+		if (abstractNamespace)
+		{
+			*sunPath++ = NULL;
+		}
+
+		// Append the local name
+		strcpy(sunPath, name);
+
+		// Address length
+		addressLength =
+				(offsetof(struct sockaddr_un, sun_path))
+				+ pathLength;
+	}
+
+	return addressLength;
+}
+
+/**
+ * Binds a local UNIX socket to a name.
+ *
+ * @param sd socket descriptor.
+ * @param name socket name.
+ * @param error error code.
+ */
+static void BindLocalSocketToName(
+		int sd,
+		const char* name,
+		std::error_code& error)
+{
+	struct sockaddr_un address;
+
+	// Construct the address of the name
+	socklen_t addressLength = NewLocalAddress(name, &address, error);
+	if (error)
+		return;
+
+	// Unlink if the socket name is already binded
+	unlink(address.sun_path);
+
+	// Bind socket
+	LOG_INFO("Binding to local name %s%s.",
+			('/' != name[0]) ? "(null)" : "",
+			name);
+
+	if (-1 == bind(sd, (struct sockaddr*) &address, addressLength))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Blocks and waits for incoming client connections on the
+ * given socket.
+ * @param sd socket descriptor.
+ * @param error error code.
+ * @return client socket.
+ */
+static int AcceptOnLocalSocket(
+		int sd,
+		std::error_code& error)
+{
+	// Blocks and waits for an incoming client connection
+	// and accepts it
+	LOG_DEBUG("Waiting for a client connection...");
+	int clientSocket = accept(sd, NULL, NULL);
+
+	METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+
+	// If client socket is not valid
+	if (-1 == clientSocket)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		METRIC_ADD(ECHO_COUNTER_ACCEPTED, 1);
+	}
+
+	return clientSocket;
+}
+
+void RunLocalEchoServer(const char* name, std::error_code& error)
+{
+	// Data buffer
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+	char* buffer = NULL;
+
+	// Construct a new local UNIX socket.
+	int serverSocket = NewLocalSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindLocalSocketToName(serverSocket, name, error);
+
+		// If bind is failed
+		if (error)
+			goto exit;
+
+		// Listen on socket with a backlog of 4 pending connections
+		ListenOnSocket(serverSocket, 4, error);
+		if (error)
+			goto exit;
+
+		// Accept a client connection on socket
+		int clientSocket = AcceptOnLocalSocket(serverSocket, error);
+		if (error)
+			goto exit;
+
+		// Move the data inside the kernel if requested and supported
+		if (!gZeroCopy.load(std::memory_order_relaxed)
+				|| !SpliceEchoSocket(clientSocket, bufferSize, error))
+		{
+			buffer = new char[bufferSize];
+			ssize_t recvSize;
+			ssize_t sentSize;
+
+			// Receive and send back the data
+			while (1)
+			{
+				// Receive from the socket
+				recvSize = ReceiveFromSocket(clientSocket,
+						buffer, bufferSize, error);
+
+				if ((0 == recvSize) || error)
+					break;
+
+				// Send to the socket
+				sentSize = SendToSocket(clientSocket,
+						buffer, (size_t) recvSize, error);
+
+				if ((0 == sentSize) || error)
+					break;
+			}
+		}
+
+		// Close the client socket
+		close(clientSocket);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+
+	delete[] buffer;
+}
+
+#ifdef HAVE_IO_URING
+
+/**
+ * Per client connection state of the io_uring echo server.
+ */
+struct UringConnection
+{
+	// Client socket descriptor
+	int sd;
+
+	// Multishot receive is armed
+	bool receiving;
+
+	// Send is in flight
+	bool sending;
+
+	// Connection is shut down, released once idle
+	bool closing;
+
+	// Waiting for free buffers to receive again
+	bool starved;
+
+	// Received buffers to be sent back, in order
+	int pendingHead;
+	int pendingTail;
+
+	// Next connection waiting for free buffers
+	UringConnection* nextStarved;
+
+	// Neighbour connections of the server
+	UringConnection* prev;
+	UringConnection* next;
+};
+
+/**
+ * State of a provided buffer while it is held by the server.
+ */
+struct UringBuffer
+{
+	// Number of bytes received
+	unsigned length;
+
+	// Number of bytes already sent back
+	unsigned offset;
+
+	// Next pending buffer of the same connection
+	int next;
+
+	// Receiving connection
+	UringConnection* connection;
+
+	// Owners of the buffer, the server and the zero copy sends
+	// the kernel has not finished with yet
+	unsigned references;
+
+	// Last send was zero copy
+	bool zeroCopy;
+
+	// Datagram reply header
+	struct msghdr message;
+	struct iovec iov;
+};
+
+/**
+ * io_uring echo server state.
+ */
+struct UringEchoServer
+{
+	// Ring instance
+	IoUring ring;
+
+	// Provided receive buffers
+	IoUringBufferRing buffers;
+
+	// Receive buffers are registered, sends go out from them
+	// without copying
+	bool fixedBuffers;
+
+	// Per buffer state
+	UringBuffer* bufferStates;
+
+	// Listening socket, or the datagram socket
+	int serverSocket;
+
+	// Stream or datagram server
+	bool stream;
+
+	// Header layout of the multishot datagram receive
+	struct msghdr recvMessage;
+
+	// Datagram receive is waiting for free buffers
+	bool recvStarved;
+
+	// Buffers returned since the last resume
+	unsigned returnedBuffers;
+
+	// Connections waiting for free buffers, in order
+	UringConnection* starved;
+	UringConnection* starvedTail;
+
+	// Open client connections
+	UringConnection* connections;
+
+	// Pool of connection states
+	BufferPool connectionPool;
+};
+
+/**
+ * Initializes the server state, nothing is allocated until
+ * the ring is constructed.
+ *
+ * @param server server instance.
+ * @param serverSocket listening or datagram socket.
+ * @param stream stream server.
+ */
+static void InitUringEchoServer(
+		UringEchoServer* server,
+		int serverSocket,
+		bool stream)
+{
+	memset(server, 0, sizeof(*server));
+	server->ring.fd = -1;
+	server->serverSocket = serverSocket;
+	server->stream = stream;
+
+	// Only the sender address is kept with the datagram
+	server->recvMessage.msg_namelen = sizeof(struct sockaddr_in);
+
+	InitBufferPool(&server->connectionPool, sizeof(UringConnection),
+			CONNECTIONS_PER_CHUNK);
+}
+
+/**
+ * Constructs the ring and registers the receive buffers.
+ *
+ * @param server server instance.
+ * @param bufferSize receive buffer size.
+ * @param error error code.
+ */
+static void NewUringEchoServer(
+		UringEchoServer* server,
+		size_t bufferSize,
+		std::error_code& error)
+{
+	// Construct the io_uring instance
+	LOG_DEBUG("Constructing a new io_uring instance...");
+	if (!InitIoUring(&server->ring, URING_ENTRIES, URING_CQ_ENTRIES))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return;
+	}
+
+	// Provide the receive buffers to the kernel
+	if (!NewIoUringBufferRing(&server->ring, &server->buffers,
+			URING_BUFFER_GROUP, URING_BUFFER_COUNT, bufferSize,
+			&server->fixedBuffers))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return;
+	}
+
+	server->bufferStates = new UringBuffer[URING_BUFFER_COUNT];
+
+	LOG_INFO("Using %d buffers of %zu bytes, %s.",
+			URING_BUFFER_COUNT, bufferSize,
+			server->fixedBuffers ? "registered" : "not registered");
+}
+
+/**
+ * Takes the next submission queue entry, submits the queued
+ * entries first if the queue is full.
+ *
+ * @param server server instance.
+ * @param error error code.
+ * @return entry or NULL.
+ */
+static struct io_uring_sqe* NextUringSqe(
+		UringEchoServer* server,
+		std::error_code& error)
+{
+	struct io_uring_sqe* sqe = GetIoUringSqe(&server->ring);
+
+	if (NULL == sqe)
+	{
+		if ((-1 == SubmitIoUring(&server->ring, 0))
+				&& (EINTR != errno) && (EBUSY != errno))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			return NULL;
+		}
+
+		sqe = GetIoUringSqe(&server->ring);
+		if (NULL == sqe)
+		{
+			error = ECHO_ERROR_QUEUE_FULL;
+		}
+	}
+
+	return sqe;
+}
+
+/**
+ * Queues a multishot accept on the listening socket.
+ *
+ * @param server server instance.
+ * @param error error code.
+ */
+static void ArmUringAccept(
+		UringEchoServer* server,
+		std::error_code& error)
+{
+	struct io_uring_sqe* sqe = NextUringSqe(server, error);
+	if (NULL == sqe)
+		return;
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = server->serverSocket;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->user_data = URING_ACCEPT;
+}
+
+/**
+ * Queues a multishot receive into the provided buffers.
+ *
+ * @param server server instance.
+ * @param connection client connection.
+ * @param error error code.
+ */
+static void ArmUringRecv(
+		UringEchoServer* server,
+		UringConnection* connection,
+		std::error_code& error)
+{
+	struct io_uring_sqe* sqe = NextUringSqe(server, error);
+	if (NULL == sqe)
+		return;
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = connection->sd;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = server->buffers.groupId;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->user_data = (__u64) (uintptr_t) connection | URING_RECV;
+
+	connection->receiving = true;
+}
+
+/**
+ * Queues a multishot datagram receive into the provided buffers.
+ *
+ * @param server server instance.
+ * @param error error code.
+ */
+static void ArmUringRecvMsg(
+		UringEchoServer* server,
+		std::error_code& error)
+{
+	struct io_uring_sqe* sqe = NextUringSqe(server, error);
+	if (NULL == sqe)
+		return;
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = server->serverSocket;
+	sqe->addr = (__u64) (uintptr_t) &server->recvMessage;
+	sqe->len = 1;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = server->buffers.groupId;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->user_data = URING_RECVMSG;
+}
+
+/**
+ * Queues a send of the first pending buffer of the given
+ * connection, straight from the registered buffer if possible.
+ *
+ * @param server server instance.
+ * @param connection client connection.
+ * @param error error code.
+ */
+static void SubmitUringSend(
+		UringEchoServer* server,
+		UringConnection* connection,
+		std::error_code& error)
+{
+	struct io_uring_sqe* sqe = NextUringSqe(server, error);
+	if (NULL == sqe)
+		return;
+
+	unsigned short bufferId = (unsigned short) connection->pendingHead;
+	UringBuffer* state = &server->bufferStates[bufferId];
+
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = connection->sd;
+	sqe->addr = (__u64) (uintptr_t)
+			(GetIoUringBuffer(&server->buffers, bufferId) + state->offset);
+	sqe->len = state->length - state->offset;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = ((__u64) bufferId << 4) | URING_SEND;
+
+	// Registered buffers are only sent with zero copy
+	state->zeroCopy = server->fixedBuffers;
+	if (state->zeroCopy)
+	{
+		sqe->opcode = IORING_OP_SEND_ZC;
+		sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+		sqe->buf_index = 0;
+	}
+
+	connection->sending = true;
+}
+
+/**
+ * Hands the given buffer back to the kernel.
+ *
+ * @param server server instance.
+ * @param bufferId buffer identifier.
+ */
+static void ReturnUringBuffer(
+		UringEchoServer* server,
+		unsigned short bufferId)
+{
+	ReturnIoUringBuffer(&server->buffers, bufferId);
+	server->returnedBuffers++;
+}
+
+/**
+ * Drops a reference to the given buffer, the last one hands
+ * it back to the kernel.
+ *
+ * @param server server instance.
+ * @param bufferId buffer identifier.
+ */
+static void DropUringBuffer(
+		UringEchoServer* server,
+		unsigned short bufferId)
+{
+	if (0 == --server->bufferStates[bufferId].references)
+	{
+		ReturnUringBuffer(server, bufferId);
+	}
+}
+
+/**
+ * Shuts down the given connection, the armed requests complete
+ * and the connection is released once it is idle.
+ *
+ * @param server server instance.
+ * @param connection client connection.
+ */
+static void CloseUringConnection(
+		UringEchoServer* server,
+		UringConnection* connection)
+{
+	if (!connection->closing)
+	{
+		connection->closing = true;
+
+		// Completes the armed receive and send
+		if (connection->receiving || connection->sending)
+		{
+			shutdown(connection->sd, SHUT_RDWR);
+		}
+	}
+}
+
+/**
+ * Releases the given connection if it is closing and there are
+ * no requests left in flight.
+ *
+ * @param server server instance.
+ * @param connection client connection.
+ */
+static void FinishUringConnection(
+		UringEchoServer* server,
+		UringConnection* connection)
+{
+	if (!connection->closing || connection->receiving
+			|| connection->sending)
+	{
+		return;
+	}
+
+	// Unlink from the connections waiting for buffers
+	if (connection->starved)
+	{
+		UringConnection* previous = NULL;
+		UringConnection** link = &server->starved;
+		while (connection != *link)
+		{
+			previous = *link;
+			link = &previous->nextStarved;
+		}
+
+		*link = connection->nextStarved;
+		if (connection == server->starvedTail)
+		{
+			server->starvedTail = previous;
+		}
+	}
+
+	// Unlink from the open connections
+	if (NULL != connection->prev)
+	{
+		connection->prev->next = connection->next;
+	}
+	else
+	{
+		server->connections = connection->next;
+	}
+
+	if (NULL != connection->next)
+	{
+		connection->next->prev = connection->prev;
+	}
+
+	close(connection->sd);
+
+	// Pending data is dropped
+	while (-1 != connection->pendingHead)
+	{
+		unsigned short bufferId = (unsigned short) connection->pendingHead;
+		connection->pendingHead = server->bufferStates[bufferId].next;
+
+		DropUringBuffer(server, bufferId);
+	}
+
+	ReleaseBuffer(&server->connectionPool, (char*) connection);
+}
+
+/**
+ * Handles an accept completion, the new client starts receiving
+ * right away.
+ *
+ * @param server server instance.
+ * @param cqe accept completion.
+ * @param error error code.
+ */
+static void HandleUringAccept(
+		UringEchoServer* server,
+		const struct io_uring_cqe* cqe,
+		std::error_code& error)
+{
+	if (cqe->res >= 0)
+	{
+		LOG_DEBUG("Client connected.");
+		METRIC_ADD(ECHO_COUNTER_ACCEPTED, 1);
+
+		UringConnection* connection =
+				(UringConnection*) AcquireBuffer(&server->connectionPool);
+
+		if (NULL == connection)
+		{
+			LOG_WARN("Unable to allocate client state.");
+			close(cqe->res);
+		}
+		else
+		{
+			memset(connection, 0, sizeof(*connection));
+			connection->sd = cqe->res;
+			connection->pendingHead = -1;
+			connection->pendingTail = -1;
+
+			// Link to the open connections
+			connection->next = server->connections;
+			if (NULL != server->connections)
+			{
+				server->connections->prev = connection;
+			}
+			server->connections = connection;
+
+			ArmUringRecv(server, connection, error);
+			if (error)
+				return;
+		}
+	}
+	else if (-EINVAL == cqe->res)
+	{
+		// Multishot accept is not supported by the kernel
+		error.assign(EINVAL, std::system_category());
+		return;
+	}
+	else
+	{
+		LOG_WARN("Unable to accept: %s", strerror(-cqe->res));
+	}
+
+	// Accept is no longer armed
+	if (0 == (cqe->flags & IORING_CQE_F_MORE))
+	{
+		ArmUringAccept(server, error);
+	}
+}
+
+/**
+ * Handles a receive completion, the received buffer is queued
+ * to be sent back.
+ *
+ * @param server server instance.
+ * @param connection client connection.
+ * @param cqe receive completion.
+ * @param error error code.
+ */
+static void HandleUringRecv(
+		UringEchoServer* server,
+		UringConnection* connection,
+		const struct io_uring_cqe* cqe,
+		std::error_code& error)
+{
+	bool more = (0 != (cqe->flags & IORING_CQE_F_MORE));
+	if (!more)
+	{
+		connection->receiving = false;
+	}
+
+	if (cqe->res > 0)
+	{
+		unsigned short bufferId =
+				(unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+		if (connection->closing)
+		{
+			ReturnUringBuffer(server, bufferId);
+		}
+		else
+		{
+			LOG_TRACE("Received %d bytes: %s", cqe->res,
+					LogData(GetIoUringBuffer(&server->buffers, bufferId),
+							(size_t) cqe->res));
+			METRIC_ADD(ECHO_COUNTER_BYTES_IN, cqe->res);
+
+			// Queue behind the data not sent back yet
+			UringBuffer* state = &server->bufferStates[bufferId];
+			state->length = (unsigned) cqe->res;
+			state->offset = 0;
+			state->next = -1;
+			state->connection = connection;
+			state->references = 1;
+
+			if (-1 == connection->pendingTail)
+			{
+				connection->pendingHead = bufferId;
+			}
+			else
+			{
+				server->bufferStates[connection->pendingTail].next = bufferId;
+			}
+			connection->pendingTail = bufferId;
+
+			if (!connection->sending)
+			{
+				SubmitUringSend(server, connection, error);
+			}
+
+			// Kernel may stop a multishot receive at any time
+			if (!more && !error)
+			{
+				ArmUringRecv(server, connection, error);
+			}
+		}
+	}
+	else if (-ENOBUFS == cqe->res)
+	{
+		// All buffers are being sent back, resume once one is returned
+		if (!connection->closing)
+		{
+			connection->starved = true;
+			connection->nextStarved = NULL;
+
+			if (NULL == server->starvedTail)
+			{
+				server->starved = connection;
+			}
+			else
+			{
+				server->starvedTail->nextStarved = connection;
+			}
+			server->starvedTail = connection;
+		}
+	}
+	else
+	{
+		if (0 == cqe->res)
+		{
+			LOG_DEBUG("Client disconnected.");
+		}
+		else if (!connection->closing)
+		{
+			LOG_WARN("Unable to receive: %s", strerror(-cqe->res));
+		}
+
+		CloseUringConnection(server, connection);
+	}
+
+	FinishUringConnection(server, connection);
+}
+
+/**
+ * Handles a send completion, continues with the rest of the
+ * buffer or with the next pending buffer. Zero copy sends
+ * complete twice, the second time once the buffer is free.
+ *
+ * @param server server instance.
+ * @param cqe send completion.
+ * @param error error code.
+ */
+static void HandleUringSend(
+		UringEchoServer* server,
+		const struct io_uring_cqe* cqe,
+		std::error_code& error)
+{
+	unsigned short bufferId = (unsigned short) (cqe->user_data >> 4);
+	UringBuffer* state = &server->bufferStates[bufferId];
+
+	// Kernel is done with the zero copy buffer
+	if (0 != (cqe->flags & IORING_CQE_F_NOTIF))
+	{
+		DropUringBuffer(server, bufferId);
+		return;
+	}
+
+	// Buffer is held until the notification
+	if (0 != (cqe->flags & IORING_CQE_F_MORE))
+	{
+		state->references++;
+	}
+
+	UringConnection* connection = state->connection;
+	connection->sending = false;
+
+	if (cqe->res < 0)
+	{
+		// Zero copy is not supported by the kernel or the socket
+		if (((-EINVAL == cqe->res) || (-EOPNOTSUPP == cqe->res))
+				&& state->zeroCopy && !connection->closing)
+		{
+			if (server->fixedBuffers)
+			{
+				LOG_DEBUG("Zero copy send is not supported, copying.");
+				server->fixedBuffers = false;
+			}
+
+			SubmitUringSend(server, connection, error);
+			return;
+		}
+
+		if (!connection->closing)
+		{
+			LOG_WARN("Unable to send: %s", strerror(-cqe->res));
+		}
+
+		CloseUringConnection(server, connection);
+	}
+	else if (!connection->closing)
+	{
+		state->offset += (unsigned) cqe->res;
+
+		LOG_TRACE("Sent %d bytes.", cqe->res);
+		METRIC_ADD(ECHO_COUNTER_BYTES_OUT, cqe->res);
+
+		// Send the rest of the buffer
+		if (state->offset < state->length)
+		{
+			SubmitUringSend(server, connection, error);
+			return;
+		}
+
+		// Buffer is sent back, continue with the next one
+		connection->pendingHead = state->next;
+		if (-1 == connection->pendingHead)
+		{
+			connection->pendingTail = -1;
+		}
+
+		DropUringBuffer(server, bufferId);
+
+		if (-1 != connection->pendingHead)
+		{
+			SubmitUringSend(server, connection, error);
+		}
+	}
+
+	FinishUringConnection(server, connection);
+}
+
+/**
+ * Handles a datagram receive completion, the datagram is sent
+ * back to its sender.
+ *
+ * @param server server instance.
+ * @param cqe receive completion.
+ * @param error error code.
+ */
+static void HandleUringRecvMsg(
+		UringEchoServer* server,
+		const struct io_uring_cqe* cqe,
+		std::error_code& error)
+{
+	bool more = (0 != (cqe->flags & IORING_CQE_F_MORE));
+
+	if (cqe->res > 0)
+	{
+		unsigned short bufferId =
+				(unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+		char* buffer = GetIoUringBuffer(&server->buffers, bufferId);
+
+		// Buffer starts with the receive header and the sender address
+		struct io_uring_recvmsg_out* out =
+				(struct io_uring_recvmsg_out*) buffer;
+		size_t headerSize = sizeof(*out) + server->recvMessage.msg_namelen
+				+ server->recvMessage.msg_controllen;
+		size_t payloadSize = (size_t) cqe->res - headerSize;
+
+		if (0 != (out->flags & MSG_TRUNC))
+		{
+			LOG_WARN("Datagram is truncated to %zu bytes.", payloadSize);
+		}
+
+		LOG_TRACE("Received %zu bytes: %s", payloadSize,
+				LogData(buffer + headerSize, payloadSize));
+		METRIC_ADD(ECHO_COUNTER_BYTES_IN, payloadSize);
+
+		UringBuffer* state = &server->bufferStates[bufferId];
+		state->references = 1;
+
+		memset(&state->message, 0, sizeof(state->message));
+		state->iov.iov_base = buffer + headerSize;
+		state->iov.iov_len = payloadSize;
+		state->message.msg_name = buffer + sizeof(*out);
+		state->message.msg_namelen = out->namelen;
+		state->message.msg_iov = &state->iov;
+		state->message.msg_iovlen = 1;
+
+		// Send back to the sender
+		struct io_uring_sqe* sqe = NextUringSqe(server, error);
+		if (NULL == sqe)
+			return;
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = server->serverSocket;
+		sqe->addr = (__u64) (uintptr_t) &state->message;
+		sqe->len = 1;
+		sqe->user_data = ((__u64) bufferId << 4) | URING_SENDMSG;
+	}
+	else if (-ENOBUFS == cqe->res)
+	{
+		// All buffers are being sent back, resume once one is returned
+		server->recvStarved = true;
+		return;
+	}
+	else if (-EINVAL == cqe->res)
+	{
+		// Multishot receive is not supported by the kernel
+		error.assign(EINVAL, std::system_category());
+		return;
+	}
+	else if (0 != cqe->res)
+	{
+		LOG_WARN("Unable to receive: %s", strerror(-cqe->res));
+	}
+
+	// Receive is no longer armed
+	if (!more)
+	{
+		ArmUringRecvMsg(server, error);
+	}
+}
+
+/**
+ * Rearms the receives that ran out of buffers, one for each
+ * buffer returned to the kernel since the last call.
+ *
+ * @param server server instance.
+ * @param error error code.
+ */
+static void ResumeUringReceives(
+		UringEchoServer* server,
+		std::error_code& error)
+{
+	unsigned returnedBuffers = server->returnedBuffers;
+	server->returnedBuffers = 0;
+
+	if (0 == returnedBuffers)
+		return;
+
+	if (server->recvStarved)
+	{
+		server->recvStarved = false;
+		ArmUringRecvMsg(server, error);
+	}
+
+	// Longest waiting connections first
+	while ((0 != returnedBuffers--) && (NULL != server->starved)
+			&& !error)
+	{
+		UringConnection* connection = server->starved;
+		server->starved = connection->nextStarved;
+		if (NULL == server->starved)
+		{
+			server->starvedTail = NULL;
+		}
+
+		connection->starved = false;
+
+		ArmUringRecv(server, connection, error);
+	}
+}
+
+/**
+ * Submits the queued requests and dispatches the completions
+ * until an error occurs. A single system call both submits and
+ * waits, under load every call carries many completions.
+ *
+ * @param server server instance.
+ * @param error error code.
+ */
+static void RunUringEchoServer(
+		UringEchoServer* server,
+		std::error_code& error)
+{
+	if (server->stream)
+	{
+		ArmUringAccept(server, error);
+	}
+	else
+	{
+		ArmUringRecvMsg(server, error);
+	}
+
+	while (!error)
+	{
+		// Submit and wait for at least one completion
+		if ((-1 == SubmitIoUring(&server->ring, 1))
+				&& (EINTR != errno) && (EBUSY != errno))
+		{
+			// Fail with the error number
+			error.assign(errno, std::system_category());
+			break;
+		}
+
+		METRIC_ADD(ECHO_COUNTER_SYSCALLS, 1);
+		int completionCount = 0;
+
+		struct io_uring_cqe* cqe;
+		while (!error
+				&& (NULL != (cqe = PeekIoUringCqe(&server->ring))))
+		{
+			completionCount++;
+
+			// Handlers queue new requests, consume the completion first
+			struct io_uring_cqe completion = *cqe;
+			AdvanceIoUringCq(&server->ring);
+
+			UringConnection* connection = (UringConnection*) (uintptr_t)
+					(completion.user_data & ~(__u64) URING_KIND_MASK);
+
+			switch (completion.user_data & URING_KIND_MASK)
+			{
+			case URING_ACCEPT:
+				HandleUringAccept(server, &completion, error);
+				break;
+
+			case URING_RECV:
+				HandleUringRecv(server, connection, &completion, error);
+				break;
+
+			case URING_SEND:
+				HandleUringSend(server, &completion, error);
+				break;
+
+			case URING_RECVMSG:
+				HandleUringRecvMsg(server, &completion, error);
+				break;
+
+			case URING_SENDMSG:
+				if (completion.res < 0)
+				{
+					LOG_WARN("Unable to send: %s", strerror(-completion.res));
+				}
+				else
+				{
+					METRIC_ADD(ECHO_COUNTER_BYTES_OUT, completion.res);
+				}
+
+				DropUringBuffer(server,
+						(unsigned short) (completion.user_data >> 4));
+				break;
+			}
+		}
+
+		METRIC_RECORD(ECHO_HISTOGRAM_QUEUE_DEPTH, completionCount);
+
+		ResumeUringReceives(server, error);
+	}
+}
+
+/**
+ * Closes the client connections and releases the ring. The
+ * server socket is closed by the caller.
+ *
+ * @param server server instance.
+ */
+static void ReleaseUringEchoServer(UringEchoServer* server)
+{
+	// Requests in flight are cancelled with the ring
+	while (NULL != server->connections)
+	{
+		UringConnection* connection = server->connections;
+		server->connections = connection->next;
+
+		close(connection->sd);
+		ReleaseBuffer(&server->connectionPool, (char*) connection);
+	}
+
+	FreeIoUringBufferRing(&server->ring, &server->buffers);
+	FreeIoUring(&server->ring);
+
+	delete[] server->bufferStates;
+	server->bufferStates = NULL;
+
+	FreeBufferPool(&server->connectionPool);
+}
+
+#endif
+
+/**
+ * Echoes on the given socket with the io_uring engine until
+ * an error occurs.
+ *
+ * @param serverSocket listening socket, or the datagram socket.
+ * @param stream stream server.
+ * @param error error code.
+ */
+static void ServeWithUring(
+		int serverSocket,
+		bool stream,
+		std::error_code& error)
+{
+#ifdef HAVE_IO_URING
+	size_t bufferSize = gBufferSize.load(std::memory_order_relaxed);
+
+	// Datagram buffers also hold the receive header and sender address
+	if (!stream)
+	{
+		if (bufferSize > MAX_DATAGRAM_SIZE)
+		{
+			bufferSize = MAX_DATAGRAM_SIZE;
+		}
+
+		bufferSize += sizeof(struct io_uring_recvmsg_out)
+				+ sizeof(struct sockaddr_in);
+	}
+
+	UringEchoServer server;
+	InitUringEchoServer(&server, serverSocket, stream);
+
+	// Construct the ring
+	NewUringEchoServer(&server, bufferSize, error);
+	if (!error)
+	{
+		// Serve the clients
+		RunUringEchoServer(&server, error);
+	}
+
+	ReleaseUringEchoServer(&server);
+#else
+	error = ECHO_ERROR_NO_URING;
+#endif
+}
+
+void RunTcpUringEchoServer(unsigned short port, std::error_code& error)
+{
+	// Construct a new TCP socket.
+	int serverSocket = NewTcpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Listen on socket with the maximum backlog
+		ListenOnSocket(serverSocket, SOMAXCONN, error);
+		if (error)
+			goto exit;
+
+		// Serve the clients
+		ServeWithUring(serverSocket, true, error);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+}
+
+void RunUdpUringEchoServer(unsigned short port, std::error_code& error)
+{
+	// Construct a new UDP socket.
+	int serverSocket = NewUdpSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindSocketToPort(serverSocket, port, error);
+		if (error)
+			goto exit;
+
+		// If random port number is requested
+		if (0 == port)
+		{
+			// Get the port number socket is currently binded
+			GetSocketPort(serverSocket, error);
+			if (error)
+				goto exit;
+		}
+
+		// Receive and send back the datagrams
+		ServeWithUring(serverSocket, false, error);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+}
+
+void RunLocalUringEchoServer(const char* name, std::error_code& error)
+{
+	// Construct a new local UNIX socket.
+	int serverSocket = NewLocalSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindLocalSocketToName(serverSocket, name, error);
+
+		// If bind is failed
+		if (error)
+			goto exit;
+
+		// Listen on socket with a backlog of 4 pending connections
+		ListenOnSocket(serverSocket, 4, error);
+		if (error)
+			goto exit;
+
+		// Serve the clients
+		ServeWithUring(serverSocket, true, error);
+	}
+
+exit:
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+}
+
+/**
+ * Connects a local UNIX socket to the given name.
+ *
+ * @param sd socket descriptor.
+ * @param name socket name.
+ * @param error error code.
+ */
+static void ConnectLocalSocketToName(
+		int sd,
+		const char* name,
+		std::error_code& error)
+{
+	struct sockaddr_un address;
+
+	// Construct the address of the name
+	socklen_t addressLength = NewLocalAddress(name, &address, error);
+	if (error)
+		return;
+
+	// Connect to local name
+	LOG_INFO("Connecting to local name %s%s...",
+			('/' != name[0]) ? "(null)" : "",
+			name);
+
+	if (-1 == connect(sd, (struct sockaddr*) &address, addressLength))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		LOG_INFO("Connected.");
+	}
+}
+
+/**
+ * Sends the shared memory and the event descriptors of the
+ * given channel to the client.
+ *
+ * @param sd socket descriptor.
+ * @param channel shared memory channel.
+ * @param error error code.
+ */
+static void SendShmChannel(
+		int sd,
+		ShmChannel* channel,
+		std::error_code& error)
+{
+	// Ring capacity is the payload, the descriptors ride along
+	uint32_t capacity = channel->requests.capacity;
+	int fds[3] = { channel->memoryFd, channel->serverEvent,
+			channel->clientEvent };
+
+	struct iovec iov;
+	iov.iov_base = &capacity;
+	iov.iov_len = sizeof(capacity);
+
+	char control[CMSG_SPACE(sizeof(fds))];
+	memset(control, 0, sizeof(control));
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	// Send the descriptors
+	LOG_DEBUG("Sending the shared memory channel...");
+	if (-1 == sendmsg(sd, &message, MSG_NOSIGNAL))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+}
+
+/**
+ * Receives the descriptors of a channel from the server and
+ * maps its shared memory.
+ *
+ * @param sd socket descriptor.
+ * @param channel shared memory channel.
+ * @param error error code.
+ */
+static void ReceiveShmChannel(
+		int sd,
+		ShmChannel* channel,
+		std::error_code& error)
+{
+	uint32_t capacity = 0;
+	int fds[3];
+
+	struct iovec iov;
+	iov.iov_base = &capacity;
+	iov.iov_len = sizeof(capacity);
+
+	char control[CMSG_SPACE(sizeof(fds))];
+	memset(control, 0, sizeof(control));
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	// Receive the descriptors
+	LOG_DEBUG("Receiving the shared memory channel...");
+	ssize_t recvSize = recvmsg(sd, &message, MSG_CMSG_CLOEXEC);
+
+	if (-1 == recvSize)
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+		return;
+	}
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+	if ((NULL == cmsg) || (SOL_SOCKET != cmsg->cmsg_level)
+			|| (SCM_RIGHTS != cmsg->cmsg_type))
+	{
+		error = ECHO_ERROR_NO_SHARED_MEMORY;
+		return;
+	}
+
+	if (((ssize_t) sizeof(capacity) != recvSize)
+			|| (CMSG_LEN(sizeof(fds)) != cmsg->cmsg_len))
+	{
+		// Close whatever is received
+		size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t i = 0; i < count; i++)
+		{
+			close(((int*) CMSG_DATA(cmsg))[i]);
+		}
+
+		error = ECHO_ERROR_INVALID_HANDSHAKE;
+		return;
+	}
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	// Map the rings
+	if (!AttachShmChannel(channel, fds[0], fds[1], fds[2], capacity))
+	{
+		// Fail with the error number
+		error.assign(errno, std::system_category());
+	}
+	else
+	{
+		LOG_INFO("Mapped two rings of %u bytes.", capacity);
+	}
+}
+
+/**
+ * Sends the requests of the client back until the client
+ * is gone. Messages are copied from the request ring straight
+ * into the reply ring.
+ *
+ * @param channel shared memory channel.
+ * @param clientSocket client socket, only watched for hangup.
+ */
+static void EchoShmChannel(
+		ShmChannel* channel,
+		int clientSocket)
+{
+	ShmRing* requests = &channel->requests;
+	ShmRing* replies = &channel->replies;
+
+	while (1)
+	{
+		uint32_t size;
+		const char* message = PeekShmRing(requests, &size);
+
+		// Wait for the next request
+		if (NULL == message)
+		{
+			if (!WaitShmRing(requests, true, 0, channel->serverEvent,
+					clientSocket))
+				break;
+
+			continue;
+		}
+
+		if (size > GetShmRingMaxMessage(replies))
+		{
+			LOG_WARN("Invalid message size %u.", size);
+			break;
+		}
+
+		LOG_TRACE("Received %u bytes: %s", size, LogData(message, size));
+
+		// Wait for the client to make room for the reply
+		while (!WriteShmRing(replies, message, size))
+		{
+			if (!WaitShmRing(replies, false, size, channel->serverEvent,
+					clientSocket))
+				return;
+		}
+
+		ConsumeShmRing(requests);
+	}
+
+	LOG_DEBUG("Client disconnected.");
+}
+
+void RunLocalShmEchoServer(const char* name, std::error_code& error)
+{
+	ShmChannel channel;
+	InitShmChannel(&channel);
+
+	int clientSocket = -1;
+
+	// Construct a new local UNIX socket.
+	int serverSocket = NewLocalSocket(error);
+	if (!error)
+	{
+		// Bind socket to a port number
+		BindLocalSocketToName(serverSocket, name, error);
+
+		// If bind is failed
+		if (error)
+			goto exit;
+
+		// Listen on socket with a backlog of 4 pending connections
+		ListenOnSocket(serverSocket, 4, error);
+		if (error)
+			goto exit;
+
+		// Serve the clients one after another
+		while (1)
+		{
+			// Accept a client connection on socket
+			clientSocket = AcceptOnLocalSocket(serverSocket, error);
+			if (error)
+				goto exit;
+
+			// Construct the shared memory
+			LOG_DEBUG("Constructing a new shared memory channel...");
+			if (!NewShmChannel(&channel, SHM_RING_CAPACITY))
+			{
+				// Fail with the error number
+				error.assign(errno, std::system_category());
+				goto exit;
+			}
+
+			// Hand it to the client
+			SendShmChannel(clientSocket, &channel, error);
+
+			// Client gone before the handshake must not stop the others
+			if (error)
+			{
+				LOG_WARN("Handshake failed: %s", error.message().c_str());
+				error.clear();
+			}
+			else
+			{
+				// Send back the requests
+				EchoShmChannel(&channel, clientSocket);
+			}
+
+			// Rings are not reused, the client may still map them
+			FreeShmChannel(&channel);
+
+			// Close the client socket
+			close(clientSocket);
+			clientSocket = -1;
+		}
+	}
+
+exit:
+	FreeShmChannel(&channel);
+
+	if (clientSocket > 0)
+	{
+		close(clientSocket);
+	}
+
+	if (serverSocket > 0)
+	{
+		close(serverSocket);
+	}
+}
+
+size_t ExchangeLocalEcho(
+		const char* name,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error)
+{
+	size_t received = 0;
+
+	// Construct a new local UNIX socket.
+	int clientSocket = NewLocalSocket(error);
+	if (!error)
+	{
+		// Connect to the server
+		ConnectLocalSocketToName(clientSocket, name, error);
+
+		// If connect is failed
+		if (error)
+			goto exit;
+
+		// Send the data and receive the echo
+		received = ExchangeOnSocket(clientSocket, data, size,
+				reply, replySize, error);
+	}
+
+exit:
+	if (clientSocket > 0)
+	{
+		close(clientSocket);
+	}
+
+	return received;
+}
+
+/**
+ * Persistent shared memory echo client channel. The socket only
+ * carries the handshake, then tells the rings that the server
+ * is gone.
+ */
+struct ShmEchoSession
+{
+	// Socket descriptor
+	int sd;
+
+	// Request and reply rings
+	ShmChannel channel;
+};
+
+ShmEchoSession* OpenShmEchoSession(const char* name, std::error_code& error)
+{
+	// Construct a new local UNIX socket.
+	int clientSocket = NewLocalSocket(error);
+	if (error)
+		return NULL;
+
+	ShmEchoSession* session = new ShmEchoSession();
+	session->sd = clientSocket;
+	InitShmChannel(&session->channel);
+
+	// Connect to the server
+	ConnectLocalSocketToName(clientSocket, name, error);
+
+	// Map the shared memory of the server
+	if (!error)
+	{
+		ReceiveShmChannel(clientSocket, &session->channel, error);
+	}
+
+	if (error)
+	{
+		CloseShmEchoSession(session);
+		return NULL;
+	}
+
+	return session;
+}
+
+void SendShmEchoSession(
+		ShmEchoSession* session,
+		const char* const* messages,
+		const size_t* sizes,
+		size_t count,
+		EchoReplyHandler handler,
+		void* context,
+		std::error_code& error)
+{
+	ShmRing* requests = &session->channel.requests;
+	ShmRing* replies = &session->channel.replies;
+	size_t sent = 0;
+	size_t received = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (sizes[i] > GetShmRingMaxMessage(requests))
+		{
+			error = ECHO_ERROR_MESSAGE_TOO_BIG;
+			return;
+		}
+	}
+
+	while (received < count)
+	{
+		bool progress = false;
+
+		// Queue as many requests as the ring has room for
+		while ((sent < count)
+				&& WriteShmRing(requests, messages[sent], (uint32_t) sizes[sent]))
+		{
+			sent++;
+			progress = true;
+		}
+
+		// Hand over the replies echoed so far, straight from the ring
+		uint32_t replySize;
+		const char* reply;
+		while ((received < sent)
+				&& (NULL != (reply = PeekShmRing(replies, &replySize))))
+		{
+			handler(context, received, reply, replySize);
+			ConsumeShmRing(replies);
+
+			received++;
+			progress = true;
+		}
+
+		if (progress)
+			continue;
+
+		// Wait for a reply, or for the server to consume the last
+		// requests if all of their replies are already handled
+		bool alive = (received < sent)
+				? WaitShmRing(replies, true, 0,
+						session->channel.clientEvent, session->sd)
+				: WaitShmRing(requests, false, (uint32_t) sizes[sent],
+						session->channel.clientEvent, session->sd);
+
+		if (!alive)
+		{
+			error = ECHO_ERROR_DISCONNECTED;
+			return;
+		}
+	}
+
+	LOG_DEBUG("Echoed %d messages.", count);
+}
+
+void CloseShmEchoSession(ShmEchoSession* session)
+{
+	if (NULL == session)
+		return;
+
+	FreeShmChannel(&session->channel);
+
+	close(session->sd);
+
+	delete session;
+}
+
+/**
+ * Logs the reply of the shared memory echo client.
+ *
+ * @param context unused.
+ * @param index index of the message.
+ * @param reply reply data.
+ * @param size reply size.
+ */
+static void LogShmReply(
+		void* context,
+		size_t index,
+		const char* reply,
+		size_t size)
+{
+	LOG_INFO("Received %u bytes: %s", size, LogData(reply, size));
+}
+
+void RunLocalShmEchoClient(
+		const char* name,
+		const char* message,
+		std::error_code& error)
+{
+	// Connect and map the shared memory of the server
+	ShmEchoSession* session = OpenShmEchoSession(name, error);
+	if (error)
+		return;
+
+	size_t messageSize = strlen(message);
+	LOG_INFO("Sending %u bytes: %s", messageSize, message);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// Send the request and wait for the reply
+	SendShmEchoSession(session, &message, &messageSize, 1,
+			LogShmReply, NULL, error);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!error)
+	{
+		LOG_INFO("Round trip took %lld ns.",
+				(long long) (end.tv_sec - start.tv_sec) * 1000000000LL
+				+ (end.tv_nsec - start.tv_nsec));
+	}
+
+	CloseShmEchoSession(session);
+}
+
+void SetEchoBufferSize(size_t bufferSize)
+{
+	if (bufferSize < MIN_BUFFER_SIZE)
+	{
+		bufferSize = MIN_BUFFER_SIZE;
+	}
+	else if (bufferSize > MAX_BUFFER_SIZE)
+	{
+		bufferSize = MAX_BUFFER_SIZE;
+	}
+
+	gBufferSize.store(bufferSize, std::memory_order_relaxed);
+}
+
+void SetEchoZeroCopy(bool enabled)
+{
+	gZeroCopy.store(enabled, std::memory_order_relaxed);
+}
@@ -0,0 +1,395 @@
+#ifndef ECHO_ENGINE_H
+#define ECHO_ENGINE_H
+
+// size_t
+#include <stddef.h>
+
+// std::error_code, std::error_category
+#include <system_error>
+
+/**
+ * Errors of the echo engine that have no error number. Socket
+ * and system call failures are reported in the system category
+ * with their error number instead.
+ */
+enum EchoError
+{
+	ECHO_ERROR_NAME_TOO_BIG = 1,
+	ECHO_ERROR_QUEUE_FULL,
+	ECHO_ERROR_NO_URING,
+	ECHO_ERROR_NO_SHARED_MEMORY,
+	ECHO_ERROR_INVALID_HANDSHAKE,
+	ECHO_ERROR_MESSAGE_TOO_BIG,
+	ECHO_ERROR_DISCONNECTED,
+	ECHO_ERROR_INVALID_FRAME
+};
+
+namespace std
+{
+	template <>
+	struct is_error_code_enum<EchoError> : true_type
+	{
+	};
+}
+
+/**
+ * Gets the category of the echo engine errors.
+ *
+ * @return error category.
+ */
+const std::error_category& GetEchoErrorCategory();
+
+/**
+ * Makes an error code of the given echo engine error, lets the
+ * errors be assigned to std::error_code directly.
+ *
+ * @param error echo engine error.
+ * @return error code.
+ */
+std::error_code make_error_code(EchoError error);
+
+/*
+ * The echo engine has no dependency on JNI. Servers and clients
+ * run on the calling thread until the peer disconnects or an
+ * error occurs, and log to the sink opened by the calling thread
+ * with OpenLogSink. Failures are reported through the error code.
+ */
+
+/**
+ * Connects to the given TCP echo server, sends the message and
+ * receives the reply.
+ *
+ * @param ip IP address.
+ * @param port port number.
+ * @param message NULL terminated message.
+ * @param error error code.
+ */
+void RunTcpEchoClient(
+		const char* ip,
+		unsigned short port,
+		const char* message,
+		std::error_code& error);
+
+/**
+ * Connects to the given TCP echo server, sends the data and
+ * receives its echo into the reply buffer, without copying.
+ *
+ * @param ip IP address.
+ * @param port port number.
+ * @param data data to send.
+ * @param size data size.
+ * @param reply reply buffer.
+ * @param replySize reply buffer size, echo beyond it is dropped.
+ * @param error error code.
+ * @return received reply size.
+ */
+size_t ExchangeTcpEcho(
+		const char* ip,
+		unsigned short port,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error);
+
+/**
+ * Persistent TCP echo client connection.
+ */
+struct TcpEchoSession;
+
+/**
+ * Handles the reply to a message sent through a session.
+ *
+ * @param context handler context.
+ * @param index index of the message.
+ * @param reply reply data, only valid during the call.
+ * @param size reply size.
+ */
+typedef void (*EchoReplyHandler)(
+		void* context,
+		size_t index,
+		const char* reply,
+		size_t size);
+
+/**
+ * Connects a persistent session to the given TCP echo server,
+ * with Nagle's algorithm disabled.
+ *
+ * @param ip IP address.
+ * @param port port number.
+ * @param error error code.
+ * @return client session or NULL if failed.
+ */
+TcpEchoSession* OpenTcpEchoSession(
+		const char* ip,
+		unsigned short port,
+		std::error_code& error);
+
+/**
+ * Sends the given messages through the session and waits for
+ * their replies. Messages are pipelined as text frames of the echo
+ * stream protocol, many of them written with a single call, and
+ * the replies are handed over in order as they arrive.
+ *
+ * @param session client session.
+ * @param messages messages to send.
+ * @param sizes message sizes.
+ * @param count number of messages.
+ * @param handler reply handler.
+ * @param context handler context.
+ * @param error error code.
+ */
+void SendTcpEchoSession(
+		TcpEchoSession* session,
+		const char* const* messages,
+		const size_t* sizes,
+		size_t count,
+		EchoReplyHandler handler,
+		void* context,
+		std::error_code& error);
+
+/**
+ * Closes the session connection and releases the session.
+ *
+ * @param session client session, may be NULL.
+ */
+void CloseTcpEchoSession(TcpEchoSession* session);
+
+/**
+ * Serves a single TCP client.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunTcpEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Serves the TCP clients from a single epoll reactor.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunTcpReactorEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Serves the TCP clients of the echo stream protocol from a single
+ * epoll reactor, each frame is sent back with its own type. Frames
+ * bigger than the data buffer close the connection.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunTcpFramedEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Serves the TCP clients from a reactor thread per CPU, each on
+ * its own listening socket sharing the port. Fails if another
+ * socket is already bound to the port, and if any reactor fails
+ * to start the started ones are stopped.
+ *
+ * @param port port number, 0 for a random one.
+ * @param threads number of reactors, less than 1 for one per CPU,
+ *        at most 64.
+ * @param error error code.
+ */
+void RunTcpMultiReactorEchoServer(
+		unsigned short port,
+		int threads,
+		std::error_code& error);
+
+/**
+ * Serves the TCP clients with the io_uring engine.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunTcpUringEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Sends the message to the given UDP echo server and receives
+ * the reply.
+ *
+ * @param ip IP address.
+ * @param port port number.
+ * @param message NULL terminated message.
+ * @param error error code.
+ */
+void RunUdpEchoClient(
+		const char* ip,
+		unsigned short port,
+		const char* message,
+		std::error_code& error);
+
+/**
+ * Sends the data as a datagram to the given UDP echo server and
+ * receives the reply into the reply buffer.
+ *
+ * @param ip IP address.
+ * @param port port number.
+ * @param data data to send.
+ * @param size data size.
+ * @param reply reply buffer.
+ * @param replySize reply buffer size, the reply is truncated to it.
+ * @param error error code.
+ * @return received reply size.
+ */
+size_t ExchangeUdpEcho(
+		const char* ip,
+		unsigned short port,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error);
+
+/**
+ * Echoes a single UDP datagram.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunUdpEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Echoes the UDP datagrams in batches of system calls.
+ *
+ * @param port port number, 0 for a random one.
+ * @param batchSize datagrams per call, less than 1 for the default.
+ * @param error error code.
+ */
+void RunUdpBatchEchoServer(
+		unsigned short port,
+		int batchSize,
+		std::error_code& error);
+
+/**
+ * Echoes the UDP datagrams with the io_uring engine.
+ *
+ * @param port port number, 0 for a random one.
+ * @param error error code.
+ */
+void RunUdpUringEchoServer(unsigned short port, std::error_code& error);
+
+/**
+ * Serves a single local UNIX socket client.
+ *
+ * @param name socket name, in the abstract namespace unless
+ * starting with a slash.
+ * @param error error code.
+ */
+void RunLocalEchoServer(const char* name, std::error_code& error);
+
+/**
+ * Connects to the given local echo server, sends the data and
+ * receives its echo into the reply buffer.
+ *
+ * @param name socket name, in the abstract namespace unless
+ * starting with a slash.
+ * @param data data to send.
+ * @param size data size.
+ * @param reply reply buffer.
+ * @param replySize reply buffer size, echo beyond it is dropped.
+ * @param error error code.
+ * @return received reply size.
+ */
+size_t ExchangeLocalEcho(
+		const char* name,
+		const char* data,
+		size_t size,
+		char* reply,
+		size_t replySize,
+		std::error_code& error);
+
+/**
+ * Serves the local UNIX socket clients with the io_uring engine.
+ *
+ * @param name socket name.
+ * @param error error code.
+ */
+void RunLocalUringEchoServer(const char* name, std::error_code& error);
+
+/**
+ * Serves the clients through shared memory rings, handed over
+ * the local UNIX socket. Each client gets its own rings and is
+ * served until it disconnects, then the next one is accepted.
+ *
+ * @param name socket name.
+ * @param error error code.
+ */
+void RunLocalShmEchoServer(const char* name, std::error_code& error);
+
+/**
+ * Persistent shared memory echo client channel.
+ */
+struct ShmEchoSession;
+
+/**
+ * Connects a persistent session to the given shared memory echo
+ * server and maps the rings it hands over.
+ *
+ * @param name socket name.
+ * @param error error code.
+ * @return client session or NULL if failed.
+ */
+ShmEchoSession* OpenShmEchoSession(const char* name, std::error_code& error);
+
+/**
+ * Sends the given messages through the session and waits for
+ * their replies. Messages are written into the request ring as
+ * long as it has room, and the replies are handed over in order
+ * straight from the reply ring as they arrive.
+ *
+ * @param session client session.
+ * @param messages messages to send.
+ * @param sizes message sizes.
+ * @param count number of messages.
+ * @param handler reply handler.
+ * @param context handler context.
+ * @param error error code.
+ */
+void SendShmEchoSession(
+		ShmEchoSession* session,
+		const char* const* messages,
+		const size_t* sizes,
+		size_t count,
+		EchoReplyHandler handler,
+		void* context,
+		std::error_code& error);
+
+/**
+ * Unmaps the rings, disconnects from the server and releases
+ * the session.
+ *
+ * @param session client session, may be NULL.
+ */
+void CloseShmEchoSession(ShmEchoSession* session);
+
+/**
+ * Sends the message to the given shared memory echo server and
+ * receives the reply.
+ *
+ * @param name socket name.
+ * @param message NULL terminated message.
+ * @param error error code.
+ */
+void RunLocalShmEchoClient(
+		const char* name,
+		const char* message,
+		std::error_code& error);
+
+/**
+ * Sets the data buffer size of the servers started next.
+ *
+ * @param bufferSize buffer size, clamped to the supported range.
+ */
+void SetEchoBufferSize(size_t bufferSize);
+
+/**
+ * Echoes through a pipe without copying to user space, for the
+ * stream servers started next that support it.
+ *
+ * @param enabled zero copy is enabled.
+ */
+void SetEchoZeroCopy(bool enabled);
+
+#endif
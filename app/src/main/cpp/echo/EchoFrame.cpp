@@ -0,0 +1,90 @@
+#include "EchoFrame.h"
+#include "EchoEngine.h"
+
+// Varint bits carried by each byte
+#define VARINT_VALUE_BITS 7
+#define VARINT_VALUE_MASK 0x7f
+#define VARINT_MORE_FLAG 0x80
+
+size_t ParseEchoFrame(
+		const char* data,
+		size_t length,
+		EchoFrame* frame,
+		std::error_code& error)
+{
+	const unsigned char* bytes = (const unsigned char*) data;
+	size_t size = 0;
+	size_t position = 0;
+
+	// Payload size, least significant group first
+	while (1)
+	{
+		if (position == length)
+			return 0;
+
+		if (position == ECHO_FRAME_MAX_HEADER_SIZE - 1)
+		{
+			error = ECHO_ERROR_INVALID_FRAME;
+			return 0;
+		}
+
+		unsigned char byte = bytes[position];
+		size |= (size_t) (byte & VARINT_VALUE_MASK)
+				<< (position * VARINT_VALUE_BITS);
+		position++;
+
+		if (0 == (byte & VARINT_MORE_FLAG))
+			break;
+	}
+
+	if (size > MAX_ECHO_FRAME_SIZE)
+	{
+		error = ECHO_ERROR_MESSAGE_TOO_BIG;
+		return 0;
+	}
+
+	// Frame type
+	if (position == length)
+		return 0;
+
+	frame->type = bytes[position++];
+	frame->payload = data + position;
+	frame->size = size;
+
+	return position + size;
+}
+
+size_t EncodeEchoFrameHeader(
+		unsigned char type,
+		size_t size,
+		char* header)
+{
+	unsigned char* bytes = (unsigned char*) header;
+	size_t position = 0;
+
+	while (size > VARINT_VALUE_MASK)
+	{
+		bytes[position++] = (unsigned char) (size & VARINT_VALUE_MASK)
+				| VARINT_MORE_FLAG;
+		size >>= VARINT_VALUE_BITS;
+	}
+
+	bytes[position++] = (unsigned char) size;
+	bytes[position++] = type;
+
+	return position;
+}
+
+size_t GetEchoFrameLength(size_t size)
+{
+	// Type byte and the last varint byte
+	size_t length = size + 2;
+
+	while (size > VARINT_VALUE_MASK)
+	{
+		size >>= VARINT_VALUE_BITS;
+		length++;
+	}
+
+	return length;
+}
@@ -0,0 +1,82 @@
+#ifndef ECHO_FRAME_H
+#define ECHO_FRAME_H
+
+// size_t
+#include <stddef.h>
+
+// std::error_code
+#include <system_error>
+
+// Max header length, a 5 byte varint payload size and the type
+#define ECHO_FRAME_MAX_HEADER_SIZE 6
+
+// Max payload size of a frame
+#define MAX_ECHO_FRAME_SIZE (16 * 1024 * 1024)
+
+/**
+ * Frame types, the echo servers send each frame back with its
+ * own type.
+ */
+enum EchoFrameType
+{
+	ECHO_FRAME_TEXT = 1,
+	ECHO_FRAME_BINARY = 2
+};
+
+/**
+ * Frame of the echo stream protocol. On the wire a frame is the
+ * payload size as an unsigned LEB128 varint, the type byte and
+ * the payload. The payload is borrowed from the receive buffer.
+ */
+struct EchoFrame
+{
+	// Frame type
+	unsigned char type;
+
+	// Payload, points into the parsed data
+	const char* payload;
+
+	// Payload size
+	size_t size;
+};
+
+/**
+ * Parses the frame at the start of the given data without
+ * copying the payload. Frames split anywhere are completed by
+ * parsing again once more data is received.
+ *
+ * @param data received data.
+ * @param length data length.
+ * @param frame parsed frame, set once the header is complete.
+ * @param error error code.
+ * @return frame length with the header, larger than the data
+ * length if the payload is incomplete, 0 if the header is.
+ */
+size_t ParseEchoFrame(
+		const char* data,
+		size_t length,
+		EchoFrame* frame,
+		std::error_code& error);
+
+/**
+ * Encodes the header of a frame, sent gathered with its payload.
+ *
+ * @param type frame type.
+ * @param size payload size.
+ * @param header header buffer of ECHO_FRAME_MAX_HEADER_SIZE bytes.
+ * @return header length.
+ */
+size_t EncodeEchoFrameHeader(
+		unsigned char type,
+		size_t size,
+		char* header);
+
+/**
+ * Gets the encoded length of a frame.
+ *
+ * @param size payload size.
+ * @return frame length with the header.
+ */
+size_t GetEchoFrameLength(size_t size);
+
+#endif
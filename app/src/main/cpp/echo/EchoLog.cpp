@@ -0,0 +1,703 @@
+#include "EchoLog.h"
+
+// snprintf
+#include <stdio.h>
+
+// strchr
+#include <string.h>
+
+// pthread_create, pthread_once, pthread_setname_np, pthread_cond_wait
+#include <pthread.h>
+
+// Number of records in the ring buffer, must be a power of two
+#define LOG_RING_SIZE 1024
+
+// Max length of a batch of messages delivered at once
+#define LOG_BATCH_SIZE 8192
+
+// Max length of a single formatted message
+#define MAX_LOG_MESSAGE_LENGTH 256
+
+/**
+ * Log sink of a native call and its delivery state.
+ */
+struct LogTarget
+{
+	// Sink receiving the messages
+	EchoLogSink* sink;
+
+	// Messages of the target dropped since the ring buffer was full,
+	// reported to its sink with its next message
+	std::atomic<size_t> dropped;
+
+	// Set by the drainer once all messages are delivered
+	bool closed;
+
+	// Guards closed, signaled once it is set
+	pthread_mutex_t mutex;
+	pthread_cond_t closedCondition;
+};
+
+// Runtime log level, everything compiled in is enabled
+LogLevel gLogLevel = { { ECHO_LOG_MIN_LEVEL } };
+
+// Log ring buffer
+static LogRecord gRing[LOG_RING_SIZE];
+
+// Next slot to be reserved by the producers
+static std::atomic<size_t> gEnqueuePosition(0);
+
+// Next slot to be drained, only used by the drainer
+static size_t gDequeuePosition = 0;
+
+// Is the drainer thread running
+static bool gDrainerRunning = false;
+
+// Is the drainer waiting for a record to be published
+static std::atomic<bool> gDrainerParked(false);
+
+// Producers waiting for a free slot
+static std::atomic<int> gSlotWaiters(0);
+
+// Guards the parking of the drainer and of the waiting producers
+static pthread_mutex_t gDrainerMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Signaled when a record is published to the parked drainer
+static pthread_cond_t gPublishedCondition = PTHREAD_COND_INITIALIZER;
+
+// Signaled when the drainer frees slots for the waiting producers
+static pthread_cond_t gFreedCondition = PTHREAD_COND_INITIALIZER;
+
+// Drainer start guard
+static pthread_once_t gDrainerOnce = PTHREAD_ONCE_INIT;
+
+// Log target of the calling thread
+static thread_local LogTarget* gThreadTarget = NULL;
+
+/**
+ * Waits until the drainer frees the given slot.
+ *
+ * @param record log record.
+ * @param position position to reserve the slot at.
+ */
+static void WaitForFreeSlot(LogRecord* record, size_t position)
+{
+	pthread_mutex_lock(&gDrainerMutex);
+
+	// Announce the wait before checking the slot, so the drainer
+	// either sees the waiter or the producer sees the free slot
+	gSlotWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+	while ((ptrdiff_t) (record->sequence.load(std::memory_order_seq_cst)
+			- position) < 0)
+	{
+		pthread_cond_wait(&gFreedCondition, &gDrainerMutex);
+	}
+
+	gSlotWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+	pthread_mutex_unlock(&gDrainerMutex);
+}
+
+/**
+ * Reserves a record in the ring buffer.
+ *
+ * @param target log target.
+ * @param format message format.
+ * @param wait wait for a free slot instead of dropping.
+ * @return log record or NULL.
+ */
+static LogRecord* ReserveLogRecord(
+		LogTarget* target,
+		const char* format,
+		bool wait)
+{
+	size_t position = gEnqueuePosition.load(std::memory_order_relaxed);
+
+	while (1)
+	{
+		LogRecord* record = &gRing[position & (LOG_RING_SIZE - 1)];
+		size_t sequence = record->sequence.load(std::memory_order_acquire);
+		ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) position;
+
+		// Slot is free, try to claim it
+		if (0 == difference)
+		{
+			if (gEnqueuePosition.compare_exchange_weak(position, position + 1,
+					std::memory_order_relaxed))
+			{
+				record->target = target;
+				record->format = format;
+				record->argumentCount = 0;
+				record->textLength = 0;
+
+				return record;
+			}
+		}
+		// Slot is not drained yet, ring buffer is full
+		else if (difference < 0)
+		{
+			if (!wait)
+			{
+				target->dropped.fetch_add(1, std::memory_order_relaxed);
+				return NULL;
+			}
+
+			WaitForFreeSlot(record, position);
+			position = gEnqueuePosition.load(std::memory_order_relaxed);
+		}
+		// Another producer claimed the slot
+		else
+		{
+			position = gEnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void SetLogLevel(int level)
+{
+	if (level < LOG_LEVEL_TRACE)
+	{
+		level = LOG_LEVEL_TRACE;
+	}
+	else if (level > LOG_LEVEL_ERROR)
+	{
+		level = LOG_LEVEL_ERROR;
+	}
+
+	gLogLevel.value.store((unsigned char) level, std::memory_order_relaxed);
+}
+
+LogRecord* BeginLogRecord(const char* format)
+{
+	LogTarget* target = gThreadTarget;
+
+	// Calling thread has no log target
+	if (NULL == target)
+	{
+		return NULL;
+	}
+
+	return ReserveLogRecord(target, format, false);
+}
+
+void CommitLogRecord(LogRecord* record)
+{
+	// Sequence of a published record is one ahead of its position
+	size_t sequence = record->sequence.load(std::memory_order_relaxed);
+	record->sequence.store(sequence + 1, std::memory_order_release);
+
+	// Order the publish before the check, pairs with the drainer
+	// parking itself before checking the ring buffer
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// Wake the drainer only if it is parked
+	if (gDrainerParked.load(std::memory_order_relaxed))
+	{
+		pthread_mutex_lock(&gDrainerMutex);
+		gDrainerParked.store(false, std::memory_order_relaxed);
+		pthread_cond_signal(&gPublishedCondition);
+		pthread_mutex_unlock(&gDrainerMutex);
+	}
+}
+
+/**
+ * Copies the given text into the buffer, escaping the bytes other
+ * than printable ASCII, so binary data such as the echoed payloads
+ * stays readable and valid for the sinks expecting UTF-8 text.
+ *
+ * @param text text bytes.
+ * @param textLength text length.
+ * @param buffer escaped text buffer.
+ * @param bufferSize buffer size.
+ */
+static void EscapeLogText(
+		const char* text,
+		size_t textLength,
+		char* buffer,
+		size_t bufferSize)
+{
+	size_t length = 0;
+
+	for (size_t i = 0; i < textLength; i++)
+	{
+		unsigned char c = (unsigned char) text[i];
+
+		if ((c >= 0x20) && (c < 0x7f) && ('\\' != c))
+		{
+			if (length + 1 >= bufferSize)
+				break;
+
+			buffer[length++] = (char) c;
+		}
+		else if ('\\' == c)
+		{
+			if (length + 2 >= bufferSize)
+				break;
+
+			buffer[length++] = '\\';
+			buffer[length++] = '\\';
+		}
+		else
+		{
+			// Escaped byte must fit whole
+			if (length + 4 >= bufferSize)
+				break;
+
+			snprintf(buffer + length, bufferSize - length, "\\x%02x", c);
+			length += 4;
+		}
+	}
+
+	buffer[length] = '\0';
+}
+
+/**
+ * Formats the given record into the buffer. Length modifiers of
+ * the format are ignored since the arguments are stored widened.
+ *
+ * @param record log record.
+ * @param buffer message buffer.
+ * @param bufferSize buffer size.
+ * @return message length.
+ */
+static size_t FormatLogRecord(
+		const LogRecord* record,
+		char* buffer,
+		size_t bufferSize)
+{
+	size_t length = 0;
+	unsigned char argument = 0;
+	const char* format = record->format;
+
+	while (('\0' != *format) && (length < bufferSize - 1))
+	{
+		// Copy the plain characters
+		if ('%' != *format)
+		{
+			buffer[length++] = *format++;
+			continue;
+		}
+
+		if ('%' == format[1])
+		{
+			buffer[length++] = '%';
+			format += 2;
+			continue;
+		}
+
+		// Copy the flags, width and precision
+		char spec[32];
+		size_t specLength = 0;
+		spec[specLength++] = *format++;
+
+		while (('\0' != *format) && (NULL != strchr("-+ #0123456789.", *format))
+				&& (specLength < sizeof(spec) - 4))
+		{
+			spec[specLength++] = *format++;
+		}
+
+		// Skip the length modifiers
+		while (('\0' != *format) && (NULL != strchr("hljztL", *format)))
+		{
+			format++;
+		}
+
+		char conversion = *format;
+		if ('\0' == conversion)
+			break;
+
+		format++;
+
+		// Missing arguments are left blank
+		if (argument >= record->argumentCount)
+			continue;
+
+		unsigned char type = record->types[argument];
+		const LogArgument& value = record->values[argument];
+		argument++;
+
+		char* output = buffer + length;
+		size_t outputSize = bufferSize - length;
+		int written = 0;
+
+		if (LOG_ARGUMENT_STRING == type)
+		{
+			char text[MAX_LOG_MESSAGE_LENGTH];
+			EscapeLogText(record->text + value.text.offset, value.text.length,
+					text, sizeof(text));
+
+			spec[specLength++] = 's';
+			spec[specLength] = '\0';
+			written = snprintf(output, outputSize, spec, text);
+		}
+		else if (NULL != strchr("diuxXoc", conversion))
+		{
+			if ('c' == conversion)
+			{
+				spec[specLength++] = 'c';
+				spec[specLength] = '\0';
+				written = snprintf(output, outputSize, spec,
+						(int) value.signedValue);
+			}
+			else
+			{
+				spec[specLength++] = 'l';
+				spec[specLength++] = 'l';
+				spec[specLength++] = conversion;
+				spec[specLength] = '\0';
+
+				if (LOG_ARGUMENT_DOUBLE == type)
+				{
+					written = snprintf(output, outputSize, spec,
+							(long long) value.doubleValue);
+				}
+				else
+				{
+					written = snprintf(output, outputSize, spec,
+							value.signedValue);
+				}
+			}
+		}
+		else if (NULL != strchr("fFeEgGaA", conversion))
+		{
+			spec[specLength++] = conversion;
+			spec[specLength] = '\0';
+
+			double doubleValue = value.doubleValue;
+			if (LOG_ARGUMENT_SIGNED == type)
+			{
+				doubleValue = (double) value.signedValue;
+			}
+			else if (LOG_ARGUMENT_UNSIGNED == type)
+			{
+				doubleValue = (double) value.unsignedValue;
+			}
+
+			written = snprintf(output, outputSize, spec, doubleValue);
+		}
+		else if ('p' == conversion)
+		{
+			spec[specLength++] = 'p';
+			spec[specLength] = '\0';
+			written = snprintf(output, outputSize, spec, value.pointerValue);
+		}
+
+		if (written > 0)
+		{
+			length += ((size_t) written < outputSize)
+					? (size_t) written
+					: outputSize - 1;
+		}
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+/**
+ * Delivers the batched messages to the given target.
+ *
+ * @param target log target.
+ * @param batch batched messages.
+ * @param batchLength batch length.
+ */
+static void FlushLogBatch(
+		LogTarget* target,
+		char* batch,
+		size_t* batchLength)
+{
+	if ((NULL == target) || (0 == *batchLength))
+		return;
+
+	batch[*batchLength] = '\0';
+
+	// Log messages at once, separated by new lines
+	target->sink->WriteLog(batch, *batchLength);
+
+	*batchLength = 0;
+}
+
+/**
+ * Appends the given message to the batch, flushing the batch
+ * first if the target changes or the message does not fit.
+ *
+ * @param target log target.
+ * @param batchTarget target of the batched messages.
+ * @param batch batched messages.
+ * @param batchLength batch length.
+ * @param message message text.
+ * @param messageLength message length.
+ */
+static void AppendLogBatch(
+		LogTarget* target,
+		LogTarget** batchTarget,
+		char* batch,
+		size_t* batchLength,
+		const char* message,
+		size_t messageLength)
+{
+	if ((target != *batchTarget)
+			|| (*batchLength + messageLength + 2 > LOG_BATCH_SIZE))
+	{
+		FlushLogBatch(*batchTarget, batch, batchLength);
+		*batchTarget = target;
+	}
+
+	if (0 != *batchLength)
+	{
+		batch[(*batchLength)++] = '\n';
+	}
+
+	memcpy(batch + *batchLength, message, messageLength);
+	*batchLength += messageLength;
+}
+
+/**
+ * Marks the given target as closed and wakes its closing thread.
+ * The target may be released as soon as this returns.
+ *
+ * @param target log target.
+ */
+static void SignalLogTargetClosed(LogTarget* target)
+{
+	pthread_mutex_lock(&target->mutex);
+	target->closed = true;
+	pthread_cond_signal(&target->closedCondition);
+	pthread_mutex_unlock(&target->mutex);
+}
+
+/**
+ * Drains the published records and delivers them in batches.
+ *
+ * @return number of drained records.
+ */
+static size_t DrainLogRecords()
+{
+	static char batch[LOG_BATCH_SIZE];
+	size_t batchLength = 0;
+	LogTarget* batchTarget = NULL;
+	size_t drained = 0;
+
+	while (drained < LOG_RING_SIZE)
+	{
+		LogRecord* record = &gRing[gDequeuePosition & (LOG_RING_SIZE - 1)];
+		size_t sequence = record->sequence.load(std::memory_order_acquire);
+
+		// Next record is not published yet
+		if (sequence != gDequeuePosition + 1)
+			break;
+
+		LogTarget* target = record->target;
+		char message[MAX_LOG_MESSAGE_LENGTH];
+
+		// Report the dropped messages of the target before its next
+		// one, the release record included
+		size_t dropped = target->dropped.load(std::memory_order_relaxed);
+		if (0 != dropped)
+		{
+			dropped = target->dropped.exchange(0, std::memory_order_relaxed);
+
+			size_t messageLength = (size_t) snprintf(message, sizeof(message),
+					"%zu log messages dropped.", dropped);
+
+			AppendLogBatch(target, &batchTarget, batch, &batchLength,
+					message, messageLength);
+		}
+
+		// Release records mark the end of a target
+		if (NULL == record->format)
+		{
+			FlushLogBatch(batchTarget, batch, &batchLength);
+			batchTarget = NULL;
+
+			SignalLogTargetClosed(target);
+		}
+		else
+		{
+			size_t messageLength = FormatLogRecord(record,
+					message, sizeof(message));
+
+			AppendLogBatch(target, &batchTarget, batch, &batchLength,
+					message, messageLength);
+		}
+
+		// Hand the slot back to the producers
+		record->sequence.store(gDequeuePosition + LOG_RING_SIZE,
+				std::memory_order_release);
+		gDequeuePosition++;
+		drained++;
+	}
+
+	FlushLogBatch(batchTarget, batch, &batchLength);
+
+	// Order the freed slots before the check, pairs with the
+	// producers announcing their wait before checking the slot
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// Wake the producers waiting for a free slot
+	if ((0 != drained) && (0 != gSlotWaiters.load(std::memory_order_relaxed)))
+	{
+		pthread_mutex_lock(&gDrainerMutex);
+		pthread_cond_broadcast(&gFreedCondition);
+		pthread_mutex_unlock(&gDrainerMutex);
+	}
+
+	return drained;
+}
+
+/**
+ * Checks if the next record to drain is published.
+ *
+ * @return true if published.
+ */
+static bool IsLogRecordPublished()
+{
+	LogRecord* record = &gRing[gDequeuePosition & (LOG_RING_SIZE - 1)];
+
+	return (gDequeuePosition + 1)
+			== record->sequence.load(std::memory_order_seq_cst);
+}
+
+/**
+ * Parks the drainer until a record is published.
+ */
+static void ParkLogDrainer()
+{
+	pthread_mutex_lock(&gDrainerMutex);
+
+	// Park before checking the ring buffer, so a producer either
+	// sees the drainer parked or the drainer sees its record
+	gDrainerParked.store(true, std::memory_order_seq_cst);
+
+	if (IsLogRecordPublished())
+	{
+		gDrainerParked.store(false, std::memory_order_relaxed);
+	}
+
+	// Woken producer clears the flag
+	while (gDrainerParked.load(std::memory_order_relaxed))
+	{
+		pthread_cond_wait(&gPublishedCondition, &gDrainerMutex);
+	}
+
+	pthread_mutex_unlock(&gDrainerMutex);
+}
+
+/**
+ * Drains the log records for the lifetime of the process.
+ *
+ * @param args unused.
+ * @return NULL.
+ */
+static void* LogDrainerThread(void* args)
+{
+	while (1)
+	{
+		// Park only if there was nothing to drain
+		if (0 == DrainLogRecords())
+		{
+			ParkLogDrainer();
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Initializes the ring buffer and starts the drainer thread.
+ */
+static void StartLogDrainer()
+{
+	// Slot sequence starts at its own position
+	for (size_t i = 0; i < LOG_RING_SIZE; i++)
+	{
+		gRing[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	pthread_t thread;
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+	gDrainerRunning = (0 == pthread_create(&thread, &attributes,
+			LogDrainerThread, NULL));
+
+	pthread_attr_destroy(&attributes);
+
+	// Name the drainer for the profilers
+	if (gDrainerRunning)
+	{
+		pthread_setname_np(thread, "EchoLog");
+	}
+}
+
+FileLogSink::FileLogSink(FILE* file)
+	: file(file)
+{
+}
+
+void FileLogSink::WriteLog(const char* messages, size_t length)
+{
+	fwrite(messages, 1, length, file);
+	fputc('\n', file);
+	fflush(file);
+}
+
+bool OpenLogSink(EchoLogSink* sink)
+{
+	// Release the sink the calling thread still has open
+	CloseLogSink();
+
+	if (NULL == sink)
+		return false;
+
+	pthread_once(&gDrainerOnce, StartLogDrainer);
+	if (!gDrainerRunning)
+		return false;
+
+	LogTarget* target = new LogTarget();
+	target->sink = sink;
+	target->dropped.store(0, std::memory_order_relaxed);
+	target->closed = false;
+	pthread_mutex_init(&target->mutex, NULL);
+	pthread_cond_init(&target->closedCondition, NULL);
+
+	gThreadTarget = target;
+
+	return true;
+}
+
+void CloseLogSink()
+{
+	LogTarget* target = gThreadTarget;
+	if (NULL == target)
+		return;
+
+	gThreadTarget = NULL;
+
+	// Release record must not be dropped
+	LogRecord* record = ReserveLogRecord(target, NULL, true);
+	CommitLogRecord(record);
+
+	// Wait for the preceding messages to be delivered
+	pthread_mutex_lock(&target->mutex);
+
+	while (!target->closed)
+	{
+		pthread_cond_wait(&target->closedCondition, &target->mutex);
+	}
+
+	pthread_mutex_unlock(&target->mutex);
+
+	pthread_cond_destroy(&target->closedCondition);
+	pthread_mutex_destroy(&target->mutex);
+	delete target;
+}
+
+EchoLogSink* GetLogSink()
+{
+	LogTarget* target = gThreadTarget;
+
+	return (NULL != target) ? target->sink : NULL;
+}
@@ -0,0 +1,409 @@
+#ifndef ECHO_LOG_H
+#define ECHO_LOG_H
+
+// size_t
+#include <stddef.h>
+
+// FILE
+#include <stdio.h>
+
+// memcpy
+#include <string.h>
+
+// std::atomic
+#include <atomic>
+
+// Log levels
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+
+// Levels below the floor are compiled out, release builds
+// drop the trace and debug messages by default
+#ifndef ECHO_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define ECHO_LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define ECHO_LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+#endif
+
+// Max arguments captured by a log record
+#define MAX_LOG_ARGUMENTS 8
+
+// Max bytes of string arguments captured by a log record
+#define MAX_LOG_RECORD_TEXT 192
+
+// Cache line size, the runtime level is kept apart from the
+// variables the loggers write
+#define LOG_CACHE_LINE 64
+
+/**
+ * Log record argument types.
+ */
+enum LogArgumentType
+{
+	LOG_ARGUMENT_SIGNED,
+	LOG_ARGUMENT_UNSIGNED,
+	LOG_ARGUMENT_DOUBLE,
+	LOG_ARGUMENT_POINTER,
+	LOG_ARGUMENT_STRING
+};
+
+/**
+ * Log record argument value. String arguments are stored as
+ * an offset into the record text and their length.
+ */
+union LogArgument
+{
+	long long signedValue;
+	unsigned long long unsignedValue;
+	double doubleValue;
+	const void* pointerValue;
+
+	struct
+	{
+		unsigned short offset;
+		unsigned short length;
+	} text;
+};
+
+/**
+ * Destination of the log messages of a native call, such as the
+ * Java activity or a file on a build host.
+ */
+class EchoLogSink
+{
+public:
+	virtual ~EchoLogSink() {}
+
+	/**
+	 * Writes a batch of messages. Only called by the drainer
+	 * thread, never by the thread logging the messages.
+	 *
+	 * @param messages NULL terminated messages, separated by new lines.
+	 * @param length messages length.
+	 */
+	virtual void WriteLog(const char* messages, size_t length) = 0;
+};
+
+/**
+ * Log sink writing the messages to a standard I/O stream.
+ */
+class FileLogSink : public EchoLogSink
+{
+public:
+	/**
+	 * Constructs a sink writing to the given stream.
+	 *
+	 * @param file output stream, not closed by the sink.
+	 */
+	explicit FileLogSink(FILE* file);
+
+	virtual void WriteLog(const char* messages, size_t length);
+
+private:
+	// Output stream
+	FILE* file;
+};
+
+/**
+ * Log sink of a native call and its delivery state.
+ */
+struct LogTarget;
+
+/**
+ * Binary log record. Only the format pointer and the raw
+ * arguments are captured, formatting is done by the drainer.
+ */
+struct LogRecord
+{
+	// Ring buffer slot sequence
+	std::atomic<size_t> sequence;
+
+	// Receiving sink, NULL if the record is dropped
+	LogTarget* target;
+
+	// Format string, also identifies the message
+	const char* format;
+
+	// Number of arguments
+	unsigned char argumentCount;
+
+	// Argument types
+	unsigned char types[MAX_LOG_ARGUMENTS];
+
+	// Argument values
+	LogArgument values[MAX_LOG_ARGUMENTS];
+
+	// Used bytes of the text
+	unsigned short textLength;
+
+	// Copied string arguments
+	char text[MAX_LOG_RECORD_TEXT];
+};
+
+/**
+ * Reserves a record in the log ring buffer for the log target
+ * of the calling thread. Never blocks, if the ring buffer is full
+ * the message is counted as dropped, and the count is reported to
+ * the sink of the target with its next message.
+ *
+ * @param format message format.
+ * @return log record or NULL.
+ */
+LogRecord* BeginLogRecord(const char* format);
+
+/**
+ * Publishes the given record to the drainer thread.
+ *
+ * @param record log record.
+ */
+void CommitLogRecord(LogRecord* record);
+
+/**
+ * Makes the given sink the log sink of the calling thread.
+ * A sink the thread still has open is closed first. Starts the
+ * drainer thread on first use.
+ *
+ * @param sink log sink, kept until the sink is closed.
+ * @return true if the messages are delivered to the sink.
+ */
+bool OpenLogSink(EchoLogSink* sink);
+
+/**
+ * Waits until the messages of the calling thread are delivered
+ * and releases its log sink.
+ */
+void CloseLogSink();
+
+/**
+ * Gets the log sink of the calling thread, so threads started
+ * by a native call can log to the same sink.
+ *
+ * @return log sink or NULL.
+ */
+EchoLogSink* GetLogSink();
+
+/**
+ * Sets the runtime log level. Levels below the compile time
+ * floor stay disabled.
+ *
+ * @param level log level.
+ */
+void SetLogLevel(int level);
+
+/**
+ * Runtime log level, alone in its cache line so that it stays
+ * shared in the cache of every logging thread.
+ */
+struct alignas(LOG_CACHE_LINE) LogLevel
+{
+	std::atomic<unsigned char> value;
+};
+
+extern LogLevel gLogLevel;
+
+// Is the given level enabled, constant false below the floor.
+// Above it, the runtime check is still a branch on a relaxed byte
+// load: it compiles to a plain load with no fence, that hits the
+// cache since the level is only written by SetLogLevel. Anything
+// cheaper would patch the code of the log sites, which the
+// toolchains of all ABIs do not support.
+#define LOG_ENABLED(level) \
+	(((level) >= ECHO_LOG_MIN_LEVEL) \
+	&& ((level) >= gLogLevel.value.load(std::memory_order_relaxed)))
+
+static inline void AddLogArgument(LogRecord* record, unsigned char type,
+		LogArgument value)
+{
+	if (record->argumentCount < MAX_LOG_ARGUMENTS)
+	{
+		record->types[record->argumentCount] = type;
+		record->values[record->argumentCount] = value;
+		record->argumentCount++;
+	}
+}
+
+static inline void AddLogArgument(LogRecord* record, long long value)
+{
+	LogArgument argument;
+	argument.signedValue = value;
+	AddLogArgument(record, LOG_ARGUMENT_SIGNED, argument);
+}
+
+static inline void AddLogArgument(LogRecord* record, unsigned long long value)
+{
+	LogArgument argument;
+	argument.unsignedValue = value;
+	AddLogArgument(record, LOG_ARGUMENT_UNSIGNED, argument);
+}
+
+static inline void AddLogArgument(LogRecord* record, int value)
+{
+	AddLogArgument(record, (long long) value);
+}
+
+static inline void AddLogArgument(LogRecord* record, long value)
+{
+	AddLogArgument(record, (long long) value);
+}
+
+static inline void AddLogArgument(LogRecord* record, unsigned int value)
+{
+	AddLogArgument(record, (unsigned long long) value);
+}
+
+static inline void AddLogArgument(LogRecord* record, unsigned short value)
+{
+	AddLogArgument(record, (unsigned long long) value);
+}
+
+static inline void AddLogArgument(LogRecord* record, unsigned long value)
+{
+	AddLogArgument(record, (unsigned long long) value);
+}
+
+static inline void AddLogArgument(LogRecord* record, double value)
+{
+	LogArgument argument;
+	argument.doubleValue = value;
+	AddLogArgument(record, LOG_ARGUMENT_DOUBLE, argument);
+}
+
+static inline void AddLogArgument(LogRecord* record, const void* value)
+{
+	LogArgument argument;
+	argument.pointerValue = value;
+	AddLogArgument(record, LOG_ARGUMENT_POINTER, argument);
+}
+
+/**
+ * Data buffer logged as a string, it does not need to be
+ * NULL terminated. Bytes other than printable ASCII are
+ * escaped when the message is formatted.
+ */
+struct LogBytes
+{
+	const char* data;
+	size_t size;
+};
+
+/**
+ * Wraps the given data buffer to be logged as a string.
+ *
+ * @param data data buffer.
+ * @param size data size.
+ * @return log argument.
+ */
+static inline LogBytes LogData(const char* data, size_t size)
+{
+	LogBytes bytes;
+	bytes.data = data;
+	bytes.size = size;
+
+	return bytes;
+}
+
+static inline void AddLogArgument(LogRecord* record, LogBytes value)
+{
+	LogArgument argument;
+	argument.text.offset = record->textLength;
+	argument.text.length = 0;
+
+	// Copy as much as fits, always NULL terminated
+	size_t available = MAX_LOG_RECORD_TEXT - record->textLength;
+	if (0 == available)
+	{
+		argument.text.offset = MAX_LOG_RECORD_TEXT - 1;
+	}
+	else
+	{
+		size_t length = value.size;
+		if (length >= available)
+		{
+			length = available - 1;
+		}
+
+		memcpy(record->text + record->textLength, value.data, length);
+		record->text[record->textLength + length] = 0;
+		argument.text.length = (unsigned short) length;
+		record->textLength += (unsigned short) (length + 1);
+	}
+
+	AddLogArgument(record, LOG_ARGUMENT_STRING, argument);
+}
+
+static inline void AddLogArgument(LogRecord* record, const char* value)
+{
+	// Counted up to the text size, strnlen with a bound past the end
+	// of an inlined literal warns in the optimized builds
+	size_t length = 0;
+	if (NULL != value)
+	{
+		while ((length < MAX_LOG_RECORD_TEXT) && (0 != value[length]))
+		{
+			length++;
+		}
+	}
+
+	AddLogArgument(record, LogData(value, length));
+}
+
+static inline void AddLogArgument(LogRecord* record, char* value)
+{
+	AddLogArgument(record, (const char*) value);
+}
+
+static inline void AddLogArguments(LogRecord* record)
+{
+}
+
+template <typename T, typename... Args>
+static inline void AddLogArguments(LogRecord* record, T value, Args... args)
+{
+	AddLogArgument(record, value);
+	AddLogArguments(record, args...);
+}
+
+/**
+ * Queues the given message to the log target of the calling
+ * thread. The arguments are captured in binary form and the
+ * message is formatted and delivered to the sink by the drainer
+ * thread, the caller never waits for the sink.
+ *
+ * @param format message format.
+ * @param args message arguments.
+ */
+template <typename... Args>
+static inline void LogMessage(const char* format, Args... args)
+{
+	LogRecord* record = BeginLogRecord(format);
+
+	if (NULL != record)
+	{
+		AddLogArguments(record, args...);
+		CommitLogRecord(record);
+	}
+}
+
+// Logs the message if the level is enabled, the arguments
+// are not evaluated otherwise
+#define LOG_AT_LEVEL(level, ...) \
+	do \
+	{ \
+		if (LOG_ENABLED(level)) \
+		{ \
+			LogMessage(__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_TRACE(...) LOG_AT_LEVEL(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT_LEVEL(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,241 @@
+#include "EchoMetrics.h"
+
+// clock_gettime
+#include <time.h>
+
+// posix_memalign
+#include <stdlib.h>
+
+// placement new
+#include <new>
+
+// pthread_key_create, pthread_once, pthread_setspecific
+#include <pthread.h>
+
+// std::atomic
+#include <atomic>
+
+// Cache line size, shards of different threads never share one
+#define METRICS_CACHE_LINE 64
+
+/**
+ * Histogram of a shard.
+ */
+struct MetricsHistogram
+{
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+	std::atomic<uint64_t> buckets[ECHO_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Metrics of a thread. Only the owner thread updates a shard,
+ * snapshots read it concurrently.
+ */
+struct MetricsShard
+{
+	alignas(METRICS_CACHE_LINE) std::atomic<uint64_t> counters[ECHO_COUNTER_COUNT];
+	MetricsHistogram histograms[ECHO_HISTOGRAM_COUNT];
+
+	// Owned by a running thread
+	alignas(METRICS_CACHE_LINE) std::atomic<bool> owned;
+
+	// Next shard of the registry, never changes once linked
+	MetricsShard* next;
+};
+
+// Shards of the registry, only ever prepended
+static std::atomic<MetricsShard*> gShards(NULL);
+
+// Shard of the threads a shard could not be allocated for, never
+// linked to the registry so its values are not reported
+static MetricsShard gUnlinkedShard;
+
+// Releases the shard of an exiting thread
+static pthread_key_t gShardKey;
+
+// Shard key creation guard
+static pthread_once_t gShardKeyOnce = PTHREAD_ONCE_INIT;
+
+// Shard of the calling thread
+static thread_local MetricsShard* gThreadShard = NULL;
+
+/**
+ * Hands the shard of an exiting thread over to the next thread,
+ * its values stay in the registry.
+ *
+ * @param shard metrics shard.
+ */
+static void ReleaseMetricsShard(void* shard)
+{
+	((MetricsShard*) shard)->owned.store(false, std::memory_order_release);
+}
+
+/**
+ * Creates the key releasing the shards.
+ */
+static void CreateMetricsShardKey()
+{
+	pthread_key_create(&gShardKey, ReleaseMetricsShard);
+}
+
+/**
+ * Takes a released shard or links a new one to the registry.
+ *
+ * @return metrics shard.
+ */
+static MetricsShard* AcquireMetricsShard()
+{
+	MetricsShard* shard;
+
+	// Reuse the shard of an exited thread
+	for (shard = gShards.load(std::memory_order_acquire);
+			NULL != shard; shard = shard->next)
+	{
+		bool owned = false;
+		if (!shard->owned.load(std::memory_order_relaxed)
+				&& shard->owned.compare_exchange_strong(owned, true,
+						std::memory_order_acquire))
+			break;
+	}
+
+	if (NULL == shard)
+	{
+		// Plain new does not honor the cache line alignment
+		void* memory;
+		if (0 != posix_memalign(&memory, METRICS_CACHE_LINE,
+				sizeof(MetricsShard)))
+			return &gUnlinkedShard;
+
+		// Value initialized, all values start at zero
+		shard = new (memory) MetricsShard();
+		shard->owned.store(true, std::memory_order_relaxed);
+
+		shard->next = gShards.load(std::memory_order_relaxed);
+		while (!gShards.compare_exchange_weak(shard->next, shard,
+				std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	pthread_once(&gShardKeyOnce, CreateMetricsShardKey);
+	pthread_setspecific(gShardKey, shard);
+
+	return shard;
+}
+
+/**
+ * Gets the shard of the calling thread.
+ *
+ * @return metrics shard.
+ */
+static inline MetricsShard* GetMetricsShard()
+{
+	if (NULL == gThreadShard)
+	{
+		gThreadShard = AcquireMetricsShard();
+	}
+
+	return gThreadShard;
+}
+
+/**
+ * Adds to a value only updated by the calling thread, readers
+ * never see a torn value.
+ *
+ * @param value shard value.
+ * @param amount amount to add.
+ */
+static inline void AddShardValue(
+		std::atomic<uint64_t>* value,
+		uint64_t amount)
+{
+	value->store(value->load(std::memory_order_relaxed) + amount,
+			std::memory_order_relaxed);
+}
+
+void AddEchoCounter(EchoCounter counter, uint64_t value)
+{
+	AddShardValue(&GetMetricsShard()->counters[counter], value);
+}
+
+void RecordEchoHistogram(EchoHistogram histogram, uint64_t value)
+{
+	MetricsHistogram* shardHistogram =
+			&GetMetricsShard()->histograms[histogram];
+
+	// Bucket of the highest bit, zero has its own
+	int bucket = (0 == value) ? 0 : 64 - __builtin_clzll(value);
+	if (bucket >= ECHO_HISTOGRAM_BUCKETS)
+	{
+		bucket = ECHO_HISTOGRAM_BUCKETS - 1;
+	}
+
+	AddShardValue(&shardHistogram->buckets[bucket], 1);
+	AddShardValue(&shardHistogram->count, 1);
+	AddShardValue(&shardHistogram->sum, value);
+
+	if (value > shardHistogram->max.load(std::memory_order_relaxed))
+	{
+		shardHistogram->max.store(value, std::memory_order_relaxed);
+	}
+}
+
+int64_t GetEchoMetricsTime()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+size_t SnapshotEchoMetrics(int64_t* values, size_t count)
+{
+	if (count > ECHO_METRICS_SNAPSHOT_SIZE)
+	{
+		count = ECHO_METRICS_SNAPSHOT_SIZE;
+	}
+
+	uint64_t snapshot[ECHO_METRICS_SNAPSHOT_SIZE] = { 0 };
+
+	for (MetricsShard* shard = gShards.load(std::memory_order_acquire);
+			NULL != shard; shard = shard->next)
+	{
+		uint64_t* value = snapshot;
+
+		for (int i = 0; i < ECHO_COUNTER_COUNT; i++)
+		{
+			*value++ += shard->counters[i].load(std::memory_order_relaxed);
+		}
+
+		for (int i = 0; i < ECHO_HISTOGRAM_COUNT; i++)
+		{
+			MetricsHistogram* histogram = &shard->histograms[i];
+
+			*value++ += histogram->count.load(std::memory_order_relaxed);
+			*value++ += histogram->sum.load(std::memory_order_relaxed);
+
+			// Max of all threads
+			uint64_t max = histogram->max.load(std::memory_order_relaxed);
+			if (max > *value)
+			{
+				*value = max;
+			}
+			value++;
+
+			for (int j = 0; j < ECHO_HISTOGRAM_BUCKETS; j++)
+			{
+				*value++ += histogram->buckets[j].load(
+						std::memory_order_relaxed);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		values[i] = (int64_t) snapshot[i];
+	}
+
+	return count;
+}
@@ -0,0 +1,120 @@
+#ifndef ECHO_METRICS_H
+#define ECHO_METRICS_H
+
+// size_t
+#include <stddef.h>
+
+// int64_t
+#include <stdint.h>
+
+// Metrics can be compiled out, the macros below then expand to
+// nothing and no time is taken around the system calls
+#ifndef ECHO_METRICS_ENABLED
+#define ECHO_METRICS_ENABLED 1
+#endif
+
+// Power of two buckets of a histogram, the last one takes the
+// values beyond it
+#define ECHO_HISTOGRAM_BUCKETS 32
+
+/**
+ * Counters of the echo engine, summed over all threads.
+ */
+enum EchoCounter
+{
+	// Accepted client connections
+	ECHO_COUNTER_ACCEPTED,
+
+	// Bytes received and sent
+	ECHO_COUNTER_BYTES_IN,
+	ECHO_COUNTER_BYTES_OUT,
+
+	// Socket and ring system calls
+	ECHO_COUNTER_SYSCALLS,
+
+	// Calls that failed with EAGAIN
+	ECHO_COUNTER_WOULD_BLOCK,
+
+	ECHO_COUNTER_COUNT
+};
+
+/**
+ * Histograms of the echo engine, summed over all threads.
+ */
+enum EchoHistogram
+{
+	// Receive and send call durations in nanoseconds, blocking
+	// calls include the wait for data
+	ECHO_HISTOGRAM_RECV_LATENCY,
+	ECHO_HISTOGRAM_SEND_LATENCY,
+
+	// Ready events, completions or datagrams per wait
+	ECHO_HISTOGRAM_QUEUE_DEPTH,
+
+	ECHO_HISTOGRAM_COUNT
+};
+
+// Snapshot values of a histogram: count, sum, max and the buckets
+#define ECHO_HISTOGRAM_SNAPSHOT_SIZE (3 + ECHO_HISTOGRAM_BUCKETS)
+
+// Snapshot values: the counters, then the histograms
+#define ECHO_METRICS_SNAPSHOT_SIZE (ECHO_COUNTER_COUNT \
+		+ (ECHO_HISTOGRAM_COUNT * ECHO_HISTOGRAM_SNAPSHOT_SIZE))
+
+/*
+ * Each thread updates its own shard of the registry without
+ * locking or contention, shards of exited threads are reused by
+ * the next ones. Snapshots sum the shards while they are updated,
+ * each value is consistent on its own.
+ */
+
+/**
+ * Adds to a counter of the calling thread.
+ *
+ * @param counter counter.
+ * @param value value to add.
+ */
+void AddEchoCounter(EchoCounter counter, uint64_t value);
+
+/**
+ * Records a value in a histogram of the calling thread.
+ *
+ * @param histogram histogram.
+ * @param value value to record.
+ */
+void RecordEchoHistogram(EchoHistogram histogram, uint64_t value);
+
+/**
+ * Gets the monotonic time of the latency histograms.
+ *
+ * @return time in nanoseconds.
+ */
+int64_t GetEchoMetricsTime();
+
+/**
+ * Sums the shards of all threads. Values are cumulative since
+ * the library is loaded.
+ *
+ * @param values snapshot values, ECHO_METRICS_SNAPSHOT_SIZE at most.
+ * @param count number of values.
+ * @return number of values written.
+ */
+size_t SnapshotEchoMetrics(int64_t* values, size_t count);
+
+#if ECHO_METRICS_ENABLED
+#define METRIC_ADD(counter, value) \
+		AddEchoCounter(counter, (uint64_t) (value))
+#define METRIC_RECORD(histogram, value) \
+		RecordEchoHistogram(histogram, (uint64_t) (value))
+#define METRIC_TIME() GetEchoMetricsTime()
+#define METRIC_RECORD_SINCE(histogram, start) \
+		RecordEchoHistogram(histogram, \
+				(uint64_t) (GetEchoMetricsTime() - (start)))
+#else
+#define METRIC_ADD(counter, value)
+#define METRIC_RECORD(histogram, value)
+#define METRIC_TIME() 0
+#define METRIC_RECORD_SINCE(histogram, start) ((void) (start))
+#endif
+
+#endif
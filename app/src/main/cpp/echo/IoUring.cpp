@@ -0,0 +1,310 @@
+#include "IoUring.h"
+
+#ifdef HAVE_IO_URING
+
+// errno
+#include <errno.h>
+
+// memset
+#include <string.h>
+
+// syscall, close
+#include <unistd.h>
+
+// __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <sys/syscall.h>
+
+// mmap, munmap
+#include <sys/mman.h>
+
+// iovec
+#include <sys/uio.h>
+
+// The C library has no io_uring wrappers
+static int IoUringSetup(unsigned entries, struct io_uring_params* params)
+{
+	return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(
+		int fd,
+		unsigned submitCount,
+		unsigned waitCount,
+		unsigned flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, submitCount, waitCount,
+			flags, NULL, 0);
+}
+
+static int IoUringRegister(
+		int fd,
+		unsigned opcode,
+		void* arg,
+		unsigned argCount)
+{
+	return (int) syscall(__NR_io_uring_register, fd, opcode, arg, argCount);
+}
+
+bool InitIoUring(IoUring* ring, unsigned entries, unsigned cqEntries)
+{
+	memset(ring, 0, sizeof(*ring));
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = cqEntries;
+
+	ring->fd = IoUringSetup(entries, &params);
+	if (-1 == ring->fd)
+	{
+		return false;
+	}
+
+	ring->sqRingSize = params.sq_off.array
+			+ (params.sq_entries * sizeof(unsigned));
+	ring->cqRingSize = params.cq_off.cqes
+			+ (params.cq_entries * sizeof(struct io_uring_cqe));
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	// Both queues share a single mapping on newer kernels
+	bool singleMap = (0 != (params.features & IORING_FEAT_SINGLE_MMAP));
+	if (singleMap && (ring->cqRingSize > ring->sqRingSize))
+	{
+		ring->sqRingSize = ring->cqRingSize;
+	}
+
+	ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+	if (MAP_FAILED == ring->sqRing)
+	{
+		ring->sqRing = NULL;
+		goto error;
+	}
+
+	if (singleMap)
+	{
+		ring->cqRing = ring->sqRing;
+	}
+	else
+	{
+		ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+		if (MAP_FAILED == ring->cqRing)
+		{
+			ring->cqRing = NULL;
+			goto error;
+		}
+	}
+
+	ring->sqes = (struct io_uring_sqe*) mmap(NULL, ring->sqesSize,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+			IORING_OFF_SQES);
+
+	if (MAP_FAILED == ring->sqes)
+	{
+		ring->sqes = NULL;
+		goto error;
+	}
+
+	{
+		char* sq = (char*) ring->sqRing;
+		ring->sqHead = (unsigned*) (sq + params.sq_off.head);
+		ring->sqTail = (unsigned*) (sq + params.sq_off.tail);
+		ring->sqMask = *(unsigned*) (sq + params.sq_off.ring_mask);
+		ring->sqEntries = params.sq_entries;
+		ring->sqLocalTail = *ring->sqTail;
+
+		// Entries are always used in order, index array is identity
+		unsigned* sqArray = (unsigned*) (sq + params.sq_off.array);
+		for (unsigned i = 0; i < params.sq_entries; i++)
+		{
+			sqArray[i] = i;
+		}
+
+		char* cq = (char*) ring->cqRing;
+		ring->cqHead = (unsigned*) (cq + params.cq_off.head);
+		ring->cqTail = (unsigned*) (cq + params.cq_off.tail);
+		ring->cqMask = *(unsigned*) (cq + params.cq_off.ring_mask);
+		ring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+	}
+
+	return true;
+
+error:
+	int error = errno;
+	FreeIoUring(ring);
+	errno = error;
+
+	return false;
+}
+
+void FreeIoUring(IoUring* ring)
+{
+	if (NULL != ring->sqes)
+	{
+		munmap(ring->sqes, ring->sqesSize);
+		ring->sqes = NULL;
+	}
+
+	if ((NULL != ring->cqRing) && (ring->cqRing != ring->sqRing))
+	{
+		munmap(ring->cqRing, ring->cqRingSize);
+	}
+	ring->cqRing = NULL;
+
+	if (NULL != ring->sqRing)
+	{
+		munmap(ring->sqRing, ring->sqRingSize);
+		ring->sqRing = NULL;
+	}
+
+	if (ring->fd > 0)
+	{
+		close(ring->fd);
+		ring->fd = -1;
+	}
+}
+
+struct io_uring_sqe* GetIoUringSqe(IoUring* ring)
+{
+	unsigned head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+	if ((ring->sqLocalTail - head) >= ring->sqEntries)
+	{
+		return NULL;
+	}
+
+	struct io_uring_sqe* sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+	ring->sqLocalTail++;
+
+	memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+int SubmitIoUring(IoUring* ring, unsigned waitCount)
+{
+	// Publish the queued entries
+	__atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+	// Entries the kernel has not consumed, including the ones left
+	// by an earlier enter that failed or submitted part of them
+	unsigned submitCount = ring->sqLocalTail
+			- __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+	// Nothing to enter the kernel for
+	if ((0 == submitCount) && (0 == waitCount))
+	{
+		return 0;
+	}
+
+	return IoUringEnter(ring->fd, submitCount, waitCount,
+			(0 == waitCount) ? 0 : IORING_ENTER_GETEVENTS);
+}
+
+bool NewIoUringBufferRing(
+		IoUring* ring,
+		IoUringBufferRing* buffers,
+		unsigned short groupId,
+		unsigned count,
+		size_t bufferSize,
+		bool* fixed)
+{
+	memset(buffers, 0, sizeof(*buffers));
+	buffers->groupId = groupId;
+	buffers->count = count;
+	buffers->bufferSize = bufferSize;
+	*fixed = false;
+
+	// Ring must be page aligned
+	buffers->ringSize = count * sizeof(struct io_uring_buf);
+	void* ringMemory = mmap(NULL, buffers->ringSize, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == ringMemory)
+	{
+		return false;
+	}
+
+	buffers->ring = (struct io_uring_buf*) ringMemory;
+
+	buffers->buffersSize = count * bufferSize;
+	void* bufferMemory = mmap(NULL, buffers->buffersSize,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == bufferMemory)
+	{
+		int error = errno;
+		munmap(ringMemory, buffers->ringSize);
+		buffers->ring = NULL;
+		errno = error;
+
+		return false;
+	}
+
+	buffers->buffers = (char*) bufferMemory;
+
+	struct io_uring_buf_reg registration;
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = (unsigned long) buffers->ring;
+	registration.ring_entries = count;
+	registration.bgid = groupId;
+
+	if (-1 == IoUringRegister(ring->fd, IORING_REGISTER_PBUF_RING,
+			&registration, 1))
+	{
+		int error = errno;
+		munmap(bufferMemory, buffers->buffersSize);
+		munmap(ringMemory, buffers->ringSize);
+		memset(buffers, 0, sizeof(*buffers));
+		errno = error;
+
+		return false;
+	}
+
+	// Hand all buffers to the kernel
+	for (unsigned i = 0; i < count; i++)
+	{
+		ReturnIoUringBuffer(buffers, (unsigned short) i);
+	}
+
+	// Pinning the memory may exceed the locked memory limit,
+	// sends then copy from the buffers as usual
+	struct iovec iov;
+	iov.iov_base = buffers->buffers;
+	iov.iov_len = buffers->buffersSize;
+
+	*fixed = (0 == IoUringRegister(ring->fd, IORING_REGISTER_BUFFERS,
+			&iov, 1));
+
+	return true;
+}
+
+void FreeIoUringBufferRing(IoUring* ring, IoUringBufferRing* buffers)
+{
+	if (NULL == buffers->ring)
+	{
+		return;
+	}
+
+	// Closing the ring releases the registrations as well
+	if (ring->fd > 0)
+	{
+		struct io_uring_buf_reg registration;
+		memset(&registration, 0, sizeof(registration));
+		registration.bgid = buffers->groupId;
+
+		IoUringRegister(ring->fd, IORING_UNREGISTER_PBUF_RING,
+				&registration, 1);
+		IoUringRegister(ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+	}
+
+	munmap(buffers->buffers, buffers->buffersSize);
+	munmap(buffers->ring, buffers->ringSize);
+
+	memset(buffers, 0, sizeof(*buffers));
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+// size_t
+#include <stddef.h>
+
+// io_uring_sqe, io_uring_cqe, io_uring_buf
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// Multishot accept and receive with provided buffer rings and
+// zero copy send need the kernel 6.0 headers, older headers
+// build without the engine
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) \
+		&& defined(IORING_CQE_F_NOTIF)
+#define HAVE_IO_URING 1
+#endif
+
+#ifdef HAVE_IO_URING
+
+/**
+ * Minimal io_uring instance, the submission and completion
+ * queues are mapped from the kernel. Not thread safe, a ring
+ * is owned by a single thread.
+ */
+struct IoUring
+{
+	// Ring descriptor
+	int fd;
+
+	// Submission queue indices shared with the kernel
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned sqMask;
+	unsigned sqEntries;
+
+	// Submission queue tail not yet published to the kernel
+	unsigned sqLocalTail;
+
+	// Submission queue entries
+	struct io_uring_sqe* sqes;
+
+	// Completion queue indices shared with the kernel
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned cqMask;
+
+	// Completion queue entries
+	struct io_uring_cqe* cqes;
+
+	// Mapped regions
+	void* sqRing;
+	size_t sqRingSize;
+	void* cqRing;
+	size_t cqRingSize;
+	size_t sqesSize;
+};
+
+/**
+ * Ring of buffers provided to the kernel, receive requests
+ * with buffer select pick the next free buffer. The buffers
+ * are a single mapping so they can be registered as one
+ * fixed buffer.
+ */
+struct IoUringBufferRing
+{
+	// Ring shared with the kernel, used as a plain array since
+	// the flexible array of io_uring_buf_ring is laid out
+	// differently by C++, the tail overlays the first entry
+	struct io_uring_buf* ring;
+	size_t ringSize;
+
+	// Buffer memory
+	char* buffers;
+	size_t buffersSize;
+
+	// Size of each buffer
+	size_t bufferSize;
+
+	// Number of buffers, a power of two
+	unsigned count;
+
+	// Buffer group identifier used by the requests
+	unsigned short groupId;
+
+	// Ring tail not yet published to the kernel
+	unsigned short tail;
+};
+
+/**
+ * Constructs a new io_uring instance and maps its queues.
+ *
+ * @param ring ring instance.
+ * @param entries submission queue size.
+ * @param cqEntries completion queue size.
+ * @return false on error, errno is set.
+ */
+bool InitIoUring(IoUring* ring, unsigned entries, unsigned cqEntries);
+
+/**
+ * Unmaps the queues and closes the given ring.
+ *
+ * @param ring ring instance.
+ */
+void FreeIoUring(IoUring* ring);
+
+/**
+ * Takes the next free submission queue entry, the entry is
+ * cleared and submitted on the next submit call.
+ *
+ * @param ring ring instance.
+ * @return entry or NULL if the submission queue is full.
+ */
+struct io_uring_sqe* GetIoUringSqe(IoUring* ring);
+
+/**
+ * Submits the queued entries and waits for the given number
+ * of completions.
+ *
+ * @param ring ring instance.
+ * @param waitCount completions to wait for, zero to not wait.
+ * @return number of submitted entries or -1 on error, errno is set.
+ */
+int SubmitIoUring(IoUring* ring, unsigned waitCount);
+
+/**
+ * Constructs a new provided buffer ring and registers it to
+ * the given ring. The buffer memory is also registered as the
+ * fixed buffer zero, failing that only makes fixed false.
+ *
+ * @param ring ring instance.
+ * @param buffers buffer ring instance.
+ * @param groupId buffer group identifier.
+ * @param count number of buffers, a power of two.
+ * @param bufferSize size of each buffer.
+ * @param fixed set to true if the buffers are registered.
+ * @return false on error, errno is set.
+ */
+bool NewIoUringBufferRing(
+		IoUring* ring,
+		IoUringBufferRing* buffers,
+		unsigned short groupId,
+		unsigned count,
+		size_t bufferSize,
+		bool* fixed);
+
+/**
+ * Unregisters and unmaps the given buffer ring.
+ *
+ * @param ring ring instance.
+ * @param buffers buffer ring instance.
+ */
+void FreeIoUringBufferRing(IoUring* ring, IoUringBufferRing* buffers);
+
+/**
+ * Gets the address of the given buffer.
+ *
+ * @param buffers buffer ring instance.
+ * @param bufferId buffer identifier from a completion.
+ * @return buffer address.
+ */
+static inline char* GetIoUringBuffer(
+		IoUringBufferRing* buffers,
+		unsigned short bufferId)
+{
+	return buffers->buffers + (bufferId * buffers->bufferSize);
+}
+
+/**
+ * Hands the given buffer back to the kernel.
+ *
+ * @param buffers buffer ring instance.
+ * @param bufferId buffer identifier from a completion.
+ */
+static inline void ReturnIoUringBuffer(
+		IoUringBufferRing* buffers,
+		unsigned short bufferId)
+{
+	struct io_uring_buf* buffer =
+			&buffers->ring[buffers->tail & (buffers->count - 1)];
+
+	buffer->addr = (unsigned long) GetIoUringBuffer(buffers, bufferId);
+	buffer->len = (unsigned) buffers->bufferSize;
+	buffer->bid = bufferId;
+
+	// Publish after the entry is written
+	buffers->tail++;
+	__atomic_store_n(&buffers->ring[0].resv, buffers->tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * Gets the next completion without waiting.
+ *
+ * @param ring ring instance.
+ * @return completion or NULL if there is none.
+ */
+static inline struct io_uring_cqe* PeekIoUringCqe(IoUring* ring)
+{
+	unsigned head = *ring->cqHead;
+
+	if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+	{
+		return NULL;
+	}
+
+	return &ring->cqes[head & ring->cqMask];
+}
+
+/**
+ * Marks the completion returned by the last peek as consumed.
+ *
+ * @param ring ring instance.
+ */
+static inline void AdvanceIoUringCq(IoUring* ring)
+{
+	__atomic_store_n(ring->cqHead, *ring->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+#endif
+
+#endif
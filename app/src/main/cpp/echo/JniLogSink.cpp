@@ -0,0 +1,159 @@
+#include "JniLogSink.h"
+
+// CacheJniClass, CacheJniMethod, JniEnvArgument
+#include "JniCache.h"
+
+// Class of the log targets and its log method
+#define LOG_TARGET_CLASS "com/example/lutao/cmakejni/echo/AbstractEchoActivity"
+#define LOG_METHOD_NAME "logMessage"
+#define LOG_METHOD_SIGNATURE "(Ljava/lang/String;)V"
+
+// Java VM interface pointer
+static JavaVM* gVm = NULL;
+
+// Log target class and its log method, cached on load
+static jclass gTargetClazz = NULL;
+static jmethodID gLogMethodID = NULL;
+
+// JNIEnv interface of the drainer thread, attached on first use
+static thread_local JNIEnv* gDrainerEnv = NULL;
+
+// Log sink opened by the calling thread
+static thread_local JniLogSink* gThreadSink = NULL;
+
+/**
+ * Attaches the drainer thread as a daemon, it must not keep the
+ * Java virtual machine alive.
+ *
+ * @return JNIEnv interface or NULL.
+ */
+static JNIEnv* AttachLogDrainer()
+{
+	JNIEnv* env = NULL;
+
+	JavaVMAttachArgs attachArgs;
+	attachArgs.version = JNI_VERSION_1_6;
+	attachArgs.name = (char*) "EchoLog";
+	attachArgs.group = NULL;
+
+	if (0 != gVm->AttachCurrentThreadAsDaemon(JniEnvArgument(&env),
+			&attachArgs))
+	{
+		return NULL;
+	}
+
+	return env;
+}
+
+JniLogSink::JniLogSink(jobject obj, jmethodID methodID)
+	: obj(obj),
+	  methodID(methodID)
+{
+}
+
+void JniLogSink::WriteLog(const char* messages, size_t length)
+{
+	JNIEnv* env = gDrainerEnv;
+
+	if (NULL == env)
+	{
+		env = gDrainerEnv = AttachLogDrainer();
+
+		if (NULL == env)
+			return;
+	}
+
+	// Convert the batch to a Java string, it is ASCII since the
+	// string arguments are escaped when formatted
+	jstring message = env->NewStringUTF(messages);
+
+	// If string is properly constructed
+	if (NULL != message)
+	{
+		// Log messages at once, separated by new lines
+		env->CallVoidMethod(obj, methodID, message);
+
+		// Release the message reference
+		env->DeleteLocalRef(message);
+	}
+
+	// Logging must not fail the drainer
+	if (NULL != env->ExceptionOccurred())
+	{
+		env->ExceptionClear();
+	}
+}
+
+jobject JniLogSink::GetObject() const
+{
+	return obj;
+}
+
+void LoadLogCache(JNIEnv* env)
+{
+	// Cache the JavaVM interface pointer
+	if (NULL == gVm)
+	{
+		env->GetJavaVM(&gVm);
+	}
+
+	gTargetClazz = CacheJniClass(env, LOG_TARGET_CLASS);
+	gLogMethodID = CacheJniMethod(env, LOG_TARGET_CLASS, LOG_METHOD_NAME,
+			LOG_METHOD_SIGNATURE);
+}
+
+void OpenLogTarget(JNIEnv* env, jobject obj)
+{
+	// Release the target the calling thread still has open
+	CloseLogTarget(env);
+
+	// Cache the JavaVM interface pointer
+	if ((NULL == gVm) && (0 != env->GetJavaVM(&gVm)))
+		return;
+
+	// Log method is cached for the activities, others look it up
+	jmethodID methodID = gLogMethodID;
+	if ((NULL == methodID) || !env->IsInstanceOf(obj, gTargetClazz))
+	{
+		jclass clazz = env->GetObjectClass(obj);
+		methodID = env->GetMethodID(clazz, LOG_METHOD_NAME,
+				LOG_METHOD_SIGNATURE);
+		env->DeleteLocalRef(clazz);
+
+		if (NULL == methodID)
+		{
+			env->ExceptionClear();
+			return;
+		}
+	}
+
+	jobject globalObj = env->NewGlobalRef(obj);
+	if (NULL == globalObj)
+		return;
+
+	JniLogSink* sink = new JniLogSink(globalObj, methodID);
+
+	if (!OpenLogSink(sink))
+	{
+		env->DeleteGlobalRef(globalObj);
+		delete sink;
+		return;
+	}
+
+	gThreadSink = sink;
+}
+
+void CloseLogTarget(JNIEnv* env)
+{
+	JniLogSink* sink = gThreadSink;
+	if (NULL == sink)
+		return;
+
+	gThreadSink = NULL;
+
+	// Wait for the preceding messages to be delivered
+	CloseLogSink();
+
+	env->DeleteGlobalRef(sink->GetObject());
+	delete sink;
+}
@@ -0,0 +1,68 @@
+#ifndef JNI_LOG_SINK_H
+#define JNI_LOG_SINK_H
+
+#include "EchoLog.h"
+
+// JNI
+#include <jni.h>
+
+/**
+ * Log sink delivering the messages to the logMessage(String)
+ * method of a Java object. The drainer thread is attached to
+ * the Java virtual machine as a daemon on first delivery.
+ */
+class JniLogSink : public EchoLogSink
+{
+public:
+	/**
+	 * Constructs a sink for the given object.
+	 *
+	 * @param obj global reference to the object.
+	 * @param methodID log method of the object.
+	 */
+	JniLogSink(jobject obj, jmethodID methodID);
+
+	virtual void WriteLog(const char* messages, size_t length);
+
+	/**
+	 * Gets the global reference to the object.
+	 *
+	 * @return object instance.
+	 */
+	jobject GetObject() const;
+
+private:
+	// Global reference to the object
+	jobject obj;
+
+	// Log method of the object
+	jmethodID methodID;
+};
+
+/**
+ * Caches the log target class and its log method, called
+ * from JNI_OnLoad.
+ *
+ * @param env JNIEnv interface.
+ */
+void LoadLogCache(JNIEnv* env);
+
+/**
+ * Makes the given object the log target of the calling thread.
+ * A target the thread still has open is closed first. Starts the
+ * drainer thread on first use.
+ *
+ * @param env JNIEnv interface.
+ * @param obj object with a logMessage(String) method.
+ */
+void OpenLogTarget(JNIEnv* env, jobject obj);
+
+/**
+ * Waits until the messages of the calling thread are delivered
+ * and releases its log target.
+ *
+ * @param env JNIEnv interface.
+ */
+void CloseLogTarget(JNIEnv* env);
+
+#endif
@@ -0,0 +1,418 @@
+#include "ShmRing.h"
+
+// errno
+#include <errno.h>
+
+// memcpy
+#include <string.h>
+
+// syscall, close, ftruncate, read, write
+#include <unistd.h>
+
+// __NR_memfd_create
+#include <sys/syscall.h>
+
+// mmap, munmap
+#include <sys/mman.h>
+
+// fstat
+#include <sys/stat.h>
+
+// fcntl, F_ADD_SEALS
+#include <fcntl.h>
+
+// eventfd
+#include <sys/eventfd.h>
+
+// poll
+#include <poll.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+// Records are length prefixed and aligned to the prefix
+#define SHM_RECORD_ALIGNMENT sizeof(uint32_t)
+
+// Marks the unused end of the ring, the next record is at the start
+#define SHM_PADDING 0xFFFFFFFFU
+
+// Ring checks before blocking on the event
+#define SHM_SPIN_COUNT 2048
+
+// Spinning only helps if the other side runs on another CPU
+static int GetShmSpinCount()
+{
+	static const int spinCount =
+			(sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SHM_SPIN_COUNT : 0;
+
+	return spinCount;
+}
+
+// Size of a record holding a message of the given size
+static inline uint32_t GetShmRecordSize(uint32_t size)
+{
+	return (uint32_t) (sizeof(uint32_t)
+			+ ((size + SHM_RECORD_ALIGNMENT - 1)
+			& ~(SHM_RECORD_ALIGNMENT - 1)));
+}
+
+// Size of the shared memory of a ring
+static inline size_t GetShmRingSize(uint32_t capacity)
+{
+	return sizeof(ShmRingHeader) + capacity;
+}
+
+// Lets the other hardware thread run while spinning
+static inline void RelaxCpu()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+static void SignalShmEvent(int event)
+{
+	uint64_t value = 1;
+	while ((-1 == write(event, &value, sizeof(value))) && (EINTR == errno))
+	{
+	}
+}
+
+static void AttachShmRing(
+		ShmRing* ring,
+		char* memory,
+		uint32_t capacity,
+		int readerEvent,
+		int writerEvent)
+{
+	ring->header = (ShmRingHeader*) memory;
+	ring->data = memory + sizeof(ShmRingHeader);
+	ring->capacity = capacity;
+	ring->readerEvent = readerEvent;
+	ring->writerEvent = writerEvent;
+}
+
+void InitShmChannel(ShmChannel* channel)
+{
+	memset(channel, 0, sizeof(*channel));
+	channel->memoryFd = -1;
+	channel->serverEvent = -1;
+	channel->clientEvent = -1;
+}
+
+// Maps the memory and attaches both rings
+static bool MapShmChannel(ShmChannel* channel, uint32_t capacity)
+{
+	channel->memorySize = 2 * GetShmRingSize(capacity);
+	void* memory = mmap(NULL, channel->memorySize, PROT_READ | PROT_WRITE,
+			MAP_SHARED, channel->memoryFd, 0);
+
+	if (MAP_FAILED == memory)
+	{
+		return false;
+	}
+
+	channel->memory = memory;
+
+	// Server reads the requests and writes the replies
+	AttachShmRing(&channel->requests, (char*) memory, capacity,
+			channel->serverEvent, channel->clientEvent);
+	AttachShmRing(&channel->replies,
+			(char*) memory + GetShmRingSize(capacity), capacity,
+			channel->clientEvent, channel->serverEvent);
+
+	return true;
+}
+
+bool NewShmChannel(ShmChannel* channel, uint32_t capacity)
+{
+#ifdef __NR_memfd_create
+	// Anonymous shared memory, only reachable through the descriptor
+	channel->memoryFd = (int) syscall(__NR_memfd_create, "EchoShm",
+			MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+	errno = ENOSYS;
+#endif
+
+	if (-1 == channel->memoryFd)
+	{
+		return false;
+	}
+
+	if (-1 == ftruncate(channel->memoryFd, 2 * GetShmRingSize(capacity)))
+	{
+		return false;
+	}
+
+#ifdef F_ADD_SEALS
+	// Other side must not be able to resize the mapping under us
+	fcntl(channel->memoryFd, F_ADD_SEALS,
+			F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+
+	channel->serverEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (-1 == channel->serverEvent)
+	{
+		return false;
+	}
+
+	channel->clientEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (-1 == channel->clientEvent)
+	{
+		return false;
+	}
+
+	if (!MapShmChannel(channel, capacity))
+	{
+		return false;
+	}
+
+	// New memory is zero filled, only the capacities are set
+	channel->requests.header->capacity = capacity;
+	channel->replies.header->capacity = capacity;
+
+	return true;
+}
+
+bool AttachShmChannel(
+		ShmChannel* channel,
+		int memoryFd,
+		int serverEvent,
+		int clientEvent,
+		uint32_t capacity)
+{
+	channel->memoryFd = memoryFd;
+	channel->serverEvent = serverEvent;
+	channel->clientEvent = clientEvent;
+
+	// Capacity must be a power of two and the memory big enough
+	struct stat memoryStat;
+	if ((0 == capacity) || (0 != (capacity & (capacity - 1)))
+			|| (-1 == fstat(memoryFd, &memoryStat))
+			|| ((size_t) memoryStat.st_size < 2 * GetShmRingSize(capacity)))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!MapShmChannel(channel, capacity))
+	{
+		return false;
+	}
+
+	if ((capacity != channel->requests.header->capacity)
+			|| (capacity != channel->replies.header->capacity))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	return true;
+}
+
+void FreeShmChannel(ShmChannel* channel)
+{
+	if (NULL != channel->memory)
+	{
+		munmap(channel->memory, channel->memorySize);
+	}
+
+	if (-1 != channel->memoryFd)
+	{
+		close(channel->memoryFd);
+	}
+
+	if (-1 != channel->serverEvent)
+	{
+		close(channel->serverEvent);
+	}
+
+	if (-1 != channel->clientEvent)
+	{
+		close(channel->clientEvent);
+	}
+
+	InitShmChannel(channel);
+}
+
+uint32_t GetShmRingMaxMessage(ShmRing* ring)
+{
+	// Half of the ring always fits, even after a padding
+	return (ring->capacity / 2) - (uint32_t) sizeof(uint32_t);
+}
+
+// Gets the padding needed before a record at the given position
+static inline uint32_t GetShmPadding(
+		ShmRing* ring,
+		uint32_t tail,
+		uint32_t recordSize)
+{
+	uint32_t contiguous = ring->capacity - (tail & (ring->capacity - 1));
+	return (contiguous < recordSize) ? contiguous : 0;
+}
+
+// Is there room for a message of the given size
+static inline bool HasShmRingRoom(ShmRing* ring, uint32_t size)
+{
+	uint32_t tail = ring->header->tail.load(std::memory_order_relaxed);
+	uint32_t head = ring->header->head.load(std::memory_order_acquire);
+	uint32_t recordSize = GetShmRecordSize(size);
+
+	return ((tail - head) + GetShmPadding(ring, tail, recordSize)
+			+ recordSize) <= ring->capacity;
+}
+
+// Is there a message to read
+static inline bool HasShmRingMessage(ShmRing* ring)
+{
+	return ring->header->head.load(std::memory_order_relaxed)
+			!= ring->header->tail.load(std::memory_order_acquire);
+}
+
+bool WriteShmRing(ShmRing* ring, const void* message, uint32_t size)
+{
+	if ((size > GetShmRingMaxMessage(ring)) || !HasShmRingRoom(ring, size))
+	{
+		return false;
+	}
+
+	uint32_t tail = ring->header->tail.load(std::memory_order_relaxed);
+	uint32_t recordSize = GetShmRecordSize(size);
+	uint32_t padding = GetShmPadding(ring, tail, recordSize);
+
+	// Record does not fit before the end, wrap around
+	if (0 != padding)
+	{
+		*(uint32_t*) (ring->data + (tail & (ring->capacity - 1))) = SHM_PADDING;
+		tail += padding;
+	}
+
+	char* record = ring->data + (tail & (ring->capacity - 1));
+	*(uint32_t*) record = size;
+	memcpy(record + sizeof(uint32_t), message, size);
+
+	// Sequential consistency orders the publish before the
+	// waiting check, the reader does the opposite
+	ring->header->tail.store(tail + recordSize, std::memory_order_seq_cst);
+
+	if (0 != ring->header->readerWaiting.load(std::memory_order_seq_cst))
+	{
+		SignalShmEvent(ring->readerEvent);
+	}
+
+	return true;
+}
+
+const char* PeekShmRing(ShmRing* ring, uint32_t* size)
+{
+	if (!HasShmRingMessage(ring))
+	{
+		return NULL;
+	}
+
+	uint32_t head = ring->header->head.load(std::memory_order_relaxed);
+	uint32_t length = *(uint32_t*) (ring->data + (head & (ring->capacity - 1)));
+
+	// Skip the unused end, there is always a record after it
+	if (SHM_PADDING == length)
+	{
+		head += ring->capacity - (head & (ring->capacity - 1));
+		ring->header->head.store(head, std::memory_order_release);
+
+		length = *(uint32_t*) ring->data;
+	}
+
+	*size = length;
+
+	return ring->data + (head & (ring->capacity - 1)) + sizeof(uint32_t);
+}
+
+void ConsumeShmRing(ShmRing* ring)
+{
+	uint32_t head = ring->header->head.load(std::memory_order_relaxed);
+	uint32_t length = *(uint32_t*) (ring->data + (head & (ring->capacity - 1)));
+
+	ring->header->head.store(head + GetShmRecordSize(length),
+			std::memory_order_seq_cst);
+
+	if (0 != ring->header->writerWaiting.load(std::memory_order_seq_cst))
+	{
+		SignalShmEvent(ring->writerEvent);
+	}
+}
+
+// Is the ring ready for the waiting side
+static inline bool IsShmRingReady(ShmRing* ring, bool reading, uint32_t size)
+{
+	return reading ? HasShmRingMessage(ring) : HasShmRingRoom(ring, size);
+}
+
+bool WaitShmRing(
+		ShmRing* ring,
+		bool reading,
+		uint32_t size,
+		int event,
+		int hangupFd)
+{
+	// Other side usually answers within the spin
+	int spinCount = GetShmSpinCount();
+	for (int i = 0; i < spinCount; i++)
+	{
+		if (IsShmRingReady(ring, reading, size))
+		{
+			return true;
+		}
+
+		RelaxCpu();
+	}
+
+	std::atomic<uint32_t>* waiting = reading
+			? &ring->header->readerWaiting
+			: &ring->header->writerWaiting;
+
+	// Announce the wait, then check again before blocking
+	waiting->store(1, std::memory_order_seq_cst);
+
+	bool alive = true;
+	while (!IsShmRingReady(ring, reading, size))
+	{
+		struct pollfd fds[2];
+		fds[0].fd = event;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = hangupFd;
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+
+		if ((-1 == poll(fds, 2, -1)) && (EINTR != errno))
+		{
+			alive = false;
+			break;
+		}
+
+		// Nothing but the hangup is ever sent on the socket
+		if (0 != fds[1].revents)
+		{
+			alive = IsShmRingReady(ring, reading, size);
+			break;
+		}
+
+		// Reset the event
+		uint64_t value;
+		if (0 != (fds[0].revents & POLLIN))
+		{
+			read(event, &value, sizeof(value));
+		}
+	}
+
+	waiting->store(0, std::memory_order_relaxed);
+
+	return alive;
+}
@@ -0,0 +1,185 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+// size_t
+#include <stddef.h>
+
+// uint32_t
+#include <stdint.h>
+
+// std::atomic
+#include <atomic>
+
+// Cache line size, the positions of both sides are kept apart
+#define SHM_CACHE_LINE 64
+
+/**
+ * Ring header in the shared memory. The positions are free
+ * running byte counters, only the owning side writes them.
+ */
+struct ShmRingHeader
+{
+	// Read position, written by the reader
+	alignas(SHM_CACHE_LINE) std::atomic<uint32_t> head;
+
+	// Reader is blocked, or about to block, on its event
+	std::atomic<uint32_t> readerWaiting;
+
+	// Write position, written by the writer
+	alignas(SHM_CACHE_LINE) std::atomic<uint32_t> tail;
+
+	// Writer is blocked, or about to block, on its event
+	std::atomic<uint32_t> writerWaiting;
+
+	// Data capacity in bytes, a power of two
+	alignas(SHM_CACHE_LINE) uint32_t capacity;
+};
+
+/**
+ * Single producer single consumer ring of length prefixed
+ * messages in shared memory. Each side signals the event of
+ * the other side only when it is waiting.
+ */
+struct ShmRing
+{
+	// Shared header
+	ShmRingHeader* header;
+
+	// Shared data, follows the header
+	char* data;
+
+	// Data capacity in bytes
+	uint32_t capacity;
+
+	// Event signaled when a message is written
+	int readerEvent;
+
+	// Event signaled when a message is consumed
+	int writerEvent;
+};
+
+/**
+ * Shared memory echo channel, a request ring from the client
+ * to the server and a reply ring back. Both rings live in a
+ * single memfd, each side blocks on its own eventfd.
+ */
+struct ShmChannel
+{
+	// Shared memory descriptor
+	int memoryFd;
+
+	// Event the server blocks on
+	int serverEvent;
+
+	// Event the client blocks on
+	int clientEvent;
+
+	// Mapped shared memory
+	void* memory;
+	size_t memorySize;
+
+	// Client to server messages
+	ShmRing requests;
+
+	// Server to client messages
+	ShmRing replies;
+};
+
+/**
+ * Initializes the given channel, nothing is allocated.
+ *
+ * @param channel channel instance.
+ */
+void InitShmChannel(ShmChannel* channel);
+
+/**
+ * Constructs the shared memory and the events of a new channel
+ * on the server side.
+ *
+ * @param channel channel instance.
+ * @param capacity capacity of each ring, a power of two.
+ * @return false on error, errno is set.
+ */
+bool NewShmChannel(ShmChannel* channel, uint32_t capacity);
+
+/**
+ * Maps the shared memory of a channel received by the client.
+ * The channel owns the given descriptors even on error.
+ *
+ * @param channel channel instance.
+ * @param memoryFd shared memory descriptor.
+ * @param serverEvent server event descriptor.
+ * @param clientEvent client event descriptor.
+ * @param capacity capacity of each ring.
+ * @return false on error, errno is set.
+ */
+bool AttachShmChannel(
+		ShmChannel* channel,
+		int memoryFd,
+		int serverEvent,
+		int clientEvent,
+		uint32_t capacity);
+
+/**
+ * Unmaps the shared memory and closes the descriptors.
+ *
+ * @param channel channel instance.
+ */
+void FreeShmChannel(ShmChannel* channel);
+
+/**
+ * Gets the largest message that fits into the given ring.
+ *
+ * @param ring ring instance.
+ * @return max message size.
+ */
+uint32_t GetShmRingMaxMessage(ShmRing* ring);
+
+/**
+ * Copies the given message into the ring and wakes up the
+ * reader if it is waiting.
+ *
+ * @param ring ring instance.
+ * @param message message data.
+ * @param size message size.
+ * @return false if there is no room.
+ */
+bool WriteShmRing(ShmRing* ring, const void* message, uint32_t size);
+
+/**
+ * Gets the next message without consuming it.
+ *
+ * @param ring ring instance.
+ * @param size message size.
+ * @return message data or NULL if the ring is empty.
+ */
+const char* PeekShmRing(ShmRing* ring, uint32_t* size);
+
+/**
+ * Consumes the message returned by the last peek and wakes up
+ * the writer if it is waiting.
+ *
+ * @param ring ring instance.
+ */
+void ConsumeShmRing(ShmRing* ring);
+
+/**
+ * Spins for a while, then blocks on the given event until the
+ * ring has a message to read, or room for a message of the
+ * given size.
+ *
+ * @param ring ring instance.
+ * @param reading wait for a message, otherwise for room.
+ * @param size message size when waiting for room.
+ * @param event event of the waiting side.
+ * @param hangupFd socket of the other side, readable once closed.
+ * @return false if the other side is gone.
+ */
+bool WaitShmRing(
+		ShmRing* ring,
+		bool reading,
+		uint32_t size,
+		int event,
+		int hangupFd);
+
+#endif
@@ -0,0 +1,81 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class com_example_lutao_cmakejni_AbstractEchoActivity */
+
+#ifndef _Included_com_example_lutao_cmakejni_AbstractEchoActivity
+#define _Included_com_example_lutao_cmakejni_AbstractEchoActivity
+#ifdef __cplusplus
+extern "C" {
+#endif
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_TRACE
+#define com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_TRACE 0L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_DEBUG
+#define com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_DEBUG 1L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_INFO
+#define com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_INFO 2L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_WARN
+#define com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_WARN 3L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_ERROR
+#define com_example_lutao_cmakejni_AbstractEchoActivity_LOG_LEVEL_ERROR 4L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_ACCEPTED
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_ACCEPTED 0L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_BYTES_IN
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_BYTES_IN 1L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_BYTES_OUT
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_BYTES_OUT 2L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_SYSCALLS
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_SYSCALLS 3L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_WOULD_BLOCK
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_WOULD_BLOCK 4L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_RECV_LATENCY
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_RECV_LATENCY 5L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_SEND_LATENCY
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_SEND_LATENCY 40L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_QUEUE_DEPTH
+#define com_example_lutao_cmakejni_AbstractEchoActivity_METRIC_QUEUE_DEPTH 75L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_COUNT
+#define com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_COUNT 0L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_SUM
+#define com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_SUM 1L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_MAX
+#define com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_MAX 2L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_BUCKETS
+#define com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_BUCKETS 3L
+#undef com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_BUCKET_COUNT
+#define com_example_lutao_cmakejni_AbstractEchoActivity_HISTOGRAM_BUCKET_COUNT 32L
+/*
+ * Class:     com_example_lutao_cmakejni_AbstractEchoActivity
+ * Method:    nativeSetLogLevel
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetLogLevel
+  (JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_AbstractEchoActivity
+ * Method:    nativeSetBufferSize
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetBufferSize
+  (JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_AbstractEchoActivity
+ * Method:    nativeSetZeroCopy
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeSetZeroCopy
+  (JNIEnv *, jclass, jboolean);
+
+/*
+ * Class:     com_example_lutao_cmakejni_AbstractEchoActivity
+ * Method:    nativeGetMetrics
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_example_lutao_cmakejni_AbstractEchoActivity_nativeGetMetrics
+  (JNIEnv *, jclass);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
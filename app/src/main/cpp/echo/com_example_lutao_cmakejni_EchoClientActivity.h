@@ -23,6 +23,46 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_native
 JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeStartUdpClient
   (JNIEnv *, jobject, jstring, jint, jstring);
 
+/*
+ * Class:     com_example_lutao_cmakejni_EchoClientActivity
+ * Method:    nativeSendTcpBuffer
+ * Signature: (Ljava/lang/String;ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpBuffer
+  (JNIEnv *, jobject, jstring, jint, jobject, jobject);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoClientActivity
+ * Method:    nativeSendUdpBuffer
+ * Signature: (Ljava/lang/String;ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendUdpBuffer
+  (JNIEnv *, jobject, jstring, jint, jobject, jobject);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoClientActivity
+ * Method:    nativeOpenTcpSession
+ * Signature: (Ljava/lang/String;I)J
+ */
+JNIEXPORT jlong JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeOpenTcpSession
+  (JNIEnv *, jobject, jstring, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoClientActivity
+ * Method:    nativeSendTcpSession
+ * Signature: (J[Ljava/lang/String;)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeSendTcpSession
+  (JNIEnv *, jobject, jlong, jobjectArray);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoClientActivity
+ * Method:    nativeCloseTcpSession
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoClientActivity_nativeCloseTcpSession
+  (JNIEnv *, jobject, jlong);
+
 #ifdef __cplusplus
 }
 #endif
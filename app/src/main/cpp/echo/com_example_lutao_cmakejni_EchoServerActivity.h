@@ -23,6 +23,54 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_native
 JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpServer
   (JNIEnv *, jobject, jint);
 
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartTcpReactorServer
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpReactorServer
+  (JNIEnv *, jobject, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartTcpFramedServer
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpFramedServer
+  (JNIEnv *, jobject, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartTcpMultiReactorServer
+ * Signature: (II)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpMultiReactorServer
+  (JNIEnv *, jobject, jint, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartUdpBatchServer
+ * Signature: (II)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpBatchServer
+  (JNIEnv *, jobject, jint, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartTcpUringServer
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartTcpUringServer
+  (JNIEnv *, jobject, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_EchoServerActivity
+ * Method:    nativeStartUdpUringServer
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_EchoServerActivity_nativeStartUdpUringServer
+  (JNIEnv *, jobject, jint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,38 @@ extern "C" {
 JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalServer
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     com_example_lutao_cmakejni_LocalEchoActivity
+ * Method:    nativeStartLocalUringServer
+ * Signature: (Ljava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalUringServer
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     com_example_lutao_cmakejni_LocalEchoActivity
+ * Method:    nativeStartLocalShmServer
+ * Signature: (Ljava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmServer
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     com_example_lutao_cmakejni_LocalEchoActivity
+ * Method:    nativeStartLocalShmClient
+ * Signature: (Ljava/lang/String;Ljava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeStartLocalShmClient
+  (JNIEnv *, jobject, jstring, jstring);
+
+/*
+ * Class:     com_example_lutao_cmakejni_LocalEchoActivity
+ * Method:    nativeSendLocalBuffer
+ * Signature: (Ljava/lang/String;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_LocalEchoActivity_nativeSendLocalBuffer
+  (JNIEnv *, jobject, jstring, jobject, jobject);
+
 #ifdef __cplusplus
 }
 #endif
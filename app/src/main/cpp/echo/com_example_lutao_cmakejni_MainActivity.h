@@ -41,12 +41,28 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeWorker
 
 /*
  * Class:     com_example_lutao_cmakejni_MainActivity
- * Method:    posixThreads
+ * Method:    nativeSubmit
  * Signature: (II)V
  */
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_posixThreads
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeSubmit
   (JNIEnv *, jobject, jint, jint);
 
+/*
+ * Class:     com_example_lutao_cmakejni_MainActivity
+ * Method:    nativeAwait
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeAwait
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_example_lutao_cmakejni_MainActivity
+ * Method:    nativeSetMessageBuffer
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeSetMessageBuffer
+  (JNIEnv *, jobject, jboolean);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,6 @@
 #include <jni.h>
+#include "JniCache.h"
+#include "JniModules.h"
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
@@ -6,8 +8,8 @@
 using namespace std;
 
 
-//native 方法
-jint get_random_num(){
+//native 方法，前两个参数和静态注册的函数一样
+static jint get_random_num(JNIEnv* env, jobject obj){
     return rand();
 }
 
@@ -18,21 +20,15 @@ jint get_random_num(){
 2.签名（传进来参数类型和返回值类型的说明）
 3.C/C++中对应函数的函数名（地址）
 */
-static JNINativeMethod getMethods[] = {
+static const JNINativeMethod getMethods[] = {
         {"getRandomNum","()I",(void*)get_random_num},
 };
 
 
 //此函数通过调用JNI中 RegisterNatives 方法来注册我们的函数
-static int registerNativeMethods(JNIEnv* env, const char* className,JNINativeMethod* getMethods,int methodsNum){
-    jclass clazz;
-    //找到声明native方法的类
-    clazz = env->FindClass(className);
-    if(clazz == NULL){
-        return JNI_FALSE;
-    }
-    //注册函数 参数：java类 所要注册的函数数组 注册函数的个数
-    if(env->RegisterNatives(clazz,getMethods,methodsNum) < 0){
+static int registerNativeMethods(JNIEnv* env, const char* className,const JNINativeMethod* getMethods,int methodsNum){
+    //找到声明native方法的类并注册函数 参数：java类 所要注册的函数数组 注册函数的个数
+    if(!RegisterJniNatives(env,className,getMethods,methodsNum)){
         return JNI_FALSE;
     }
     return JNI_TRUE;
@@ -40,23 +36,14 @@ static int registerNativeMethods(JNIEnv* env, const char* className,JNINativeMet
 
 static int registerNatives(JNIEnv* env){
     //指定类的路径，通过FindClass 方法来找到对应的类
-    const char* className  = "com/example/wenzhe/myjni/JniTest";
+    const char* className  = "com/example/lutao/cmakejni/MainActivity";
     return registerNativeMethods(env,className,getMethods, sizeof(getMethods)/ sizeof(getMethods[0]));
 }
 
 
-//回调函数 在这里面注册函数
-JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved){
-    JNIEnv* env = NULL;
-    //判断虚拟机状态是否有问题
-    if(vm->GetEnv((void**)&env,JNI_VERSION_1_6)!= JNI_OK){
-        return -1;
-    }
+//库加载时调用 在这里面注册函数
+bool LoadDynamicLoadModule(JavaVM* vm, JNIEnv* env){
     assert(env != NULL);
     //开始注册函数 registerNatives -》registerNativeMethods -》env->RegisterNatives
-    if(!registerNatives(env)){
-        return -1;
-    }
-    //返回jni 的版本
-    return JNI_VERSION_1_6;
+    return registerNatives(env);
 }
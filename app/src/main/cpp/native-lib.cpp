@@ -2,7 +2,12 @@
 #include <string>
 #include <stdio.h>
 #include <unistd.h>
-#include <pthread.h>
+#include <atomic>
+#include <new>
+#include "WorkPool.h"
+#include "MessageBatch.h"
+#include "JniCache.h"
+#include "JniModules.h"
 #include "echo/com_example_lutao_cmakejni_MainActivity.h"
 
 
@@ -13,14 +18,37 @@ JNIEXPORT jstring JNICALL Java_com_example_lutao_cmakejni_MainActivity_stringFro
 }
 
 
-struct NativeWorkerArgs
+// Worker pool task
+struct NativeWorkerTask
 {
+    // Pool task, must be the first member
+    WorkTask task;
+
+    // Tasks of the same submit, freed by the last one done
+    NativeWorkerTask* batch;
+    std::atomic<jint>* remaining;
+
     jint id;
     jint iterations;
 };
 
-// Method ID can be cached
-static jmethodID gOnNativeMessage = NULL;
+// Longest wait of a message before its batch is delivered
+#define MESSAGE_BATCH_INTERVAL 50000000LL
+
+// Classes cached when the library loads
+#define MAIN_ACTIVITY_CLASS "com/example/lutao/cmakejni/MainActivity"
+#define STRING_CLASS "java/lang/String"
+#define RUNTIME_EXCEPTION_CLASS "java/lang/RuntimeException"
+
+// Method IDs are cached when the library loads
+static jmethodID gOnNativeMessages = NULL;
+static jmethodID gOnNativeMessageBuffer = NULL;
+
+// String class, pool threads can not look up classes
+static jclass gStringClazz = NULL;
+
+// Deliver the batches as a direct buffer instead of a string array
+static std::atomic<bool> gDirectBuffer(true);
 
 // Java VM interface pointer
 static JavaVM* gVm = NULL;
@@ -28,34 +56,96 @@ static JavaVM* gVm = NULL;
 // Global reference to object
 static jobject gObj = NULL;
 
-// Mutex instance
-static pthread_mutex_t mutex;
+// Worker pool, one attached thread per core
+static WorkPool gPool;
+static bool gPoolStarted = false;
+
+// Tasks submitted and not done yet
+static WorkGroup gGroup;
+
+// Native methods of the main activity
+static const JNINativeMethod gMainActivityMethods[] = {
+        {"stringFromJNI", "()Ljava/lang/String;",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_stringFromJNI},
+        {"nativeInit", "()V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeInit},
+        {"nativeFree", "()V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeFree},
+        {"nativeSetMessageBuffer", "(Z)V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeSetMessageBuffer},
+        {"nativeWorker", "(II)V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeWorker},
+        {"nativeSubmit", "(II)V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeSubmit},
+        {"nativeAwait", "()V",
+                (void*) Java_com_example_lutao_cmakejni_MainActivity_nativeAwait},
+};
 
-// 重载该方法，可以获得JVM的接口指针
-jint JNI_OnLoad (JavaVM* vm, void* reserved)
+// 库加载时调用，可以获得JVM的接口指针
+bool LoadMainModule(JavaVM* vm, JNIEnv* env)
 {
     // Cache the JavaVM interface pointer
     gVm = vm;
 
-    return JNI_VERSION_1_6;
+    // Cache the classes once, with the class loader of the library
+    CacheJniClass(env, RUNTIME_EXCEPTION_CLASS);
+    gStringClazz = CacheJniClass(env, STRING_CLASS);
+
+    // Bind the native methods now, the symbols are not exported
+    if (!RegisterJniNatives(env, MAIN_ACTIVITY_CLASS, gMainActivityMethods,
+                            JNI_METHOD_COUNT(gMainActivityMethods)))
+    {
+        return false;
+    }
+
+    // Cache the callback methods
+    gOnNativeMessages = CacheJniMethod(env,
+                                       MAIN_ACTIVITY_CLASS,
+                                       "onNativeMessages",
+                                       "([Ljava/lang/String;)V");
+
+    gOnNativeMessageBuffer = CacheJniMethod(env,
+                                            MAIN_ACTIVITY_CLASS,
+                                            "onNativeMessageBuffer",
+                                            "(Ljava/nio/ByteBuffer;)V");
+
+    return true;
 }
 
+// Throws a runtime exception with the given message
+static void ThrowRuntimeException(JNIEnv* env, const char* message)
+{
+    // Exception class is cached when the library loads
+    ThrowJniException(env, RUNTIME_EXCEPTION_CLASS, message);
+}
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeInit
-        (JNIEnv *env, jobject obj)
+// Attaches each pool thread to the Java virtual machine once
+static void* AttachWorkerThread(void* context)
 {
-    // Initialize mutex
-    if (0 != pthread_mutex_init(&mutex, NULL))
+    JNIEnv* env = NULL;
+
+    // Attach current thread to Java virtual machine
+    // and obrain JNIEnv interface pointer
+    if (0 != gVm->AttachCurrentThread(JniEnvArgument(&env), NULL))
     {
-        // Get the exception class
-        jclass exceptionClazz = env->FindClass(
-                "java/lang/RuntimeException");
+        return NULL;
+    }
 
-        // Throw exception
-        env->ThrowNew(exceptionClazz, "Unable to initialize mutex");
-        goto exit;
+    return env;
+}
+
+// Detaches each pool thread before it exits
+static void DetachWorkerThread(void* context, void* threadContext)
+{
+    if (NULL != threadContext)
+    {
+        gVm->DetachCurrentThread();
     }
+}
 
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeInit
+        (JNIEnv *env, jobject obj)
+{
     // If object global reference is not set
     if (NULL == gObj)
     {
@@ -68,28 +158,40 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeInit
         }
     }
 
-    // If method ID is not cached
-    if (NULL == gOnNativeMessage)
+    // If methods or classes could not be cached
+    if ((NULL == gOnNativeMessages) || (NULL == gOnNativeMessageBuffer)
+        || (NULL == gStringClazz))
     {
-        // Get the class from the object
-        jclass clazz = env->GetObjectClass(obj);
+        // Throw exception
+        ThrowRuntimeException(env, "Unable to find method");
+        goto exit;
+    }
 
-        // Get the method id for the callback
-        gOnNativeMessage = env->GetMethodID(clazz,
-                                            "onNativeMessage",
-                                            "(Ljava/lang/String;)V");
+    // If worker pool is not started
+    if (!gPoolStarted)
+    {
+        // Initialize the task group
+        if (!InitWorkGroup(&gGroup))
+        {
+            // Throw exception
+            ThrowRuntimeException(env, "Unable to initialize task group");
+            goto exit;
+        }
 
-        // If method could not be found
-        if (NULL == gOnNativeMessage)
+        // Start a worker per core, each attached to the virtual machine
+        if (!NewWorkPool(&gPool, 0, AttachWorkerThread, DetachWorkerThread,
+                         NULL))
         {
-            // Get the exception class
-            jclass exceptionClazz = env->FindClass(
-                    "java/lang/RuntimeException");
+            FreeWorkGroup(&gGroup);
 
             // Throw exception
-            env->ThrowNew(exceptionClazz, "Unable to find method");
+            ThrowRuntimeException(env, "Unable to create worker pool");
+            goto exit;
         }
+
+        gPoolStarted = true;
     }
+
     exit:
     return;
 }
@@ -97,6 +199,17 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeInit
 JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeFree
         (JNIEnv *env, jobject obj)
 {
+    // If worker pool is started
+    if (gPoolStarted)
+    {
+        // Wait for the submitted tasks, then stop the workers
+        AwaitWorkGroup(&gGroup);
+        FreeWorkPool(&gPool);
+        FreeWorkGroup(&gGroup);
+
+        gPoolStarted = false;
+    }
+
     // If object global reference is set
     if (NULL != gObj)
     {
@@ -104,132 +217,226 @@ JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeFree
         env->DeleteGlobalRef(gObj);
         gObj = NULL;
     }
+}
 
-    // Destory mutex
-    if (0 != pthread_mutex_destroy(&mutex))
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeSetMessageBuffer
+        (JNIEnv *env, jobject obj, jboolean directBuffer)
+{
+    gDirectBuffer.store(JNI_FALSE != directBuffer);
+}
+
+// Delivers the batched messages with a single call to the object
+static void FlushMessageBatch(
+        JNIEnv* env,
+        jobject obj,
+        MessageBatch* batch)
+{
+    if (0 == batch->count)
+        return;
+
+    if (gDirectBuffer.load(std::memory_order_relaxed))
     {
-        // Get the exception class
-        jclass exceptionClazz = env->FindClass(
-                "java/lang/RuntimeException");
+        // Java reads the records before the call returns
+        jobject buffer = env->NewDirectByteBuffer(batch->data,
+                                                  (jlong) batch->length);
 
-        // Throw exception
-        env->ThrowNew(exceptionClazz, "Unable to destroy mutex");
+        if (NULL != buffer)
+        {
+            // Call the on native message buffer method
+            env->CallVoidMethod(obj, gOnNativeMessageBuffer, buffer);
+
+            // Release the buffer reference
+            env->DeleteLocalRef(buffer);
+        }
+    }
+    else
+    {
+        jobjectArray messages = env->NewObjectArray(batch->count,
+                                                    gStringClazz, NULL);
+
+        if (NULL != messages)
+        {
+            size_t offset = 0;
+            uint32_t length;
+            const char* message;
+
+            for (jsize i = 0;
+                 NULL != (message = NextMessageRecord(batch, &offset, &length));
+                 i++)
+            {
+                // Message from the C string
+                jstring messageString = env->NewStringUTF(message);
+                if (NULL == messageString)
+                    break;
+
+                env->SetObjectArrayElement(messages, i, messageString);
+
+                // Array holds the string now
+                env->DeleteLocalRef(messageString);
+            }
+
+            // Call the on native messages method
+            if (NULL == env->ExceptionOccurred())
+            {
+                env->CallVoidMethod(obj, gOnNativeMessages, messages);
+            }
+
+            // Release the array reference
+            env->DeleteLocalRef(messages);
+        }
     }
+
+    ClearMessageBatch(batch);
 }
 
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeWorker
-        (JNIEnv* env,
-         jobject obj,
-         jint id,
-         jint iterations){
-    // Lock mutex
-    if (0 != pthread_mutex_lock(&mutex))
+// Sends a message per iteration to the object
+static void RunNativeWorker(
+        JNIEnv* env,
+        jobject obj,
+        jint id,
+        jint iterations)
+{
+    // Messages are delivered in batches, not one by one
+    MessageBatch* batch = new (std::nothrow) MessageBatch;
+    if (NULL == batch)
     {
-        // Get the exception class
-        jclass exceptionClazz = env->FindClass(
-                "java/lang/RuntimeException");
-
         // Throw exception
-        env->ThrowNew(exceptionClazz, "Unable to lock mutex");
-        goto exit;
+        ThrowRuntimeException(env, "Unable to allocate message batch");
+        return;
     }
 
+    ClearMessageBatch(batch);
+
     // Loop for given number of iterations
     for (jint i = 0; i < iterations; i++)
     {
         // Prepare message
-        char message[26];
-        sprintf(message, "Worker %d: Iteration %d", id, i);
+        char message[64];
+        int length = snprintf(message, sizeof(message),
+                              "Worker %d: Iteration %d", id, i);
 
-        // Message from the C string
-        jstring messageString = env->NewStringUTF(message);
+        // Deliver the batch once it is full
+        if (!AppendMessageBatch(batch, message, (size_t) length))
+        {
+            FlushMessageBatch(env, obj, batch);
+            AppendMessageBatch(batch, message, (size_t) length);
+        }
 
-        // Call the on native message method
-        env->CallVoidMethod(obj, gOnNativeMessage, messageString);
+        // Or once its first message waits too long
+        if (IsMessageBatchDue(batch, MESSAGE_BATCH_INTERVAL))
+        {
+            FlushMessageBatch(env, obj, batch);
+        }
 
         // Check if an exception occurred
         if (NULL != env->ExceptionOccurred())
             break;
-
-        // Sleep for a second
-        sleep(1);
     }
 
-    // Unlock mutex
-    if (0 != pthread_mutex_unlock(&mutex))
+    // Deliver the rest
+    if (NULL == env->ExceptionOccurred())
     {
-        // Get the exception class
-        jclass exceptionClazz = env->FindClass(
-                "java/lang/RuntimeException");
-
-        // Throw exception
-        env->ThrowNew(exceptionClazz, "Unable to unlock mutex");
+        FlushMessageBatch(env, obj, batch);
     }
 
-    exit:
-    return;
+    delete batch;
 }
 
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeWorker
+        (JNIEnv* env,
+         jobject obj,
+         jint id,
+         jint iterations){
+    RunNativeWorker(env, obj, id, iterations);
+}
 
-static void* nativeWorkerThread (void* args)
+// Runs a submitted task on a pool thread
+static void NativeWorkerTaskRun(WorkTask* task, void* threadContext)
 {
-    JNIEnv* env = NULL;
+    NativeWorkerTask* nativeWorkerTask = (NativeWorkerTask*) task;
+    JNIEnv* env = (JNIEnv*) threadContext;
 
-    // Attach current thread to Java virtual machine
-    // and obrain JNIEnv interface pointer
-    if (0 == gVm->AttachCurrentThread(&env, NULL))
+    // Thread could not be attached
+    if (NULL != env)
     {
-        // Get the native worker thread arguments
-        NativeWorkerArgs* nativeWorkerArgs = (NativeWorkerArgs*) args;
-
-        // Run the native worker in thread context
-        Java_com_example_lutao_cmakejni_MainActivity_nativeWorker(env,
-                                                          gObj,
-                                                          nativeWorkerArgs->id,
-                                                          nativeWorkerArgs->iterations);
+        RunNativeWorker(env, gObj, nativeWorkerTask->id,
+                        nativeWorkerTask->iterations);
 
-        // Free the native worker thread arguments
-        delete nativeWorkerArgs;
-
-        // Detach current thread from Java virtual machine
-        gVm->DetachCurrentThread();
+        // Nobody would handle it, keep the thread usable
+        if (NULL != env->ExceptionOccurred())
+        {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
     }
 
-    return (void*) 1;
+    // Last task of the submit frees all of them
+    if (1 == nativeWorkerTask->remaining->fetch_sub(1))
+    {
+        delete nativeWorkerTask->remaining;
+        delete[] nativeWorkerTask->batch;
+    }
 }
 
-
-JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_posixThreads
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeSubmit
         (JNIEnv* env,
          jobject obj,
-         jint threads,
+         jint tasks,
          jint iterations){
-    // Create a POSIX thread for each worker
-    for (jint i = 0; i < threads; i++)
+    // If worker pool is not started
+    if (!gPoolStarted)
     {
-        // Thread handle
-        pthread_t thread;
+        // Throw exception
+        ThrowRuntimeException(env, "Worker pool is not started");
+        return;
+    }
 
-        // Native worker thread arguments
-        NativeWorkerArgs* nativeWorkerArgs = new NativeWorkerArgs();
-        nativeWorkerArgs->id = i;
-        nativeWorkerArgs->iterations = iterations;
+    if (tasks <= 0)
+    {
+        return;
+    }
 
-        // Create a new thread
-        int result = pthread_create(
-                &thread,
-                NULL,
-                nativeWorkerThread,
-                (void*) nativeWorkerArgs);
+    // Tasks, the pointers passed to the pool and the count of the
+    // unfinished tasks, allocated once per submit instead of per task
+    NativeWorkerTask* batch = new (std::nothrow) NativeWorkerTask[tasks];
+    WorkTask** poolTasks = new (std::nothrow) WorkTask*[tasks];
+    std::atomic<jint>* remaining = new (std::nothrow) std::atomic<jint>(tasks);
 
-        if (0 != result)
-        {
-            // Get the exception class
-            jclass exceptionClazz = env->FindClass(
-                    "java/lang/RuntimeException");
+    if ((NULL == batch) || (NULL == poolTasks) || (NULL == remaining))
+    {
+        delete[] batch;
+        delete[] poolTasks;
+        delete remaining;
 
-            // Throw exception
-            env->ThrowNew(exceptionClazz, "Unable to create thread");
-        }
+        // Throw exception
+        ThrowRuntimeException(env, "Unable to allocate tasks");
+        return;
+    }
+
+    for (jint i = 0; i < tasks; i++)
+    {
+        batch[i].task.run = NativeWorkerTaskRun;
+        batch[i].batch = batch;
+        batch[i].remaining = remaining;
+        batch[i].id = i;
+        batch[i].iterations = iterations;
+
+        poolTasks[i] = &batch[i].task;
+    }
+
+    // Hand all tasks to the pool at once
+    SubmitWork(&gPool, &gGroup, poolTasks, tasks);
+
+    delete[] poolTasks;
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_MainActivity_nativeAwait
+        (JNIEnv* env,
+         jobject obj){
+    // If worker pool is started
+    if (gPoolStarted)
+    {
+        // Wait for all submitted tasks
+        AwaitWorkGroup(&gGroup);
     }
 }
@@ -0,0 +1,311 @@
+#include "FrameCache.h"
+
+// malloc, free
+#include <stdlib.h>
+
+// memcpy
+#include <string.h>
+
+// std::vector
+#include <vector>
+
+// std::atomic
+#include <atomic>
+
+/**
+ * Cached frame, linked from the most to the least recently used.
+ */
+struct CachedFrame
+{
+	// Frame number
+	size_t index;
+
+	// More and less recently used frames
+	CachedFrame* newer;
+	CachedFrame* older;
+
+	// Frame bytes
+	char* pixels;
+};
+
+/**
+ * Frame cache handle.
+ */
+struct FrameCache
+{
+	// Cached frames by frame number, NULL if not cached
+	std::vector<CachedFrame*> slots;
+
+	// Most and least recently used frames
+	CachedFrame* newest;
+	CachedFrame* oldest;
+
+	// Frames with a buffer that are not cached, linked by older
+	CachedFrame* freeFrames;
+
+	// Memory budget and bytes of a frame
+	size_t budget;
+	size_t frameBytes;
+
+	// Frames with a buffer, cached or free
+	size_t allocatedFrames;
+
+	// Statistics, read from other threads
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> evictions;
+	std::atomic<size_t> cachedFrames;
+	std::atomic<size_t> cachedBytes;
+};
+
+/**
+ * Unlinks the given frame from the recently used list.
+ *
+ * @param cache frame cache.
+ * @param frame cached frame.
+ */
+static void UnlinkFrame(FrameCache* cache, CachedFrame* frame)
+{
+	if (NULL != frame->newer)
+	{
+		frame->newer->older = frame->older;
+	}
+	else
+	{
+		cache->newest = frame->older;
+	}
+
+	if (NULL != frame->older)
+	{
+		frame->older->newer = frame->newer;
+	}
+	else
+	{
+		cache->oldest = frame->newer;
+	}
+}
+
+/**
+ * Links the given frame as the most recently used one.
+ *
+ * @param cache frame cache.
+ * @param frame frame.
+ */
+static void LinkNewestFrame(FrameCache* cache, CachedFrame* frame)
+{
+	frame->newer = NULL;
+	frame->older = cache->newest;
+
+	if (NULL != cache->newest)
+	{
+		cache->newest->newer = frame;
+	}
+	else
+	{
+		cache->oldest = frame;
+	}
+
+	cache->newest = frame;
+}
+
+/**
+ * Removes the least recently used frame and keeps its buffer in
+ * the free frames.
+ *
+ * @param cache frame cache, not empty.
+ */
+static void EvictOldestFrame(FrameCache* cache)
+{
+	CachedFrame* frame = cache->oldest;
+
+	UnlinkFrame(cache, frame);
+	cache->slots[frame->index] = NULL;
+
+	frame->older = cache->freeFrames;
+	cache->freeFrames = frame;
+
+	cache->cachedFrames.fetch_sub(1, std::memory_order_relaxed);
+	cache->cachedBytes.fetch_sub(cache->frameBytes, std::memory_order_relaxed);
+	cache->evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Releases the buffers of the free frames.
+ *
+ * @param cache frame cache.
+ */
+static void ReleaseFreeFrames(FrameCache* cache)
+{
+	while (NULL != cache->freeFrames)
+	{
+		CachedFrame* frame = cache->freeFrames;
+		cache->freeFrames = frame->older;
+
+		free(frame->pixels);
+		delete frame;
+
+		cache->allocatedFrames--;
+	}
+}
+
+/**
+ * Gets a frame to cache, a free one, a new one while the budget
+ * allows, otherwise the least recently used one.
+ *
+ * @param cache frame cache.
+ * @return frame or NULL if none fits.
+ */
+static CachedFrame* TakeFrame(FrameCache* cache)
+{
+	if ((NULL == cache->freeFrames)
+			&& ((cache->allocatedFrames + 1) * cache->frameBytes
+					<= cache->budget))
+	{
+		char* pixels = (char*) malloc(cache->frameBytes);
+		if (NULL != pixels)
+		{
+			CachedFrame* frame = new CachedFrame();
+			frame->pixels = pixels;
+			cache->allocatedFrames++;
+
+			return frame;
+		}
+	}
+
+	if ((NULL == cache->freeFrames) && (NULL != cache->oldest))
+	{
+		EvictOldestFrame(cache);
+	}
+
+	CachedFrame* frame = cache->freeFrames;
+	if (NULL != frame)
+	{
+		cache->freeFrames = frame->older;
+	}
+
+	return frame;
+}
+
+FrameCache* NewFrameCache(size_t frameCount, size_t budget)
+{
+	FrameCache* cache = new FrameCache();
+	cache->slots.assign(frameCount, NULL);
+	cache->newest = NULL;
+	cache->oldest = NULL;
+	cache->freeFrames = NULL;
+	cache->budget = budget;
+	cache->frameBytes = 0;
+	cache->allocatedFrames = 0;
+	cache->hits.store(0, std::memory_order_relaxed);
+	cache->misses.store(0, std::memory_order_relaxed);
+	cache->evictions.store(0, std::memory_order_relaxed);
+	cache->cachedFrames.store(0, std::memory_order_relaxed);
+	cache->cachedBytes.store(0, std::memory_order_relaxed);
+
+	return cache;
+}
+
+void SetFrameCacheBudget(FrameCache* cache, size_t budget)
+{
+	cache->budget = budget;
+
+	// Free buffers go first, then the least recently used frames
+	while (cache->allocatedFrames * cache->frameBytes > budget)
+	{
+		if (NULL == cache->freeFrames)
+		{
+			EvictOldestFrame(cache);
+		}
+
+		CachedFrame* frame = cache->freeFrames;
+		cache->freeFrames = frame->older;
+
+		free(frame->pixels);
+		delete frame;
+
+		cache->allocatedFrames--;
+	}
+}
+
+void ResetFrameCache(FrameCache* cache, size_t frameBytes)
+{
+	while (NULL != cache->newest)
+	{
+		CachedFrame* frame = cache->newest;
+
+		UnlinkFrame(cache, frame);
+		cache->slots[frame->index] = NULL;
+
+		frame->older = cache->freeFrames;
+		cache->freeFrames = frame;
+	}
+
+	cache->cachedFrames.store(0, std::memory_order_relaxed);
+	cache->cachedBytes.store(0, std::memory_order_relaxed);
+
+	// Buffers of another size are of no use
+	if (frameBytes != cache->frameBytes)
+	{
+		ReleaseFreeFrames(cache);
+		cache->frameBytes = frameBytes;
+	}
+}
+
+const char* FindCachedFrame(FrameCache* cache, size_t index)
+{
+	CachedFrame* frame = (index < cache->slots.size())
+			? cache->slots[index] : NULL;
+
+	if (NULL == frame)
+	{
+		cache->misses.fetch_add(1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	cache->hits.fetch_add(1, std::memory_order_relaxed);
+
+	if (cache->newest != frame)
+	{
+		UnlinkFrame(cache, frame);
+		LinkNewestFrame(cache, frame);
+	}
+
+	return frame->pixels;
+}
+
+void AddCachedFrame(FrameCache* cache, size_t index, const char* pixels)
+{
+	if ((index >= cache->slots.size()) || (0 == cache->frameBytes))
+		return;
+
+	CachedFrame* frame = TakeFrame(cache);
+	if (NULL == frame)
+		return;
+
+	memcpy(frame->pixels, pixels, cache->frameBytes);
+	frame->index = index;
+
+	LinkNewestFrame(cache, frame);
+	cache->slots[index] = frame;
+
+	cache->cachedFrames.fetch_add(1, std::memory_order_relaxed);
+	cache->cachedBytes.fetch_add(cache->frameBytes, std::memory_order_relaxed);
+}
+
+void GetFrameCacheStats(const FrameCache* cache, FrameCacheStats* stats)
+{
+	stats->hits = cache->hits.load(std::memory_order_relaxed);
+	stats->misses = cache->misses.load(std::memory_order_relaxed);
+	stats->evictions = cache->evictions.load(std::memory_order_relaxed);
+	stats->frames = cache->cachedFrames.load(std::memory_order_relaxed);
+	stats->bytes = cache->cachedBytes.load(std::memory_order_relaxed);
+}
+
+void FreeFrameCache(FrameCache* cache)
+{
+	if (NULL != cache)
+	{
+		ResetFrameCache(cache, 0);
+		delete cache;
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+// size_t
+#include <stddef.h>
+
+// uint64_t
+#include <stdint.h>
+
+/**
+ * Counters and usage of a frame cache.
+ */
+struct FrameCacheStats
+{
+	// Lookups that found the frame
+	uint64_t hits;
+
+	// Lookups that did not
+	uint64_t misses;
+
+	// Frames dropped to stay in the budget
+	uint64_t evictions;
+
+	// Frames cached and their bytes
+	size_t frames;
+	size_t bytes;
+};
+
+/*
+ * A frame cache keeps converted frames by their frame number, up
+ * to a memory budget, and evicts the least recently used frames
+ * when it is full. Frames are found in O(1) through a table of all
+ * frame numbers of the video. The buffers of evicted frames are
+ * reused, new ones are only allocated until the budget is used.
+ * Only the statistics are safe to read from another thread.
+ */
+
+/**
+ * Frame cache handle.
+ */
+struct FrameCache;
+
+/**
+ * Constructs an empty frame cache.
+ *
+ * @param frameCount number of frames of the video.
+ * @param budget memory budget in bytes.
+ * @return frame cache.
+ */
+FrameCache* NewFrameCache(size_t frameCount, size_t budget);
+
+/**
+ * Changes the memory budget, evicting the least recently used
+ * frames and releasing buffers until the cache fits.
+ *
+ * @param cache frame cache.
+ * @param budget memory budget in bytes, zero disables the cache.
+ */
+void SetFrameCacheBudget(FrameCache* cache, size_t budget);
+
+/**
+ * Drops all frames, for frames of the given size. Buffers are
+ * kept if the size does not change. The counters are kept.
+ *
+ * @param cache frame cache.
+ * @param frameBytes bytes of a frame.
+ */
+void ResetFrameCache(FrameCache* cache, size_t frameBytes);
+
+/**
+ * Finds the given frame and makes it the most recently used one.
+ * Counts a hit or a miss.
+ *
+ * @param cache frame cache.
+ * @param index frame number.
+ * @return frame bytes, valid until the next frame is added, or
+ *         NULL if not cached.
+ */
+const char* FindCachedFrame(FrameCache* cache, size_t index);
+
+/**
+ * Copies the given frame into the cache as the most recently used
+ * one, evicting the least recently used frame if the budget is
+ * used. Nothing is cached if a frame does not fit into the budget.
+ *
+ * @param cache frame cache.
+ * @param index frame number, not cached.
+ * @param pixels frame bytes.
+ */
+void AddCachedFrame(FrameCache* cache, size_t index, const char* pixels);
+
+/**
+ * Gets the counters and usage of the cache, from any thread.
+ *
+ * @param cache frame cache.
+ * @param stats statistics.
+ */
+void GetFrameCacheStats(const FrameCache* cache, FrameCacheStats* stats);
+
+/**
+ * Releases the frames and the cache.
+ *
+ * @param cache frame cache, may be NULL.
+ */
+void FreeFrameCache(FrameCache* cache);
+
+#endif
@@ -0,0 +1,362 @@
+#include "PixelConverter.h"
+#include "PixelKernels.h"
+
+// memcpy
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+// __get_cpuid, __cpuid_count
+#include <cpuid.h>
+#endif
+
+#if defined(__arm__)
+// getauxval
+#include <sys/auxv.h>
+
+// NEON bit of the hardware capabilities
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+/**
+ * Clamps the given value to a byte.
+ *
+ * @param value value.
+ * @return clamped value.
+ */
+static inline uint8_t ClampPixel(int value)
+{
+	return (value < 0) ? 0 : ((value > 255) ? 255 : (uint8_t) value);
+}
+
+/**
+ * Packs the given components into an RGB565 pixel, truncating them.
+ *
+ * @param r red.
+ * @param g green.
+ * @param b blue.
+ * @return pixel.
+ */
+static inline uint16_t PackRgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return (uint16_t) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+/**
+ * Converts a YUV pixel to RGB.
+ *
+ * @param y luma.
+ * @param u blue difference.
+ * @param v red difference.
+ * @param rgb red, green and blue.
+ */
+static inline void ConvertYuvPixel(
+		uint8_t y,
+		uint8_t u,
+		uint8_t v,
+		uint8_t* rgb)
+{
+	int luma = (int) (((uint32_t) y * 0x0101 * YUV_Y_SCALE) >> 16)
+			+ YUV_Y_BIAS;
+	int d = u - 128;
+	int e = v - 128;
+
+	rgb[0] = ClampPixel((luma + (YUV_V_TO_R * e)) >> YUV_SHIFT);
+	rgb[1] = ClampPixel(
+			(luma - ((YUV_U_TO_G * d) + (YUV_V_TO_G * e))) >> YUV_SHIFT);
+	rgb[2] = ClampPixel((luma + (YUV_U_TO_B * d)) >> YUV_SHIFT);
+}
+
+void ConvertBgr24ToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t width)
+{
+	for (size_t x = 0; x < width; x++, src += 3, dst += 4)
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = 255;
+	}
+}
+
+void ConvertBgr24ToRgb565Scalar(
+		const uint8_t* src,
+		uint16_t* dst,
+		size_t width)
+{
+	for (size_t x = 0; x < width; x++, src += 3)
+	{
+		dst[x] = PackRgb565(src[2], src[1], src[0]);
+	}
+}
+
+void ConvertRgb565ToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t width)
+{
+	for (size_t x = 0; x < width; x++, src += 2, dst += 4)
+	{
+		// Little endian in the files
+		unsigned pixel = src[0] | (src[1] << 8);
+		unsigned r = pixel >> 11;
+		unsigned g = (pixel >> 5) & 0x3F;
+		unsigned b = pixel & 0x1F;
+
+		// High bits are replicated, full intensity stays full
+		dst[0] = (uint8_t) ((r << 3) | (r >> 2));
+		dst[1] = (uint8_t) ((g << 2) | (g >> 4));
+		dst[2] = (uint8_t) ((b << 3) | (b >> 2));
+		dst[3] = 255;
+	}
+}
+
+void ConvertI420ToRgbaScalar(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8_t* dst,
+		size_t width)
+{
+	for (size_t x = 0; x < width; x++, dst += 4)
+	{
+		ConvertYuvPixel(y[x], u[x / 2], v[x / 2], dst);
+		dst[3] = 255;
+	}
+}
+
+void ConvertI420ToRgb565Scalar(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint16_t* dst,
+		size_t width)
+{
+	uint8_t rgb[3];
+
+	for (size_t x = 0; x < width; x++)
+	{
+		ConvertYuvPixel(y[x], u[x / 2], v[x / 2], rgb);
+		dst[x] = PackRgb565(rgb[0], rgb[1], rgb[2]);
+	}
+}
+
+static const PixelKernels gScalarPixelKernels =
+{
+	ConvertBgr24ToRgbaScalar,
+	ConvertBgr24ToRgb565Scalar,
+	ConvertRgb565ToRgbaScalar,
+	ConvertI420ToRgbaScalar,
+	ConvertI420ToRgb565Scalar,
+};
+
+#if defined(__i386__) || defined(__x86_64__)
+/**
+ * Checks if the CPU supports SSE4.1.
+ *
+ * @return true if supported.
+ */
+static bool HasSse41()
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx)
+			&& (0 != (ecx & bit_SSE4_1));
+}
+
+/**
+ * Checks if the CPU supports AVX2 and the system saves the YMM
+ * registers.
+ *
+ * @return true if supported.
+ */
+static bool HasAvx2()
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+			|| (0 == (ecx & bit_OSXSAVE)) || (0 == (ecx & bit_AVX)))
+		return false;
+
+	// XMM and YMM state enabled in XCR0
+	unsigned int xcr0, xcr0High;
+	__asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0High) : "c" (0));
+	if (0x6 != (xcr0 & 0x6))
+		return false;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+	return 0 != (ebx & bit_AVX2);
+}
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+/**
+ * Checks if the CPU supports NEON, always the case on ARMv8.
+ *
+ * @return true if supported.
+ */
+static bool HasNeon()
+{
+#if defined(__aarch64__)
+	return true;
+#else
+	return 0 != (getauxval(AT_HWCAP) & HWCAP_NEON);
+#endif
+}
+#endif
+
+bool IsPixelIsaSupported(PixelIsa isa)
+{
+	switch (isa)
+	{
+	case PIXEL_ISA_SCALAR:
+		return true;
+
+#if defined(__i386__) || defined(__x86_64__)
+	case PIXEL_ISA_SSE41:
+		return HasSse41();
+
+	case PIXEL_ISA_AVX2:
+		return HasAvx2();
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+	case PIXEL_ISA_NEON:
+		return HasNeon();
+#endif
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Detects the fastest instruction set supported by the CPU.
+ *
+ * @return instruction set.
+ */
+static PixelIsa DetectBestPixelIsa()
+{
+	static const PixelIsa isas[] =
+	{
+		PIXEL_ISA_AVX2,
+		PIXEL_ISA_SSE41,
+		PIXEL_ISA_NEON,
+	};
+
+	for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++)
+	{
+		if (IsPixelIsaSupported(isas[i]))
+			return isas[i];
+	}
+
+	return PIXEL_ISA_SCALAR;
+}
+
+PixelIsa GetBestPixelIsa()
+{
+	// Detected once, thread safe
+	static const PixelIsa bestIsa = DetectBestPixelIsa();
+
+	return bestIsa;
+}
+
+/**
+ * Gets the kernels of the given instruction set.
+ *
+ * @param isa instruction set.
+ * @return kernels, the scalar ones if not built.
+ */
+static const PixelKernels* GetPixelKernels(PixelIsa isa)
+{
+	switch (isa)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+	case PIXEL_ISA_SSE41:
+		return GetSse41PixelKernels();
+
+	case PIXEL_ISA_AVX2:
+		return GetAvx2PixelKernels();
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+	case PIXEL_ISA_NEON:
+		return GetNeonPixelKernels();
+#endif
+
+	default:
+		return &gScalarPixelKernels;
+	}
+}
+
+void ConvertVideoFrame(
+		const VideoFormat* format,
+		const char* frame,
+		const VideoBitmap* bitmap,
+		PixelIsa isa)
+{
+	const PixelKernels* kernels = GetPixelKernels(isa);
+	const uint8_t* data = (const uint8_t*) frame;
+
+	size_t width = (size_t) ((format->width < bitmap->width)
+			? format->width : bitmap->width);
+	int height = (format->height < bitmap->height)
+			? format->height : bitmap->height;
+
+	// Chroma planes follow the luma plane
+	size_t chromaStride = ((size_t) format->width + 1) / 2;
+	const uint8_t* uPlane = data + (format->stride * format->height);
+	const uint8_t* vPlane = uPlane
+			+ (chromaStride * ((format->height + 1) / 2));
+
+	for (int row = 0; row < height; row++)
+	{
+		uint8_t* dst = (uint8_t*) bitmap->pixels + (row * bitmap->stride);
+
+		// Bottom up frames are flipped
+		int frameRow = format->bottomUp ? (format->height - 1 - row) : row;
+		const uint8_t* src = data + (frameRow * format->stride);
+
+		switch (format->pixelFormat)
+		{
+		case VIDEO_FORMAT_BGR24:
+			if (BITMAP_FORMAT_RGBA_8888 == bitmap->format)
+			{
+				kernels->bgr24ToRgba(src, dst, width);
+			}
+			else
+			{
+				kernels->bgr24ToRgb565(src, (uint16_t*) dst, width);
+			}
+			break;
+
+		case VIDEO_FORMAT_RGB565:
+			if (BITMAP_FORMAT_RGBA_8888 == bitmap->format)
+			{
+				kernels->rgb565ToRgba(src, dst, width);
+			}
+			else
+			{
+				memcpy(dst, src, width * 2);
+			}
+			break;
+
+		case VIDEO_FORMAT_I420:
+			{
+				const uint8_t* u = uPlane + ((frameRow / 2) * chromaStride);
+				const uint8_t* v = vPlane + ((frameRow / 2) * chromaStride);
+
+				if (BITMAP_FORMAT_RGBA_8888 == bitmap->format)
+				{
+					kernels->i420ToRgba(src, u, v, dst, width);
+				}
+				else
+				{
+					kernels->i420ToRgb565(src, u, v, (uint16_t*) dst, width);
+				}
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef PIXEL_CONVERTER_H
+#define PIXEL_CONVERTER_H
+
+#include "VideoFile.h"
+
+// size_t
+#include <stddef.h>
+
+/**
+ * Pixel formats of the bitmaps, the values of the Android bitmap
+ * formats.
+ */
+enum BitmapFormat
+{
+	// Red, green, blue and alpha bytes
+	BITMAP_FORMAT_RGBA_8888 = 1,
+
+	// Native endian 16 bit pixels, 5 bits red, 6 green and 5 blue
+	BITMAP_FORMAT_RGB_565 = 4
+};
+
+/**
+ * Bitmap the frames are converted into.
+ */
+struct VideoBitmap
+{
+	// Size in pixels
+	int width;
+	int height;
+
+	// Bytes per row
+	size_t stride;
+
+	BitmapFormat format;
+
+	// Top row
+	void* pixels;
+};
+
+/**
+ * Instruction sets of the conversion kernels.
+ */
+enum PixelIsa
+{
+	PIXEL_ISA_SCALAR,
+	PIXEL_ISA_SSE41,
+	PIXEL_ISA_AVX2,
+	PIXEL_ISA_NEON,
+
+	PIXEL_ISA_COUNT
+};
+
+/*
+ * Each conversion is defined by the scalar kernels, the SIMD
+ * kernels give the same pixels bit for bit. YUV frames are
+ * converted with the BT.601 limited range coefficients in 6 bit
+ * fixed point, RGB565 is expanded by replicating the high bits and
+ * reduced by truncating.
+ */
+
+/**
+ * Checks if the kernels of the given instruction set are built
+ * and supported by the CPU.
+ *
+ * @param isa instruction set.
+ * @return true if the kernels can run.
+ */
+bool IsPixelIsaSupported(PixelIsa isa);
+
+/**
+ * Gets the fastest instruction set supported by the CPU, detected
+ * on first call.
+ *
+ * @return instruction set.
+ */
+PixelIsa GetBestPixelIsa();
+
+/**
+ * Converts the given frame into the bitmap, top row first. Only
+ * the area of both sizes is converted, other pixels and the row
+ * padding of the bitmap are left as they are.
+ *
+ * @param format frame format.
+ * @param frame frame data, not aligned.
+ * @param bitmap destination bitmap.
+ * @param isa instruction set, supported by the CPU.
+ */
+void ConvertVideoFrame(
+		const VideoFormat* format,
+		const char* frame,
+		const VideoBitmap* bitmap,
+		PixelIsa isa);
+
+#endif
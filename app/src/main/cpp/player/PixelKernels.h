@@ -0,0 +1,97 @@
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+// size_t
+#include <stddef.h>
+
+// uint8_t, uint16_t
+#include <stdint.h>
+
+/*
+ * BT.601 limited range YUV to RGB in 6 bit fixed point. The luma
+ * is scaled as y * 257 by a 16 bit high multiply, which keeps all
+ * of the terms in 16 bits. The SIMD kernels saturate the sums, the
+ * saturated values are beyond 255 after the shift anyway.
+ */
+
+// 1.164 * 64 * 65536 / 257
+#define YUV_Y_SCALE 18997
+
+// 1.164 * 64 * -16, plus the rounding of the shift
+#define YUV_Y_BIAS (-1160)
+
+// 1.596 * 64, 0.391 * 64, 0.813 * 64 and 2.018 * 64
+#define YUV_V_TO_R 102
+#define YUV_U_TO_G 25
+#define YUV_V_TO_G 52
+#define YUV_U_TO_B 129
+
+#define YUV_SHIFT 6
+
+/**
+ * Row conversion kernels of an instruction set. Rows are not
+ * aligned and their width is in pixels. YUV rows start at an even
+ * pixel, their chroma rows have a sample for each pixel pair.
+ */
+struct PixelKernels
+{
+	void (*bgr24ToRgba)(const uint8_t* src, uint8_t* dst, size_t width);
+	void (*bgr24ToRgb565)(const uint8_t* src, uint16_t* dst, size_t width);
+	void (*rgb565ToRgba)(const uint8_t* src, uint8_t* dst, size_t width);
+	void (*i420ToRgba)(
+			const uint8_t* y,
+			const uint8_t* u,
+			const uint8_t* v,
+			uint8_t* dst,
+			size_t width);
+	void (*i420ToRgb565)(
+			const uint8_t* y,
+			const uint8_t* u,
+			const uint8_t* v,
+			uint16_t* dst,
+			size_t width);
+};
+
+/*
+ * Scalar kernels, defining the conversions. The SIMD kernels call
+ * them for the pixels after their last full vector.
+ */
+
+void ConvertBgr24ToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t width);
+
+void ConvertBgr24ToRgb565Scalar(
+		const uint8_t* src,
+		uint16_t* dst,
+		size_t width);
+
+void ConvertRgb565ToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t width);
+
+void ConvertI420ToRgbaScalar(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8_t* dst,
+		size_t width);
+
+void ConvertI420ToRgb565Scalar(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint16_t* dst,
+		size_t width);
+
+/*
+ * SIMD kernels, each built with the compiler flags of its
+ * instruction set on the matching architectures only.
+ */
+
+#if defined(__i386__) || defined(__x86_64__)
+const PixelKernels* GetSse41PixelKernels();
+const PixelKernels* GetAvx2PixelKernels();
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+const PixelKernels* GetNeonPixelKernels();
+#endif
+
+#endif
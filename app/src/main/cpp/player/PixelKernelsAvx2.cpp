@@ -0,0 +1,278 @@
+#include "PixelKernels.h"
+
+// AVX2
+#include <immintrin.h>
+
+/*
+ * Built with -mavx2, only called once the CPU support is checked.
+ * Most instructions work on the two 128 bit lanes separately, the
+ * interleaved results are put back in pixel order by permutes.
+ */
+
+/**
+ * Loads eight BGR pixels, four in each lane.
+ *
+ * @param src BGR pixels, with four more bytes readable.
+ * @return BGR pixels.
+ */
+static inline __m256i LoadBgr24(const uint8_t* src)
+{
+	__m128i low = _mm_loadu_si128((const __m128i*) src);
+	__m128i high = _mm_loadu_si128((const __m128i*) (src + 12));
+
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+/**
+ * Shuffles eight BGR pixels, four in each lane, into RGB with a
+ * zero alpha byte.
+ *
+ * @param bgr BGR pixels.
+ * @return RGB pixels.
+ */
+static inline __m256i ShuffleBgr24(__m256i bgr)
+{
+	const __m256i order = _mm256_setr_epi8(
+			2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+			2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+
+	return _mm256_shuffle_epi8(bgr, order);
+}
+
+/**
+ * Packs the components of RGB pixels with a zero alpha byte into
+ * RGB565, in the low 16 bits of each.
+ *
+ * @param rgb RGB pixels.
+ * @return RGB565 pixels.
+ */
+static inline __m256i PackRgb565(__m256i rgb)
+{
+	__m256i r = _mm256_slli_epi32(
+			_mm256_and_si256(rgb, _mm256_set1_epi32(0xF8)), 8);
+	__m256i g = _mm256_srli_epi32(
+			_mm256_and_si256(rgb, _mm256_set1_epi32(0xFC00)), 5);
+	__m256i b = _mm256_srli_epi32(
+			_mm256_and_si256(rgb, _mm256_set1_epi32(0xF80000)), 19);
+
+	return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+/**
+ * Stores sixteen pixels interleaved from their red and green and
+ * their blue and alpha bytes.
+ *
+ * @param dst RGBA pixels.
+ * @param rg red and green bytes of each pixel.
+ * @param ba blue and alpha bytes of each pixel.
+ */
+static inline void StoreRgba(uint8_t* dst, __m256i rg, __m256i ba)
+{
+	// Pixels 0 to 3 and 8 to 11, then 4 to 7 and 12 to 15
+	__m256i low = _mm256_unpacklo_epi16(rg, ba);
+	__m256i high = _mm256_unpackhi_epi16(rg, ba);
+
+	_mm256_storeu_si256((__m256i*) dst,
+			_mm256_permute2x128_si256(low, high, 0x20));
+	_mm256_storeu_si256((__m256i*) (dst + 32),
+			_mm256_permute2x128_si256(low, high, 0x31));
+}
+
+/**
+ * Converts sixteen YUV pixels to RGB, unclamped.
+ *
+ * @param y sixteen luma bytes.
+ * @param u eight blue difference bytes.
+ * @param v eight red difference bytes.
+ * @param r red.
+ * @param g green.
+ * @param b blue.
+ */
+static inline void ConvertYuv(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		__m256i* r,
+		__m256i* g,
+		__m256i* b)
+{
+	// Luma as y * 257
+	__m256i luma = _mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i*) y));
+	luma = _mm256_or_si256(luma, _mm256_slli_epi16(luma, 8));
+	luma = _mm256_add_epi16(
+			_mm256_mulhi_epu16(luma, _mm256_set1_epi16(YUV_Y_SCALE)),
+			_mm256_set1_epi16(YUV_Y_BIAS));
+
+	// A chroma sample for each pixel pair
+	__m128i d8 = _mm_sub_epi16(
+			_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) u)),
+			_mm_set1_epi16(128));
+	__m128i e8 = _mm_sub_epi16(
+			_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) v)),
+			_mm_set1_epi16(128));
+	__m256i d = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_unpacklo_epi16(d8, d8)),
+			_mm_unpackhi_epi16(d8, d8), 1);
+	__m256i e = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_unpacklo_epi16(e8, e8)),
+			_mm_unpackhi_epi16(e8, e8), 1);
+
+	*r = _mm256_srai_epi16(_mm256_adds_epi16(luma,
+			_mm256_mullo_epi16(e, _mm256_set1_epi16(YUV_V_TO_R))), YUV_SHIFT);
+	*g = _mm256_srai_epi16(_mm256_subs_epi16(luma, _mm256_add_epi16(
+			_mm256_mullo_epi16(d, _mm256_set1_epi16(YUV_U_TO_G)),
+			_mm256_mullo_epi16(e, _mm256_set1_epi16(YUV_V_TO_G)))), YUV_SHIFT);
+	*b = _mm256_srai_epi16(_mm256_adds_epi16(luma,
+			_mm256_mullo_epi16(d, _mm256_set1_epi16(YUV_U_TO_B))), YUV_SHIFT);
+}
+
+static void ConvertBgr24ToRgbaAvx2(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+	size_t x = 0;
+
+	// Eight pixels a step, the loads need ten of them
+	for (; x + 10 <= width; x += 8)
+	{
+		_mm256_storeu_si256((__m256i*) (dst + (x * 4)), _mm256_or_si256(
+				ShuffleBgr24(LoadBgr24(src + (x * 3))), alpha));
+	}
+
+	ConvertBgr24ToRgbaScalar(src + (x * 3), dst + (x * 4), width - x);
+}
+
+static void ConvertBgr24ToRgb565Avx2(
+		const uint8_t* src,
+		uint16_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	// Sixteen pixels a step, the loads need eighteen of them
+	for (; x + 18 <= width; x += 16)
+	{
+		__m256i low = PackRgb565(ShuffleBgr24(LoadBgr24(src + (x * 3))));
+		__m256i high = PackRgb565(ShuffleBgr24(LoadBgr24(src + (x * 3) + 24)));
+
+		// Packed lane by lane, pixels 0 to 3, 8 to 11, 4 to 7, 12 to 15
+		__m256i pixels = _mm256_permute4x64_epi64(
+				_mm256_packus_epi32(low, high), 0xD8);
+
+		_mm256_storeu_si256((__m256i*) (dst + x), pixels);
+	}
+
+	ConvertBgr24ToRgb565Scalar(src + (x * 3), dst + x, width - x);
+}
+
+static void ConvertRgb565ToRgbaAvx2(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i pixels = _mm256_loadu_si256((const __m256i*) (src + (x * 2)));
+
+		__m256i r = _mm256_srli_epi16(pixels, 11);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5),
+				_mm256_set1_epi16(0x3F));
+		__m256i b = _mm256_and_si256(pixels, _mm256_set1_epi16(0x1F));
+
+		r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+		g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+		b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+		StoreRgba(dst + (x * 4),
+				_mm256_or_si256(r, _mm256_slli_epi16(g, 8)),
+				_mm256_or_si256(b, _mm256_set1_epi16((short) 0xFF00)));
+	}
+
+	ConvertRgb565ToRgbaScalar(src + (x * 2), dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgbaAvx2(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8_t* dst,
+		size_t width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi16(255);
+	size_t x = 0;
+
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i r;
+		__m256i g;
+		__m256i b;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2), &r, &g, &b);
+
+		r = _mm256_min_epi16(_mm256_max_epi16(r, zero), full);
+		g = _mm256_min_epi16(_mm256_max_epi16(g, zero), full);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), full);
+
+		StoreRgba(dst + (x * 4),
+				_mm256_or_si256(r, _mm256_slli_epi16(g, 8)),
+				_mm256_or_si256(b, _mm256_set1_epi16((short) 0xFF00)));
+	}
+
+	ConvertI420ToRgbaScalar(y + x, u + (x / 2), v + (x / 2),
+			dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgb565Avx2(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint16_t* dst,
+		size_t width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi16(255);
+	size_t x = 0;
+
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i r;
+		__m256i g;
+		__m256i b;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2), &r, &g, &b);
+
+		r = _mm256_min_epi16(_mm256_max_epi16(r, zero), full);
+		g = _mm256_min_epi16(_mm256_max_epi16(g, zero), full);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), full);
+
+		__m256i pixels = _mm256_or_si256(_mm256_or_si256(
+				_mm256_slli_epi16(
+						_mm256_and_si256(r, _mm256_set1_epi16(0xF8)), 8),
+				_mm256_slli_epi16(
+						_mm256_and_si256(g, _mm256_set1_epi16(0xFC)), 3)),
+				_mm256_srli_epi16(b, 3));
+
+		_mm256_storeu_si256((__m256i*) (dst + x), pixels);
+	}
+
+	ConvertI420ToRgb565Scalar(y + x, u + (x / 2), v + (x / 2),
+			dst + x, width - x);
+}
+
+static const PixelKernels gAvx2PixelKernels =
+{
+	ConvertBgr24ToRgbaAvx2,
+	ConvertBgr24ToRgb565Avx2,
+	ConvertRgb565ToRgbaAvx2,
+	ConvertI420ToRgbaAvx2,
+	ConvertI420ToRgb565Avx2,
+};
+
+const PixelKernels* GetAvx2PixelKernels()
+{
+	return &gAvx2PixelKernels;
+}
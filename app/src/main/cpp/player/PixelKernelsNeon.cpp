@@ -0,0 +1,207 @@
+#include "PixelKernels.h"
+
+// memcpy
+#include <string.h>
+
+// NEON
+#include <arm_neon.h>
+
+/*
+ * Built with NEON enabled, on ARMv7 only called once the CPU
+ * support is checked.
+ */
+
+/**
+ * Packs eight pixels into RGB565, truncating the components.
+ *
+ * @param r red.
+ * @param g green.
+ * @param b blue.
+ * @return RGB565 pixels.
+ */
+static inline uint16x8_t PackRgb565(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t pixels = vshll_n_u8(vand_u8(r, vdup_n_u8(0xF8)), 8);
+	pixels = vorrq_u16(pixels, vshll_n_u8(vand_u8(g, vdup_n_u8(0xFC)), 3));
+
+	return vorrq_u16(pixels, vmovl_u8(vshr_n_u8(b, 3)));
+}
+
+/**
+ * Converts eight YUV pixels to RGB, clamped by the saturating
+ * narrowing shifts.
+ *
+ * @param y eight luma bytes.
+ * @param u four blue difference bytes.
+ * @param v four red difference bytes.
+ * @param r red.
+ * @param g green.
+ * @param b blue.
+ */
+static inline void ConvertYuv(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8x8_t* r,
+		uint8x8_t* g,
+		uint8x8_t* b)
+{
+	uint32_t u4;
+	uint32_t v4;
+	memcpy(&u4, u, sizeof(u4));
+	memcpy(&v4, v, sizeof(v4));
+
+	// Luma as y * 257, high half of the 32 bit products
+	uint8x8_t y8 = vld1_u8(y);
+	uint16x8_t y16 = vorrq_u16(vmovl_u8(y8), vshll_n_u8(y8, 8));
+	uint16x4_t scale = vdup_n_u16(YUV_Y_SCALE);
+	uint16x8_t scaled = vcombine_u16(
+			vshrn_n_u32(vmull_u16(vget_low_u16(y16), scale), 16),
+			vshrn_n_u32(vmull_u16(vget_high_u16(y16), scale), 16));
+	int16x8_t luma = vaddq_s16(vreinterpretq_s16_u16(scaled),
+			vdupq_n_s16(YUV_Y_BIAS));
+
+	// A chroma sample for each pixel pair
+	uint8x8_t u8 = vreinterpret_u8_u32(vdup_n_u32(u4));
+	uint8x8_t v8 = vreinterpret_u8_u32(vdup_n_u32(v4));
+	u8 = vzip_u8(u8, u8).val[0];
+	v8 = vzip_u8(v8, v8).val[0];
+	int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)),
+			vdupq_n_s16(128));
+	int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)),
+			vdupq_n_s16(128));
+
+	*r = vqshrun_n_s16(vqaddq_s16(luma,
+			vmulq_n_s16(e, YUV_V_TO_R)), YUV_SHIFT);
+	*g = vqshrun_n_s16(vqsubq_s16(luma, vaddq_s16(
+			vmulq_n_s16(d, YUV_U_TO_G),
+			vmulq_n_s16(e, YUV_V_TO_G))), YUV_SHIFT);
+	*b = vqshrun_n_s16(vqaddq_s16(luma,
+			vmulq_n_s16(d, YUV_U_TO_B)), YUV_SHIFT);
+}
+
+static void ConvertBgr24ToRgbaNeon(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 16 <= width; x += 16)
+	{
+		uint8x16x3_t bgr = vld3q_u8(src + (x * 3));
+		uint8x16x4_t rgba;
+		rgba.val[0] = bgr.val[2];
+		rgba.val[1] = bgr.val[1];
+		rgba.val[2] = bgr.val[0];
+		rgba.val[3] = vdupq_n_u8(255);
+
+		vst4q_u8(dst + (x * 4), rgba);
+	}
+
+	ConvertBgr24ToRgbaScalar(src + (x * 3), dst + (x * 4), width - x);
+}
+
+static void ConvertBgr24ToRgb565Neon(
+		const uint8_t* src,
+		uint16_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		uint8x8x3_t bgr = vld3_u8(src + (x * 3));
+
+		vst1q_u16(dst + x, PackRgb565(bgr.val[2], bgr.val[1], bgr.val[0]));
+	}
+
+	ConvertBgr24ToRgb565Scalar(src + (x * 3), dst + x, width - x);
+}
+
+static void ConvertRgb565ToRgbaNeon(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		uint16x8_t pixels = vreinterpretq_u16_u8(vld1q_u8(src + (x * 2)));
+
+		uint8x8_t r = vshrn_n_u16(pixels, 11);
+		uint8x8_t g = vand_u8(vshrn_n_u16(pixels, 5), vdup_n_u8(0x3F));
+		uint8x8_t b = vand_u8(vmovn_u16(pixels), vdup_n_u8(0x1F));
+
+		uint8x8x4_t rgba;
+		rgba.val[0] = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+		rgba.val[1] = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+		rgba.val[2] = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+		rgba.val[3] = vdup_n_u8(255);
+
+		vst4_u8(dst + (x * 4), rgba);
+	}
+
+	ConvertRgb565ToRgbaScalar(src + (x * 2), dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgbaNeon(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		uint8x8x4_t rgba;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2),
+				&rgba.val[0], &rgba.val[1], &rgba.val[2]);
+		rgba.val[3] = vdup_n_u8(255);
+
+		vst4_u8(dst + (x * 4), rgba);
+	}
+
+	ConvertI420ToRgbaScalar(y + x, u + (x / 2), v + (x / 2),
+			dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgb565Neon(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint16_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		uint8x8_t r;
+		uint8x8_t g;
+		uint8x8_t b;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2), &r, &g, &b);
+
+		vst1q_u16(dst + x, PackRgb565(r, g, b));
+	}
+
+	ConvertI420ToRgb565Scalar(y + x, u + (x / 2), v + (x / 2),
+			dst + x, width - x);
+}
+
+static const PixelKernels gNeonPixelKernels =
+{
+	ConvertBgr24ToRgbaNeon,
+	ConvertBgr24ToRgb565Neon,
+	ConvertRgb565ToRgbaNeon,
+	ConvertI420ToRgbaNeon,
+	ConvertI420ToRgb565Neon,
+};
+
+const PixelKernels* GetNeonPixelKernels()
+{
+	return &gNeonPixelKernels;
+}
@@ -0,0 +1,252 @@
+#include "PixelKernels.h"
+
+// memcpy
+#include <string.h>
+
+// SSE4.1
+#include <smmintrin.h>
+
+/*
+ * Built with -msse4.1, only called once the CPU support is checked.
+ */
+
+/**
+ * Shuffles four BGR pixels into RGB with a zero alpha byte.
+ *
+ * @param bgr twelve BGR bytes and four ignored ones.
+ * @return RGB pixels.
+ */
+static inline __m128i ShuffleBgr24(__m128i bgr)
+{
+	const __m128i order = _mm_setr_epi8(
+			2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+
+	return _mm_shuffle_epi8(bgr, order);
+}
+
+/**
+ * Packs the components of RGB pixels with a zero alpha byte into
+ * RGB565, in the low 16 bits of each.
+ *
+ * @param rgb RGB pixels.
+ * @return RGB565 pixels.
+ */
+static inline __m128i PackRgb565(__m128i rgb)
+{
+	__m128i r = _mm_slli_epi32(_mm_and_si128(rgb, _mm_set1_epi32(0xF8)), 8);
+	__m128i g = _mm_srli_epi32(_mm_and_si128(rgb, _mm_set1_epi32(0xFC00)), 5);
+	__m128i b = _mm_srli_epi32(_mm_and_si128(rgb, _mm_set1_epi32(0xF80000)), 19);
+
+	return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+/**
+ * Expands the components of eight RGB565 pixels to bytes.
+ *
+ * @param pixels RGB565 pixels.
+ * @param rg red and green bytes of each pixel.
+ * @param ba blue and alpha bytes of each pixel.
+ */
+static inline void ExpandRgb565(__m128i pixels, __m128i* rg, __m128i* ba)
+{
+	__m128i r = _mm_srli_epi16(pixels, 11);
+	__m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 5), _mm_set1_epi16(0x3F));
+	__m128i b = _mm_and_si128(pixels, _mm_set1_epi16(0x1F));
+
+	r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+	g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+	b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+	*rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+	*ba = _mm_or_si128(b, _mm_set1_epi16((short) 0xFF00));
+}
+
+/**
+ * Converts eight YUV pixels to RGB, unclamped.
+ *
+ * @param y eight luma bytes.
+ * @param u four blue difference bytes.
+ * @param v four red difference bytes.
+ * @param r red.
+ * @param g green.
+ * @param b blue.
+ */
+static inline void ConvertYuv(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		__m128i* r,
+		__m128i* g,
+		__m128i* b)
+{
+	int32_t u4;
+	int32_t v4;
+	memcpy(&u4, u, sizeof(u4));
+	memcpy(&v4, v, sizeof(v4));
+
+	// Luma as y * 257
+	__m128i luma = _mm_loadl_epi64((const __m128i*) y);
+	luma = _mm_unpacklo_epi8(luma, luma);
+	luma = _mm_add_epi16(
+			_mm_mulhi_epu16(luma, _mm_set1_epi16(YUV_Y_SCALE)),
+			_mm_set1_epi16(YUV_Y_BIAS));
+
+	// A chroma sample for each pixel pair
+	__m128i d = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_cvtsi32_si128(u4)),
+			_mm_set1_epi16(128));
+	__m128i e = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_cvtsi32_si128(v4)),
+			_mm_set1_epi16(128));
+	d = _mm_unpacklo_epi16(d, d);
+	e = _mm_unpacklo_epi16(e, e);
+
+	*r = _mm_srai_epi16(_mm_adds_epi16(luma,
+			_mm_mullo_epi16(e, _mm_set1_epi16(YUV_V_TO_R))), YUV_SHIFT);
+	*g = _mm_srai_epi16(_mm_subs_epi16(luma, _mm_add_epi16(
+			_mm_mullo_epi16(d, _mm_set1_epi16(YUV_U_TO_G)),
+			_mm_mullo_epi16(e, _mm_set1_epi16(YUV_V_TO_G)))), YUV_SHIFT);
+	*b = _mm_srai_epi16(_mm_adds_epi16(luma,
+			_mm_mullo_epi16(d, _mm_set1_epi16(YUV_U_TO_B))), YUV_SHIFT);
+}
+
+static void ConvertBgr24ToRgbaSse41(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+	size_t x = 0;
+
+	// Four pixels a step, the loads need six of them
+	for (; x + 6 <= width; x += 4)
+	{
+		__m128i bgr = _mm_loadu_si128((const __m128i*) (src + (x * 3)));
+
+		_mm_storeu_si128((__m128i*) (dst + (x * 4)),
+				_mm_or_si128(ShuffleBgr24(bgr), alpha));
+	}
+
+	ConvertBgr24ToRgbaScalar(src + (x * 3), dst + (x * 4), width - x);
+}
+
+static void ConvertBgr24ToRgb565Sse41(
+		const uint8_t* src,
+		uint16_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	// Eight pixels a step, the loads need ten of them
+	for (; x + 10 <= width; x += 8)
+	{
+		__m128i low = _mm_loadu_si128((const __m128i*) (src + (x * 3)));
+		__m128i high = _mm_loadu_si128((const __m128i*) (src + (x * 3) + 12));
+
+		_mm_storeu_si128((__m128i*) (dst + x), _mm_packus_epi32(
+				PackRgb565(ShuffleBgr24(low)), PackRgb565(ShuffleBgr24(high))));
+	}
+
+	ConvertBgr24ToRgb565Scalar(src + (x * 3), dst + x, width - x);
+}
+
+static void ConvertRgb565ToRgbaSse41(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i rg;
+		__m128i ba;
+		ExpandRgb565(_mm_loadu_si128((const __m128i*) (src + (x * 2))),
+				&rg, &ba);
+
+		_mm_storeu_si128((__m128i*) (dst + (x * 4)),
+				_mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*) (dst + (x * 4) + 16),
+				_mm_unpackhi_epi16(rg, ba));
+	}
+
+	ConvertRgb565ToRgbaScalar(src + (x * 2), dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgbaSse41(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint8_t* dst,
+		size_t width)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i r;
+		__m128i g;
+		__m128i b;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2), &r, &g, &b);
+
+		// Clamped by the saturating packs
+		__m128i rb = _mm_packus_epi16(r, b);
+		__m128i ga = _mm_packus_epi16(g, _mm_set1_epi16(255));
+		__m128i rg = _mm_unpacklo_epi8(rb, ga);
+		__m128i ba = _mm_unpackhi_epi8(rb, ga);
+
+		_mm_storeu_si128((__m128i*) (dst + (x * 4)),
+				_mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*) (dst + (x * 4) + 16),
+				_mm_unpackhi_epi16(rg, ba));
+	}
+
+	ConvertI420ToRgbaScalar(y + x, u + (x / 2), v + (x / 2),
+			dst + (x * 4), width - x);
+}
+
+static void ConvertI420ToRgb565Sse41(
+		const uint8_t* y,
+		const uint8_t* u,
+		const uint8_t* v,
+		uint16_t* dst,
+		size_t width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(255);
+	size_t x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i r;
+		__m128i g;
+		__m128i b;
+		ConvertYuv(y + x, u + (x / 2), v + (x / 2), &r, &g, &b);
+
+		r = _mm_min_epi16(_mm_max_epi16(r, zero), full);
+		g = _mm_min_epi16(_mm_max_epi16(g, zero), full);
+		b = _mm_min_epi16(_mm_max_epi16(b, zero), full);
+
+		__m128i pixels = _mm_or_si128(_mm_or_si128(
+				_mm_slli_epi16(_mm_and_si128(r, _mm_set1_epi16(0xF8)), 8),
+				_mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0xFC)), 3)),
+				_mm_srli_epi16(b, 3));
+
+		_mm_storeu_si128((__m128i*) (dst + x), pixels);
+	}
+
+	ConvertI420ToRgb565Scalar(y + x, u + (x / 2), v + (x / 2),
+			dst + x, width - x);
+}
+
+static const PixelKernels gSse41PixelKernels =
+{
+	ConvertBgr24ToRgbaSse41,
+	ConvertBgr24ToRgb565Sse41,
+	ConvertRgb565ToRgbaSse41,
+	ConvertI420ToRgbaSse41,
+	ConvertI420ToRgb565Sse41,
+};
+
+const PixelKernels* GetSse41PixelKernels()
+{
+	return &gSse41PixelKernels;
+}
@@ -0,0 +1,1165 @@
+#include "VideoFile.h"
+
+// open, O_RDONLY, O_CLOEXEC, posix_fadvise64
+#include <fcntl.h>
+
+// close, sysconf
+#include <unistd.h>
+
+// mmap, mmap64, madvise, munmap
+#include <sys/mman.h>
+
+// fstat64
+#include <sys/stat.h>
+
+// errno
+#include <errno.h>
+
+// memcmp, memchr, strtok_r
+#include <string.h>
+
+// strtol
+#include <stdlib.h>
+
+// uint16_t, uint32_t, uint64_t, uintptr_t, SIZE_MAX
+#include <stdint.h>
+
+// std::vector
+#include <vector>
+
+// Largest YUV4MPEG2 stream or frame header line
+#define MAX_Y4M_HEADER_SIZE 1024
+
+// Largest frame width or height, keeps the frame sizes in range
+#define MAX_VIDEO_SIZE 16384
+
+// Bytes of the frames read ahead of the playback position, at
+// least one frame
+#define READAHEAD_SIZE (4 * 1024 * 1024)
+
+// Bytes mapped at a time of the files too big to be mapped whole,
+// at least the bytes asked for
+#define FILE_WINDOW_SIZE (32 * 1024 * 1024)
+
+// RIFF chunk header, FOURCC and size
+#define RIFF_CHUNK_HEADER_SIZE 8
+
+// RIFF list header, chunk header and list type
+#define RIFF_LIST_HEADER_SIZE 12
+
+// AVI index entry, chunk ID, flags, offset and size
+#define AVI_INDEX_ENTRY_SIZE 16
+
+// AVI stream header fields read, up to the stream length
+#define AVI_STREAM_HEADER_SIZE 36
+
+// Bitmap info header and the bit field masks after it
+#define AVI_BITMAP_FORMAT_SIZE 52
+
+// Uncompressed and bit field bitmap compressions
+#define BI_RGB 0
+#define BI_BITFIELDS 3
+
+/**
+ * Video file handle.
+ */
+struct VideoFile
+{
+	// Read only mapping of the whole file, or of a window of it
+	// when the address space has no room for the whole file
+	const unsigned char* data;
+	uint64_t dataOffset;
+	size_t dataSize;
+	uint64_t fileSize;
+
+	// Descriptor the windows are mapped from, -1 if the whole file
+	// is mapped
+	int fd;
+
+	// madvise advice of the mapping, given again to each window
+	int advice;
+
+	VideoFormat format;
+
+	// Offsets of the frame data in the file, by frame number
+	std::vector<uint64_t> frames;
+
+	// Frames of a read ahead window
+	size_t readaheadFrames;
+
+	// Frame after the last one played, anything else is a seek
+	size_t nextFrame;
+
+	// End of the frames read ahead
+	size_t readaheadEnd;
+};
+
+/**
+ * AVI file layout found while parsing.
+ */
+struct AviLayout
+{
+	// Chunk ID digits of the video stream
+	char streamId[2];
+
+	// Video stream is found
+	bool hasVideo;
+
+	// Frame rate of the main header, used without a stream rate
+	uint32_t microSecPerFrame;
+
+	// Begin and end of the movi lists, the first one is the
+	// base of the index offsets
+	std::vector<uint64_t> moviBegins;
+	std::vector<uint64_t> moviEnds;
+
+	// Old style index of the first RIFF, zero size if none
+	uint64_t indexOffset;
+	uint32_t indexSize;
+};
+
+class PlayerErrorCategory : public std::error_category
+{
+public:
+	virtual const char* name() const noexcept
+	{
+		return "player";
+	}
+
+	virtual std::string message(int error) const
+	{
+		switch (error)
+		{
+		case PLAYER_ERROR_UNKNOWN_FORMAT:
+			return "File is not an AVI or YUV4MPEG2 video.";
+		case PLAYER_ERROR_INVALID_FILE:
+			return "Video file is invalid or truncated.";
+		case PLAYER_ERROR_UNSUPPORTED_FORMAT:
+			return "Video is compressed or its pixel format is not supported.";
+		case PLAYER_ERROR_NO_VIDEO:
+			return "No video frames.";
+		case PLAYER_ERROR_FRAME_OUT_OF_RANGE:
+			return "Frame number is out of range.";
+		default:
+			return "Unknown error.";
+		}
+	}
+};
+
+const std::error_category& GetPlayerErrorCategory()
+{
+	static PlayerErrorCategory category;
+
+	return category;
+}
+
+std::error_code make_error_code(PlayerError error)
+{
+	return std::error_code((int) error, GetPlayerErrorCategory());
+}
+
+/**
+ * Gets a little endian 16 bit value.
+ *
+ * @param data value bytes.
+ * @return value.
+ */
+static inline uint16_t GetLe16(const unsigned char* data)
+{
+	return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+/**
+ * Gets a little endian 32 bit value.
+ *
+ * @param data value bytes.
+ * @return value.
+ */
+static inline uint32_t GetLe32(const unsigned char* data)
+{
+	return (uint32_t) data[0] | ((uint32_t) data[1] << 8)
+			| ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+/**
+ * Checks the FOURCC at the given bytes.
+ *
+ * @param data FOURCC bytes.
+ * @param fourCc expected FOURCC.
+ * @return true if they match.
+ */
+static inline bool IsFourCc(const unsigned char* data, const char* fourCc)
+{
+	return 0 == memcmp(data, fourCc, 4);
+}
+
+/**
+ * Maps the window of the given file starting at the page of an
+ * offset, in place of the current one.
+ *
+ * @param file video file, mapped by windows.
+ * @param offset file offset.
+ * @param size number of bytes the window holds at least.
+ * @param error error code.
+ * @return false if failed.
+ */
+static bool MapFileWindow(
+		VideoFile* file,
+		uint64_t offset,
+		size_t size,
+		std::error_code& error)
+{
+	uint64_t pageMask = (uint64_t) sysconf(_SC_PAGESIZE) - 1;
+	uint64_t begin = offset & ~pageMask;
+	uint64_t end = begin + FILE_WINDOW_SIZE;
+
+	if (end < offset + size)
+	{
+		end = offset + size;
+	}
+
+	if (end > file->fileSize)
+	{
+		end = file->fileSize;
+	}
+
+	if (NULL != file->data)
+	{
+		munmap((void*) file->data, file->dataSize);
+		file->data = NULL;
+		file->dataOffset = 0;
+		file->dataSize = 0;
+	}
+
+	if (end - begin > SIZE_MAX)
+	{
+		error.assign(EFBIG, std::system_category());
+		return false;
+	}
+
+	// 64 bit offset on the 32 bit ABIs as well
+	void* data = mmap64(NULL, (size_t) (end - begin), PROT_READ,
+			MAP_SHARED, file->fd, (off64_t) begin);
+
+	if (MAP_FAILED == data)
+	{
+		error.assign(errno, std::system_category());
+		return false;
+	}
+
+	file->data = (const unsigned char*) data;
+	file->dataOffset = begin;
+	file->dataSize = (size_t) (end - begin);
+
+	// Only a hint, failures are ignored
+	madvise(data, file->dataSize, file->advice);
+	return true;
+}
+
+/**
+ * Gets the given number of bytes at an offset of the mapped file,
+ * without copying them. A file mapped by windows maps the window
+ * of the bytes if they are not in the current one.
+ *
+ * @param file video file.
+ * @param offset file offset.
+ * @param size number of bytes.
+ * @param error error code.
+ * @return mapped bytes, valid until the next call, or NULL if they
+ *         are past the end of the file or failed to be mapped.
+ */
+static const unsigned char* GetFileData(
+		VideoFile* file,
+		uint64_t offset,
+		size_t size,
+		std::error_code& error)
+{
+	if ((offset > file->fileSize) || (size > file->fileSize - offset))
+	{
+		// End of file before the data
+		error = PLAYER_ERROR_INVALID_FILE;
+		return NULL;
+	}
+
+	// The whole file mapping holds any bytes
+	if ((offset < file->dataOffset)
+			|| (offset + size > file->dataOffset + file->dataSize))
+	{
+		if (!MapFileWindow(file, offset, size, error))
+			return NULL;
+	}
+
+	return file->data + (offset - file->dataOffset);
+}
+
+/**
+ * Copies the given number of bytes at an offset of the mapped
+ * file, for the headers parsed in place.
+ *
+ * @param file video file.
+ * @param offset file offset.
+ * @param buffer data buffer.
+ * @param size number of bytes.
+ * @param error error code.
+ */
+static void CopyFileData(
+		VideoFile* file,
+		uint64_t offset,
+		void* buffer,
+		size_t size,
+		std::error_code& error)
+{
+	const unsigned char* data = GetFileData(file, offset, size, error);
+
+	if (NULL != data)
+	{
+		memcpy(buffer, data, size);
+	}
+}
+
+/**
+ * Advises the kernel of the use of the given bytes of the file
+ * mapped whole, the range is widened to whole pages.
+ *
+ * @param file video file, mapped whole.
+ * @param begin first byte.
+ * @param end end of the bytes.
+ * @param advice madvise advice.
+ */
+static void AdviseFileRange(
+		const VideoFile* file,
+		uint64_t begin,
+		uint64_t end,
+		int advice)
+{
+	uintptr_t pageMask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+	uintptr_t address = (uintptr_t) (file->data + begin) & ~pageMask;
+
+	// Only a hint, failures are ignored
+	madvise((void*) address,
+			(size_t) ((uintptr_t) (file->data + end) - address), advice);
+}
+
+/**
+ * Advises the kernel of the use of the whole given file, the
+ * windows mapped later get the same advice.
+ *
+ * @param file video file.
+ * @param advice madvise advice.
+ */
+static void AdviseFile(VideoFile* file, int advice)
+{
+	file->advice = advice;
+
+	if (NULL != file->data)
+	{
+		// Only a hint, failures are ignored
+		madvise((void*) file->data, file->dataSize, advice);
+	}
+}
+
+/**
+ * Sets the frame size and stride of the given format from its
+ * pixel format and size.
+ *
+ * @param format frame format.
+ */
+static void SetFrameSize(VideoFormat* format)
+{
+	size_t width = (size_t) format->width;
+	size_t height = (size_t) format->height;
+
+	switch (format->pixelFormat)
+	{
+	case VIDEO_FORMAT_BGR24:
+		// Rows are padded to four bytes
+		format->stride = ((width * 3) + 3) & ~((size_t) 3);
+		format->frameSize = format->stride * height;
+		break;
+
+	case VIDEO_FORMAT_RGB565:
+		format->stride = ((width * 2) + 3) & ~((size_t) 3);
+		format->frameSize = format->stride * height;
+		break;
+
+	case VIDEO_FORMAT_I420:
+		// Chroma planes are rounded up
+		format->stride = width;
+		format->frameSize = (width * height)
+				+ (2 * ((width + 1) / 2) * ((height + 1) / 2));
+		break;
+	}
+}
+
+/**
+ * Adds the frame at the given offset to the index, if it is
+ * entirely in the file.
+ *
+ * @param file video file.
+ * @param offset frame data offset.
+ * @param size frame chunk size.
+ * @param error error code.
+ */
+static void AddFrame(
+		VideoFile* file,
+		uint64_t offset,
+		uint32_t size,
+		std::error_code& error)
+{
+	if (0 == size)
+	{
+		// Dropped frame, the previous one is shown again
+		if (!file->frames.empty())
+		{
+			file->frames.push_back(file->frames.back());
+		}
+	}
+	else if ((size < file->format.frameSize)
+			|| (offset + file->format.frameSize > file->fileSize))
+	{
+		error = PLAYER_ERROR_INVALID_FILE;
+	}
+	else
+	{
+		file->frames.push_back(offset);
+	}
+}
+
+/**
+ * Parses the format of the given video stream.
+ *
+ * @param file video file.
+ * @param header stream header.
+ * @param bitmap bitmap format, AVI_BITMAP_FORMAT_SIZE bytes
+ *        padded with zeros.
+ * @param error error code.
+ */
+static void ParseAviVideoFormat(
+		VideoFile* file,
+		const unsigned char* header,
+		const unsigned char* bitmap,
+		std::error_code& error)
+{
+	VideoFormat* format = &file->format;
+
+	int32_t width = (int32_t) GetLe32(bitmap + 4);
+	int32_t height = (int32_t) GetLe32(bitmap + 8);
+	uint16_t bitCount = GetLe16(bitmap + 14);
+	uint32_t compression = GetLe32(bitmap + 16);
+
+	if ((BI_RGB == compression) && (24 == bitCount))
+	{
+		format->pixelFormat = VIDEO_FORMAT_BGR24;
+	}
+	else if ((BI_BITFIELDS == compression) && (16 == bitCount)
+			&& (0xF800 == GetLe32(bitmap + 40))
+			&& (0x07E0 == GetLe32(bitmap + 44))
+			&& (0x001F == GetLe32(bitmap + 48)))
+	{
+		format->pixelFormat = VIDEO_FORMAT_RGB565;
+	}
+	else if ((IsFourCc(bitmap + 16, "I420") || IsFourCc(bitmap + 16, "IYUV"))
+			&& (12 == bitCount))
+	{
+		format->pixelFormat = VIDEO_FORMAT_I420;
+	}
+	else
+	{
+		error = PLAYER_ERROR_UNSUPPORTED_FORMAT;
+		return;
+	}
+
+	// Bitmaps with a negative height are stored top down, YUV
+	// frames always are
+	format->bottomUp = (height > 0)
+			&& (VIDEO_FORMAT_I420 != format->pixelFormat);
+	format->width = width;
+	format->height = (height < 0) ? -height : height;
+
+	if ((format->width <= 0) || (format->width > MAX_VIDEO_SIZE)
+			|| (format->height <= 0) || (format->height > MAX_VIDEO_SIZE))
+	{
+		error = PLAYER_ERROR_INVALID_FILE;
+		return;
+	}
+
+	// Rate over scale, the main header has the frame period
+	uint32_t scale = GetLe32(header + 20);
+	uint32_t rate = GetLe32(header + 24);
+
+	if ((0 != scale) && (0 != rate))
+	{
+		format->frameRate = (double) rate / scale;
+	}
+
+	SetFrameSize(format);
+}
+
+/**
+ * Parses the header list of the given AVI file, the format of the
+ * first video stream is kept.
+ *
+ * @param file video file.
+ * @param begin first chunk of the list.
+ * @param end end of the list.
+ * @param layout AVI file layout.
+ * @param error error code.
+ */
+static void ParseAviHeaderList(
+		VideoFile* file,
+		uint64_t begin,
+		uint64_t end,
+		AviLayout* layout,
+		std::error_code& error)
+{
+	unsigned char chunk[RIFF_LIST_HEADER_SIZE];
+	int streamCount = 0;
+
+	for (uint64_t offset = begin;
+			!error && (offset + RIFF_LIST_HEADER_SIZE <= end); )
+	{
+		CopyFileData(file, offset, chunk, RIFF_LIST_HEADER_SIZE, error);
+		if (error)
+			break;
+
+		uint32_t size = GetLe32(chunk + 4);
+
+		if (IsFourCc(chunk, "avih") && (size >= 4))
+		{
+			unsigned char period[4] = { 0 };
+			CopyFileData(file, offset + RIFF_CHUNK_HEADER_SIZE, period,
+					sizeof(period), error);
+			if (error)
+				break;
+
+			layout->microSecPerFrame = GetLe32(period);
+		}
+		else if (IsFourCc(chunk, "LIST") && IsFourCc(chunk + 8, "strl"))
+		{
+			int stream = streamCount++;
+			if (layout->hasVideo || (stream > 99))
+			{
+				// Only the first video stream is played
+			}
+			else
+			{
+				unsigned char header[AVI_STREAM_HEADER_SIZE] = { 0 };
+				unsigned char bitmap[AVI_BITMAP_FORMAT_SIZE] = { 0 };
+				bool hasHeader = false;
+				bool hasBitmap = false;
+
+				// Stream header and format chunks of the stream list
+				uint64_t listEnd = offset + RIFF_CHUNK_HEADER_SIZE + size;
+				for (uint64_t child = offset + RIFF_LIST_HEADER_SIZE;
+						!error && (child + RIFF_CHUNK_HEADER_SIZE <= listEnd); )
+				{
+					unsigned char childChunk[RIFF_CHUNK_HEADER_SIZE];
+					CopyFileData(file, child, childChunk,
+							RIFF_CHUNK_HEADER_SIZE, error);
+					if (error)
+						break;
+
+					uint32_t childSize = GetLe32(childChunk + 4);
+					uint64_t data = child + RIFF_CHUNK_HEADER_SIZE;
+
+					if (IsFourCc(childChunk, "strh")
+							&& (childSize >= AVI_STREAM_HEADER_SIZE))
+					{
+						CopyFileData(file, data, header,
+								AVI_STREAM_HEADER_SIZE, error);
+						hasHeader = true;
+					}
+					else if (IsFourCc(childChunk, "strf") && (childSize >= 40))
+					{
+						// Bit field masks may not be there
+						CopyFileData(file, data, bitmap,
+								(childSize < AVI_BITMAP_FORMAT_SIZE)
+										? childSize : AVI_BITMAP_FORMAT_SIZE,
+								error);
+						hasBitmap = true;
+					}
+
+					child = data + childSize + (childSize & 1);
+				}
+
+				if (!error && hasHeader && hasBitmap
+						&& IsFourCc(header, "vids"))
+				{
+					ParseAviVideoFormat(file, header, bitmap, error);
+
+					layout->hasVideo = true;
+					layout->streamId[0] = (char) ('0' + (stream / 10));
+					layout->streamId[1] = (char) ('0' + (stream % 10));
+				}
+			}
+		}
+
+		offset += RIFF_CHUNK_HEADER_SIZE + (uint64_t) size + (size & 1);
+	}
+}
+
+/**
+ * Checks if the given chunk ID is a frame of the video stream,
+ * uncompressed ("db") or not ("dc").
+ *
+ * @param layout AVI file layout.
+ * @param id chunk ID.
+ * @return true if it is a video frame.
+ */
+static bool IsAviVideoChunk(const AviLayout* layout, const unsigned char* id)
+{
+	return (layout->streamId[0] == (char) id[0])
+			&& (layout->streamId[1] == (char) id[1])
+			&& ((('d' == id[2]) && ('b' == id[3]))
+					|| (('d' == id[2]) && ('c' == id[3])));
+}
+
+/**
+ * Builds the frame index from the old style index chunk of the
+ * given AVI file.
+ *
+ * @param file video file.
+ * @param layout AVI file layout.
+ * @param error error code.
+ */
+static void ParseAviIndex(
+		VideoFile* file,
+		const AviLayout* layout,
+		std::error_code& error)
+{
+	// Entries are copied, checking the first one may map another
+	// window of the file
+	unsigned char entry[AVI_INDEX_ENTRY_SIZE];
+
+	// Offsets are relative to the movi list type, or absolute in
+	// some files
+	bool hasBase = false;
+	uint64_t base = layout->moviBegins[0];
+
+	for (size_t i = 0;
+			!error && (i + AVI_INDEX_ENTRY_SIZE <= layout->indexSize);
+			i += AVI_INDEX_ENTRY_SIZE)
+	{
+		CopyFileData(file, layout->indexOffset + i, entry,
+				AVI_INDEX_ENTRY_SIZE, error);
+		if (error || !IsAviVideoChunk(layout, entry))
+			continue;
+
+		uint32_t offset = GetLe32(entry + 8);
+		uint32_t size = GetLe32(entry + 12);
+
+		if (!hasBase)
+		{
+			// Find the chunk of the first entry, relative offsets
+			// may be past the end of the file
+			unsigned char id[4];
+			std::error_code relativeError;
+			CopyFileData(file, base + offset, id, sizeof(id), relativeError);
+
+			if (relativeError || !IsFourCc(id, (const char*) entry))
+			{
+				base = 0;
+				CopyFileData(file, offset, id, sizeof(id), error);
+
+				if (!error && !IsFourCc(id, (const char*) entry))
+				{
+					error = PLAYER_ERROR_INVALID_FILE;
+				}
+			}
+
+			hasBase = true;
+		}
+
+		if (!error)
+		{
+			AddFrame(file, base + offset + RIFF_CHUNK_HEADER_SIZE,
+					size, error);
+		}
+	}
+}
+
+/**
+ * Builds the frame index by walking the movi lists of the given
+ * AVI file, for files without an old style index or bigger than
+ * it can address.
+ *
+ * @param file video file.
+ * @param layout AVI file layout.
+ * @param error error code.
+ */
+static void ScanAviMoviLists(
+		VideoFile* file,
+		const AviLayout* layout,
+		std::error_code& error)
+{
+	unsigned char chunk[RIFF_LIST_HEADER_SIZE];
+
+	for (size_t i = 0; !error && (i < layout->moviBegins.size()); i++)
+	{
+		uint64_t end = layout->moviEnds[i];
+
+		// Chunks follow the list type
+		for (uint64_t offset = layout->moviBegins[i] + 4;
+				!error && (offset + RIFF_CHUNK_HEADER_SIZE <= end); )
+		{
+			CopyFileData(file, offset, chunk, RIFF_CHUNK_HEADER_SIZE, error);
+			if (error)
+				break;
+
+			uint32_t size = GetLe32(chunk + 4);
+
+			if (IsFourCc(chunk, "LIST"))
+			{
+				// Enter the rec lists grouping the chunks
+				offset += RIFF_LIST_HEADER_SIZE;
+				continue;
+			}
+
+			if (IsAviVideoChunk(layout, chunk))
+			{
+				AddFrame(file, offset + RIFF_CHUNK_HEADER_SIZE, size, error);
+			}
+
+			offset += RIFF_CHUNK_HEADER_SIZE + (uint64_t) size + (size & 1);
+		}
+	}
+}
+
+/**
+ * Parses the given AVI file. OpenDML files continue in AVIX
+ * RIFFs, their frames are found by walking the movi lists.
+ *
+ * @param file video file.
+ * @param error error code.
+ */
+static void ParseAviFile(VideoFile* file, std::error_code& error)
+{
+	AviLayout layout;
+	layout.hasVideo = false;
+	layout.microSecPerFrame = 0;
+	layout.indexOffset = 0;
+	layout.indexSize = 0;
+
+	unsigned char chunk[RIFF_LIST_HEADER_SIZE];
+
+	for (uint64_t riff = 0;
+			!error && (riff + RIFF_LIST_HEADER_SIZE <= file->fileSize); )
+	{
+		CopyFileData(file, riff, chunk, RIFF_LIST_HEADER_SIZE, error);
+		if (error)
+			break;
+
+		// Trailing data after the last RIFF is ignored
+		if (!IsFourCc(chunk, "RIFF")
+				|| !IsFourCc(chunk + 8, (0 == riff) ? "AVI " : "AVIX"))
+			break;
+
+		uint64_t riffEnd = riff + RIFF_CHUNK_HEADER_SIZE + GetLe32(chunk + 4);
+		if (riffEnd > file->fileSize)
+		{
+			// Truncated while recording, the frames written are kept
+			riffEnd = file->fileSize;
+		}
+
+		for (uint64_t offset = riff + RIFF_LIST_HEADER_SIZE;
+				!error && (offset + RIFF_LIST_HEADER_SIZE <= riffEnd); )
+		{
+			CopyFileData(file, offset, chunk, RIFF_LIST_HEADER_SIZE, error);
+			if (error)
+				break;
+
+			uint32_t size = GetLe32(chunk + 4);
+			uint64_t data = offset + RIFF_CHUNK_HEADER_SIZE;
+			uint64_t dataEnd = data + size;
+			if (dataEnd > riffEnd)
+			{
+				dataEnd = riffEnd;
+			}
+
+			if (IsFourCc(chunk, "LIST") && IsFourCc(chunk + 8, "hdrl")
+					&& (0 == riff))
+			{
+				ParseAviHeaderList(file, data + 4, dataEnd, &layout, error);
+			}
+			else if (IsFourCc(chunk, "LIST") && IsFourCc(chunk + 8, "movi"))
+			{
+				layout.moviBegins.push_back(data);
+				layout.moviEnds.push_back(dataEnd);
+			}
+			else if (IsFourCc(chunk, "idx1") && (0 == riff)
+					&& (dataEnd == data + size))
+			{
+				layout.indexOffset = data;
+				layout.indexSize = size;
+			}
+
+			offset = data + size + (size & 1);
+		}
+
+		riff = riffEnd + (riffEnd & 1);
+	}
+
+	if (error)
+		return;
+
+	if (!layout.hasVideo)
+	{
+		error = PLAYER_ERROR_NO_VIDEO;
+		return;
+	}
+
+	if (layout.moviBegins.empty()
+			|| ((0.0 == file->format.frameRate)
+					&& (0 == layout.microSecPerFrame)))
+	{
+		error = PLAYER_ERROR_INVALID_FILE;
+		return;
+	}
+
+	if (0.0 == file->format.frameRate)
+	{
+		file->format.frameRate = 1000000.0 / layout.microSecPerFrame;
+	}
+
+	// The old style index only covers the first RIFF
+	if ((0 != layout.indexSize) && (1 == layout.moviBegins.size()))
+	{
+		ParseAviIndex(file, &layout, error);
+	}
+
+	if (!error && file->frames.empty())
+	{
+		ScanAviMoviLists(file, &layout, error);
+	}
+}
+
+/**
+ * Parses the given YUV4MPEG2 file. Only the 8 bit 4:2:0 color
+ * spaces are supported, the chroma siting is ignored.
+ *
+ * @param file video file.
+ * @param error error code.
+ */
+static void ParseY4mFile(VideoFile* file, std::error_code& error)
+{
+	VideoFormat* format = &file->format;
+	char header[MAX_Y4M_HEADER_SIZE + 1];
+
+	size_t size = (file->fileSize < MAX_Y4M_HEADER_SIZE)
+			? (size_t) file->fileSize : MAX_Y4M_HEADER_SIZE;
+	CopyFileData(file, 0, header, size, error);
+	if (error)
+		return;
+
+	char* end = (char*) memchr(header, '\n', size);
+	if (NULL == end)
+	{
+		error = PLAYER_ERROR_INVALID_FILE;
+		return;
+	}
+
+	uint64_t offset = (end - header) + 1;
+	*end = '\0';
+
+	// Parameters after the signature, 4:2:0 is the default
+	long rateNumerator = 0;
+	long rateDenominator = 0;
+	char* state = NULL;
+
+	format->pixelFormat = VIDEO_FORMAT_I420;
+
+	for (char* token = strtok_r(header + 9, " ", &state);
+			NULL != token; token = strtok_r(NULL, " ", &state))
+	{
+		switch (token[0])
+		{
+		case 'W':
+			format->width = (int) strtol(token + 1, NULL, 10);
+			break;
+
+		case 'H':
+			format->height = (int) strtol(token + 1, NULL, 10);
+			break;
+
+		case 'F':
+			{
+				char* separator = NULL;
+				rateNumerator = strtol(token + 1, &separator, 10);
+
+				if (':' == *separator)
+				{
+					rateDenominator = strtol(separator + 1, NULL, 10);
+				}
+			}
+			break;
+
+		case 'C':
+			if ((0 != strcmp(token, "C420"))
+					&& (0 != strcmp(token, "C420jpeg"))
+					&& (0 != strcmp(token, "C420paldv"))
+					&& (0 != strcmp(token, "C420mpeg2")))
+			{
+				error = PLAYER_ERROR_UNSUPPORTED_FORMAT;
+				return;
+			}
+			break;
+		}
+	}
+
+	if ((format->width <= 0) || (format->width > MAX_VIDEO_SIZE)
+			|| (format->height <= 0) || (format->height > MAX_VIDEO_SIZE)
+			|| (rateNumerator <= 0) || (rateDenominator <= 0))
+	{
+		error = PLAYER_ERROR_INVALID_FILE;
+		return;
+	}
+
+	format->frameRate = (double) rateNumerator / rateDenominator;
+	format->bottomUp = false;
+	SetFrameSize(format);
+
+	// Each frame has its own header line
+	while (offset < file->fileSize)
+	{
+		// Searched in place in the mapping
+		size = ((file->fileSize - offset) < MAX_Y4M_HEADER_SIZE)
+				? (size_t) (file->fileSize - offset) : MAX_Y4M_HEADER_SIZE;
+		const char* line = (const char*) GetFileData(file, offset, size,
+				error);
+		if (NULL == line)
+			break;
+
+		// Lines shorter than the tag are invalid, the bytes after a
+		// short last line are past the end of the file
+		const char* lineEnd = (const char*) memchr(line, '\n', size);
+		if ((NULL == lineEnd) || (lineEnd - line < 5)
+				|| (0 != memcmp(line, "FRAME", 5)))
+		{
+			error = PLAYER_ERROR_INVALID_FILE;
+			break;
+		}
+
+		offset += (lineEnd - line) + 1;
+
+		// A truncated last frame is dropped
+		if (offset + format->frameSize > file->fileSize)
+			break;
+
+		file->frames.push_back(offset);
+		offset += format->frameSize;
+	}
+}
+
+/**
+ * Advises the kernel to read the frames of the next window ahead
+ * of the playback position.
+ *
+ * @param file video file.
+ * @param begin first frame of the window.
+ * @param end end of the window.
+ */
+static void ReadAheadFrames(const VideoFile* file, size_t begin, size_t end)
+{
+	uint64_t first = file->frames[begin];
+	uint64_t last = file->frames[end - 1] + file->format.frameSize;
+
+	// Frames are stored in order, except in odd indexes
+	if (last <= first)
+		return;
+
+	if (-1 == file->fd)
+	{
+		AdviseFileRange(file, first, last, MADV_WILLNEED);
+	}
+	else
+	{
+		// Mostly past the current window, only a hint
+		posix_fadvise64(file->fd, (off64_t) first, (off64_t) (last - first),
+				POSIX_FADV_WILLNEED);
+	}
+}
+
+VideoFile* OpenVideoFile(const char* path, std::error_code& error)
+{
+	VideoFile* file = new VideoFile();
+	file->data = NULL;
+	file->dataOffset = 0;
+	file->dataSize = 0;
+	file->fileSize = 0;
+	file->fd = -1;
+	file->advice = MADV_NORMAL;
+	file->format = VideoFormat();
+	file->readaheadFrames = 1;
+	file->nextFrame = 0;
+	file->readaheadEnd = 0;
+
+	struct stat64 status;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (-1 == fd)
+	{
+		error.assign(errno, std::system_category());
+	}
+	else if (-1 == fstat64(fd, &status))
+	{
+		error.assign(errno, std::system_category());
+	}
+	else if ((file->fileSize = (uint64_t) status.st_size)
+			< RIFF_LIST_HEADER_SIZE)
+	{
+		error = PLAYER_ERROR_UNKNOWN_FORMAT;
+	}
+	else
+	{
+		// Map the whole file, the mapping stays once the file is closed
+		void* data = MAP_FAILED;
+		if (file->fileSize <= SIZE_MAX)
+		{
+			data = mmap(NULL, (size_t) file->fileSize, PROT_READ,
+					MAP_SHARED, fd, 0);
+		}
+
+		if (MAP_FAILED != data)
+		{
+			file->data = (const unsigned char*) data;
+			file->dataSize = (size_t) file->fileSize;
+		}
+		else
+		{
+			// No room in the address space, mostly on the 32 bit ABIs,
+			// the file is mapped by windows and its descriptor kept
+			file->fd = fd;
+			fd = -1;
+		}
+	}
+
+	if (-1 != fd)
+	{
+		close(fd);
+	}
+
+	if (!error)
+	{
+		// Parsing touches a page of each frame, the frames in between
+		// are not read ahead
+		AdviseFile(file, MADV_RANDOM);
+
+		const unsigned char* signature = GetFileData(file, 0,
+				RIFF_LIST_HEADER_SIZE, error);
+
+		// NULL if the first window failed to be mapped
+		if (NULL != signature)
+		{
+			if (IsFourCc(signature, "RIFF")
+					&& IsFourCc(signature + 8, "AVI "))
+			{
+				ParseAviFile(file, error);
+			}
+			else if (0 == memcmp(signature, "YUV4MPEG2 ", 10))
+			{
+				ParseY4mFile(file, error);
+			}
+			else
+			{
+				error = PLAYER_ERROR_UNKNOWN_FORMAT;
+			}
+		}
+	}
+
+	if (!error && file->frames.empty())
+	{
+		error = PLAYER_ERROR_NO_VIDEO;
+	}
+
+	if (error)
+	{
+		CloseVideoFile(file);
+		file = NULL;
+	}
+	else
+	{
+		// Playback reads the frames in order, the pages played are
+		// reclaimed first
+		AdviseFile(file, MADV_SEQUENTIAL);
+
+		if (file->format.frameSize < READAHEAD_SIZE)
+		{
+			file->readaheadFrames = READAHEAD_SIZE / file->format.frameSize;
+		}
+	}
+
+	return file;
+}
+
+const VideoFormat* GetVideoFormat(const VideoFile* file)
+{
+	return &file->format;
+}
+
+size_t GetVideoFrameCount(const VideoFile* file)
+{
+	return file->frames.size();
+}
+
+const char* GetVideoFrame(
+		VideoFile* file,
+		size_t index,
+		std::error_code& error)
+{
+	size_t frameCount = file->frames.size();
+
+	if (index >= frameCount)
+	{
+		error = PLAYER_ERROR_FRAME_OUT_OF_RANGE;
+		return NULL;
+	}
+
+	// A seek starts a new window at the frame
+	if (index != file->nextFrame)
+	{
+		file->readaheadEnd = index;
+	}
+
+	file->nextFrame = index + 1;
+
+	// The next window is advised once half of the current one is
+	// played, so the pages are read before they are needed
+	if (index + (file->readaheadFrames / 2) >= file->readaheadEnd)
+	{
+		size_t begin = (file->readaheadEnd > index)
+				? file->readaheadEnd : index;
+		size_t end = index + file->readaheadFrames;
+		if (end > frameCount)
+		{
+			end = frameCount;
+		}
+
+		if (begin < end)
+		{
+			ReadAheadFrames(file, begin, end);
+		}
+
+		file->readaheadEnd = end;
+	}
+
+	return (const char*) GetFileData(file, file->frames[index],
+			file->format.frameSize, error);
+}
+
+void CloseVideoFile(VideoFile* file)
+{
+	if (NULL != file)
+	{
+		if (NULL != file->data)
+		{
+			munmap((void*) file->data, file->dataSize);
+		}
+
+		if (-1 != file->fd)
+		{
+			close(file->fd);
+		}
+
+		delete file;
+	}
+}
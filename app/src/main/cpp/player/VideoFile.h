@@ -0,0 +1,153 @@
+#ifndef VIDEO_FILE_H
+#define VIDEO_FILE_H
+
+// size_t
+#include <stddef.h>
+
+// std::error_code, std::error_category
+#include <system_error>
+
+/**
+ * Errors of the player engine that have no error number. File
+ * system call failures are reported in the system category with
+ * their error number instead.
+ */
+enum PlayerError
+{
+	PLAYER_ERROR_UNKNOWN_FORMAT = 1,
+	PLAYER_ERROR_INVALID_FILE,
+	PLAYER_ERROR_UNSUPPORTED_FORMAT,
+	PLAYER_ERROR_NO_VIDEO,
+	PLAYER_ERROR_FRAME_OUT_OF_RANGE
+};
+
+namespace std
+{
+	template <>
+	struct is_error_code_enum<PlayerError> : true_type
+	{
+	};
+}
+
+/**
+ * Gets the category of the player engine errors.
+ *
+ * @return error category.
+ */
+const std::error_category& GetPlayerErrorCategory();
+
+/**
+ * Makes an error code of the given player engine error, lets the
+ * errors be assigned to std::error_code directly.
+ *
+ * @param error player engine error.
+ * @return error code.
+ */
+std::error_code make_error_code(PlayerError error);
+
+/**
+ * Uncompressed pixel formats of the video frames.
+ */
+enum VideoPixelFormat
+{
+	// Packed blue, green and red bytes
+	VIDEO_FORMAT_BGR24 = 1,
+
+	// Packed 16 bit pixels, 5 bits red, 6 green and 5 blue
+	VIDEO_FORMAT_RGB565,
+
+	// Planar Y, then U and V at half the width and height
+	VIDEO_FORMAT_I420
+};
+
+/**
+ * Format of the frames of a video file.
+ */
+struct VideoFormat
+{
+	// Size in pixels
+	int width;
+	int height;
+
+	// Frames per second
+	double frameRate;
+
+	VideoPixelFormat pixelFormat;
+
+	// Bytes per row of the packed formats, rows are padded to four
+	// bytes in AVI files
+	size_t stride;
+
+	// Rows are stored from the bottom to the top
+	bool bottomUp;
+
+	// Bytes of a frame
+	size_t frameSize;
+};
+
+/*
+ * The player engine has no dependency on JNI. A video file is
+ * an uncompressed AVI (RIFF) or a YUV4MPEG2 file, mapped in memory
+ * and its index parsed when it is opened. A file the address space
+ * has no room for, mostly on the 32 bit ABIs, is mapped by windows
+ * around the frames instead. Frames are then accessed by their
+ * number in O(1), as slices of the mapping without copying, and the
+ * frames ahead of the last one are read ahead in the background. A
+ * video file is not safe to use from many threads at the same time.
+ * Failures are reported through the error code.
+ */
+
+/**
+ * Video file handle.
+ */
+struct VideoFile;
+
+/**
+ * Opens the given video file and builds the index of its frames.
+ *
+ * @param path file path.
+ * @param error error code.
+ * @return video file or NULL if failed.
+ */
+VideoFile* OpenVideoFile(const char* path, std::error_code& error);
+
+/**
+ * Gets the frame format of the given video file.
+ *
+ * @param file video file.
+ * @return frame format.
+ */
+const VideoFormat* GetVideoFormat(const VideoFile* file);
+
+/**
+ * Gets the number of frames of the given video file.
+ *
+ * @param file video file.
+ * @return number of frames.
+ */
+size_t GetVideoFrameCount(const VideoFile* file);
+
+/**
+ * Gets the given frame, seeking to it if it does not follow the
+ * last one.
+ *
+ * @param file video file.
+ * @param index frame number.
+ * @param error error code.
+ * @return frame data, frame size bytes valid until the next frame
+ *         is got or the file is closed, or NULL if failed. Not
+ *         aligned.
+ */
+const char* GetVideoFrame(
+		VideoFile* file,
+		size_t index,
+		std::error_code& error);
+
+/**
+ * Closes the given video file and releases its mapping and index.
+ *
+ * @param file video file, may be NULL.
+ */
+void CloseVideoFile(VideoFile* file);
+
+#endif
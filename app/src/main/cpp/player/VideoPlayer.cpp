@@ -0,0 +1,611 @@
+#include "VideoPlayer.h"
+
+// pthread_create, pthread_join, pthread_setname_np
+#include <pthread.h>
+
+// clock_gettime, clock_nanosleep, nanosleep
+#include <time.h>
+
+// posix_memalign, free
+#include <stdlib.h>
+
+// memcpy
+#include <string.h>
+
+// errno, EINTR
+#include <errno.h>
+
+// int64_t, SIZE_MAX
+#include <stdint.h>
+
+// std::atomic
+#include <atomic>
+
+// placement new
+#include <new>
+
+// Bytes of the converted frames cached for seeking, by default
+#define DEFAULT_FRAME_CACHE_SIZE (64 * 1024 * 1024)
+
+// Frames cached from the frame decoding starts at, after a seek,
+// the frames played in order later are not cached
+#define SEEK_CACHE_FRAMES 30
+
+// Bytes of the converted frames decoded ahead of playback
+#define DECODE_AHEAD_SIZE (32 * 1024 * 1024)
+
+// Frames decoded ahead, whatever their size
+#define MIN_DECODE_AHEAD_FRAMES 2
+#define MAX_DECODE_AHEAD_FRAMES 8
+
+// Longest sleep of the decode thread, bounds the time to stop it
+#define MAX_DECODE_SLEEP (20 * 1000 * 1000)
+
+// Sleep of the render side while the decode thread is behind
+#define RENDER_POLL_SLEEP (1000 * 1000)
+
+// Cache line size, the positions of both sides are kept apart
+#define PLAYER_CACHE_LINE 64
+
+// Alignment of the frame buffers, for the vector stores
+#define FRAME_BUFFER_ALIGNMENT 64
+
+// No seek or cache budget change is pending
+#define NO_PLAYER_REQUEST SIZE_MAX
+
+#define NANOS_PER_SECOND 1000000000LL
+
+/**
+ * Converted frame in the pool.
+ */
+struct DecodedFrame
+{
+	// Frame number
+	size_t index;
+
+	// Converted pixels, rows are not padded
+	char* pixels;
+};
+
+/**
+ * Video player handle.
+ */
+struct VideoPlayer
+{
+	// Only used by the decode thread while it runs
+	VideoFile* file;
+
+	// Ring of the frame pool, each slot owns its buffer
+	DecodedFrame frames[MAX_DECODE_AHEAD_FRAMES];
+	size_t frameCount;
+
+	// All of the frame buffers
+	char* buffers;
+
+	// Bytes per row and bytes of the frame buffers
+	size_t frameStride;
+	size_t frameBytes;
+
+	// Recently decoded frames, only used by the decode thread
+	// while it runs
+	FrameCache* cache;
+
+	// Conversion of the frames
+	BitmapFormat format;
+	PixelIsa isa;
+
+	// Nanoseconds per frame, zero without a frame rate
+	int64_t frameInterval;
+
+	// Sleep of the decode thread while the pool is full
+	int64_t decodeSleep;
+
+	// Decode thread, to be joined if running, only used by the
+	// render side
+	pthread_t thread;
+	bool running;
+
+	// First frame decoded by the thread
+	size_t startFrame;
+
+	// Frame after the last one rendered
+	size_t nextFrame;
+
+	// Presentation time of the clock frame, the later frames
+	// follow at the frame rate
+	bool clockSet;
+	int64_t clockTime;
+	size_t clockFrame;
+
+	// Decode failure, set before the thread is finished
+	std::error_code decodeError;
+
+	// Read position, written by the render side
+	alignas(PLAYER_CACHE_LINE) std::atomic<size_t> head;
+
+	// Write position, written by the decode thread
+	alignas(PLAYER_CACHE_LINE) std::atomic<size_t> tail;
+
+	// Decode thread is done, at the end of the video or failed
+	std::atomic<bool> finished;
+
+	// Decode thread is asked to stop
+	alignas(PLAYER_CACHE_LINE) std::atomic<bool> stopping;
+
+	// Seek and cache budget posted from any thread, applied by the
+	// next render
+	std::atomic<size_t> seekRequest;
+	std::atomic<size_t> cacheSizeRequest;
+};
+
+/**
+ * Gets the monotonic time.
+ *
+ * @return nanoseconds.
+ */
+static int64_t GetMonotonicTime()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec * NANOS_PER_SECOND) + now.tv_nsec;
+}
+
+/**
+ * Sleeps for the given time.
+ *
+ * @param nanos nanoseconds.
+ */
+static void SleepFor(int64_t nanos)
+{
+	struct timespec duration;
+	duration.tv_sec = (time_t) (nanos / NANOS_PER_SECOND);
+	duration.tv_nsec = (long) (nanos % NANOS_PER_SECOND);
+
+	nanosleep(&duration, NULL);
+}
+
+/**
+ * Sleeps until the given monotonic time.
+ *
+ * @param time nanoseconds.
+ */
+static void SleepUntil(int64_t time)
+{
+	struct timespec deadline;
+	deadline.tv_sec = (time_t) (time / NANOS_PER_SECOND);
+	deadline.tv_nsec = (long) (time % NANOS_PER_SECOND);
+
+	// Restarted with the same deadline when interrupted
+	while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+			&deadline, NULL))
+	{
+	}
+}
+
+/**
+ * Decode thread, converts the frames into the free buffers of the
+ * pool until the end of the video.
+ *
+ * @param args video player.
+ * @return NULL.
+ */
+static void* DecodeThread(void* args)
+{
+	VideoPlayer* player = (VideoPlayer*) args;
+	const VideoFormat* format = GetVideoFormat(player->file);
+	size_t frameCount = GetVideoFrameCount(player->file);
+
+	size_t tail = player->tail.load(std::memory_order_relaxed);
+	size_t index = player->startFrame;
+
+	while ((index < frameCount)
+			&& !player->stopping.load(std::memory_order_acquire))
+	{
+		// Wait for the render side to return a buffer, frees one
+		// per frame interval
+		if (tail - player->head.load(std::memory_order_acquire)
+				== player->frameCount)
+		{
+			SleepFor(player->decodeSleep);
+			continue;
+		}
+
+		DecodedFrame* frame = &player->frames[tail % player->frameCount];
+		frame->index = index;
+
+		// Frames seen recently are copied instead of converted
+		const char* cached = FindCachedFrame(player->cache, index);
+		if (NULL != cached)
+		{
+			memcpy(frame->pixels, cached, player->frameBytes);
+		}
+		else
+		{
+			// Slice of the mapping, read ahead by the video file
+			const char* data = GetVideoFrame(player->file, index,
+					player->decodeError);
+			if (NULL == data)
+				break;
+
+			VideoBitmap bitmap;
+			bitmap.width = format->width;
+			bitmap.height = format->height;
+			bitmap.stride = player->frameStride;
+			bitmap.format = player->format;
+			bitmap.pixels = frame->pixels;
+
+			ConvertVideoFrame(format, data, &bitmap, player->isa);
+
+			// Only the frames a seek back lands on are worth a copy
+			if (index - player->startFrame < SEEK_CACHE_FRAMES)
+			{
+				AddCachedFrame(player->cache, index, frame->pixels);
+			}
+		}
+
+		// Publish the frame to the render side
+		player->tail.store(++tail, std::memory_order_release);
+		index++;
+	}
+
+	// Publishes the decode error as well
+	player->finished.store(true, std::memory_order_release);
+
+	return NULL;
+}
+
+/**
+ * Stops the decode thread if it is running and waits for it.
+ *
+ * @param player video player.
+ */
+static void StopDecodeThread(VideoPlayer* player)
+{
+	if (player->running)
+	{
+		player->stopping.store(true, std::memory_order_release);
+		pthread_join(player->thread, NULL);
+
+		player->running = false;
+	}
+}
+
+/**
+ * Applies the seek and the cache budget posted since the last
+ * render, stopping the decode thread for them.
+ *
+ * @param player video player.
+ */
+static void ApplyPlayerRequests(VideoPlayer* player)
+{
+	size_t size = player->cacheSizeRequest.exchange(NO_PLAYER_REQUEST,
+			std::memory_order_acquire);
+	if (NO_PLAYER_REQUEST != size)
+	{
+		// Restarted from the next frame by the render
+		StopDecodeThread(player);
+		SetFrameCacheBudget(player->cache, size);
+	}
+
+	size_t index = player->seekRequest.exchange(NO_PLAYER_REQUEST,
+			std::memory_order_acquire);
+	if (NO_PLAYER_REQUEST != index)
+	{
+		// Restarted from the frame by the render
+		StopDecodeThread(player);
+		player->nextFrame = index;
+	}
+}
+
+/**
+ * Allocates the frame pool for the given bitmap format, unless
+ * the current one has the same frame size.
+ *
+ * @param player video player.
+ * @param format bitmap format.
+ * @return false if out of memory.
+ */
+static bool AllocateFramePool(VideoPlayer* player, BitmapFormat format)
+{
+	const VideoFormat* videoFormat = GetVideoFormat(player->file);
+	size_t pixelSize = (BITMAP_FORMAT_RGBA_8888 == format) ? 4 : 2;
+	size_t frameStride = (size_t) videoFormat->width * pixelSize;
+
+	if ((NULL != player->buffers) && (frameStride == player->frameStride))
+		return true;
+
+	free(player->buffers);
+	player->buffers = NULL;
+
+	player->frameStride = frameStride;
+	player->frameBytes = frameStride * videoFormat->height;
+
+	// Cached frames of the other format are dropped
+	ResetFrameCache(player->cache, player->frameBytes);
+
+	// Frames of the decode ahead size, in the pool limits
+	size_t frameCount = DECODE_AHEAD_SIZE / player->frameBytes;
+	if (frameCount < MIN_DECODE_AHEAD_FRAMES)
+	{
+		frameCount = MIN_DECODE_AHEAD_FRAMES;
+	}
+	else if (frameCount > MAX_DECODE_AHEAD_FRAMES)
+	{
+		frameCount = MAX_DECODE_AHEAD_FRAMES;
+	}
+
+	void* buffers;
+	if (0 != posix_memalign(&buffers, FRAME_BUFFER_ALIGNMENT,
+			frameCount * player->frameBytes))
+		return false;
+
+	player->buffers = (char*) buffers;
+	player->frameCount = frameCount;
+
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		player->frames[i].pixels = player->buffers + (i * player->frameBytes);
+	}
+
+	return true;
+}
+
+/**
+ * Waits until the presentation time of the given frame. The clock
+ * starts at the first frame rendered and restarts when a frame is
+ * late by more than a frame interval, instead of catching up.
+ *
+ * @param player video player.
+ * @param index frame number.
+ */
+static void WaitFramePresentation(VideoPlayer* player, size_t index)
+{
+	int64_t now = GetMonotonicTime();
+
+	if (player->clockSet)
+	{
+		int64_t time = player->clockTime
+				+ (((int64_t) index - (int64_t) player->clockFrame)
+				* player->frameInterval);
+
+		if (time > now)
+		{
+			SleepUntil(time);
+			return;
+		}
+
+		if (now - time <= player->frameInterval)
+			return;
+	}
+
+	player->clockSet = true;
+	player->clockTime = now;
+	player->clockFrame = index;
+}
+
+/**
+ * Copies the given converted frame into the bitmap, only the area
+ * of both sizes.
+ *
+ * @param player video player.
+ * @param frame converted frame.
+ * @param bitmap destination bitmap, in the format of the frame.
+ */
+static void CopyDecodedFrame(
+		const VideoPlayer* player,
+		const DecodedFrame* frame,
+		const VideoBitmap* bitmap)
+{
+	const VideoFormat* format = GetVideoFormat(player->file);
+	int width = (format->width < bitmap->width)
+			? format->width : bitmap->width;
+	int height = (format->height < bitmap->height)
+			? format->height : bitmap->height;
+	size_t rowBytes = (player->frameStride / format->width) * width;
+
+	for (int row = 0; row < height; row++)
+	{
+		memcpy((char*) bitmap->pixels + (row * bitmap->stride),
+				frame->pixels + (row * player->frameStride), rowBytes);
+	}
+}
+
+VideoPlayer* OpenVideoPlayer(const char* path, std::error_code& error)
+{
+	VideoFile* file = OpenVideoFile(path, error);
+	if (NULL == file)
+		return NULL;
+
+	// Plain new does not honor the cache line alignment
+	void* memory;
+	if (0 != posix_memalign(&memory, PLAYER_CACHE_LINE, sizeof(VideoPlayer)))
+	{
+		CloseVideoFile(file);
+
+		error.assign(ENOMEM, std::system_category());
+		return NULL;
+	}
+
+	VideoPlayer* player = new (memory) VideoPlayer();
+	player->file = file;
+	player->cache = NewFrameCache(GetVideoFrameCount(file),
+			DEFAULT_FRAME_CACHE_SIZE);
+	player->frameCount = 0;
+	player->buffers = NULL;
+	player->frameStride = 0;
+	player->frameBytes = 0;
+	player->format = BITMAP_FORMAT_RGBA_8888;
+	player->isa = PIXEL_ISA_SCALAR;
+	player->running = false;
+	player->startFrame = 0;
+	player->nextFrame = 0;
+	player->clockSet = false;
+	player->clockTime = 0;
+	player->clockFrame = 0;
+	player->seekRequest.store(NO_PLAYER_REQUEST, std::memory_order_relaxed);
+	player->cacheSizeRequest.store(NO_PLAYER_REQUEST,
+			std::memory_order_relaxed);
+
+	// Frames are paced by the frame rate if there is one
+	double frameRate = GetVideoFormat(file)->frameRate;
+	player->frameInterval = (frameRate > 0.0)
+			? (int64_t) (NANOS_PER_SECOND / frameRate) : 0;
+
+	player->decodeSleep = player->frameInterval / 2;
+	if (player->decodeSleep > MAX_DECODE_SLEEP)
+	{
+		player->decodeSleep = MAX_DECODE_SLEEP;
+	}
+	else if (player->decodeSleep < RENDER_POLL_SLEEP)
+	{
+		player->decodeSleep = RENDER_POLL_SLEEP;
+	}
+
+	return player;
+}
+
+const VideoFormat* GetVideoPlayerFormat(const VideoPlayer* player)
+{
+	return GetVideoFormat(player->file);
+}
+
+size_t GetVideoPlayerFrameCount(const VideoPlayer* player)
+{
+	return GetVideoFrameCount(player->file);
+}
+
+bool StartVideoPlayer(
+		VideoPlayer* player,
+		BitmapFormat format,
+		std::error_code& error)
+{
+	StopDecodeThread(player);
+
+	// Buffers are reused unless the pixel size changes
+	if (!AllocateFramePool(player, format))
+	{
+		error.assign(ENOMEM, std::system_category());
+		return false;
+	}
+
+	player->format = format;
+	player->isa = GetBestPixelIsa();
+
+	// Decoding resumes at the next frame, the clock restarts
+	player->startFrame = player->nextFrame;
+	player->clockSet = false;
+	player->decodeError.clear();
+
+	player->head.store(0, std::memory_order_relaxed);
+	player->tail.store(0, std::memory_order_relaxed);
+	player->finished.store(false, std::memory_order_relaxed);
+	player->stopping.store(false, std::memory_order_relaxed);
+
+	// Published to the thread by its creation
+	int result = pthread_create(&player->thread, NULL, DecodeThread, player);
+	if (0 != result)
+	{
+		error.assign(result, std::system_category());
+		return false;
+	}
+
+	// Name the decode thread for the profilers
+	pthread_setname_np(player->thread, "VideoDecoder");
+	player->running = true;
+
+	return true;
+}
+
+bool RenderVideoFrame(
+		VideoPlayer* player,
+		const VideoBitmap* bitmap,
+		std::error_code& error)
+{
+	ApplyPlayerRequests(player);
+
+	if ((!player->running) || (bitmap->format != player->format))
+	{
+		if (!StartVideoPlayer(player, bitmap->format, error))
+			return false;
+	}
+
+	// Wait for a ready frame, only if the decode thread is behind
+	size_t head = player->head.load(std::memory_order_relaxed);
+	while (head == player->tail.load(std::memory_order_acquire))
+	{
+		if (player->finished.load(std::memory_order_acquire))
+		{
+			// Frames queued right before the thread finished
+			if (head != player->tail.load(std::memory_order_acquire))
+				break;
+
+			error = player->decodeError;
+			return false;
+		}
+
+		SleepFor(RENDER_POLL_SLEEP);
+	}
+
+	const DecodedFrame* frame = &player->frames[head % player->frameCount];
+
+	WaitFramePresentation(player, frame->index);
+	CopyDecodedFrame(player, frame, bitmap);
+	player->nextFrame = frame->index + 1;
+
+	// Return the buffer to the pool
+	player->head.store(head + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool SeekVideoPlayer(
+		VideoPlayer* player,
+		size_t index,
+		std::error_code& error)
+{
+	if (index >= GetVideoFrameCount(player->file))
+	{
+		error = PLAYER_ERROR_FRAME_OUT_OF_RANGE;
+		return false;
+	}
+
+	// Posted to the render side, a later seek replaces it
+	player->seekRequest.store(index, std::memory_order_release);
+
+	return true;
+}
+
+void SetVideoPlayerCacheSize(VideoPlayer* player, size_t size)
+{
+	// The largest budget marks no request, one byte less is as big
+	if (NO_PLAYER_REQUEST == size)
+	{
+		size--;
+	}
+
+	// Posted to the render side, a later budget replaces it
+	player->cacheSizeRequest.store(size, std::memory_order_release);
+}
+
+void GetVideoPlayerCacheStats(
+		const VideoPlayer* player,
+		FrameCacheStats* stats)
+{
+	GetFrameCacheStats(player->cache, stats);
+}
+
+void CloseVideoPlayer(VideoPlayer* player)
+{
+	if (NULL != player)
+	{
+		StopDecodeThread(player);
+
+		free(player->buffers);
+		FreeFrameCache(player->cache);
+		CloseVideoFile(player->file);
+
+		player->~VideoPlayer();
+		free(player);
+	}
+}
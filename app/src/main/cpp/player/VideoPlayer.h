@@ -0,0 +1,131 @@
+#ifndef VIDEO_PLAYER_H
+#define VIDEO_PLAYER_H
+
+#include "VideoFile.h"
+#include "PixelConverter.h"
+#include "FrameCache.h"
+
+/*
+ * A video player owns a video file and a decode thread. Once
+ * started, the thread converts the frames ahead of playback into
+ * a bounded pool of buffers, allocated when the player starts, and
+ * queues them to the render side through a lock free single
+ * producer single consumer ring. The decode thread is paced by the
+ * ring and the frame rate, rendering a frame only copies a ready
+ * buffer into the bitmap and returns it to the pool, and waits for
+ * its presentation time. The frames converted right after a seek
+ * are also kept in a frame cache, so seeking back to a recent
+ * position copies them instead of converting them again, the
+ * frames played in order are not cached. A player is rendered by a
+ * single thread, seeks and cache budget changes may come from any
+ * thread and are applied by the next render. Failures are reported
+ * through the error code.
+ */
+
+/**
+ * Video player handle.
+ */
+struct VideoPlayer;
+
+/**
+ * Opens the given video file for playback. The decode thread is
+ * not started yet.
+ *
+ * @param path file path.
+ * @param error error code.
+ * @return video player or NULL if failed.
+ */
+VideoPlayer* OpenVideoPlayer(const char* path, std::error_code& error);
+
+/**
+ * Gets the frame format of the given video player.
+ *
+ * @param player video player.
+ * @return frame format.
+ */
+const VideoFormat* GetVideoPlayerFormat(const VideoPlayer* player);
+
+/**
+ * Gets the number of frames of the given video player.
+ *
+ * @param player video player.
+ * @return number of frames.
+ */
+size_t GetVideoPlayerFrameCount(const VideoPlayer* player);
+
+/**
+ * Starts the decode thread, converting the frames into the given
+ * bitmap format from the next frame to render. A running decode
+ * thread is stopped first and its queued frames are dropped.
+ *
+ * @param player video player.
+ * @param format bitmap format.
+ * @param error error code.
+ * @return false if failed.
+ */
+bool StartVideoPlayer(
+		VideoPlayer* player,
+		BitmapFormat format,
+		std::error_code& error);
+
+/**
+ * Renders the next frame into the given bitmap, starting the
+ * decode thread if it is not started or converts into another
+ * format. Waits until the frame is decoded and until its
+ * presentation time.
+ *
+ * @param player video player.
+ * @param bitmap destination bitmap.
+ * @param error error code.
+ * @return false at the end of the video or if failed.
+ */
+bool RenderVideoFrame(
+		VideoPlayer* player,
+		const VideoBitmap* bitmap,
+		std::error_code& error);
+
+/**
+ * Makes the given frame the next one to render, from any thread.
+ * The next render stops the decode thread, drops its queued frames
+ * and restarts it from the frame.
+ *
+ * @param player video player.
+ * @param index frame number.
+ * @param error error code.
+ * @return false if the frame is out of range.
+ */
+bool SeekVideoPlayer(
+		VideoPlayer* player,
+		size_t index,
+		std::error_code& error);
+
+/**
+ * Sets the memory budget of the frame cache, 64 MiB by default,
+ * from any thread. The next render stops the decode thread, drops
+ * its queued frames, changes the budget and restarts the thread
+ * from the next frame.
+ *
+ * @param player video player.
+ * @param size budget in bytes, zero disables the cache.
+ */
+void SetVideoPlayerCacheSize(VideoPlayer* player, size_t size);
+
+/**
+ * Gets the counters and usage of the frame cache, from any thread.
+ *
+ * @param player video player.
+ * @param stats statistics.
+ */
+void GetVideoPlayerCacheStats(
+		const VideoPlayer* player,
+		FrameCacheStats* stats);
+
+/**
+ * Stops the decode thread if it is running, releases the frame
+ * buffers and the frame cache and closes the video file.
+ *
+ * @param player video player, may be NULL.
+ */
+void CloseVideoPlayer(VideoPlayer* player);
+
+#endif
@@ -0,0 +1,280 @@
+#include "com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity.h"
+#include "com_example_lutao_cmakejni_player_bitmap_BitmapPlayerActivity.h"
+#include "VideoPlayer.h"
+#include "JniCache.h"
+#include "JniModules.h"
+
+// JNI
+#include <jni.h>
+
+// NULL
+#include <stdio.h>
+
+// intptr_t
+#include <stdint.h>
+
+#ifdef __ANDROID__
+// AndroidBitmap_getInfo, AndroidBitmap_lockPixels
+#include <android/bitmap.h>
+
+static_assert((int) ANDROID_BITMAP_FORMAT_RGBA_8888 == (int) BITMAP_FORMAT_RGBA_8888,
+		"Bitmap formats must match the Android ones");
+static_assert((int) ANDROID_BITMAP_FORMAT_RGB_565 == (int) BITMAP_FORMAT_RGB_565,
+		"Bitmap formats must match the Android ones");
+#endif
+
+/**
+ * Throws an IOException with the message of the given error
+ * code, if it is set.
+ *
+ * @param env JNIEnv interface.
+ * @param error error code.
+ */
+static void ThrowErrorException(
+		JNIEnv* env,
+		const std::error_code& error)
+{
+	if (error)
+	{
+		// Exception classes are cached when the library loads
+		ThrowJniException(env, "java/io/IOException",
+				error.message().c_str());
+	}
+}
+
+JNIEXPORT jlong JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_open
+		(JNIEnv* env,
+		jclass clazz,
+		jstring fileName)
+{
+	std::error_code error;
+	VideoPlayer* player = NULL;
+
+	// Get the file name as C string
+	const char* path = env->GetStringUTFChars(fileName, NULL);
+	if (NULL != path)
+	{
+		// Parse the index of the frames once, the decode thread
+		// starts with the first frame rendered
+		player = OpenVideoPlayer(path, error);
+
+		// Release the file name
+		env->ReleaseStringUTFChars(fileName, path);
+	}
+
+	ThrowErrorException(env, error);
+
+	return (jlong) (intptr_t) player;
+}
+
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getWidth
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	return GetVideoPlayerFormat((VideoPlayer*) (intptr_t) avi)->width;
+}
+
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getHeight
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	return GetVideoPlayerFormat((VideoPlayer*) (intptr_t) avi)->height;
+}
+
+JNIEXPORT jdouble JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameRate
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	return GetVideoPlayerFormat((VideoPlayer*) (intptr_t) avi)->frameRate;
+}
+
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameCount
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	return (jint) GetVideoPlayerFrameCount((VideoPlayer*) (intptr_t) avi);
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_seek
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi,
+		jint frame)
+{
+	std::error_code error;
+
+	if (0 > frame)
+	{
+		error = PLAYER_ERROR_FRAME_OUT_OF_RANGE;
+	}
+	else
+	{
+		// Decoding restarts from the frame with the next render
+		SeekVideoPlayer((VideoPlayer*) (intptr_t) avi, (size_t) frame, error);
+	}
+
+	ThrowErrorException(env, error);
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_setCacheSize
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi,
+		jlong size)
+{
+	SetVideoPlayerCacheSize((VideoPlayer*) (intptr_t) avi,
+			(0 > size) ? 0 : (size_t) size);
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getCacheStats
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	FrameCacheStats stats;
+	GetVideoPlayerCacheStats((VideoPlayer*) (intptr_t) avi, &stats);
+
+	// Snapshot layout known to the Java side
+	jlong values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_STATS_SIZE];
+	values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_HITS] = (jlong) stats.hits;
+	values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_MISSES] = (jlong) stats.misses;
+	values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_EVICTIONS] = (jlong) stats.evictions;
+	values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_FRAMES] = (jlong) stats.frames;
+	values[com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_BYTES] = (jlong) stats.bytes;
+
+	jlongArray snapshot = env->NewLongArray(
+			com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_STATS_SIZE);
+	if (NULL != snapshot)
+	{
+		env->SetLongArrayRegion(snapshot, 0,
+				com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_STATS_SIZE, values);
+	}
+
+	return snapshot;
+}
+
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_close
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi)
+{
+	CloseVideoPlayer((VideoPlayer*) (intptr_t) avi);
+}
+
+#ifdef __ANDROID__
+JNIEXPORT jboolean JNICALL Java_com_example_lutao_cmakejni_player_bitmap_BitmapPlayerActivity_render
+		(JNIEnv* env,
+		jclass clazz,
+		jlong avi,
+		jobject bitmap)
+{
+	std::error_code error;
+	bool rendered = false;
+
+	AndroidBitmapInfo info;
+	void* pixels = NULL;
+
+	// Get the bitmap info
+	if (0 > AndroidBitmap_getInfo(env, bitmap, &info))
+	{
+		ThrowJniException(env, "java/io/IOException",
+				"Unable to get the bitmap info.");
+	}
+	else if ((ANDROID_BITMAP_FORMAT_RGBA_8888 != info.format)
+			&& (ANDROID_BITMAP_FORMAT_RGB_565 != info.format))
+	{
+		ThrowJniException(env, "java/io/IOException",
+				"Bitmap format is not supported.");
+	}
+	// Lock the bitmap pixels
+	else if (0 > AndroidBitmap_lockPixels(env, bitmap, &pixels))
+	{
+		ThrowJniException(env, "java/io/IOException",
+				"Unable to lock the bitmap pixels.");
+	}
+	else
+	{
+		VideoBitmap videoBitmap;
+		videoBitmap.width = (int) info.width;
+		videoBitmap.height = (int) info.height;
+		videoBitmap.stride = info.stride;
+		videoBitmap.format = (BitmapFormat) info.format;
+		videoBitmap.pixels = pixels;
+
+		// Copy the next decoded frame, once it is due
+		rendered = RenderVideoFrame((VideoPlayer*) (intptr_t) avi,
+				&videoBitmap, error);
+
+		// Unlock the bitmap pixels
+		AndroidBitmap_unlockPixels(env, bitmap);
+
+		ThrowErrorException(env, error);
+	}
+
+	return rendered;
+}
+#endif
+
+// Classes whose native methods are registered on load
+#define ABSTRACT_PLAYER_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/player/bitmap/AbstractPlayerActivity"
+#define BITMAP_PLAYER_ACTIVITY_CLASS \
+		"com/example/lutao/cmakejni/player/bitmap/BitmapPlayerActivity"
+
+// Native methods of the activity
+static const JNINativeMethod gAbstractPlayerActivityMethods[] =
+{
+	{ "open", "(Ljava/lang/String;)J",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_open },
+	{ "getWidth", "(J)I",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getWidth },
+	{ "getHeight", "(J)I",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getHeight },
+	{ "getFrameRate", "(J)D",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameRate },
+	{ "getFrameCount", "(J)I",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameCount },
+	{ "seek", "(JI)V",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_seek },
+	{ "setCacheSize", "(JJ)V",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_setCacheSize },
+	{ "getCacheStats", "(J)[J",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getCacheStats },
+	{ "close", "(J)V",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_close },
+};
+
+#ifdef __ANDROID__
+// Native methods of the bitmap player, rendering needs the Android
+// bitmaps
+static const JNINativeMethod gBitmapPlayerActivityMethods[] =
+{
+	{ "render", "(JLandroid/graphics/Bitmap;)Z",
+			(void*) Java_com_example_lutao_cmakejni_player_bitmap_BitmapPlayerActivity_render },
+};
+#endif
+
+bool LoadPlayerModule(JavaVM* vm, JNIEnv* env)
+{
+	// Cache the exception class thrown by the native methods
+	CacheJniClass(env, "java/io/IOException");
+
+	// Bind the native methods now, the symbols are not exported
+	if (!RegisterJniNatives(env, ABSTRACT_PLAYER_ACTIVITY_CLASS,
+			gAbstractPlayerActivityMethods,
+			JNI_METHOD_COUNT(gAbstractPlayerActivityMethods)))
+		return false;
+
+#ifdef __ANDROID__
+	if (!RegisterJniNatives(env, BITMAP_PLAYER_ACTIVITY_CLASS,
+			gBitmapPlayerActivityMethods,
+			JNI_METHOD_COUNT(gBitmapPlayerActivityMethods)))
+		return false;
+#endif
+
+	return true;
+}
@@ -7,6 +7,18 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_HITS
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_HITS 0L
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_MISSES
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_MISSES 1L
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_EVICTIONS
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_EVICTIONS 2L
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_FRAMES
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_FRAMES 3L
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_BYTES
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_BYTES 4L
+#undef com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_STATS_SIZE
+#define com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_CACHE_STATS_SIZE 5L
 /*
  * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
  * Method:    open
@@ -39,6 +51,38 @@ JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPla
 JNIEXPORT jdouble JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameRate
   (JNIEnv *, jclass, jlong);
 
+/*
+ * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
+ * Method:    getFrameCount
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getFrameCount
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
+ * Method:    seek
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_seek
+  (JNIEnv *, jclass, jlong, jint);
+
+/*
+ * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
+ * Method:    setCacheSize
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_setCacheSize
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
+ * Method:    getCacheStats
+ * Signature: (J)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity_getCacheStats
+  (JNIEnv *, jclass, jlong);
+
 /*
  * Class:     com_example_lutao_cmakejni_player_bitmap_AbstractPlayerActivity
  * Method:    close
@@ -7,8 +7,14 @@ import android.widget.Button;
 import android.widget.EditText;
 import android.widget.TextView;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.Charset;
+
 public class MainActivity extends AppCompatActivity
 {
+    private static final Charset UTF_8 = Charset.forName("UTF-8");
+
     EditText edit_thread_count, edit_iter_count;
     Button btn_start_thread;
     TextView tv_log;
@@ -16,7 +22,12 @@ public class MainActivity extends AppCompatActivity
     // Used to load the 'native-lib' library on application startup.
     static
     {
-        System.loadLibrary("native-lib");
+        if (BuildConfig.JNI_SINGLE_LIBRARY) {
+            System.loadLibrary("cmakejni");
+        } else {
+            System.loadLibrary("native-lib");
+            System.loadLibrary("jnidynamicload");
+        }
     }
 
     @Override
@@ -62,6 +73,53 @@ public class MainActivity extends AppCompatActivity
         });
     }
 
+    /**
+     * Receives a batch of native messages.
+     * @param messages messages.
+     */
+    private void onNativeMessages(String[] messages) {
+        final StringBuilder text = new StringBuilder();
+        for (String message : messages) {
+            text.append(message).append('\n');
+        }
+
+        appendLog(text);
+    }
+
+    /**
+     * Receives a batch of native messages as records of a 32-bit
+     * length in native byte order, the UTF-8 bytes and a NULL
+     * terminator. The buffer is only valid during the call.
+     * @param buffer direct buffer of records.
+     */
+    private void onNativeMessageBuffer(ByteBuffer buffer) {
+        buffer.order(ByteOrder.nativeOrder());
+
+        final StringBuilder text = new StringBuilder();
+        byte[] bytes = new byte[64];
+        while (buffer.remaining() >= 4) {
+            int length = buffer.getInt();
+            if (length > bytes.length) {
+                bytes = new byte[length];
+            }
+
+            buffer.get(bytes, 0, length);
+            buffer.get();
+
+            text.append(new String(bytes, 0, length, UTF_8)).append('\n');
+        }
+
+        appendLog(text);
+    }
+
+    private void appendLog(final CharSequence text) {
+        runOnUiThread(new Runnable() {
+            public void run() {
+                tv_log.append(text);
+            }
+        });
+    }
+
     private static int getNumber(EditText editText, int defaultValue) {
         int value;
         try {
@@ -74,11 +132,27 @@ public class MainActivity extends AppCompatActivity
     }
 
     private void startThreads(int threads, int iterations) {
-        posixThreads(threads, iterations);
+        nativeSubmit(threads, iterations);
+
+        // Wait off the UI thread
+        Thread awaitThread = new Thread() {
+            public void run() {
+                nativeAwait();
+                onNativeMessage("Workers done.");
+            }
+        };
+
+        awaitThread.start();
     }
 
     public native String stringFromJNI();
 
+    /**
+     * Registered by the jnidynamicload library.
+     * @return random number.
+     */
+    public native int getRandomNum();
+
     /**
      * Initializes the native code.
      */
@@ -89,6 +163,13 @@ public class MainActivity extends AppCompatActivity
      */
     public native void nativeFree();
 
+    /**
+     * Selects how the batched native messages are delivered.
+     * @param directBuffer to onNativeMessageBuffer if true, to
+     *                     onNativeMessages otherwise.
+     */
+    public native void nativeSetMessageBuffer(boolean directBuffer);
+
     /**
      * Native worker.
      * @param id worker id.
@@ -97,12 +178,18 @@ public class MainActivity extends AppCompatActivity
     public native void nativeWorker(int id, int iterations);
 
     /**
-     * Using the POSIX threads.
+     * Submits native workers to the native thread pool. The pool
+     * has a thread per core, started by nativeInit.
      *
-     * @param threads thread count.
+     * @param tasks worker count.
      * @param iterations iteration count.
      */
-    public native void posixThreads(int threads, int iterations);
+    public native void nativeSubmit(int tasks, int iterations);
+
+    /**
+     * Waits until all submitted native workers are done.
+     */
+    public native void nativeAwait();
 
     /**
      * Using Java based threads.
@@ -10,6 +10,7 @@ import android.widget.EditText;
 import android.widget.ScrollView;
 import android.widget.TextView;
 
+import com.example.lutao.cmakejni.BuildConfig;
 import com.example.lutao.cmakejni.R;
 
 /**
@@ -17,6 +18,35 @@ import com.example.lutao.cmakejni.R;
  */
 public abstract class AbstractEchoActivity extends Activity implements
 		OnClickListener {
+	/** Native log levels. */
+	public static final int LOG_LEVEL_TRACE = 0;
+	public static final int LOG_LEVEL_DEBUG = 1;
+	public static final int LOG_LEVEL_INFO = 2;
+	public static final int LOG_LEVEL_WARN = 3;
+	public static final int LOG_LEVEL_ERROR = 4;
+
+	/** Native metrics counters, indexes of the snapshot. */
+	public static final int METRIC_ACCEPTED = 0;
+	public static final int METRIC_BYTES_IN = 1;
+	public static final int METRIC_BYTES_OUT = 2;
+	public static final int METRIC_SYSCALLS = 3;
+	public static final int METRIC_WOULD_BLOCK = 4;
+
+	/** Native metrics histograms, indexes of the snapshot. */
+	public static final int METRIC_RECV_LATENCY = 5;
+	public static final int METRIC_SEND_LATENCY = 40;
+	public static final int METRIC_QUEUE_DEPTH = 75;
+
+	/**
+	 * Offsets in a histogram. Bucket i counts the values below 2^i and
+	 * not below 2^(i - 1), latencies are in nanoseconds.
+	 */
+	public static final int HISTOGRAM_COUNT = 0;
+	public static final int HISTOGRAM_SUM = 1;
+	public static final int HISTOGRAM_MAX = 2;
+	public static final int HISTOGRAM_BUCKETS = 3;
+	public static final int HISTOGRAM_BUCKET_COUNT = 32;
+
 	/** Port number. */
 	protected EditText portEdit;
 
@@ -101,6 +131,65 @@ public abstract class AbstractEchoActivity extends Activity implements
 		logScroll.fullScroll(View.FOCUS_DOWN);
 	}
 	
+	/**
+	 * Sets the minimum level of the native log messages. Levels
+	 * compiled out of the native library stay disabled.
+	 * @param level
+	 */
+	public static native void nativeSetLogLevel(int level);
+
+	/**
+	 * Sets the data buffer size of the native servers and clients
+	 * started afterwards.
+	 * @param bufferSize buffer size in bytes.
+	 */
+	public static native void nativeSetBufferSize(int bufferSize);
+
+	/**
+	 * Enables echoing through a kernel pipe with splice in the native
+	 * TCP and local socket servers started afterwards, the data is not
+	 * copied to user space.
+	 * @param enabled
+	 */
+	public static native void nativeSetZeroCopy(boolean enabled);
+
+	/**
+	 * Gets a snapshot of the native metrics, summed over all threads
+	 * since the library is loaded.
+	 * @return counters followed by the histograms.
+	 */
+	public static native long[] nativeGetMetrics();
+
+	/**
+	 * Logs the native metrics.
+	 */
+	protected void logMetrics() {
+		long[] metrics = nativeGetMetrics();
+
+		logMessage("Accepted " + metrics[METRIC_ACCEPTED]
+				+ ", in " + metrics[METRIC_BYTES_IN]
+				+ " bytes, out " + metrics[METRIC_BYTES_OUT]
+				+ " bytes, " + metrics[METRIC_SYSCALLS] + " calls, "
+				+ metrics[METRIC_WOULD_BLOCK] + " would block.");
+		logMessage("Receive " + formatLatency(metrics, METRIC_RECV_LATENCY)
+				+ ", send " + formatLatency(metrics, METRIC_SEND_LATENCY)
+				+ ".");
+	}
+
+	/**
+	 * Formats the mean and max of the given latency histogram.
+	 * @param metrics
+	 * @param histogram
+	 * @return latency text.
+	 */
+	private static String formatLatency(long[] metrics, int histogram) {
+		long count = metrics[histogram + HISTOGRAM_COUNT];
+		long mean = (0 == count) ? 0 : metrics[histogram + HISTOGRAM_SUM] / count;
+
+		return "mean " + mean + " ns, max "
+				+ metrics[histogram + HISTOGRAM_MAX] + " ns";
+	}
+
 	/**
 	 * Abstract async echo task.
 	 */
@@ -130,6 +219,7 @@ public abstract class AbstractEchoActivity extends Activity implements
 
 		public void run() {
 			onBackground();
+			logMetrics();
 			handler.post(new Runnable() {
 				public void run() {
 					onPostExecute();
@@ -151,6 +241,10 @@ public abstract class AbstractEchoActivity extends Activity implements
 	}
 
 	static {
-		System.loadLibrary("Echo");
+		if (BuildConfig.JNI_SINGLE_LIBRARY) {
+			System.loadLibrary("cmakejni");
+		} else {
+			System.loadLibrary("Echo");
+		}
 	}
 }
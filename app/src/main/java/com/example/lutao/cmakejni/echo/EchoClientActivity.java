@@ -5,6 +5,9 @@ import android.widget.EditText;
 
 import com.example.lutao.cmakejni.R;
 
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+
 /**
  * Echo client.
  * @author Onur Cinar
@@ -62,6 +65,89 @@ public class EchoClientActivity extends AbstractEchoActivity {
 	private native void nativeStartUdpClient(String ip, int port, String message)
 			throws Exception;
 
+	/**
+	 * Sends the remaining bytes of the given direct buffer to the TCP server
+	 * with the given IP address and port number, and receives the echo into
+	 * the remaining space of the reply buffer. Both positions are advanced.
+	 * @param ip
+	 * @param port
+	 * @param message direct buffer.
+	 * @param reply direct buffer.
+	 * @return received size.
+	 * @throws Exception
+	 */
+	private native int nativeSendTcpBuffer(String ip, int port,
+			ByteBuffer message, ByteBuffer reply) throws Exception;
+
+	/**
+	 * Sends the remaining bytes of the given direct buffer as a datagram to
+	 * the UDP server with the given IP address and port number, and receives
+	 * the reply into the remaining space of the reply buffer. Both positions
+	 * are advanced.
+	 * @param ip
+	 * @param port
+	 * @param message direct buffer.
+	 * @param reply direct buffer.
+	 * @return received size.
+	 * @throws Exception
+	 */
+	private native int nativeSendUdpBuffer(String ip, int port,
+			ByteBuffer message, ByteBuffer reply) throws Exception;
+
+	/**
+	 * Sends the message from a direct buffer to the TCP server and logs
+	 * the echo.
+	 * @param ip
+	 * @param port
+	 * @param message
+	 * @throws Exception
+	 */
+	private void startTcpBufferClient(String ip, int port, String message)
+			throws Exception {
+		Charset charset = Charset.forName("UTF-8");
+		byte[] messageBytes = message.getBytes(charset);
+
+		ByteBuffer messageBuffer = ByteBuffer.allocateDirect(messageBytes.length);
+		messageBuffer.put(messageBytes);
+		messageBuffer.flip();
+
+		ByteBuffer replyBuffer = ByteBuffer.allocateDirect(messageBytes.length);
+		nativeSendTcpBuffer(ip, port, messageBuffer, replyBuffer);
+		replyBuffer.flip();
+
+		byte[] replyBytes = new byte[replyBuffer.remaining()];
+		replyBuffer.get(replyBytes);
+		logMessage("Echo: " + new String(replyBytes, charset));
+	}
+
+	/**
+	 * Opens a persistent TCP session with the given server IP address and
+	 * port number.
+	 * @param ip
+	 * @param port
+	 * @return session handle.
+	 * @throws Exception
+	 */
+	private native long nativeOpenTcpSession(String ip, int port)
+			throws Exception;
+
+	/**
+	 * Sends the given messages through the session, pipelined over the same
+	 * connection, and returns their echoes.
+	 * @param session
+	 * @param messages
+	 * @return echoed messages.
+	 * @throws Exception
+	 */
+	private native String[] nativeSendTcpSession(long session, String[] messages)
+			throws Exception;
+
+	/**
+	 * Closes the given TCP session.
+	 * @param session
+	 */
+	private native void nativeCloseTcpSession(long session);
+
 	/**
 	 * Client task.
 	 */
@@ -90,11 +176,27 @@ public class EchoClientActivity extends AbstractEchoActivity {
 		protected void onBackground() {
 			logMessage("Starting client.");
 
+			long session = 0;
+
 			try {
-				 nativeStartTcpClient(ip, port, message);
+				// Each line is a message, all sent over one connection
+				session = nativeOpenTcpSession(ip, port);
+
+				String[] echoes = nativeSendTcpSession(session,
+						message.split("\n"));
+
+				for (String echo : echoes) {
+					logMessage("Echo: " + echo);
+				}
+//				nativeStartTcpClient(ip, port, message);
+//				startTcpBufferClient(ip, port, message);
 //				nativeStartUdpClient(ip, port, message);
 			} catch (Throwable e) {
 				logMessage(e.getMessage());
+			} finally {
+				if (0 != session) {
+					nativeCloseTcpSession(session);
+				}
 			}
 
 			logMessage("Client terminated.");
@@ -37,6 +37,59 @@ public class EchoServerActivity extends AbstractEchoActivity {
 	 */
 	private native void nativeStartUdpServer(int port) throws Exception;
 
+	/**
+	 * Starts the event driven TCP server on the given port. Serves
+	 * all clients concurrently from a single thread.
+	 * @param port
+	 * @throws Exception
+	 */
+	private native void nativeStartTcpReactorServer(int port) throws Exception;
+
+	/**
+	 * Starts the event driven TCP server of the framed echo protocol on
+	 * the given port. Sends each frame back with its own type.
+	 * @param port
+	 * @throws Exception
+	 */
+	private native void nativeStartTcpFramedServer(int port) throws Exception;
+
+	/**
+	 * Starts the given number of event driven TCP servers sharing the
+	 * given port, each on its own thread pinned to a CPU. Fails if the
+	 * port is already in use.
+	 * @param port
+	 * @param threads reactor count, or zero for one per CPU, at most 64.
+	 * @throws Exception
+	 */
+	private native void nativeStartTcpMultiReactorServer(int port, int threads)
+			throws Exception;
+
+	/**
+	 * Starts the UDP server on the given port. Keeps echoing, receiving
+	 * and sending back up to the given number of datagrams per call.
+	 * @param port
+	 * @param batchSize datagrams per call, or zero for the default.
+	 * @throws Exception
+	 */
+	private native void nativeStartUdpBatchServer(int port, int batchSize)
+			throws Exception;
+
+	/**
+	 * Starts the TCP server on the given port using io_uring. Serves
+	 * all clients from a single thread with multishot accept and
+	 * receive, sending back from registered buffers.
+	 * @param port
+	 * @throws Exception
+	 */
+	private native void nativeStartTcpUringServer(int port) throws Exception;
+
+	/**
+	 * Starts the UDP server on the given port using io_uring.
+	 * @param port
+	 * @throws Exception
+	 */
+	private native void nativeStartUdpUringServer(int port) throws Exception;
+
 	/**
 	 * Server task.
 	 */
@@ -56,8 +109,14 @@ public class EchoServerActivity extends AbstractEchoActivity {
 			logMessage("Starting server.");
 
 			try {
-				 nativeStartTcpServer(port);
+				 nativeStartTcpReactorServer(port);
+//				nativeStartTcpMultiReactorServer(port, 0);
+//				nativeStartTcpFramedServer(port);
+//				nativeStartTcpServer(port);
 //				nativeStartUdpServer(port);
+//				nativeStartUdpBatchServer(port, 0);
+//				nativeStartTcpUringServer(port);
+//				nativeStartUdpUringServer(port);
 			} catch (Exception e) {
 				logMessage(e.getMessage());
 			}
@@ -3,6 +3,7 @@ package com.example.lutao.cmakejni.echo;
 import java.io.File;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.nio.ByteBuffer;
 
 import android.net.LocalSocket;
 import android.net.LocalSocketAddress;
@@ -72,6 +73,47 @@ public class LocalEchoActivity extends AbstractEchoActivity {
 	 */
 	private native void nativeStartLocalServer(String name) throws Exception;
 
+	/**
+	 * Starts the Local UNIX socket server binded to given name using
+	 * io_uring. Serves all clients from a single thread.
+	 * @param name
+	 * @throws Exception
+	 */
+	private native void nativeStartLocalUringServer(String name)
+			throws Exception;
+
+	/**
+	 * Starts the shared memory server. Clients connect to the Local
+	 * UNIX socket binded to given name to receive the shared memory,
+	 * messages then go through the shared memory rings.
+	 * @param name
+	 * @throws Exception
+	 */
+	private native void nativeStartLocalShmServer(String name)
+			throws Exception;
+
+	/**
+	 * Starts the shared memory client.
+	 * @param name
+	 * @param message
+	 * @throws Exception
+	 */
+	private native void nativeStartLocalShmClient(String name, String message)
+			throws Exception;
+
+	/**
+	 * Sends the remaining bytes of the given direct buffer to the Local
+	 * UNIX socket server binded to given name, and receives the echo into
+	 * the remaining space of the reply buffer. Both positions are advanced.
+	 * @param name
+	 * @param message direct buffer.
+	 * @param reply direct buffer.
+	 * @return received size.
+	 * @throws Exception
+	 */
+	private native int nativeSendLocalBuffer(String name, ByteBuffer message,
+			ByteBuffer reply) throws Exception;
+
 	/**
 	 * Starts the local UNIX socket client.
 	 * @param port
@@ -147,6 +189,8 @@ public class LocalEchoActivity extends AbstractEchoActivity {
 
 			try {
 				nativeStartLocalServer(name);
+//				nativeStartLocalUringServer(name);
+//				nativeStartLocalShmServer(name);
 			} catch (Exception e) {
 				logMessage(e.getMessage());
 			}
@@ -180,6 +224,7 @@ public class LocalEchoActivity extends AbstractEchoActivity {
 
 			try {
 				startLocalClient(name, message);
+//				nativeStartLocalShmClient(name, message);
 			} catch (Exception e) {
 				logMessage(e.getMessage());
 			}
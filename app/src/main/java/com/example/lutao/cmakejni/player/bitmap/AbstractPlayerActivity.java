@@ -0,0 +1,136 @@
+package com.example.lutao.cmakejni.player.bitmap;
+
+import android.app.Activity;
+import android.app.AlertDialog;
+
+import java.io.IOException;
+
+import com.example.lutao.cmakejni.BuildConfig;
+import com.example.lutao.cmakejni.R;
+
+/**
+ * Abstract player activity object.
+ */
+public abstract class AbstractPlayerActivity extends Activity {
+	/** Video file name extra. */
+	public static final String EXTRA_FILE_NAME =
+			"com.example.lutao.cmakejni.player.bitmap.EXTRA_FILE_NAME";
+
+	/** Frame cache statistics, indexes of the snapshot. */
+	public static final int CACHE_HITS = 0;
+	public static final int CACHE_MISSES = 1;
+	public static final int CACHE_EVICTIONS = 2;
+	public static final int CACHE_FRAMES = 3;
+	public static final int CACHE_BYTES = 4;
+	public static final int CACHE_STATS_SIZE = 5;
+
+	/** Native video player handle. */
+	protected long avi = 0;
+
+	protected void onStart() {
+		super.onStart();
+
+		try {
+			avi = open(getFileName());
+		} catch (IOException e) {
+			new AlertDialog.Builder(this)
+					.setTitle(R.string.error_alert_title)
+					.setMessage(e.getMessage())
+					.show();
+		}
+	}
+
+	protected void onStop() {
+		super.onStop();
+
+		if (0 != avi) {
+			close(avi);
+			avi = 0;
+		}
+	}
+
+	/**
+	 * Gets the video file name.
+	 * @return file name.
+	 */
+	protected String getFileName() {
+		return getIntent().getExtras().getString(EXTRA_FILE_NAME);
+	}
+
+	/**
+	 * Opens the given uncompressed AVI or YUV4MPEG2 video file and
+	 * parses the index of its frames.
+	 * @param fileName
+	 * @return file handle.
+	 * @throws IOException
+	 */
+	protected native static long open(String fileName) throws IOException;
+
+	/**
+	 * Gets the video width.
+	 * @param avi file handle.
+	 * @return width in pixels.
+	 */
+	protected native static int getWidth(long avi);
+
+	/**
+	 * Gets the video height.
+	 * @param avi file handle.
+	 * @return height in pixels.
+	 */
+	protected native static int getHeight(long avi);
+
+	/**
+	 * Gets the video frame rate.
+	 * @param avi file handle.
+	 * @return frames per second.
+	 */
+	protected native static double getFrameRate(long avi);
+
+	/**
+	 * Gets the number of video frames.
+	 * @param avi file handle.
+	 * @return frame count.
+	 */
+	protected native static int getFrameCount(long avi);
+
+	/**
+	 * Makes the given frame the next one to render. Frames rendered
+	 * right after a recent seek are served from the frame cache. May
+	 * be called from any thread, the next render applies it.
+	 * @param avi file handle.
+	 * @param frame frame number.
+	 * @throws IOException
+	 */
+	protected native static void seek(long avi, int frame) throws IOException;
+
+	/**
+	 * Sets the memory budget of the frame cache, 64 MiB by default.
+	 * May be called from any thread, the next render applies it.
+	 * @param avi file handle.
+	 * @param size budget in bytes, zero disables the cache.
+	 */
+	protected native static void setCacheSize(long avi, long size);
+
+	/**
+	 * Gets a snapshot of the frame cache statistics since the video
+	 * is opened.
+	 * @param avi file handle.
+	 * @return hits, misses, evictions, cached frames and bytes.
+	 */
+	protected native static long[] getCacheStats(long avi);
+
+	/**
+	 * Stops the decode thread and closes the video file.
+	 * @param avi file handle.
+	 */
+	protected native static void close(long avi);
+
+	static {
+		if (BuildConfig.JNI_SINGLE_LIBRARY) {
+			System.loadLibrary("cmakejni");
+		} else {
+			System.loadLibrary("BitmapPlayer");
+		}
+	}
+}
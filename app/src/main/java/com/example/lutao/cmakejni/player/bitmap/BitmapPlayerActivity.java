@@ -0,0 +1,158 @@
+package com.example.lutao.cmakejni.player.bitmap;
+
+import android.app.AlertDialog;
+import android.graphics.Bitmap;
+import android.graphics.Canvas;
+import android.os.Bundle;
+import android.view.SurfaceHolder;
+import android.view.SurfaceView;
+import android.view.View;
+
+import java.io.IOException;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+import com.example.lutao.cmakejni.R;
+
+/**
+ * AVI player through bitmaps.
+ */
+public class BitmapPlayerActivity extends AbstractPlayerActivity {
+	/** Is playing. */
+	private final AtomicBoolean isPlaying = new AtomicBoolean();
+
+	/** Surface holder. */
+	private SurfaceHolder surfaceHolder;
+
+	/** Render thread. */
+	private Thread renderThread;
+
+	public void onCreate(Bundle savedInstanceState) {
+		super.onCreate(savedInstanceState);
+		setContentView(R.layout.activity_bitmap);
+
+		SurfaceView surfaceView = (SurfaceView) findViewById(R.id.surface_view);
+
+		surfaceHolder = surfaceView.getHolder();
+		surfaceHolder.addCallback(surfaceHolderCallback);
+
+		// Tapping the video replays it from the first frame
+		surfaceView.setOnClickListener(new View.OnClickListener() {
+			public void onClick(View view) {
+				replay();
+			}
+		});
+	}
+
+	protected void onStop() {
+		// The file is closed once the render thread is done with it
+		stopRendering();
+
+		super.onStop();
+	}
+
+	/**
+	 * Starts the render thread if the video is open.
+	 */
+	private void startRendering() {
+		if ((0 != avi) && (null == renderThread)) {
+			isPlaying.set(true);
+
+			renderThread = new Thread(renderer, "BitmapRenderer");
+			renderThread.start();
+		}
+	}
+
+	/**
+	 * Stops the render thread and waits for it.
+	 */
+	private void stopRendering() {
+		isPlaying.set(false);
+
+		if (null != renderThread) {
+			try {
+				renderThread.join();
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+
+			renderThread = null;
+		}
+	}
+
+	/**
+	 * Replays the video from the first frame. The seek is applied by
+	 * the render thread, which is restarted if it reached the end.
+	 */
+	private void replay() {
+		if (0 == avi) {
+			return;
+		}
+
+		try {
+			seek(avi, 0);
+		} catch (IOException e) {
+			// The first frame is always in range
+			return;
+		}
+
+		if ((null != renderThread) && !renderThread.isAlive()) {
+			stopRendering();
+			startRendering();
+		}
+	}
+
+	/** Surface holder callback. */
+	private final SurfaceHolder.Callback surfaceHolderCallback = new SurfaceHolder.Callback() {
+		public void surfaceChanged(SurfaceHolder holder, int format,
+				int width, int height) {
+		}
+
+		public void surfaceCreated(SurfaceHolder holder) {
+			startRendering();
+		}
+
+		public void surfaceDestroyed(SurfaceHolder holder) {
+			stopRendering();
+		}
+	};
+
+	/** Renderer, paced by the native player. */
+	private final Runnable renderer = new Runnable() {
+		public void run() {
+			Bitmap bitmap = Bitmap.createBitmap(getWidth(avi),
+					getHeight(avi), Bitmap.Config.ARGB_8888);
+
+			try {
+				while (isPlaying.get() && render(avi, bitmap)) {
+					Canvas canvas = surfaceHolder.lockCanvas();
+					if (null != canvas) {
+						canvas.drawBitmap(bitmap, 0, 0, null);
+						surfaceHolder.unlockCanvasAndPost(canvas);
+					}
+				}
+			} catch (final IOException e) {
+				runOnUiThread(new Runnable() {
+					public void run() {
+						new AlertDialog.Builder(BitmapPlayerActivity.this)
+								.setTitle(R.string.error_alert_title)
+								.setMessage(e.getMessage())
+								.show();
+					}
+				});
+			} finally {
+				bitmap.recycle();
+			}
+		}
+	};
+
+	/**
+	 * Renders the next frame into the given bitmap. Waits until the
+	 * frame is decoded and its presentation time is reached.
+	 * @param avi file handle.
+	 * @param bitmap RGBA_8888 or RGB_565 bitmap.
+	 * @return false at the end of the video.
+	 * @throws IOException
+	 */
+	private native static boolean render(long avi, Bitmap bitmap)
+			throws IOException;
+}
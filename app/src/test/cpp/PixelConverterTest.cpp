@@ -0,0 +1,383 @@
+#include "PixelConverter.h"
+
+// printf
+#include <stdio.h>
+
+// memcmp
+#include <string.h>
+
+// uint8_t, uint16_t, uint32_t
+#include <stdint.h>
+
+// std::vector
+#include <vector>
+
+/*
+ * Checks the scalar kernels against known pixels, then every SIMD
+ * kernel the CPU supports against the scalar ones, bit for bit.
+ */
+
+// Widths around the vector sizes and load limits of the kernels
+static const int gWidths[] =
+{
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 15, 16, 17, 18, 19, 20, 31, 32,
+    33, 34, 35, 47, 48, 63, 64, 65, 127, 1919, 1920
+};
+
+static const int gHeights[] = { 1, 2, 3, 4, 17 };
+
+// Bitmap bytes no conversion writes, after each row and around
+// the converted area
+#define PADDING_BYTE 0xA5
+#define BITMAP_PADDING 12
+
+static const char* gIsaNames[PIXEL_ISA_COUNT] =
+{
+    "scalar",
+    "SSE4.1",
+    "AVX2",
+    "NEON",
+};
+
+static int gFailures = 0;
+
+static uint32_t gRandomState = 12345;
+
+/**
+ * Gets the next pseudo random byte, the same ones on every run.
+ *
+ * @return byte.
+ */
+static uint8_t NextRandomByte()
+{
+    gRandomState = (gRandomState * 1103515245) + 12345;
+
+    return (uint8_t) (gRandomState >> 16);
+}
+
+/**
+ * Makes the format of a frame, laid out as in the video files.
+ *
+ * @param pixelFormat pixel format.
+ * @param width width.
+ * @param height height.
+ * @param bottomUp rows are stored from the bottom.
+ * @return frame format.
+ */
+static VideoFormat MakeFormat(
+        VideoPixelFormat pixelFormat,
+        int width,
+        int height,
+        bool bottomUp)
+{
+    VideoFormat format = VideoFormat();
+    format.width = width;
+    format.height = height;
+    format.frameRate = 25.0;
+    format.pixelFormat = pixelFormat;
+    format.bottomUp = bottomUp;
+
+    switch (pixelFormat)
+    {
+    case VIDEO_FORMAT_BGR24:
+        format.stride = ((width * 3) + 3) & ~3;
+        format.frameSize = format.stride * height;
+        break;
+
+    case VIDEO_FORMAT_RGB565:
+        format.stride = ((width * 2) + 3) & ~3;
+        format.frameSize = format.stride * height;
+        break;
+
+    case VIDEO_FORMAT_I420:
+        format.stride = width;
+        format.frameSize = (width * height)
+                + (2 * ((width + 1) / 2) * ((height + 1) / 2));
+        break;
+    }
+
+    return format;
+}
+
+/**
+ * Converts the given frame into a new bitmap filled with the
+ * padding bytes.
+ *
+ * @param format frame format.
+ * @param frame frame data.
+ * @param bitmapFormat bitmap format.
+ * @param width bitmap width.
+ * @param height bitmap height.
+ * @param isa instruction set.
+ * @return bitmap pixels, rows padded.
+ */
+static std::vector<uint8_t> Convert(
+        const VideoFormat& format,
+        const std::vector<uint8_t>& frame,
+        BitmapFormat bitmapFormat,
+        int width,
+        int height,
+        PixelIsa isa)
+{
+    size_t pixelSize = (BITMAP_FORMAT_RGBA_8888 == bitmapFormat) ? 4 : 2;
+    size_t stride = (width * pixelSize) + BITMAP_PADDING;
+
+    // 16 bit pixels are aligned as in the Android bitmaps
+    std::vector<uint8_t> pixels(stride * height, PADDING_BYTE);
+
+    VideoBitmap bitmap;
+    bitmap.width = width;
+    bitmap.height = height;
+    bitmap.stride = stride;
+    bitmap.format = bitmapFormat;
+    bitmap.pixels = pixels.data();
+
+    ConvertVideoFrame(&format, (const char*) frame.data(), &bitmap, isa);
+
+    return pixels;
+}
+
+/**
+ * Records a failed check.
+ *
+ * @param isa instruction set.
+ * @param name check name.
+ * @param format frame format.
+ * @param bitmapFormat bitmap format.
+ */
+static void Fail(
+        PixelIsa isa,
+        const char* name,
+        const VideoFormat& format,
+        BitmapFormat bitmapFormat)
+{
+    printf("FAILED %s %s: format %d %dx%d%s to bitmap format %d\n",
+            gIsaNames[isa], name, format.pixelFormat, format.width,
+            format.height, format.bottomUp ? " bottom up" : "",
+            bitmapFormat);
+    gFailures++;
+}
+
+/**
+ * Checks the first pixel of a converted frame.
+ *
+ * @param isa instruction set.
+ * @param format frame format.
+ * @param frame frame data.
+ * @param rgba expected RGBA pixel.
+ * @param rgb565 expected RGB565 pixel.
+ */
+static void CheckPixel(
+        PixelIsa isa,
+        const VideoFormat& format,
+        const std::vector<uint8_t>& frame,
+        const uint8_t* rgba,
+        uint16_t rgb565)
+{
+    std::vector<uint8_t> pixels = Convert(format, frame,
+            BITMAP_FORMAT_RGBA_8888, format.width, format.height, isa);
+    if (0 != memcmp(pixels.data(), rgba, 4))
+    {
+        Fail(isa, "known pixel", format, BITMAP_FORMAT_RGBA_8888);
+    }
+
+    pixels = Convert(format, frame, BITMAP_FORMAT_RGB_565,
+            format.width, format.height, isa);
+    if (0 != memcmp(pixels.data(), &rgb565, 2))
+    {
+        Fail(isa, "known pixel", format, BITMAP_FORMAT_RGB_565);
+    }
+}
+
+/**
+ * Checks single pixels of known colors.
+ *
+ * @param isa instruction set.
+ */
+static void TestKnownPixels(PixelIsa isa)
+{
+    struct YuvPixel
+    {
+        uint8_t yuv[3];
+        uint8_t rgba[4];
+        uint16_t rgb565;
+    };
+
+    // White, black, gray, red, green and blue
+    static const YuvPixel yuvPixels[] =
+    {
+        { { 235, 128, 128 }, { 255, 255, 255, 255 }, 0xFFFF },
+        { { 16, 128, 128 }, { 0, 0, 0, 255 }, 0x0000 },
+        { { 128, 128, 128 }, { 130, 130, 130, 255 }, 0x8410 },
+        { { 81, 90, 240 }, { 254, 0, 0, 255 }, 0xF800 },
+        { { 145, 54, 34 }, { 0, 255, 1, 255 }, 0x07E0 },
+        { { 41, 240, 110 }, { 0, 0, 255, 255 }, 0x001F },
+    };
+
+    VideoFormat format = MakeFormat(VIDEO_FORMAT_I420, 1, 1, false);
+    for (size_t i = 0; i < sizeof(yuvPixels) / sizeof(yuvPixels[0]); i++)
+    {
+        std::vector<uint8_t> frame(yuvPixels[i].yuv, yuvPixels[i].yuv + 3);
+        CheckPixel(isa, format, frame, yuvPixels[i].rgba,
+                yuvPixels[i].rgb565);
+    }
+
+    // Bottom up, the last row is the top one
+    format = MakeFormat(VIDEO_FORMAT_BGR24, 1, 2, true);
+    static const uint8_t bgr[] = { 1, 2, 3, 0, 10, 20, 30, 0 };
+    static const uint8_t bgrRgba[] = { 30, 20, 10, 255 };
+    CheckPixel(isa, format, std::vector<uint8_t>(bgr, bgr + sizeof(bgr)),
+            bgrRgba, 0x18A1);
+
+    // Full intensity stays full when expanded
+    format = MakeFormat(VIDEO_FORMAT_RGB565, 1, 1, true);
+    static const uint8_t rgb565[] = { 0xE0, 0x07, 0, 0 };
+    static const uint8_t rgb565Rgba[] = { 0, 255, 0, 255 };
+    CheckPixel(isa, format,
+            std::vector<uint8_t>(rgb565, rgb565 + sizeof(rgb565)),
+            rgb565Rgba, 0x07E0);
+}
+
+/**
+ * Checks random frames of all sizes and formats against the scalar
+ * kernels, including the bitmap padding.
+ *
+ * @param isa instruction set.
+ */
+static void TestRandomFrames(PixelIsa isa)
+{
+    static const VideoPixelFormat pixelFormats[] =
+    {
+        VIDEO_FORMAT_BGR24,
+        VIDEO_FORMAT_RGB565,
+        VIDEO_FORMAT_I420,
+    };
+
+    static const BitmapFormat bitmapFormats[] =
+    {
+        BITMAP_FORMAT_RGBA_8888,
+        BITMAP_FORMAT_RGB_565,
+    };
+
+    for (size_t p = 0; p < sizeof(pixelFormats) / sizeof(pixelFormats[0]); p++)
+    for (size_t w = 0; w < sizeof(gWidths) / sizeof(gWidths[0]); w++)
+    for (size_t h = 0; h < sizeof(gHeights) / sizeof(gHeights[0]); h++)
+    {
+        VideoFormat format = MakeFormat(pixelFormats[p], gWidths[w],
+                gHeights[h], (VIDEO_FORMAT_I420 != pixelFormats[p]));
+
+        std::vector<uint8_t> frame(format.frameSize);
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            frame[i] = NextRandomByte();
+        }
+
+        for (size_t b = 0; b < sizeof(bitmapFormats) / sizeof(bitmapFormats[0]); b++)
+        {
+            // Same size, then clipped to a narrower and shorter bitmap
+            // and into a bigger one
+            int widths[] = { format.width, (format.width + 1) / 2,
+                    format.width + 5 };
+            int heights[] = { format.height, (format.height + 1) / 2,
+                    format.height + 2 };
+
+            for (int s = 0; s < 3; s++)
+            {
+                std::vector<uint8_t> expected = Convert(format, frame,
+                        bitmapFormats[b], widths[s], heights[s],
+                        PIXEL_ISA_SCALAR);
+                std::vector<uint8_t> actual = Convert(format, frame,
+                        bitmapFormats[b], widths[s], heights[s], isa);
+
+                if (expected != actual)
+                {
+                    Fail(isa, "random frame", format, bitmapFormats[b]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Checks every YUV triplet against the scalar kernels. Each 2x2
+ * block has four of the lumas, 64 blocks of a chroma pair cover
+ * them all, the rows of a frame have all of the blue differences
+ * and each frame has its own red difference.
+ *
+ * @param isa instruction set.
+ */
+static void TestAllYuv(PixelIsa isa)
+{
+    const int blocks = 256 * 64;
+    VideoFormat format = MakeFormat(VIDEO_FORMAT_I420, blocks * 2, 2, false);
+    std::vector<uint8_t> frame(format.frameSize);
+
+    uint8_t* y = frame.data();
+    uint8_t* u = y + (format.width * 2);
+    uint8_t* v = u + blocks;
+
+    for (int block = 0; block < blocks; block++)
+    {
+        uint8_t luma = (uint8_t) ((block / 256) * 4);
+
+        y[block * 2] = luma;
+        y[(block * 2) + 1] = luma + 1;
+        y[format.width + (block * 2)] = luma + 2;
+        y[format.width + (block * 2) + 1] = luma + 3;
+        u[block] = (uint8_t) block;
+    }
+
+    for (int red = 0; red < 256; red++)
+    {
+        memset(v, red, blocks);
+
+        for (int b = 0; b < 2; b++)
+        {
+            BitmapFormat bitmapFormat = (0 == b)
+                    ? BITMAP_FORMAT_RGBA_8888 : BITMAP_FORMAT_RGB_565;
+
+            std::vector<uint8_t> expected = Convert(format, frame,
+                    bitmapFormat, format.width, format.height,
+                    PIXEL_ISA_SCALAR);
+            std::vector<uint8_t> actual = Convert(format, frame,
+                    bitmapFormat, format.width, format.height, isa);
+
+            if (expected != actual)
+            {
+                Fail(isa, "all YUV", format, bitmapFormat);
+                return;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    TestKnownPixels(PIXEL_ISA_SCALAR);
+
+    for (int isa = PIXEL_ISA_SCALAR + 1; isa < PIXEL_ISA_COUNT; isa++)
+    {
+        if (!IsPixelIsaSupported((PixelIsa) isa))
+        {
+            printf("%s kernels are not supported, skipped\n", gIsaNames[isa]);
+            continue;
+        }
+
+        printf("Checking the %s kernels\n", gIsaNames[isa]);
+
+        TestKnownPixels((PixelIsa) isa);
+        TestRandomFrames((PixelIsa) isa);
+        TestAllYuv((PixelIsa) isa);
+    }
+
+    printf("Best instruction set: %s\n", gIsaNames[GetBestPixelIsa()]);
+
+    if (0 != gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include "VideoFile.h"
+
+// printf, snprintf
+#include <stdio.h>
+
+// errno
+#include <errno.h>
+
+// mkstemp
+#include <stdlib.h>
+
+// memcmp, strlen
+#include <string.h>
+
+// write, close, unlink, sysconf
+#include <unistd.h>
+
+// std::string
+#include <string>
+
+/*
+ * Checks the YUV4MPEG2 parsing on small files written next to the
+ * test, including the truncated and malformed trailers.
+ */
+
+// Frame size of the test videos, 4:2:0 so the frames are 3 / 2 of
+// the lumas
+#define TEST_WIDTH 4
+#define TEST_HEIGHT 2
+#define TEST_FRAME_SIZE 12
+
+static int gFailures = 0;
+
+/**
+ * Records a failed check.
+ *
+ * @param name check name.
+ * @param message failure.
+ */
+static void Fail(const char* name, const char* message)
+{
+    printf("FAILED %s: %s\n", name, message);
+    gFailures++;
+}
+
+/**
+ * Makes the stream header line, padded with a comment parameter
+ * to the given length.
+ *
+ * @param length header length, new line included, 0 to not pad.
+ * @return header line.
+ */
+static std::string MakeHeader(size_t length)
+{
+    char header[64];
+    snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F25:1 C420",
+            TEST_WIDTH, TEST_HEIGHT);
+
+    std::string line(header);
+    if (length > line.size() + 3)
+    {
+        line += " X";
+        line.append(length - line.size() - 1, 'x');
+    }
+
+    return line + "\n";
+}
+
+/**
+ * Makes a frame with its header line, all bytes are the given one.
+ *
+ * @param value frame byte.
+ * @return frame.
+ */
+static std::string MakeFrame(char value)
+{
+    return "FRAME\n" + std::string(TEST_FRAME_SIZE, value);
+}
+
+/**
+ * Writes the given video into a new file and opens it.
+ *
+ * @param video file bytes.
+ * @param error error code.
+ * @return video file or NULL if failed.
+ */
+static VideoFile* OpenTestVideo(const std::string& video, std::error_code& error)
+{
+    char path[] = "VideoFileTestXXXXXX";
+    int fd = mkstemp(path);
+    if (-1 == fd)
+    {
+        error.assign(errno, std::system_category());
+        return NULL;
+    }
+
+    bool written = ((ssize_t) video.size()
+            == write(fd, video.data(), video.size()));
+    close(fd);
+
+    // The mapping stays once the file is gone
+    VideoFile* file = written ? OpenVideoFile(path, error) : NULL;
+    unlink(path);
+
+    return file;
+}
+
+/**
+ * Checks that a valid video opens with all of its frames.
+ */
+static void TestValidVideo()
+{
+    std::error_code error;
+    VideoFile* file = OpenTestVideo(MakeHeader(0) + MakeFrame('a')
+            + MakeFrame('b'), error);
+    if (NULL == file)
+    {
+        Fail("valid video", error.message().c_str());
+        return;
+    }
+
+    if (2 != GetVideoFrameCount(file))
+    {
+        Fail("valid video", "frame count");
+    }
+    else
+    {
+        const char* frame = GetVideoFrame(file, 1, error);
+        if ((NULL == frame)
+                || (0 != memcmp(frame, std::string(TEST_FRAME_SIZE, 'b').data(),
+                        TEST_FRAME_SIZE)))
+        {
+            Fail("valid video", "frame data");
+        }
+    }
+
+    CloseVideoFile(file);
+}
+
+/**
+ * Checks that a truncated last frame is dropped.
+ */
+static void TestTruncatedFrame()
+{
+    std::error_code error;
+    VideoFile* file = OpenTestVideo(MakeHeader(0) + MakeFrame('a')
+            + MakeFrame('b').substr(0, 10), error);
+    if (NULL == file)
+    {
+        Fail("truncated frame", error.message().c_str());
+        return;
+    }
+
+    if (1 != GetVideoFrameCount(file))
+    {
+        Fail("truncated frame", "frame count");
+    }
+
+    CloseVideoFile(file);
+}
+
+/**
+ * Checks that trailers shorter than a frame header line are
+ * invalid. The file ends on a page boundary, so comparing past the
+ * short line would read past the end of the mapping.
+ *
+ * @param trailer bytes after the last frame.
+ */
+static void TestShortTrailer(const char* trailer)
+{
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    std::string frame = MakeFrame('a');
+
+    // Frames up to the page, the header is padded with the rest
+    size_t frameCount = (pageSize - MakeHeader(0).size() - strlen(trailer)
+            - 4) / frame.size();
+
+    std::string frames;
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        frames += frame;
+    }
+
+    frames += trailer;
+    std::string video = MakeHeader(pageSize - frames.size()) + frames;
+
+    if (pageSize != video.size())
+    {
+        Fail("short trailer", "video is not a page");
+        return;
+    }
+
+    std::error_code error;
+    VideoFile* file = OpenTestVideo(video, error);
+
+    if (NULL != file)
+    {
+        Fail("short trailer", trailer);
+        CloseVideoFile(file);
+    }
+    else if (PLAYER_ERROR_INVALID_FILE != error)
+    {
+        Fail("short trailer", error.message().c_str());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    TestValidVideo();
+    TestTruncatedFrame();
+    TestShortTrailer("X\n");
+    TestShortTrailer("FRAM\n");
+    TestShortTrailer("FRA");
+
+    if (0 != gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}